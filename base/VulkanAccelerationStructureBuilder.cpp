@@ -0,0 +1,294 @@
+/*
+* Batched acceleration structure builds with compaction
+*
+* Builds are grouped into batches whose scratch requirements fit into the budget. All builds of a batch are recorded
+* with a single vkCmdBuildAccelerationStructuresKHR call, batches are separated by barriers so they can reuse the
+* same scratch memory. The compacted sizes are queried in the same submission, compaction copies are recorded into a
+* second one
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanAccelerationStructureBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "VulkanTools.h"
+
+namespace
+{
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Orders acceleration structure builds and writes (including scratch memory) against following builds and queries
+	void accelerationStructureBarrier(VkCommandBuffer commandBuffer)
+	{
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		memoryBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+vks::AccelerationStructureBuilder::AccelerationStructureBuilder(vks::VulkanDevice* device, VkQueue queue) : device(device), queue(queue)
+{
+	VkDevice logicalDevice = device->logicalDevice;
+	vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR"));
+	vkCreateAccelerationStructureKHR = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCreateAccelerationStructureKHR"));
+	vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkDestroyAccelerationStructureKHR"));
+	vkGetAccelerationStructureBuildSizesKHR = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureBuildSizesKHR"));
+	vkGetAccelerationStructureDeviceAddressKHR = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureDeviceAddressKHR"));
+	vkCmdBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdBuildAccelerationStructuresKHR"));
+	vkCmdWriteAccelerationStructuresPropertiesKHR = reinterpret_cast<PFN_vkCmdWriteAccelerationStructuresPropertiesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdWriteAccelerationStructuresPropertiesKHR"));
+	vkCmdCopyAccelerationStructureKHR = reinterpret_cast<PFN_vkCmdCopyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdCopyAccelerationStructureKHR"));
+
+	// Scratch addresses of the builds in a batch need to be aligned
+	VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+	accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+	VkPhysicalDeviceProperties2 deviceProperties2{};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &accelerationStructureProperties;
+	vkGetPhysicalDeviceProperties2(device->physicalDevice, &deviceProperties2);
+	scratchAlignment = std::max<VkDeviceSize>(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+}
+
+vks::AccelerationStructureBuilder::~AccelerationStructureBuilder()
+{
+	if (scratchBuffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, scratchBuffer, nullptr);
+		vkFreeMemory(device->logicalDevice, scratchMemory, nullptr);
+	}
+}
+
+void vks::AccelerationStructureBuilder::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+	VkBufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &buffer));
+	VkMemoryRequirements memoryRequirements{};
+	vkGetBufferMemoryRequirements(device->logicalDevice, buffer, &memoryRequirements);
+	VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{};
+	memoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = device->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memoryAllocateInfo, nullptr, &memory));
+	VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, buffer, memory, 0));
+}
+
+void vks::AccelerationStructureBuilder::create(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, VkDeviceSize size)
+{
+	createBuffer(size, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR, accelerationStructure.buffer, accelerationStructure.memory);
+	VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
+	accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+	accelerationStructureCreateInfo.buffer = accelerationStructure.buffer;
+	accelerationStructureCreateInfo.size = size;
+	accelerationStructureCreateInfo.type = type;
+	VK_CHECK_RESULT(vkCreateAccelerationStructureKHR(device->logicalDevice, &accelerationStructureCreateInfo, nullptr, &accelerationStructure.handle));
+	VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
+	accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+	accelerationDeviceAddressInfo.accelerationStructure = accelerationStructure.handle;
+	accelerationStructure.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(device->logicalDevice, &accelerationDeviceAddressInfo);
+	accelerationStructure.size = size;
+}
+
+void vks::AccelerationStructureBuilder::destroy(AccelerationStructure& accelerationStructure)
+{
+	if (accelerationStructure.handle != VK_NULL_HANDLE) {
+		vkDestroyAccelerationStructureKHR(device->logicalDevice, accelerationStructure.handle, nullptr);
+	}
+	if (accelerationStructure.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, accelerationStructure.buffer, nullptr);
+	}
+	if (accelerationStructure.memory != VK_NULL_HANDLE) {
+		vkFreeMemory(device->logicalDevice, accelerationStructure.memory, nullptr);
+	}
+	accelerationStructure = {};
+}
+
+uint64_t vks::AccelerationStructureBuilder::getBufferDeviceAddress(VkBuffer buffer)
+{
+	VkBufferDeviceAddressInfoKHR bufferDeviceAddressInfo{};
+	bufferDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	bufferDeviceAddressInfo.buffer = buffer;
+	return vkGetBufferDeviceAddressKHR(device->logicalDevice, &bufferDeviceAddressInfo);
+}
+
+void vks::AccelerationStructureBuilder::reserveScratch(VkDeviceSize size)
+{
+	if (size <= scratchPoolSize) {
+		return;
+	}
+	if (scratchBuffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, scratchBuffer, nullptr);
+		vkFreeMemory(device->logicalDevice, scratchMemory, nullptr);
+	}
+	createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scratchBuffer, scratchMemory);
+	scratchAddress = getBufferDeviceAddress(scratchBuffer);
+	scratchPoolSize = size;
+}
+
+void vks::AccelerationStructureBuilder::add(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags)
+{
+	assert(geometries.size() == buildRanges.size());
+	PendingBuild pendingBuild;
+	pendingBuild.target = &accelerationStructure;
+	pendingBuild.type = type;
+	pendingBuild.flags = flags;
+	pendingBuild.geometries = geometries;
+	pendingBuild.buildRanges = buildRanges;
+	pendingBuild.scratchSize = 0;
+	pendingBuilds.push_back(pendingBuild);
+}
+
+void vks::AccelerationStructureBuilder::add(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges)
+{
+	add(accelerationStructure, type, geometries, buildRanges, defaultFlags);
+}
+
+void vks::AccelerationStructureBuilder::build()
+{
+	if (pendingBuilds.empty()) {
+		return;
+	}
+	auto tStart = std::chrono::high_resolution_clock::now();
+	statistics = {};
+	statistics.structureCount = static_cast<uint32_t>(pendingBuilds.size());
+
+	// Create the structures at their build size
+	for (auto& pendingBuild : pendingBuilds) {
+		VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
+		buildGeometryInfo.type = pendingBuild.type;
+		buildGeometryInfo.flags = pendingBuild.flags;
+		buildGeometryInfo.geometryCount = static_cast<uint32_t>(pendingBuild.geometries.size());
+		buildGeometryInfo.pGeometries = pendingBuild.geometries.data();
+		std::vector<uint32_t> maxPrimitiveCounts(pendingBuild.buildRanges.size());
+		for (size_t i = 0; i < pendingBuild.buildRanges.size(); i++) {
+			maxPrimitiveCounts[i] = pendingBuild.buildRanges[i].primitiveCount;
+		}
+		VkAccelerationStructureBuildSizesInfoKHR buildSizesInfo = vks::initializers::accelerationStructureBuildSizesInfoKHR();
+		vkGetAccelerationStructureBuildSizesKHR(device->logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildGeometryInfo, maxPrimitiveCounts.data(), &buildSizesInfo);
+		create(*pendingBuild.target, pendingBuild.type, buildSizesInfo.accelerationStructureSize);
+		pendingBuild.scratchSize = alignUp(buildSizesInfo.buildScratchSize, scratchAlignment);
+		statistics.buildSize += buildSizesInfo.accelerationStructureSize;
+	}
+
+	// Split into batches that fit into the scratch budget, a single build larger than the budget gets a batch of its own
+	std::vector<size_t> batchStarts;
+	VkDeviceSize batchScratchSize = 0;
+	VkDeviceSize requiredScratchSize = 0;
+	for (size_t i = 0; i < pendingBuilds.size(); i++) {
+		if (batchStarts.empty() || (batchScratchSize + pendingBuilds[i].scratchSize > scratchBudget)) {
+			batchStarts.push_back(i);
+			batchScratchSize = 0;
+		}
+		batchScratchSize += pendingBuilds[i].scratchSize;
+		requiredScratchSize = std::max(requiredScratchSize, batchScratchSize);
+	}
+	batchStarts.push_back(pendingBuilds.size());
+	reserveScratch(requiredScratchSize);
+	statistics.batchCount = static_cast<uint32_t>(batchStarts.size() - 1);
+	statistics.scratchSize = scratchPoolSize;
+
+	std::vector<PendingBuild*> compactedBuilds;
+	for (auto& pendingBuild : pendingBuilds) {
+		if (pendingBuild.flags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR) {
+			compactedBuilds.push_back(&pendingBuild);
+		}
+	}
+
+	VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	for (size_t batch = 0; batch + 1 < batchStarts.size(); batch++) {
+		std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildGeometryInfos;
+		std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> buildRangeInfos;
+		VkDeviceSize scratchOffset = 0;
+		for (size_t i = batchStarts[batch]; i < batchStarts[batch + 1]; i++) {
+			PendingBuild& pendingBuild = pendingBuilds[i];
+			VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
+			buildGeometryInfo.type = pendingBuild.type;
+			buildGeometryInfo.flags = pendingBuild.flags;
+			buildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+			buildGeometryInfo.dstAccelerationStructure = pendingBuild.target->handle;
+			buildGeometryInfo.geometryCount = static_cast<uint32_t>(pendingBuild.geometries.size());
+			buildGeometryInfo.pGeometries = pendingBuild.geometries.data();
+			buildGeometryInfo.scratchData.deviceAddress = scratchAddress + scratchOffset;
+			buildGeometryInfos.push_back(buildGeometryInfo);
+			buildRangeInfos.push_back(pendingBuild.buildRanges.data());
+			scratchOffset += pendingBuild.scratchSize;
+		}
+		if (batch > 0) {
+			// The previous batch used the same scratch memory
+			accelerationStructureBarrier(commandBuffer);
+		}
+		vkCmdBuildAccelerationStructuresKHR(commandBuffer, static_cast<uint32_t>(buildGeometryInfos.size()), buildGeometryInfos.data(), buildRangeInfos.data());
+	}
+
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	if (!compactedBuilds.empty()) {
+		VkQueryPoolCreateInfo queryPoolCreateInfo{};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+		queryPoolCreateInfo.queryCount = static_cast<uint32_t>(compactedBuilds.size());
+		VK_CHECK_RESULT(vkCreateQueryPool(device->logicalDevice, &queryPoolCreateInfo, nullptr, &queryPool));
+		std::vector<VkAccelerationStructureKHR> handles;
+		for (auto compactedBuild : compactedBuilds) {
+			handles.push_back(compactedBuild->target->handle);
+		}
+		accelerationStructureBarrier(commandBuffer);
+		vkCmdResetQueryPool(commandBuffer, queryPool, 0, queryPoolCreateInfo.queryCount);
+		vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, static_cast<uint32_t>(handles.size()), handles.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
+	}
+	device->flushCommandBuffer(commandBuffer, queue);
+
+	statistics.compactedSize = statistics.buildSize;
+	if (queryPool != VK_NULL_HANDLE) {
+		compact(compactedBuilds, queryPool);
+		vkDestroyQueryPool(device->logicalDevice, queryPool, nullptr);
+	}
+	pendingBuilds.clear();
+
+	statistics.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+	if (verbose) {
+		std::cout << "Built " << statistics.structureCount << " acceleration structure(s) in " << statistics.batchCount << " batch(es) in " << statistics.buildTime << " ms, "
+			<< statistics.buildSize / 1024 << " KB before and " << statistics.compactedSize / 1024 << " KB after compaction, "
+			<< statistics.scratchSize / 1024 << " KB scratch memory" << std::endl;
+	}
+}
+
+void vks::AccelerationStructureBuilder::compact(const std::vector<PendingBuild*>& builds, VkQueryPool queryPool)
+{
+	std::vector<VkDeviceSize> compactedSizes(builds.size());
+	VK_CHECK_RESULT(vkGetQueryPoolResults(device->logicalDevice, queryPool, 0, static_cast<uint32_t>(builds.size()), compactedSizes.size() * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+	std::vector<AccelerationStructure> sources(builds.size());
+	VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	for (size_t i = 0; i < builds.size(); i++) {
+		AccelerationStructure& target = *builds[i]->target;
+		// Keep structures that wouldn't get any smaller
+		if ((compactedSizes[i] == 0) || (compactedSizes[i] >= target.size)) {
+			continue;
+		}
+		statistics.compactedSize -= target.size - compactedSizes[i];
+		sources[i] = target;
+		create(target, builds[i]->type, compactedSizes[i]);
+		VkCopyAccelerationStructureInfoKHR copyInfo{};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+		copyInfo.src = sources[i].handle;
+		copyInfo.dst = target.handle;
+		copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+		vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+	}
+	device->flushCommandBuffer(commandBuffer, queue);
+	for (auto& source : sources) {
+		destroy(source);
+	}
+}
@@ -0,0 +1,107 @@
+/*
+* Batched acceleration structure builds with compaction
+*
+* Collects acceleration structure builds and records them with as few vkCmdBuildAccelerationStructuresKHR calls as
+* possible. Scratch memory for all builds of a batch is sub-allocated from a single pool that is kept between builds.
+* Structures built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR are compacted afterwards, based on
+* the compacted sizes queried from the device
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	struct AccelerationStructure {
+		VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+		uint64_t deviceAddress = 0;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+	};
+
+	class AccelerationStructureBuilder
+	{
+	public:
+		/** @brief Statistics of the last call to build */
+		struct Statistics {
+			uint32_t structureCount = 0;
+			uint32_t batchCount = 0;
+			// Size of all structures as built and after compaction (structures that are not compacted count with their build size)
+			VkDeviceSize buildSize = 0;
+			VkDeviceSize compactedSize = 0;
+			VkDeviceSize scratchSize = 0;
+			double buildTime = 0.0;
+		};
+
+		/** @brief Flags used for builds that don't specify their own */
+		VkBuildAccelerationStructureFlagsKHR defaultFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+		/** @brief Upper limit for the scratch pool, builds that need more scratch memory in total are split into several batches */
+		VkDeviceSize scratchBudget = 64 * 1024 * 1024;
+		/** @brief Print the statistics of every build to the console */
+		bool verbose = true;
+		Statistics statistics;
+
+		AccelerationStructureBuilder(vks::VulkanDevice* device, VkQueue queue);
+		~AccelerationStructureBuilder();
+
+		/**
+		* Queues an acceleration structure build, the structure is created and built by the next call to build
+		*
+		* @param accelerationStructure Target structure, must stay valid until build returns (it is replaced by a smaller copy if compacted)
+		* @param type Bottom or top level
+		* @param geometries Geometries of the structure (copied)
+		* @param buildRanges Build range of every geometry (copied)
+		* @param flags Build flags, structures are only compacted with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR
+		*
+		* @note Top level structures reference bottom level structures by device address, which changes with compaction. Build the bottom level structures of a scene first
+		*/
+		void add(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags);
+		void add(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges);
+		/** @brief Builds and compacts all queued structures, waits for the device to finish */
+		void build();
+		void destroy(AccelerationStructure& accelerationStructure);
+		uint64_t getBufferDeviceAddress(VkBuffer buffer);
+
+	private:
+		struct PendingBuild {
+			AccelerationStructure* target;
+			VkAccelerationStructureTypeKHR type;
+			VkBuildAccelerationStructureFlagsKHR flags;
+			std::vector<VkAccelerationStructureGeometryKHR> geometries;
+			std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges;
+			VkDeviceSize scratchSize;
+		};
+
+		vks::VulkanDevice* device;
+		VkQueue queue;
+		std::vector<PendingBuild> pendingBuilds;
+
+		// Shared scratch pool
+		VkBuffer scratchBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory scratchMemory = VK_NULL_HANDLE;
+		VkDeviceSize scratchPoolSize = 0;
+		uint64_t scratchAddress = 0;
+		VkDeviceSize scratchAlignment = 256;
+
+		PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR;
+		PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR;
+		PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR;
+		PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR;
+		PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR;
+		PFN_vkCmdBuildAccelerationStructuresKHR vkCmdBuildAccelerationStructuresKHR;
+		PFN_vkCmdWriteAccelerationStructuresPropertiesKHR vkCmdWriteAccelerationStructuresPropertiesKHR;
+		PFN_vkCmdCopyAccelerationStructureKHR vkCmdCopyAccelerationStructureKHR;
+
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory);
+		void create(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+		void reserveScratch(VkDeviceSize size);
+		void compact(const std::vector<PendingBuild*>& builds, VkQueryPool queryPool);
+	};
+}
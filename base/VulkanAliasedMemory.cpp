@@ -0,0 +1,176 @@
+/*
+* Aliased memory for intermediate render targets
+*
+* Images are placed greedily from large to small, each one at the lowest offset of a compatible allocation that doesn't
+* intersect an already placed image whose pass range overlaps its own
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanAliasedMemory.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	const uint32_t unplaced = std::numeric_limits<uint32_t>::max();
+}
+
+vks::AliasedMemory::AliasedMemory(vks::VulkanDevice* device)
+{
+	assert(device);
+	this->device = device;
+}
+
+vks::AliasedMemory::~AliasedMemory()
+{
+	// Images are owned by the caller, only the memory they are bound to is freed
+	for (auto& block : blocks) {
+		vkFreeMemory(device->logicalDevice, block.memory, nullptr);
+	}
+}
+
+void vks::AliasedMemory::addImage(VkImage image, uint32_t firstPass, uint32_t lastPass, bool transient)
+{
+	assert(firstPass <= lastPass);
+	Image entry{};
+	entry.image = image;
+	entry.firstPass = firstPass;
+	entry.lastPass = lastPass;
+	entry.block = unplaced;
+	vkGetImageMemoryRequirements(device->logicalDevice, image, &entry.memReqs);
+	// Lazily allocated memory may only be bound to transient images and is usually only available on tile based GPUs
+	VkBool32 lazyMemoryFound = VK_FALSE;
+	if (transient) {
+		entry.memoryTypeIndex = device->getMemoryType(entry.memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazyMemoryFound);
+	}
+	entry.lazy = (lazyMemoryFound == VK_TRUE);
+	if (!entry.lazy) {
+		entry.memoryTypeIndex = device->getMemoryType(entry.memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+	pending.push_back(entry);
+}
+
+VkDeviceSize vks::AliasedMemory::findOffset(const Image& image, uint32_t block) const
+{
+	// Ranges in the block occupied by images alive at the same time as this one
+	std::vector<const Image*> occupied;
+	for (auto& other : pending) {
+		if ((other.block == block) && (other.firstPass <= image.lastPass) && (image.firstPass <= other.lastPass)) {
+			occupied.push_back(&other);
+		}
+	}
+	std::sort(occupied.begin(), occupied.end(), [](const Image* a, const Image* b) { return a->offset < b->offset; });
+
+	VkDeviceSize offset = 0;
+	for (auto other : occupied) {
+		if (offset + image.memReqs.size <= other->offset) {
+			break;
+		}
+		offset = std::max(offset, alignUp(other->offset + other->memReqs.size, image.memReqs.alignment));
+	}
+	return offset;
+}
+
+void vks::AliasedMemory::allocate()
+{
+	if (pending.empty()) {
+		return;
+	}
+
+	// Blocks allocated by earlier calls can't grow anymore, so images are only placed in new blocks
+	const uint32_t firstBlock = static_cast<uint32_t>(blocks.size());
+
+	// Larger images first, smaller images are then more likely to fit into the memory of images with disjoint pass ranges
+	std::vector<size_t> order(pending.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return pending[a].memReqs.size > pending[b].memReqs.size; });
+
+	for (auto index : order) {
+		Image& image = pending[index];
+		VkDeviceSize bestOffset = 0;
+		VkDeviceSize bestGrowth = std::numeric_limits<VkDeviceSize>::max();
+		for (uint32_t i = firstBlock; i < static_cast<uint32_t>(blocks.size()); i++) {
+			if (blocks[i].memoryTypeIndex != image.memoryTypeIndex) {
+				continue;
+			}
+			VkDeviceSize offset = findOffset(image, i);
+			VkDeviceSize end = offset + image.memReqs.size;
+			VkDeviceSize growth = (end > blocks[i].size) ? end - blocks[i].size : 0;
+			if (growth < bestGrowth) {
+				image.block = i;
+				bestOffset = offset;
+				bestGrowth = growth;
+			}
+		}
+		if (image.block == unplaced) {
+			Block block{};
+			block.memoryTypeIndex = image.memoryTypeIndex;
+			block.lazy = image.lazy;
+			blocks.push_back(block);
+			image.block = static_cast<uint32_t>(blocks.size() - 1);
+		}
+		image.offset = bestOffset;
+		blocks[image.block].size = std::max(blocks[image.block].size, image.offset + image.memReqs.size);
+	}
+
+	for (uint32_t i = firstBlock; i < static_cast<uint32_t>(blocks.size()); i++) {
+		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+		memAlloc.allocationSize = blocks[i].size;
+		memAlloc.memoryTypeIndex = blocks[i].memoryTypeIndex;
+		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAlloc, nullptr, &blocks[i].memory));
+	}
+	for (auto& image : pending) {
+		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image.image, blocks[image.block].memory, image.offset));
+		images.push_back(image);
+	}
+	pending.clear();
+}
+
+VkDeviceSize vks::AliasedMemory::getRequiredSize() const
+{
+	VkDeviceSize size = 0;
+	for (auto& image : images) {
+		size += image.memReqs.size;
+	}
+	return size;
+}
+
+VkDeviceSize vks::AliasedMemory::getAllocatedSize() const
+{
+	VkDeviceSize size = 0;
+	for (auto& block : blocks) {
+		size += block.size;
+	}
+	return size;
+}
+
+uint32_t vks::AliasedMemory::getAllocationCount() const
+{
+	return static_cast<uint32_t>(blocks.size());
+}
+
+bool vks::AliasedMemory::usesLazilyAllocatedMemory() const
+{
+	return std::any_of(blocks.begin(), blocks.end(), [](const Block& block) { return block.lazy; });
+}
+
+bool vks::AliasedMemory::isAliased(VkImage a, VkImage b) const
+{
+	auto findImage = [this](VkImage image) {
+		return std::find_if(images.begin(), images.end(), [image](const Image& entry) { return entry.image == image; });
+	};
+	auto imageA = findImage(a);
+	auto imageB = findImage(b);
+	if ((imageA == images.end()) || (imageB == images.end()) || (imageA->block != imageB->block)) {
+		return false;
+	}
+	return (imageA->offset < imageB->offset + imageB->memReqs.size) && (imageB->offset < imageA->offset + imageA->memReqs.size);
+}
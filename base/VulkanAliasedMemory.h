@@ -0,0 +1,91 @@
+/*
+* Aliased memory for intermediate render targets
+*
+* Places images that are only alive during a range of passes of a frame into shared memory allocations, so targets
+* that are never in use at the same time (e.g. a depth buffer only needed for the first pass and a blur target only
+* written by a later pass) occupy the same memory. Transient attachments (never loaded or stored) are placed in lazily
+* allocated memory on implementations that support it, where they are usually kept in tile memory only
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	class AliasedMemory
+	{
+	public:
+		/**
+		* @param device Device to allocate the memory on
+		*/
+		AliasedMemory(vks::VulkanDevice* device);
+		~AliasedMemory();
+
+		/**
+		* Adds an image to be placed in the aliased memory, the image must not be bound to memory yet
+		*
+		* Images whose pass ranges overlap never share memory, the contents of all other images are undefined at the start of
+		* their first pass. So aliased images need to be written before they are read in every frame (initialLayout
+		* VK_IMAGE_LAYOUT_UNDEFINED with a clear or don't care load op), and the first pass using an image needs a dependency
+		* on the writes of the passes before it that used the same memory
+		*
+		* @param image Image to place
+		* @param firstPass Index of the first pass of the frame that writes or reads the image
+		* @param lastPass Index of the last pass of the frame that writes or reads the image
+		* @param transient True if the image has been created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+		*/
+		void addImage(VkImage image, uint32_t firstPass, uint32_t lastPass, bool transient = false);
+
+		/** @brief Allocates the memory and binds all images added since the last call */
+		void allocate();
+
+		/** @brief Size the images would occupy with a dedicated allocation each */
+		VkDeviceSize getRequiredSize() const;
+
+		/** @brief Size of all allocations (lazily allocated memory is included, but may not be backed by physical memory) */
+		VkDeviceSize getAllocatedSize() const;
+
+		/** @brief Number of device memory allocations */
+		uint32_t getAllocationCount() const;
+
+		/** @brief True if any of the allocations uses lazily allocated memory */
+		bool usesLazilyAllocatedMemory() const;
+
+		/** @brief True if the memory ranges of both images (added and allocated) intersect */
+		bool isAliased(VkImage a, VkImage b) const;
+
+	private:
+		struct Image {
+			VkImage image;
+			VkMemoryRequirements memReqs;
+			uint32_t firstPass;
+			uint32_t lastPass;
+			uint32_t memoryTypeIndex;
+			bool lazy;
+			uint32_t block;
+			VkDeviceSize offset;
+		};
+
+		struct Block {
+			uint32_t memoryTypeIndex;
+			bool lazy;
+			VkDeviceSize size;
+			VkDeviceMemory memory;
+		};
+
+		vks::VulkanDevice* device;
+		std::vector<Image> images;
+		std::vector<Block> blocks;
+		// Images not yet bound to memory
+		std::vector<Image> pending;
+
+		VkDeviceSize findOffset(const Image& image, uint32_t block) const;
+	};
+}
@@ -0,0 +1,237 @@
+/*
+* Bounding volume hierarchy built on the host
+*
+* Top-down build: the primitives of a node are binned along each axis by their centroids, the split between two bins
+* with the lowest surface area heuristic cost is chosen and the primitive range is partitioned in place
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanBVH.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cfloat>
+#include <chrono>
+
+namespace
+{
+	struct Bin {
+		vks::bvh::Bounds bounds;
+		uint32_t count = 0;
+	};
+
+	vks::bvh::Bounds emptyBounds()
+	{
+		vks::bvh::Bounds bounds;
+		bounds.min = glm::vec3(FLT_MAX);
+		bounds.max = glm::vec3(-FLT_MAX);
+		return bounds;
+	}
+
+	void grow(vks::bvh::Bounds& bounds, const vks::bvh::Bounds& other)
+	{
+		bounds.min = glm::min(bounds.min, other.min);
+		bounds.max = glm::max(bounds.max, other.max);
+	}
+
+	void grow(vks::bvh::Bounds& bounds, const glm::vec3& point)
+	{
+		bounds.min = glm::min(bounds.min, point);
+		bounds.max = glm::max(bounds.max, point);
+	}
+
+	float surfaceArea(const vks::bvh::Bounds& bounds)
+	{
+		const glm::vec3 extent = bounds.max - bounds.min;
+		if ((extent.x < 0.0f) || (extent.y < 0.0f) || (extent.z < 0.0f)) {
+			return 0.0f;
+		}
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	class Builder
+	{
+	public:
+		const std::vector<vks::bvh::Bounds>& primitiveBounds;
+		std::vector<uint32_t>& primitiveOrder;
+		const vks::bvh::BuildSettings& settings;
+		std::vector<vks::bvh::Node> nodes;
+		std::vector<glm::vec3> centroids;
+		vks::bvh::Statistics statistics;
+
+		Builder(const std::vector<vks::bvh::Bounds>& primitiveBounds, std::vector<uint32_t>& primitiveOrder, const vks::bvh::BuildSettings& settings)
+			: primitiveBounds(primitiveBounds), primitiveOrder(primitiveOrder), settings(settings) {}
+
+		void updateBounds(uint32_t nodeIndex)
+		{
+			vks::bvh::Node& node = nodes[nodeIndex];
+			vks::bvh::Bounds bounds = emptyBounds();
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+				grow(bounds, primitiveBounds[primitiveOrder[i]]);
+			}
+			node.aabbMin = bounds.min;
+			node.aabbMax = bounds.max;
+		}
+
+		// Returns the cost of the best split and its axis and position, FLT_MAX if the centroids can't be separated
+		float findSplit(const vks::bvh::Node& node, uint32_t& splitAxis, float& splitPosition)
+		{
+			vks::bvh::Bounds centroidBounds = emptyBounds();
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+				grow(centroidBounds, centroids[primitiveOrder[i]]);
+			}
+			float bestCost = FLT_MAX;
+			std::vector<Bin> bins(settings.binCount);
+			std::vector<float> leftAreas(settings.binCount - 1);
+			std::vector<uint32_t> leftCounts(settings.binCount - 1);
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				const float boundsMin = centroidBounds.min[axis];
+				const float boundsMax = centroidBounds.max[axis];
+				if (boundsMax <= boundsMin) {
+					continue;
+				}
+				for (auto& bin : bins) {
+					bin.bounds = emptyBounds();
+					bin.count = 0;
+				}
+				const float scale = static_cast<float>(settings.binCount) / (boundsMax - boundsMin);
+				for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+					const uint32_t primitive = primitiveOrder[i];
+					const uint32_t binIndex = std::min(settings.binCount - 1, static_cast<uint32_t>((centroids[primitive][axis] - boundsMin) * scale));
+					bins[binIndex].count++;
+					grow(bins[binIndex].bounds, primitiveBounds[primitive]);
+				}
+				// Sweep from both sides to get the primitive counts and areas on either side of every plane between two bins
+				vks::bvh::Bounds leftBounds = emptyBounds();
+				uint32_t leftCount = 0;
+				for (uint32_t i = 0; i < settings.binCount - 1; i++) {
+					leftCount += bins[i].count;
+					grow(leftBounds, bins[i].bounds);
+					leftCounts[i] = leftCount;
+					leftAreas[i] = surfaceArea(leftBounds);
+				}
+				vks::bvh::Bounds rightBounds = emptyBounds();
+				uint32_t rightCount = 0;
+				for (uint32_t i = settings.binCount - 1; i > 0; i--) {
+					rightCount += bins[i].count;
+					grow(rightBounds, bins[i].bounds);
+					if ((leftCounts[i - 1] == 0) || (rightCount == 0)) {
+						continue;
+					}
+					const float cost = leftCounts[i - 1] * leftAreas[i - 1] + rightCount * surfaceArea(rightBounds);
+					if (cost < bestCost) {
+						bestCost = cost;
+						splitAxis = axis;
+						splitPosition = boundsMin + i / scale;
+					}
+				}
+			}
+			return bestCost;
+		}
+
+		void subdivide(uint32_t nodeIndex, uint32_t depth)
+		{
+			statistics.depth = std::max(statistics.depth, depth);
+			const vks::bvh::Node node = nodes[nodeIndex];
+			if ((node.count <= 1) || (depth >= settings.maxDepth)) {
+				return;
+			}
+
+			uint32_t splitAxis = 0;
+			float splitPosition = 0.0f;
+			const float nodeArea = surfaceArea({ node.aabbMin, node.aabbMax });
+			float splitCost = findSplit(node, splitAxis, splitPosition);
+			if (splitCost == FLT_MAX) {
+				return;
+			}
+			splitCost = settings.traversalCost + settings.intersectionCost * splitCost / std::max(nodeArea, FLT_MIN);
+			const float leafCost = settings.intersectionCost * node.count;
+			if ((splitCost >= leafCost) && (node.count <= settings.maxLeafSize)) {
+				return;
+			}
+
+			// Partition the primitive range in place
+			uint32_t i = node.leftFirst;
+			uint32_t j = node.leftFirst + node.count - 1;
+			while (i <= j) {
+				if (centroids[primitiveOrder[i]][splitAxis] < splitPosition) {
+					i++;
+				} else {
+					std::swap(primitiveOrder[i], primitiveOrder[j]);
+					if (j == 0) {
+						break;
+					}
+					j--;
+				}
+			}
+			const uint32_t leftCount = i - node.leftFirst;
+			if ((leftCount == 0) || (leftCount == node.count)) {
+				return;
+			}
+
+			const uint32_t leftChild = static_cast<uint32_t>(nodes.size());
+			vks::bvh::Node child{};
+			child.leftFirst = node.leftFirst;
+			child.count = leftCount;
+			nodes.push_back(child);
+			child.leftFirst = i;
+			child.count = node.count - leftCount;
+			nodes.push_back(child);
+			nodes[nodeIndex].leftFirst = leftChild;
+			nodes[nodeIndex].count = 0;
+			updateBounds(leftChild);
+			updateBounds(leftChild + 1);
+			subdivide(leftChild, depth + 1);
+			subdivide(leftChild + 1, depth + 1);
+		}
+
+		void build()
+		{
+			const uint32_t primitiveCount = static_cast<uint32_t>(primitiveBounds.size());
+			primitiveOrder.resize(primitiveCount);
+			centroids.resize(primitiveCount);
+			for (uint32_t i = 0; i < primitiveCount; i++) {
+				primitiveOrder[i] = i;
+				centroids[i] = (primitiveBounds[i].min + primitiveBounds[i].max) * 0.5f;
+			}
+			nodes.reserve(std::max(primitiveCount * 2, 1u));
+			vks::bvh::Node root{};
+			root.leftFirst = 0;
+			root.count = primitiveCount;
+			nodes.push_back(root);
+			updateBounds(0);
+			subdivide(0, 0);
+		}
+
+		// Expected cost of a ray traversing the hierarchy, relative to the root's surface area
+		void gatherStatistics()
+		{
+			statistics.nodeCount = static_cast<uint32_t>(nodes.size());
+			const float rootArea = std::max(surfaceArea({ nodes[0].aabbMin, nodes[0].aabbMax }), FLT_MIN);
+			for (auto& node : nodes) {
+				const float area = surfaceArea({ node.aabbMin, node.aabbMax }) / rootArea;
+				if (node.count > 0) {
+					statistics.leafCount++;
+					statistics.sahCost += settings.intersectionCost * node.count * area;
+				} else {
+					statistics.sahCost += settings.traversalCost * area;
+				}
+			}
+		}
+	};
+}
+
+std::vector<vks::bvh::Node> vks::bvh::build(const std::vector<Bounds>& primitiveBounds, std::vector<uint32_t>& primitiveOrder, const BuildSettings& settings, Statistics* statistics)
+{
+	assert(settings.binCount >= 2);
+	auto tStart = std::chrono::high_resolution_clock::now();
+	Builder builder(primitiveBounds, primitiveOrder, settings);
+	builder.build();
+	if (statistics) {
+		builder.gatherStatistics();
+		builder.statistics.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		*statistics = builder.statistics;
+	}
+	return builder.nodes;
+}
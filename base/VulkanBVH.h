@@ -0,0 +1,71 @@
+/*
+* Bounding volume hierarchy built on the host
+*
+* Builds a binary bounding volume hierarchy over axis aligned primitive bounds using a binned surface area heuristic
+* The nodes are stored in a flat array that can be uploaded to a shader storage buffer as is, primitives are referenced
+* in leaf order, so reordering the primitives with the returned order makes each leaf a contiguous primitive range
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vks
+{
+	namespace bvh
+	{
+		/*
+			Node as stored in the flattened hierarchy (std430 layout)
+			Inner nodes have a primitive count of 0 and store the index of their first child, the second child directly follows it
+			Leaves store the index of their first primitive in leaf order
+		*/
+		struct Node {
+			glm::vec3 aabbMin;
+			uint32_t leftFirst;
+			glm::vec3 aabbMax;
+			uint32_t count;
+		};
+
+		struct Bounds {
+			glm::vec3 min;
+			glm::vec3 max;
+		};
+
+		struct BuildSettings {
+			/** @brief Number of bins per axis used to evaluate split candidates */
+			uint32_t binCount = 16;
+			/** @brief Nodes with more primitives are always split if possible, nodes with fewer are only split if the heuristic favours it */
+			uint32_t maxLeafSize = 4;
+			/** @brief Maximum depth of a leaf, traversal stacks need to hold at least this many entries */
+			uint32_t maxDepth = 32;
+			/** @brief Relative cost of visiting a node and of intersecting a primitive */
+			float traversalCost = 1.0f;
+			float intersectionCost = 1.0f;
+		};
+
+		struct Statistics {
+			uint32_t nodeCount = 0;
+			uint32_t leafCount = 0;
+			uint32_t depth = 0;
+			float sahCost = 0.0f;
+			double buildTime = 0.0;
+		};
+
+		/**
+		* Builds a hierarchy over the given primitive bounds
+		*
+		* @param primitiveBounds Bounds of all primitives
+		* @param primitiveOrder Receives the primitive index for each leaf slot, reorder the primitives with it before uploading them
+		* @param settings Build settings
+		* @param statistics Optional statistics of the build
+		*
+		* @return Flattened nodes, the root is the first node. A hierarchy over no primitives consists of an empty leaf with inverted bounds
+		*/
+		std::vector<Node> build(const std::vector<Bounds>& primitiveBounds, std::vector<uint32_t>& primitiveOrder, const BuildSettings& settings = BuildSettings(), Statistics* statistics = nullptr);
+	}
+}
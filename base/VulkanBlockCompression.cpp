@@ -0,0 +1,587 @@
+/*
+* Block compression (BCn) encoder
+*
+* Endpoints are fitted along the principal axis of each block and refined with a least squares fit to the selected indices
+* BC7 uses mode 6 only (single subset, RGBA endpoints with p-bits and 4 bit indices), which is fast and works well for most textures
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanBlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "threadpool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKS_BC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VKS_BC_NEON
+#include <arm_neon.h>
+#endif
+
+uint32_t vks::bc::workerThreadCount = 0;
+
+namespace
+{
+	// Pixels of a 4x4 block in row order with four components each
+	typedef float Block[16][4];
+
+	// Interpolation weights of the palette entries (towards the second endpoint)
+	const float bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const uint32_t bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		// Pixels outside of the image are clamped to the edge
+		for (uint32_t y = 0; y < 4; y++) {
+			const uint32_t py = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; x++) {
+				const uint32_t px = std::min(blockX * 4 + x, width - 1);
+				const uint8_t* pixel = rgba + (static_cast<size_t>(py) * width + px) * 4;
+				for (uint32_t c = 0; c < 4; c++) {
+					block[y * 4 + x][c] = pixel[c];
+				}
+			}
+		}
+	}
+
+	// Calculates the mean and the principal axis of the first channelCount components using power iteration on the covariance matrix
+	void principalAxis(const Block& block, uint32_t channelCount, float mean[4], float axis[4])
+	{
+		for (uint32_t c = 0; c < 4; c++) {
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+		}
+		for (uint32_t i = 0; i < 16; i++) {
+			for (uint32_t c = 0; c < channelCount; c++) {
+				mean[c] += block[i][c] / 16.0f;
+			}
+		}
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; i++) {
+			for (uint32_t a = 0; a < channelCount; a++) {
+				for (uint32_t b = 0; b < channelCount; b++) {
+					covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+				}
+			}
+		}
+		// Start with the row of the channel with the largest variance
+		uint32_t largest = 0;
+		for (uint32_t c = 1; c < channelCount; c++) {
+			if (covariance[c][c] > covariance[largest][largest]) {
+				largest = c;
+			}
+		}
+		if (covariance[largest][largest] <= 0.0f) {
+			axis[0] = 1.0f;
+			return;
+		}
+		for (uint32_t c = 0; c < channelCount; c++) {
+			axis[c] = covariance[largest][c] / covariance[largest][largest];
+		}
+		for (uint32_t iteration = 0; iteration < 8; iteration++) {
+			float next[4] = {};
+			float length = 0.0f;
+			for (uint32_t a = 0; a < channelCount; a++) {
+				for (uint32_t b = 0; b < channelCount; b++) {
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+			length = sqrtf(length);
+			if (length < 1e-6f) {
+				break;
+			}
+			for (uint32_t c = 0; c < channelCount; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+	}
+
+	// Returns the range of the pixels projected onto the axis
+	void projectOntoAxis(const Block& block, uint32_t channelCount, const float mean[4], const float axis[4], float& minT, float& maxT)
+	{
+		minT = FLT_MAX;
+		maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (uint32_t c = 0; c < channelCount; c++) {
+				t += (block[i][c] - mean[c]) * axis[c];
+			}
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+	}
+
+	// Selects the nearest palette entry for every pixel and returns the total squared error
+	// The pixels are transposed into four groups of four, so every palette entry is compared against four pixels at once
+	float selectIndices(const Block& block, uint32_t channelOffset, uint32_t channelCount, const float palette[][4], uint32_t paletteSize, uint8_t indices[16])
+	{
+#if defined(VKS_BC_SSE2)
+		__m128 channels[4][4];
+		for (uint32_t c = 0; c < channelCount; c++) {
+			for (uint32_t g = 0; g < 4; g++) {
+				channels[c][g] = _mm_setr_ps(block[g * 4][channelOffset + c], block[g * 4 + 1][channelOffset + c], block[g * 4 + 2][channelOffset + c], block[g * 4 + 3][channelOffset + c]);
+			}
+		}
+		__m128 bestError[4];
+		__m128i bestIndex[4];
+		for (uint32_t g = 0; g < 4; g++) {
+			bestError[g] = _mm_set1_ps(FLT_MAX);
+			bestIndex[g] = _mm_setzero_si128();
+		}
+		for (uint32_t p = 0; p < paletteSize; p++) {
+			const __m128i index = _mm_set1_epi32(static_cast<int>(p));
+			for (uint32_t g = 0; g < 4; g++) {
+				__m128 error = _mm_setzero_ps();
+				for (uint32_t c = 0; c < channelCount; c++) {
+					const __m128 d = _mm_sub_ps(channels[c][g], _mm_set1_ps(palette[p][c]));
+					error = _mm_add_ps(error, _mm_mul_ps(d, d));
+				}
+				// Strictly smaller, so ties keep the first entry like the scalar path
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError[g]));
+				bestError[g] = _mm_min_ps(error, bestError[g]);
+				bestIndex[g] = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex[g]));
+			}
+		}
+		float totalError = 0.0f;
+		for (uint32_t g = 0; g < 4; g++) {
+			float errors[4];
+			int32_t groupIndices[4];
+			_mm_storeu_ps(errors, bestError[g]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(groupIndices), bestIndex[g]);
+			for (uint32_t i = 0; i < 4; i++) {
+				totalError += errors[i];
+				indices[g * 4 + i] = static_cast<uint8_t>(groupIndices[i]);
+			}
+		}
+		return totalError;
+#elif defined(VKS_BC_NEON)
+		float32x4_t channels[4][4];
+		for (uint32_t c = 0; c < channelCount; c++) {
+			for (uint32_t g = 0; g < 4; g++) {
+				const float values[4] = { block[g * 4][channelOffset + c], block[g * 4 + 1][channelOffset + c], block[g * 4 + 2][channelOffset + c], block[g * 4 + 3][channelOffset + c] };
+				channels[c][g] = vld1q_f32(values);
+			}
+		}
+		float32x4_t bestError[4];
+		uint32x4_t bestIndex[4];
+		for (uint32_t g = 0; g < 4; g++) {
+			bestError[g] = vdupq_n_f32(FLT_MAX);
+			bestIndex[g] = vdupq_n_u32(0);
+		}
+		for (uint32_t p = 0; p < paletteSize; p++) {
+			const uint32x4_t index = vdupq_n_u32(p);
+			for (uint32_t g = 0; g < 4; g++) {
+				float32x4_t error = vdupq_n_f32(0.0f);
+				for (uint32_t c = 0; c < channelCount; c++) {
+					const float32x4_t d = vsubq_f32(channels[c][g], vdupq_n_f32(palette[p][c]));
+					error = vmlaq_f32(error, d, d);
+				}
+				// Strictly smaller, so ties keep the first entry like the scalar path
+				const uint32x4_t closer = vcltq_f32(error, bestError[g]);
+				bestError[g] = vminq_f32(error, bestError[g]);
+				bestIndex[g] = vbslq_u32(closer, index, bestIndex[g]);
+			}
+		}
+		float totalError = 0.0f;
+		for (uint32_t g = 0; g < 4; g++) {
+			float errors[4];
+			uint32_t groupIndices[4];
+			vst1q_f32(errors, bestError[g]);
+			vst1q_u32(groupIndices, bestIndex[g]);
+			for (uint32_t i = 0; i < 4; i++) {
+				totalError += errors[i];
+				indices[g * 4 + i] = static_cast<uint8_t>(groupIndices[i]);
+			}
+		}
+		return totalError;
+#else
+		float totalError = 0.0f;
+		for (uint32_t i = 0; i < 16; i++) {
+			float bestError = FLT_MAX;
+			for (uint32_t p = 0; p < paletteSize; p++) {
+				float error = 0.0f;
+				for (uint32_t c = 0; c < channelCount; c++) {
+					const float d = block[i][channelOffset + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+#endif
+	}
+
+	// Least squares fit of two endpoints to the pixels interpolated with the weights of the selected indices
+	bool fitEndpoints(const Block& block, uint32_t channelOffset, uint32_t channelCount, const float* weights, const uint8_t indices[16], float endpoints[2][4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (uint32_t i = 0; i < 16; i++) {
+			const float w = weights[indices[i]];
+			const float a = 1.0f - w;
+			aa += a * a;
+			ab += a * w;
+			bb += w * w;
+			for (uint32_t c = 0; c < channelCount; c++) {
+				ax[c] += a * block[i][channelOffset + c];
+				bx[c] += w * block[i][channelOffset + c];
+			}
+		}
+		const float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f) {
+			return false;
+		}
+		for (uint32_t c = 0; c < channelCount; c++) {
+			endpoints[0][c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			endpoints[1][c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t packColor565(const float color[4])
+	{
+		const uint32_t r = static_cast<uint32_t>(std::min(std::max(color[0] * 31.0f / 255.0f + 0.5f, 0.0f), 31.0f));
+		const uint32_t g = static_cast<uint32_t>(std::min(std::max(color[1] * 63.0f / 255.0f + 0.5f, 0.0f), 63.0f));
+		const uint32_t b = static_cast<uint32_t>(std::min(std::max(color[2] * 31.0f / 255.0f + 0.5f, 0.0f), 31.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackColor565(uint16_t packed, float color[4])
+	{
+		const uint32_t r = (packed >> 11) & 31;
+		const uint32_t g = (packed >> 5) & 63;
+		const uint32_t b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+		color[3] = 255.0f;
+	}
+
+	// Color block (four color mode)
+	void encodeBC1(const Block& block, uint8_t* out)
+	{
+		float mean[4], axis[4], minT, maxT;
+		principalAxis(block, 3, mean, axis);
+		projectOntoAxis(block, 3, mean, axis, minT, maxT);
+		float endpoints[2][4];
+		for (uint32_t c = 0; c < 3; c++) {
+			endpoints[0][c] = mean[c] + axis[c] * maxT;
+			endpoints[1][c] = mean[c] + axis[c] * minT;
+		}
+
+		uint16_t colors[2] = { 0, 0 };
+		uint8_t indices[16] = {};
+		float error = FLT_MAX;
+		for (uint32_t iteration = 0; iteration < 2; iteration++) {
+			uint16_t candidateColors[2] = { packColor565(endpoints[0]), packColor565(endpoints[1]) };
+			// The first color needs to be larger to select the four color mode
+			if (candidateColors[0] < candidateColors[1]) {
+				std::swap(candidateColors[0], candidateColors[1]);
+			}
+			float palette[4][4];
+			unpackColor565(candidateColors[0], palette[0]);
+			unpackColor565(candidateColors[1], palette[1]);
+			for (uint32_t c = 0; c < 3; c++) {
+				palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+				palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+			}
+			uint8_t candidateIndices[16];
+			const float candidateError = selectIndices(block, 0, 3, palette, 4, candidateIndices);
+			if (candidateError >= error) {
+				break;
+			}
+			error = candidateError;
+			memcpy(colors, candidateColors, sizeof(colors));
+			memcpy(indices, candidateIndices, sizeof(indices));
+			if (!fitEndpoints(block, 0, 3, bc1Weights, indices, endpoints)) {
+				break;
+			}
+		}
+
+		uint32_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			packedIndices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+		out[0] = colors[0] & 0xFF;
+		out[1] = colors[0] >> 8;
+		out[2] = colors[1] & 0xFF;
+		out[3] = colors[1] >> 8;
+		for (uint32_t b = 0; b < 4; b++) {
+			out[4 + b] = (packedIndices >> (b * 8)) & 0xFF;
+		}
+	}
+
+	// Single channel block (eight value mode), used for BC3 alpha and the BC5 channels
+	void encodeBC4(const Block& block, uint32_t channel, uint8_t* out)
+	{
+		float minValue = 255.0f, maxValue = 0.0f;
+		for (uint32_t i = 0; i < 16; i++) {
+			minValue = std::min(minValue, block[i][channel]);
+			maxValue = std::max(maxValue, block[i][channel]);
+		}
+		const uint8_t a0 = static_cast<uint8_t>(maxValue + 0.5f);
+		const uint8_t a1 = static_cast<uint8_t>(minValue + 0.5f);
+		uint8_t indices[16] = {};
+		if (a0 > a1) {
+			float palette[8][4];
+			palette[0][0] = a0;
+			palette[1][0] = a1;
+			for (uint32_t i = 2; i < 8; i++) {
+				palette[i][0] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+			}
+			selectIndices(block, channel, 1, palette, 8, indices);
+		}
+		uint64_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+		}
+		out[0] = a0;
+		out[1] = a1;
+		for (uint32_t b = 0; b < 6; b++) {
+			out[2 + b] = (packedIndices >> (b * 8)) & 0xFF;
+		}
+	}
+
+	// Quantizes an endpoint to 7 bits per component plus a shared p-bit, choosing the p-bit with the lower error
+	void quantizeBC7Endpoint(const float endpoint[4], uint8_t quantized[4], uint32_t& pbit)
+	{
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; p++) {
+			uint8_t candidate[4];
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; c++) {
+				const float q = std::min(std::max(floorf((endpoint[c] - p) / 2.0f + 0.5f), 0.0f), 127.0f);
+				candidate[c] = static_cast<uint8_t>(q) * 2 + p;
+				error += (candidate[c] - endpoint[c]) * (candidate[c] - endpoint[c]);
+			}
+			if (error < bestError) {
+				bestError = error;
+				pbit = p;
+				memcpy(quantized, candidate, 4);
+			}
+		}
+	}
+
+	void writeBits(uint8_t* out, uint32_t& position, uint32_t value, uint32_t bitCount)
+	{
+		for (uint32_t i = 0; i < bitCount; i++, position++) {
+			if ((value >> i) & 1) {
+				out[position >> 3] |= 1 << (position & 7);
+			}
+		}
+	}
+
+	// BC7 mode 6
+	void encodeBC7(const Block& block, uint8_t* out)
+	{
+		float mean[4], axis[4], minT, maxT;
+		principalAxis(block, 4, mean, axis);
+		projectOntoAxis(block, 4, mean, axis, minT, maxT);
+		float endpoints[2][4];
+		for (uint32_t c = 0; c < 4; c++) {
+			endpoints[0][c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+			endpoints[1][c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+		}
+		float weights[16];
+		for (uint32_t i = 0; i < 16; i++) {
+			weights[i] = bc7Weights[i] / 64.0f;
+		}
+
+		uint8_t quantized[2][4] = {};
+		uint32_t pbits[2] = {};
+		uint8_t indices[16] = {};
+		float error = FLT_MAX;
+		for (uint32_t iteration = 0; iteration < 2; iteration++) {
+			uint8_t candidateQuantized[2][4];
+			uint32_t candidatePbits[2];
+			quantizeBC7Endpoint(endpoints[0], candidateQuantized[0], candidatePbits[0]);
+			quantizeBC7Endpoint(endpoints[1], candidateQuantized[1], candidatePbits[1]);
+			// Palette is interpolated exactly like the decoder does
+			float palette[16][4];
+			for (uint32_t i = 0; i < 16; i++) {
+				for (uint32_t c = 0; c < 4; c++) {
+					palette[i][c] = static_cast<float>(((64 - bc7Weights[i]) * candidateQuantized[0][c] + bc7Weights[i] * candidateQuantized[1][c] + 32) >> 6);
+				}
+			}
+			uint8_t candidateIndices[16];
+			const float candidateError = selectIndices(block, 0, 4, palette, 16, candidateIndices);
+			if (candidateError >= error) {
+				break;
+			}
+			error = candidateError;
+			memcpy(quantized, candidateQuantized, sizeof(quantized));
+			memcpy(pbits, candidatePbits, sizeof(pbits));
+			memcpy(indices, candidateIndices, sizeof(indices));
+			if (!fitEndpoints(block, 0, 4, weights, indices, endpoints)) {
+				break;
+			}
+		}
+
+		// The most significant bit of the first index is implicitly zero, so endpoints are swapped if required
+		if (indices[0] & 8) {
+			for (uint32_t c = 0; c < 4; c++) {
+				std::swap(quantized[0][c], quantized[1][c]);
+			}
+			std::swap(pbits[0], pbits[1]);
+			for (uint32_t i = 0; i < 16; i++) {
+				indices[i] = 15 - indices[i];
+			}
+		}
+
+		memset(out, 0, 16);
+		uint32_t position = 0;
+		writeBits(out, position, 1 << 6, 7);
+		for (uint32_t c = 0; c < 4; c++) {
+			writeBits(out, position, quantized[0][c] >> 1, 7);
+			writeBits(out, position, quantized[1][c] >> 1, 7);
+		}
+		writeBits(out, position, pbits[0], 1);
+		writeBits(out, position, pbits[1], 1);
+		for (uint32_t i = 0; i < 16; i++) {
+			writeBits(out, position, indices[i], (i == 0) ? 3 : 4);
+		}
+	}
+}
+
+VkFormat vks::bc::getVkFormat(Format format)
+{
+	switch (format) {
+	case BC1:
+		return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BC3:
+		return VK_FORMAT_BC3_UNORM_BLOCK;
+	case BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case BC7:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t vks::bc::getBlockSize(Format format)
+{
+	return (format == BC1) ? 8 : 16;
+}
+
+size_t vks::bc::getCompressedSize(Format format, uint32_t width, uint32_t height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+void vks::bc::compressImage(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* destination)
+{
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const uint32_t blockSize = getBlockSize(format);
+
+	auto encodeRows = [=](uint32_t firstRow, uint32_t lastRow) {
+		Block block;
+		for (uint32_t blockY = firstRow; blockY < lastRow; blockY++) {
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+				loadBlock(rgba, width, height, blockX, blockY, block);
+				uint8_t* out = destination + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+				switch (format) {
+				case BC1:
+					encodeBC1(block, out);
+					break;
+				case BC3:
+					encodeBC4(block, 3, out);
+					encodeBC1(block, out + 8);
+					break;
+				case BC5:
+					encodeBC4(block, 0, out);
+					encodeBC4(block, 1, out + 8);
+					break;
+				case BC7:
+					encodeBC7(block, out);
+					break;
+				}
+			}
+		}
+	};
+
+	uint32_t threadCount = (workerThreadCount > 0) ? workerThreadCount : std::thread::hardware_concurrency();
+	threadCount = std::min(std::max(threadCount, 1u), blocksY);
+	// Small images (e.g. the last mip levels) are not worth distributing
+	if ((threadCount <= 1) || (blocksX * blocksY < 256)) {
+		encodeRows(0, blocksY);
+		return;
+	}
+	vks::ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+	const uint32_t rowsPerThread = (blocksY + threadCount - 1) / threadCount;
+	for (uint32_t t = 0; t < threadCount; t++) {
+		const uint32_t firstRow = t * rowsPerThread;
+		const uint32_t lastRow = std::min(firstRow + rowsPerThread, blocksY);
+		if (firstRow < lastRow) {
+			threadPool.threads[t]->addJob([=] { encodeRows(firstRow, lastRow); });
+		}
+	}
+	threadPool.wait();
+}
+
+void vks::bc::downsample(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& destination)
+{
+	const uint32_t dstWidth = std::max(1u, width / 2);
+	const uint32_t dstHeight = std::max(1u, height / 2);
+	destination.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		const uint32_t y0 = std::min(y * 2, height - 1);
+		const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < dstWidth; x++) {
+			const uint32_t x0 = std::min(x * 2, width - 1);
+			const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			for (uint32_t c = 0; c < 4; c++) {
+				const uint32_t sum = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] + rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c]
+					+ rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] + rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+				destination[(static_cast<size_t>(y) * dstWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void vks::bc::compressTexture(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, bool generateMipmaps, vks::ktx2::Texture& texture)
+{
+	texture.format = getVkFormat(format);
+	texture.width = width;
+	texture.height = height;
+	texture.levelCount = generateMipmaps ? static_cast<uint32_t>(floor(log2(std::max(width, height)))) + 1 : 1;
+	texture.layerCount = 1;
+	texture.faceCount = 1;
+	texture.transcoded = false;
+
+	size_t dataSize = 0;
+	texture.imageOffsets.resize(texture.levelCount);
+	for (uint32_t level = 0; level < texture.levelCount; level++) {
+		texture.imageOffsets[level] = dataSize;
+		dataSize += getCompressedSize(format, std::max(1u, width >> level), std::max(1u, height >> level));
+	}
+	texture.data.resize(dataSize);
+
+	// Each level is downsampled from the previous uncompressed level
+	std::vector<uint8_t> mip;
+	const uint8_t* source = rgba;
+	for (uint32_t level = 0; level < texture.levelCount; level++) {
+		const uint32_t levelWidth = std::max(1u, width >> level);
+		const uint32_t levelHeight = std::max(1u, height >> level);
+		compressImage(format, source, levelWidth, levelHeight, texture.data.data() + texture.imageOffsets[level]);
+		if (level + 1 < texture.levelCount) {
+			std::vector<uint8_t> next;
+			downsample(source, levelWidth, levelHeight, next);
+			mip.swap(next);
+			source = mip.data();
+		}
+	}
+}
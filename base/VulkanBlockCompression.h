@@ -0,0 +1,61 @@
+/*
+* Block compression (BCn) encoder
+*
+* Encodes RGBA8 images to BC1, BC3, BC5 and BC7 at runtime, e.g. to store textures decoded from PNG or JPEG
+* in a compressed format. Blocks are encoded on worker threads, palette index selection uses SSE2 or NEON where available
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanKTX2.h"
+
+namespace vks
+{
+	namespace bc
+	{
+		enum Format {
+			// RGB with 565 endpoints, 4 bits per pixel (alpha is ignored)
+			BC1,
+			// BC1 color with interpolated alpha, 8 bits per pixel
+			BC3,
+			// Two interpolated channels (red and green), 8 bits per pixel
+			// Meant for tangent space normal maps, shaders need to reconstruct z from x and y
+			BC5,
+			// RGBA with 7 bit endpoints (mode 6), 8 bits per pixel
+			BC7
+		};
+
+		/** @brief Number of worker threads used for encoding, 0 uses all hardware threads */
+		extern uint32_t workerThreadCount;
+
+		/** @brief Returns the matching UNORM Vulkan format */
+		VkFormat getVkFormat(Format format);
+		/** @brief Returns the size of a compressed 4x4 block in bytes */
+		uint32_t getBlockSize(Format format);
+		/** @brief Returns the size of a compressed image in bytes */
+		size_t getCompressedSize(Format format, uint32_t width, uint32_t height);
+
+		/**
+		* Compresses a single image
+		*
+		* @param format Target format
+		* @param rgba Source image with four 8 bit components per pixel
+		* @param width Width of the image (does not need to be a multiple of four)
+		* @param height Height of the image
+		* @param destination Receives the compressed blocks in row order, must hold getCompressedSize bytes
+		*/
+		void compressImage(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* destination);
+		/** @brief Halves the size of an RGBA8 image using a box filter */
+		void downsample(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& destination);
+		/**
+		* Compresses an image and optionally a mip chain generated on the CPU into a texture that can be saved as KTX2 or uploaded with ktx2::createImage
+		*/
+		void compressTexture(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, bool generateMipmaps, vks::ktx2::Texture& texture);
+	}
+}
@@ -9,6 +9,7 @@
 */
 
 #include <VulkanDevice.h>
+#include "VulkanMipmapGenerator.h"
 #include <unordered_set>
 
 namespace vks
@@ -60,6 +61,7 @@ namespace vks
 	*/
 	VulkanDevice::~VulkanDevice()
 	{
+		delete mipmapGenerator;
 		if (commandPool)
 		{
 			vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
@@ -70,6 +72,21 @@ namespace vks
 		}
 	}
 
+	/**
+	* Returns the device's mip chain generator, which is created on first use
+	* Sharing one generator means its compute pipeline is only created once, no matter how many textures and models are loaded
+	*
+	* @note Images queued with the generator must be generated before the next texture loader uses it
+	*/
+	MipmapGenerator* VulkanDevice::getMipmapGenerator()
+	{
+		if (!mipmapGenerator)
+		{
+			mipmapGenerator = new MipmapGenerator(this, shadersPath + "base/");
+		}
+		return mipmapGenerator;
+	}
+
 	/**
 	* Get the index of a memory type that has all the requested property bits set
 	*
@@ -254,6 +271,21 @@ namespace vks
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 		deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
 		
+		// Enable host image copies if the device supports them (see requestHostImageCopy)
+		if (hostImageCopy.requested)
+		{
+			const char* hostImageCopyExtensions[] = { VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME, VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME, VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME };
+			for (const char* extension : hostImageCopyExtensions)
+			{
+				if (std::find_if(deviceExtensions.begin(), deviceExtensions.end(), [extension](const char* enabled) { return strcmp(enabled, extension) == 0; }) == deviceExtensions.end())
+				{
+					deviceExtensions.push_back(extension);
+				}
+			}
+			hostImageCopy.features.pNext = pNextChain;
+			pNextChain = &hostImageCopy.features;
+		}
+
 		// If a pNext(Chain) has been passed, we need to add it to the device creation info
 		VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
 		if (pNextChain) {
@@ -295,6 +327,23 @@ namespace vks
 		// Create a default command pool for graphics command buffers
 		commandPool = createCommandPool(queueFamilyIndices.graphics);
 
+		if (hostImageCopy.requested)
+		{
+			hostImageCopy.vkCopyMemoryToImageEXT = reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(vkGetDeviceProcAddr(logicalDevice, "vkCopyMemoryToImageEXT"));
+			hostImageCopy.vkTransitionImageLayoutEXT = reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(vkGetDeviceProcAddr(logicalDevice, "vkTransitionImageLayoutEXT"));
+			// Get the layouts images can be in when they are written by the host
+			VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties{};
+			hostImageCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &hostImageCopyProperties;
+			hostImageCopy.vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties2);
+			hostImageCopy.dstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+			hostImageCopyProperties.pCopyDstLayouts = hostImageCopy.dstLayouts.data();
+			hostImageCopy.vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties2);
+			hostImageCopy.enabled = hostImageCopy.vkCopyMemoryToImageEXT && hostImageCopy.vkTransitionImageLayoutEXT;
+		}
+
 		return result;
 	}
 
@@ -549,6 +598,121 @@ namespace vks
 		return (std::find(supportedExtensions.begin(), supportedExtensions.end(), extension) != supportedExtensions.end());
 	}
 
+	/**
+	* Checks if the device supports VK_EXT_host_image_copy and requests it to be enabled by createLogicalDevice
+	*
+	* @param instance Instance the physical device belongs to, must have been created for Vulkan 1.1 or with VK_KHR_get_physical_device_properties2
+	*
+	* @note Must be called before the logical device is created
+	*/
+	void VulkanDevice::requestHostImageCopy(VkInstance instance)
+	{
+		if (!extensionSupported(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME) || !extensionSupported(VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME) || !extensionSupported(VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME))
+		{
+			return;
+		}
+		// The KHR entry points are only exposed if the instance extension has been enabled, a Vulkan 1.1 instance exposes the core ones instead
+		PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+		hostImageCopy.vkGetPhysicalDeviceProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+		hostImageCopy.vkGetPhysicalDeviceImageFormatProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceImageFormatProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceImageFormatProperties2KHR"));
+		if (!getPhysicalDeviceFeatures2 && (properties.apiVersion >= VK_API_VERSION_1_1))
+		{
+			getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+			hostImageCopy.vkGetPhysicalDeviceProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+			hostImageCopy.vkGetPhysicalDeviceImageFormatProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceImageFormatProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceImageFormatProperties2"));
+		}
+		if (!getPhysicalDeviceFeatures2 || !hostImageCopy.vkGetPhysicalDeviceProperties2KHR || !hostImageCopy.vkGetPhysicalDeviceImageFormatProperties2KHR)
+		{
+			return;
+		}
+		hostImageCopy.features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &hostImageCopy.features;
+		getPhysicalDeviceFeatures2(physicalDevice, &features2);
+		hostImageCopy.features.pNext = nullptr;
+		hostImageCopy.requested = (hostImageCopy.features.hostImageCopy == VK_TRUE);
+	}
+
+	/**
+	* Check if images with the given parameters can be written by host copies
+	*
+	* @param format Format of the image (2D, optimal tiling)
+	* @param usage Usage flags of the image, VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT is added by this function
+	* @param flags Create flags of the image
+	* @param layout Layout the image is written in and used with
+	*
+	* @return True if host image copies have been enabled, the format supports them and they don't lower device access performance of the image
+	*/
+	bool VulkanDevice::hostImageCopySupported(VkFormat format, VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageLayout layout) const
+	{
+		if (!hostImageCopy.enabled || (std::find(hostImageCopy.dstLayouts.begin(), hostImageCopy.dstLayouts.end(), layout) == hostImageCopy.dstLayouts.end()))
+		{
+			return false;
+		}
+		VkPhysicalDeviceImageFormatInfo2 formatInfo{};
+		formatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+		formatInfo.format = format;
+		formatInfo.type = VK_IMAGE_TYPE_2D;
+		formatInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		formatInfo.usage = usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+		formatInfo.flags = flags;
+		VkHostImageCopyDevicePerformanceQueryEXT performanceQuery{};
+		performanceQuery.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT;
+		VkImageFormatProperties2 formatProperties{};
+		formatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+		formatProperties.pNext = &performanceQuery;
+		if (hostImageCopy.vkGetPhysicalDeviceImageFormatProperties2KHR(physicalDevice, &formatInfo, &formatProperties) != VK_SUCCESS)
+		{
+			return false;
+		}
+		// Some implementations need to disable optimizations like framebuffer compression for images written by the host, these are uploaded through staging buffers instead
+		return performanceQuery.optimalDeviceAccess == VK_TRUE;
+	}
+
+	/**
+	* Transition the layout of an image on the host, without recording commands
+	*
+	* @note The image must have been created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT and must not be in use by the device
+	*/
+	void VulkanDevice::transitionImageLayoutOnHost(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageSubresourceRange subresourceRange)
+	{
+		VkHostImageLayoutTransitionInfoEXT transitionInfo{};
+		transitionInfo.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+		transitionInfo.image = image;
+		transitionInfo.oldLayout = oldLayout;
+		transitionInfo.newLayout = newLayout;
+		transitionInfo.subresourceRange = subresourceRange;
+		VK_CHECK_RESULT(hostImageCopy.vkTransitionImageLayoutEXT(logicalDevice, 1, &transitionInfo));
+	}
+
+	/**
+	* Copy tightly packed image data from host memory to an image, the copy has completed once the function returns
+	*
+	* @param data Image data, multiple layers are stored one after another
+	* @param image Image created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT
+	* @param layout Current layout of the image, must be one of hostImageCopy.dstLayouts
+	* @param subresource Mip level and layers to write
+	* @param extent Size of the mip level
+	*
+	* @note Copies to different images can be done from multiple threads at the same time
+	*/
+	void VulkanDevice::copyMemoryToImage(const void *data, VkImage image, VkImageLayout layout, VkImageSubresourceLayers subresource, VkExtent3D extent)
+	{
+		VkMemoryToImageCopyEXT region{};
+		region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+		region.pHostPointer = data;
+		region.imageSubresource = subresource;
+		region.imageExtent = extent;
+		VkCopyMemoryToImageInfoEXT copyInfo{};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+		copyInfo.dstImage = image;
+		copyInfo.dstImageLayout = layout;
+		copyInfo.regionCount = 1;
+		copyInfo.pRegions = &region;
+		VK_CHECK_RESULT(hostImageCopy.vkCopyMemoryToImageEXT(logicalDevice, &copyInfo));
+	}
+
 	/**
 	* Select the best-fit depth format for this device from a list of possible depth (and stencil) formats
 	*
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "VulkanBuffer.h"
+#include "VulkanHostImageCopy.h"
 #include "VulkanTools.h"
 #include "vulkan/vulkan.h"
 #include <algorithm>
@@ -19,6 +20,8 @@
 
 namespace vks
 {
+class MipmapGenerator;
+
 struct VulkanDevice
 {
 	/** @brief Physical device representation */
@@ -41,6 +44,25 @@ struct VulkanDevice
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 	/** @brief Set to true when the debug marker extension is detected */
 	bool enableDebugMarkers = false;
+	/** @brief Host image copy (VK_EXT_host_image_copy) state, see requestHostImageCopy */
+	struct
+	{
+		/** @brief Set to true if the device supports the extension and it will be enabled on logical device creation */
+		bool requested = false;
+		/** @brief Set to true once the extension has been enabled on the logical device */
+		bool enabled = false;
+		VkPhysicalDeviceHostImageCopyFeaturesEXT features{};
+		/** @brief Layouts images can be written to by host copies */
+		std::vector<VkImageLayout> dstLayouts;
+		PFN_vkGetPhysicalDeviceProperties2KHR vkGetPhysicalDeviceProperties2KHR = nullptr;
+		PFN_vkGetPhysicalDeviceImageFormatProperties2KHR vkGetPhysicalDeviceImageFormatProperties2KHR = nullptr;
+		PFN_vkCopyMemoryToImageEXT vkCopyMemoryToImageEXT = nullptr;
+		PFN_vkTransitionImageLayoutEXT vkTransitionImageLayoutEXT = nullptr;
+	} hostImageCopy;
+	/** @brief Mip chain generator shared by all texture loaders of this device, see getMipmapGenerator */
+	MipmapGenerator* mipmapGenerator = nullptr;
+	/** @brief Shader directory of the selected shading language, used by helpers of this device that load their own shaders */
+	std::string shadersPath;
 	/** @brief Contains queue family indices */
 	struct
 	{
@@ -54,6 +76,7 @@ struct VulkanDevice
 	};
 	explicit VulkanDevice(VkPhysicalDevice physicalDevice);
 	~VulkanDevice();
+	MipmapGenerator* getMipmapGenerator();
 	uint32_t        getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *memTypeFound = nullptr) const;
 	uint32_t        getQueueFamilyIndex(VkQueueFlagBits queueFlags) const;
 	VkResult        createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char *> enabledExtensions, void *pNextChain, bool useSwapChain = true, VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
@@ -66,6 +89,10 @@ struct VulkanDevice
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool, bool free = true);
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true);
 	bool            extensionSupported(std::string extension);
+	void            requestHostImageCopy(VkInstance instance);
+	bool            hostImageCopySupported(VkFormat format, VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageLayout layout) const;
+	void            transitionImageLayoutOnHost(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageSubresourceRange subresourceRange);
+	void            copyMemoryToImage(const void *data, VkImage image, VkImageLayout layout, VkImageSubresourceLayers subresource, VkExtent3D extent);
 	VkFormat        getSupportedDepthFormat(bool checkSamplingSupport);
 };
 }        // namespace vks
@@ -0,0 +1,263 @@
+/*
+* Acceleration structures for animated scenes
+*
+* Builds and updates are recorded by the application into its per-frame command buffers. Both share a single scratch
+* buffer sized for the larger of the two, barriers before and after every build serialize them against earlier builds
+* (including bottom level structures a top level structure references) and the pipeline stages reading the result
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanDynamicAccelerationStructure.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include "VulkanTools.h"
+
+namespace
+{
+	void createDeviceAddressBuffer(vks::VulkanDevice* device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory)
+	{
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = size;
+		bufferCreateInfo.usage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &buffer));
+		VkMemoryRequirements memoryRequirements{};
+		vkGetBufferMemoryRequirements(device->logicalDevice, buffer, &memoryRequirements);
+		VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{};
+		memoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+		VkMemoryAllocateInfo memoryAllocateInfo{};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
+		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = device->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memoryAllocateInfo, nullptr, &memory));
+		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, buffer, memory, 0));
+	}
+
+	void accelerationStructureBarrier(VkCommandBuffer commandBuffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+	{
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		memoryBarrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+vks::DynamicAccelerationStructure::DynamicAccelerationStructure(vks::VulkanDevice* device) : device(device)
+{
+	VkDevice logicalDevice = device->logicalDevice;
+	vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR"));
+	vkCreateAccelerationStructureKHR = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCreateAccelerationStructureKHR"));
+	vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkDestroyAccelerationStructureKHR"));
+	vkGetAccelerationStructureBuildSizesKHR = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureBuildSizesKHR"));
+	vkGetAccelerationStructureDeviceAddressKHR = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureDeviceAddressKHR"));
+	vkCmdBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdBuildAccelerationStructuresKHR"));
+}
+
+vks::DynamicAccelerationStructure::~DynamicAccelerationStructure()
+{
+	destroy();
+}
+
+uint64_t vks::DynamicAccelerationStructure::getBufferDeviceAddress(VkBuffer buffer)
+{
+	VkBufferDeviceAddressInfoKHR bufferDeviceAddressInfo{};
+	bufferDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	bufferDeviceAddressInfo.buffer = buffer;
+	return vkGetBufferDeviceAddressKHR(device->logicalDevice, &bufferDeviceAddressInfo);
+}
+
+VkAccelerationStructureBuildGeometryInfoKHR vks::DynamicAccelerationStructure::buildGeometryInfo(VkBuildAccelerationStructureModeKHR mode)
+{
+	VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
+	buildGeometryInfo.type = type;
+	buildGeometryInfo.flags = flags;
+	buildGeometryInfo.mode = mode;
+	buildGeometryInfo.geometryCount = static_cast<uint32_t>(geometries.size());
+	buildGeometryInfo.pGeometries = geometries.data();
+	return buildGeometryInfo;
+}
+
+void vks::DynamicAccelerationStructure::create(const std::vector<uint32_t>& maxPrimitiveCounts)
+{
+	assert(flags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
+	VkAccelerationStructureBuildGeometryInfoKHR sizeInfo = buildGeometryInfo(VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+	VkAccelerationStructureBuildSizesInfoKHR buildSizesInfo = vks::initializers::accelerationStructureBuildSizesInfoKHR();
+	vkGetAccelerationStructureBuildSizesKHR(device->logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &sizeInfo, maxPrimitiveCounts.data(), &buildSizesInfo);
+
+	// Sized for the maximum primitive counts, so rebuilds and updates never need to recreate the structure
+	createDeviceAddressBuffer(device, buildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR, accelerationStructure.buffer, accelerationStructure.memory);
+	VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
+	accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+	accelerationStructureCreateInfo.buffer = accelerationStructure.buffer;
+	accelerationStructureCreateInfo.size = buildSizesInfo.accelerationStructureSize;
+	accelerationStructureCreateInfo.type = type;
+	VK_CHECK_RESULT(vkCreateAccelerationStructureKHR(device->logicalDevice, &accelerationStructureCreateInfo, nullptr, &accelerationStructure.handle));
+	VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
+	accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+	accelerationDeviceAddressInfo.accelerationStructure = accelerationStructure.handle;
+	accelerationStructure.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(device->logicalDevice, &accelerationDeviceAddressInfo);
+	accelerationStructure.size = buildSizesInfo.accelerationStructureSize;
+
+	VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+	accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+	VkPhysicalDeviceProperties2 deviceProperties2{};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &accelerationStructureProperties;
+	vkGetPhysicalDeviceProperties2(device->physicalDevice, &deviceProperties2);
+	const VkDeviceSize scratchAlignment = std::max<VkDeviceSize>(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+
+	const VkDeviceSize scratchSize = std::max(buildSizesInfo.buildScratchSize, buildSizesInfo.updateScratchSize) + scratchAlignment;
+	createDeviceAddressBuffer(device, scratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scratchBuffer, scratchMemory);
+	scratchAddress = (getBufferDeviceAddress(scratchBuffer) + scratchAlignment - 1) & ~(scratchAlignment - 1);
+	rebuildRequired = true;
+}
+
+void vks::DynamicAccelerationStructure::createTopLevel(uint32_t maxInstanceCount, uint32_t frameCount)
+{
+	assert(frameCount > 0);
+	type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+	this->maxInstanceCount = maxInstanceCount;
+	instanceBuffers.resize(frameCount);
+	for (auto& instanceBuffer : instanceBuffers) {
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&instanceBuffer,
+			std::max<VkDeviceSize>(maxInstanceCount, 1) * sizeof(VkAccelerationStructureInstanceKHR)));
+		VK_CHECK_RESULT(instanceBuffer.map());
+	}
+	frameIndex = 0;
+
+	VkAccelerationStructureGeometryKHR geometry = vks::initializers::accelerationStructureGeometryKHR();
+	geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+	geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+	geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+	geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+	geometry.geometry.instances.data.deviceAddress = getBufferDeviceAddress(instanceBuffers[0].buffer);
+	geometries = { geometry };
+	buildRanges.resize(1);
+	buildRanges[0] = {};
+
+	create({ maxInstanceCount });
+}
+
+void vks::DynamicAccelerationStructure::setInstances(const std::vector<VkAccelerationStructureInstanceKHR>& instances)
+{
+	assert(type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR);
+	assert(instances.size() <= maxInstanceCount);
+	frameIndex = (frameIndex + 1) % static_cast<uint32_t>(instanceBuffers.size());
+	if (!instances.empty()) {
+		memcpy(instanceBuffers[frameIndex].mapped, instances.data(), instances.size() * sizeof(VkAccelerationStructureInstanceKHR));
+	}
+	geometries[0].geometry.instances.data.deviceAddress = getBufferDeviceAddress(instanceBuffers[frameIndex].buffer);
+	// Updates require the same number of primitives as the build they refit
+	if (instances.size() != this->instances.size()) {
+		rebuildRequired = true;
+	}
+	buildRanges[0].primitiveCount = static_cast<uint32_t>(instances.size());
+	this->instances = instances;
+}
+
+void vks::DynamicAccelerationStructure::createBottomLevel(const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges)
+{
+	assert(geometries.size() == buildRanges.size());
+	type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+	this->geometries = geometries;
+	this->buildRanges = buildRanges;
+	std::vector<uint32_t> maxPrimitiveCounts(buildRanges.size());
+	for (size_t i = 0; i < buildRanges.size(); i++) {
+		maxPrimitiveCounts[i] = buildRanges[i].primitiveCount;
+	}
+	create(maxPrimitiveCounts);
+}
+
+void vks::DynamicAccelerationStructure::requestRebuild()
+{
+	rebuildRequired = true;
+}
+
+bool vks::DynamicAccelerationStructure::instancesMovedTooFar()
+{
+	if (instances.size() != rebuildInstances.size()) {
+		return true;
+	}
+	for (size_t i = 0; i < instances.size(); i++) {
+		const VkTransformMatrixKHR& current = instances[i].transform;
+		const VkTransformMatrixKHR& reference = rebuildInstances[i].transform;
+		if (instances[i].accelerationStructureReference != rebuildInstances[i].accelerationStructureReference) {
+			return true;
+		}
+		float distance = 0.0f;
+		float basisChange = 0.0f;
+		for (uint32_t row = 0; row < 3; row++) {
+			const float delta = current.matrix[row][3] - reference.matrix[row][3];
+			distance += delta * delta;
+			for (uint32_t column = 0; column < 3; column++) {
+				basisChange = std::max(basisChange, std::abs(current.matrix[row][column] - reference.matrix[row][column]));
+			}
+		}
+		// Bounding volumes of instances that moved or rotated a lot overlap those of their former neighbours, which makes traversal expensive
+		if ((distance > rebuildDistance * rebuildDistance) || (basisChange > 0.5f)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void vks::DynamicAccelerationStructure::record(VkCommandBuffer commandBuffer)
+{
+	bool rebuild = rebuildRequired || (statistics.updatesSinceRebuild >= maxUpdateCount);
+	if (type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR) {
+		rebuild = rebuild || instancesMovedTooFar();
+	}
+
+	// Earlier builds of this structure (sharing the scratch buffer) and of structures referenced by it have to be finished
+	accelerationStructureBarrier(commandBuffer, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+
+	VkAccelerationStructureBuildGeometryInfoKHR buildInfo = buildGeometryInfo(rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR);
+	buildInfo.srcAccelerationStructure = rebuild ? VK_NULL_HANDLE : accelerationStructure.handle;
+	buildInfo.dstAccelerationStructure = accelerationStructure.handle;
+	buildInfo.scratchData.deviceAddress = scratchAddress;
+	const VkAccelerationStructureBuildRangeInfoKHR* buildRangeInfos = buildRanges.data();
+	vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &buildRangeInfos);
+
+	accelerationStructureBarrier(commandBuffer, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR, dstStageMask | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+
+	if (rebuild) {
+		statistics.rebuildCount++;
+		statistics.updatesSinceRebuild = 0;
+		rebuildInstances = instances;
+		rebuildRequired = false;
+	} else {
+		statistics.updateCount++;
+		statistics.updatesSinceRebuild++;
+	}
+}
+
+void vks::DynamicAccelerationStructure::destroy()
+{
+	if (accelerationStructure.handle != VK_NULL_HANDLE) {
+		vkDestroyAccelerationStructureKHR(device->logicalDevice, accelerationStructure.handle, nullptr);
+	}
+	if (accelerationStructure.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, accelerationStructure.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, accelerationStructure.memory, nullptr);
+	}
+	accelerationStructure = {};
+	if (scratchBuffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, scratchBuffer, nullptr);
+		vkFreeMemory(device->logicalDevice, scratchMemory, nullptr);
+		scratchBuffer = VK_NULL_HANDLE;
+		scratchMemory = VK_NULL_HANDLE;
+	}
+	for (auto& instanceBuffer : instanceBuffers) {
+		instanceBuffer.destroy();
+	}
+	instanceBuffers.clear();
+}
@@ -0,0 +1,98 @@
+/*
+* Acceleration structures for animated scenes
+*
+* Structures are created with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR and refit in place when their
+* instances move (top level) or their vertices deform (bottom level). Refitting keeps the tree topology of the last
+* full build, so a full rebuild is triggered after a number of updates or once instances moved too far from where
+* they were at the last rebuild
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanAccelerationStructureBuilder.h"
+#include "VulkanBuffer.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	class DynamicAccelerationStructure
+	{
+	public:
+		struct Statistics {
+			uint32_t rebuildCount = 0;
+			uint32_t updateCount = 0;
+			uint32_t updatesSinceRebuild = 0;
+		};
+
+		/** @brief The structure's handle and device address stay the same for rebuilds and updates */
+		AccelerationStructure accelerationStructure;
+		/** @brief Build flags, must be set before creating the structure */
+		VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+		/** @brief Number of consecutive updates after which the structure is rebuilt */
+		uint32_t maxUpdateCount = 120;
+		/** @brief Top level only, an instance that moved further than this since the last rebuild triggers a rebuild */
+		float rebuildDistance = 2.0f;
+		/** @brief Pipeline stages reading the structure after it has been built or updated */
+		VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+		Statistics statistics;
+
+		DynamicAccelerationStructure(vks::VulkanDevice* device);
+		~DynamicAccelerationStructure();
+
+		/**
+		* Creates a top level structure for up to maxInstanceCount instances
+		*
+		* @param frameCount Number of instance buffers, instances of a new frame are written to the next buffer so they don't overwrite data a previous frame may still build from
+		*/
+		void createTopLevel(uint32_t maxInstanceCount, uint32_t frameCount = 2);
+		/** @brief Writes the instances of the next frame to the next instance buffer */
+		void setInstances(const std::vector<VkAccelerationStructureInstanceKHR>& instances);
+		/**
+		* Creates a bottom level structure
+		* Geometry data (e.g. vertices of a skinned mesh) is updated in place by the application before calling record
+		*/
+		void createBottomLevel(const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges);
+		/** @brief Forces a full build with the next call to record */
+		void requestRebuild();
+		/** @brief Records a full build or an update of the structure, followed by a barrier for dstStageMask */
+		void record(VkCommandBuffer commandBuffer);
+		void destroy();
+
+	private:
+		vks::VulkanDevice* device;
+		VkAccelerationStructureTypeKHR type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+		std::vector<VkAccelerationStructureGeometryKHR> geometries;
+		std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges;
+		bool rebuildRequired = true;
+
+		// Shared by builds and updates
+		VkBuffer scratchBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory scratchMemory = VK_NULL_HANDLE;
+		uint64_t scratchAddress = 0;
+
+		// Top level only
+		std::vector<vks::Buffer> instanceBuffers;
+		uint32_t frameIndex = 0;
+		uint32_t maxInstanceCount = 0;
+		std::vector<VkAccelerationStructureInstanceKHR> instances;
+		// Instances as they were at the last rebuild
+		std::vector<VkAccelerationStructureInstanceKHR> rebuildInstances;
+
+		PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR;
+		PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR;
+		PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR;
+		PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR;
+		PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR;
+		PFN_vkCmdBuildAccelerationStructuresKHR vkCmdBuildAccelerationStructuresKHR;
+
+		uint64_t getBufferDeviceAddress(VkBuffer buffer);
+		VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo(VkBuildAccelerationStructureModeKHR mode);
+		void create(const std::vector<uint32_t>& maxPrimitiveCounts);
+		bool instancesMovedTooFar();
+	};
+}
@@ -12,8 +12,8 @@
 #include "vulkan/vulkan.h"
 #include "VulkanDevice.h"
 #include "VulkanBuffer.h"
-#include <ktx.h>
-#include <ktxvulkan.h>
+#include "VulkanKTXStream.h"
+#include "VulkanTools.h"
 
 namespace vks 
 {
@@ -76,29 +76,19 @@ namespace vks
 			assert(device);
 			assert(copyQueue != VK_NULL_HANDLE);
 
-			ktxResult result;
-			ktxTexture* ktxTexture;
-#if defined(__ANDROID__)
-			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-			assert(asset);
-			size_t size = AAsset_getLength(asset);
-			assert(size > 0);
-			void *textureData = malloc(size);
-			AAsset_read(asset, textureData, size);
-			AAsset_close(asset);
-			result = ktxTexture_CreateFromMemory(textureData, size, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, target);
-			free(textureData);
-#else
-			result = ktxTexture_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture);
-#endif
-			assert(result == KTX_SUCCESS);
-			ktx_size_t ktxSize = ktxTexture_GetImageSize(ktxTexture, 0);
-			ktx_uint8_t* ktxImage = ktxTexture_GetData(ktxTexture);
-			dim = ktxTexture->baseWidth;
+			// Only the first level is needed, it's read straight into the height data
+			vks::ktx::Stream ktxStream;
+			uint32_t ktxSize = 0;
+			if (!ktxStream.open(filename) || !ktxStream.beginLevel(ktxSize)) {
+				vks::tools::exitFatal("Could not load height map from " + filename, -1);
+			}
+			dim = ktxStream.width;
 			heightdata = new uint16_t[dim * dim];
-			memcpy(heightdata, ktxImage, ktxSize);
+			assert(ktxSize <= dim * dim * sizeof(uint16_t));
+			if (!ktxStream.readImage(heightdata)) {
+				vks::tools::exitFatal("Could not load height map from " + filename, -1);
+			}
 			this->scale = dim / patchsize;
-			ktxTexture_Destroy(ktxTexture);
 
 			// Generate vertices
 			Vertex * vertices = new Vertex[patchsize * patchsize * 4];
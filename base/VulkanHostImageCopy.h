@@ -0,0 +1,90 @@
+/*
+* VK_EXT_host_image_copy declarations
+*
+* The extension lets the host write to optimal tiled images directly, without staging buffers and queue submissions
+* Declares the parts of the extension used by the framework for Vulkan headers that predate it
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#if !defined(VK_EXT_host_image_copy)
+#define VK_EXT_host_image_copy 1
+#define VK_EXT_HOST_IMAGE_COPY_SPEC_VERSION 1
+#define VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME "VK_EXT_host_image_copy"
+
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT = static_cast<VkStructureType>(1000270000);
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT = static_cast<VkStructureType>(1000270001);
+const VkStructureType VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT = static_cast<VkStructureType>(1000270002);
+const VkStructureType VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT = static_cast<VkStructureType>(1000270005);
+const VkStructureType VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT = static_cast<VkStructureType>(1000270006);
+const VkStructureType VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT = static_cast<VkStructureType>(1000270009);
+
+const VkImageUsageFlagBits VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT = static_cast<VkImageUsageFlagBits>(0x00400000);
+
+typedef VkFlags VkHostImageCopyFlagsEXT;
+
+typedef struct VkPhysicalDeviceHostImageCopyFeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 hostImageCopy;
+} VkPhysicalDeviceHostImageCopyFeaturesEXT;
+
+typedef struct VkPhysicalDeviceHostImageCopyPropertiesEXT {
+	VkStructureType sType;
+	void* pNext;
+	uint32_t copySrcLayoutCount;
+	VkImageLayout* pCopySrcLayouts;
+	uint32_t copyDstLayoutCount;
+	VkImageLayout* pCopyDstLayouts;
+	uint8_t optimalTilingLayoutUUID[VK_UUID_SIZE];
+	VkBool32 identicalMemoryTypeRequirements;
+} VkPhysicalDeviceHostImageCopyPropertiesEXT;
+
+typedef struct VkMemoryToImageCopyEXT {
+	VkStructureType sType;
+	const void* pNext;
+	const void* pHostPointer;
+	uint32_t memoryRowLength;
+	uint32_t memoryImageHeight;
+	VkImageSubresourceLayers imageSubresource;
+	VkOffset3D imageOffset;
+	VkExtent3D imageExtent;
+} VkMemoryToImageCopyEXT;
+
+typedef struct VkCopyMemoryToImageInfoEXT {
+	VkStructureType sType;
+	const void* pNext;
+	VkHostImageCopyFlagsEXT flags;
+	VkImage dstImage;
+	VkImageLayout dstImageLayout;
+	uint32_t regionCount;
+	const VkMemoryToImageCopyEXT* pRegions;
+} VkCopyMemoryToImageInfoEXT;
+
+typedef struct VkHostImageLayoutTransitionInfoEXT {
+	VkStructureType sType;
+	const void* pNext;
+	VkImage image;
+	VkImageLayout oldLayout;
+	VkImageLayout newLayout;
+	VkImageSubresourceRange subresourceRange;
+} VkHostImageLayoutTransitionInfoEXT;
+
+typedef struct VkHostImageCopyDevicePerformanceQueryEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 optimalDeviceAccess;
+	VkBool32 identicalMemoryLayout;
+} VkHostImageCopyDevicePerformanceQueryEXT;
+
+typedef VkResult (VKAPI_PTR *PFN_vkCopyMemoryToImageEXT)(VkDevice device, const VkCopyMemoryToImageInfoEXT* pCopyMemoryToImageInfo);
+typedef VkResult (VKAPI_PTR *PFN_vkTransitionImageLayoutEXT)(VkDevice device, uint32_t transitionCount, const VkHostImageLayoutTransitionInfoEXT* pTransitions);
+#endif
+
+#if !defined(VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME)
+#define VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME "VK_KHR_format_feature_flags2"
+#endif
@@ -0,0 +1,146 @@
+/*
+* Disk cache for precomputed image based lighting textures
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanIBLCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+#include "VulkanBuffer.h"
+#include "VulkanKTX2.h"
+#include "VulkanResourceCache.h"
+#include "VulkanTools.h"
+
+namespace
+{
+	// Formats used for generated lighting textures, tightly packed without padding
+	uint32_t texelSize(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+			return 4;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+}
+
+std::string vks::ibl::cacheFileName(const std::string& name, const std::vector<std::string>& sourceFiles, const std::vector<float>& parameters)
+{
+	const std::string cachePath = vks::tools::getCacheDirectory("ibl");
+	if (cachePath.empty()) {
+		return "";
+	}
+	uint64_t hash = TextureCache::hash(name.data(), name.size());
+	for (auto& sourceFile : sourceFiles) {
+		const uint64_t fileHash = TextureCache::hashFile(sourceFile);
+		hash = TextureCache::hash(&fileHash, sizeof(fileHash), hash);
+	}
+	if (!parameters.empty()) {
+		hash = TextureCache::hash(parameters.data(), parameters.size() * sizeof(float), hash);
+	}
+	char hashString[17];
+	snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(hash));
+	return cachePath + "/" + hashString + "_" + name + ".ktx2";
+}
+
+bool vks::ibl::isCached(const std::string& filename)
+{
+	if (filename.empty()) {
+		return false;
+	}
+	std::ifstream file(filename, std::ios::binary);
+	return file.is_open();
+}
+
+bool vks::ibl::store(const std::string& filename, vks::VulkanDevice* device, VkQueue queue, VkImage image, VkFormat format, uint32_t dim, uint32_t levelCount, uint32_t faceCount, VkImageLayout imageLayout)
+{
+	const uint32_t bytesPerTexel = texelSize(format);
+	if (filename.empty() || (bytesPerTexel == 0)) {
+		return false;
+	}
+
+	// Images are stored in level, face order, matching the layout of KTX2 level data
+	ktx2::Texture texture;
+	texture.format = format;
+	texture.width = dim;
+	texture.height = dim;
+	texture.levelCount = levelCount;
+	texture.layerCount = 1;
+	texture.faceCount = faceCount;
+	texture.imageOffsets.resize(levelCount * faceCount);
+	std::vector<VkBufferImageCopy> copyRegions;
+	size_t dataSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const uint32_t levelDim = std::max(dim >> level, 1u);
+		for (uint32_t face = 0; face < faceCount; face++) {
+			texture.imageOffsets[texture.imageIndex(level, 0, face)] = dataSize;
+			VkBufferImageCopy copyRegion = {};
+			copyRegion.bufferOffset = dataSize;
+			copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copyRegion.imageSubresource.mipLevel = level;
+			copyRegion.imageSubresource.baseArrayLayer = face;
+			copyRegion.imageSubresource.layerCount = 1;
+			copyRegion.imageExtent = { levelDim, levelDim, 1 };
+			copyRegions.push_back(copyRegion);
+			dataSize += static_cast<size_t>(levelDim) * levelDim * bytesPerTexel;
+		}
+	}
+
+	vks::Buffer readbackBuffer;
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffer, dataSize));
+
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.levelCount = levelCount;
+	subresourceRange.layerCount = faceCount;
+
+	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vks::tools::setImageLayout(copyCmd, image, imageLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, subresourceRange);
+	vkCmdCopyImageToBuffer(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.buffer, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+	vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, imageLayout, subresourceRange);
+
+	// Make the copy visible to the host
+	VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	device->flushCommandBuffer(copyCmd, queue, true);
+
+	texture.data.resize(dataSize);
+	VK_CHECK_RESULT(readbackBuffer.map());
+	memcpy(texture.data.data(), readbackBuffer.mapped, dataSize);
+	readbackBuffer.unmap();
+	readbackBuffer.destroy();
+
+	const std::vector<uint8_t> fileData = ktx2::save(texture);
+	// Written to a temporary file first, so an interrupted run never leaves a truncated cache file behind
+	const std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream file(tempFilename, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
+		if (!file) {
+			return false;
+		}
+	}
+	remove(filename.c_str());
+	if (rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		return false;
+	}
+	std::cout << "Cached generated texture in " << filename << std::endl;
+	return true;
+}
@@ -0,0 +1,48 @@
+/*
+* Disk cache for precomputed image based lighting textures
+*
+* The BRDF look-up table, irradiance and pre-filtered environment cube maps only depend on the environment map, the
+* filter shaders and a few filter parameters. Generated textures are read back and stored as uncompressed KTX2 files
+* named after a hash of all of these, so later runs can load them instead of filtering the environment again
+* Files are stored in the "ibl" sub directory of vks::tools::cacheDirectory
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace ibl
+	{
+		/**
+		* Returns the cache file name for a generated texture
+		*
+		* @param name Name of the texture, e.g. "irradiance"
+		* @param sourceFiles Files the texture is generated from (environment map, shaders), identified by name, size and modification time
+		* @param parameters Everything else that changes the contents of the texture (dimension, format, sample counts, etc.)
+		*
+		* @return Empty string if the cache is disabled
+		*/
+		std::string cacheFileName(const std::string& name, const std::vector<std::string>& sourceFiles, const std::vector<float>& parameters);
+		/** @brief Returns true if a cached texture exists for the file name returned by cacheFileName */
+		bool isCached(const std::string& filename);
+		/**
+		* Reads back a generated texture and writes it to the cache
+		* The image must have been created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT and is returned in the layout it was passed in
+		*
+		* @param faceCount 1 for 2D textures, 6 for cube maps
+		* @param imageLayout Current layout of the image, e.g. VK_IMAGE_LAYOUT_GENERAL for images written by compute shaders
+		*
+		* @return False if the cache is disabled, the format is not supported or the file could not be written
+		*/
+		bool store(const std::string& filename, vks::VulkanDevice* device, VkQueue queue, VkImage image, VkFormat format, uint32_t dim, uint32_t levelCount, uint32_t faceCount, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+}
@@ -0,0 +1,527 @@
+/*
+* KTX2 texture loading
+*
+* Parses KTX 2.0 containers, decompresses Zstd supercompressed levels and transcodes Basis Universal (ETC1S/UASTC)
+* payloads to the best block compressed format supported by the device. Images are decoded on worker threads
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanKTX2.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "VulkanTools.h"
+#include "threadpool.hpp"
+
+#if defined(VKS_KTX2_ZSTD)
+#include <zstd.h>
+#endif
+#if defined(VKS_KTX2_BASISU)
+#include "basisu_transcoder.h"
+#endif
+
+uint32_t vks::ktx2::workerThreadCount = 0;
+
+namespace
+{
+	const uint8_t ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+	static_assert(sizeof(Header) == 80, "KTX2 header must be 80 bytes");
+
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// Color models of the data format descriptor used by Basis Universal payloads
+	const uint32_t colorModelETC1S = 163;
+	const uint32_t colorModelUASTC = 166;
+	// Transfer function of the data format descriptor for sRGB encoded color data
+	const uint32_t transferFunctionSRGB = 2;
+
+	// Decoded levels and images are aligned to a multiple of all texel block sizes and of 4, as required for buffer to image copies
+	const size_t imageAlignment = 48;
+
+	size_t alignOffset(size_t offset)
+	{
+		return (offset + imageAlignment - 1) / imageAlignment * imageAlignment;
+	}
+
+	bool isUncompressedTarget(VkFormat format)
+	{
+		return (format == VK_FORMAT_R8G8B8A8_UNORM) || (format == VK_FORMAT_R8G8B8A8_SRGB);
+	}
+
+	size_t transcodedImageSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		if (isUncompressedTarget(format)) {
+			return static_cast<size_t>(width) * height * 4;
+		}
+		// All transcode targets use 4x4 blocks
+		const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+		switch (format) {
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+			return blocks * 8;
+		default:
+			return blocks * 16;
+		}
+	}
+
+	// Runs the jobs on a pool of worker threads and waits for them to finish
+	void runJobs(uint32_t jobCount, const std::function<void(uint32_t)>& job)
+	{
+		uint32_t threadCount = (vks::ktx2::workerThreadCount > 0) ? vks::ktx2::workerThreadCount : std::thread::hardware_concurrency();
+		threadCount = std::min(std::max(threadCount, 1u), jobCount);
+		if (threadCount <= 1) {
+			for (uint32_t i = 0; i < jobCount; i++) {
+				job(i);
+			}
+			return;
+		}
+		vks::ThreadPool threadPool;
+		threadPool.setThreadCount(threadCount);
+		for (uint32_t i = 0; i < jobCount; i++) {
+			threadPool.threads[i % threadCount]->addJob([&job, i] { job(i); });
+		}
+		threadPool.wait();
+	}
+
+#if defined(VKS_KTX2_BASISU)
+	// The transcoded blocks are the same for sRGB and linear targets, only the Vulkan format differs
+	basist::transcoder_texture_format basisFormat(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFBC7_RGBA;
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFETC2_RGBA;
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFETC1_RGB;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFBC3_RGBA;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			return basist::transcoder_texture_format::cTFBC1_RGB;
+		default:
+			return basist::transcoder_texture_format::cTFRGBA32;
+		}
+	}
+#endif
+
+	bool transcodeBasis(const uint8_t* data, size_t size, VkPhysicalDevice physicalDevice, bool srgb, vks::ktx2::Texture& texture, std::string& error)
+	{
+#if defined(VKS_KTX2_BASISU)
+		static std::once_flag initFlag;
+		std::call_once(initFlag, [] { basist::basisu_transcoder_init(); });
+
+		basist::ktx2_transcoder transcoder;
+		if (!transcoder.init(data, static_cast<uint32_t>(size)) || !transcoder.start_transcoding()) {
+			error = "Invalid Basis Universal payload";
+			return false;
+		}
+		texture.format = vks::ktx2::selectTranscodeFormat(physicalDevice, transcoder.get_has_alpha(), srgb);
+		texture.transcoded = true;
+		const basist::transcoder_texture_format targetFormat = basisFormat(texture.format);
+
+		const uint32_t imageCount = texture.levelCount * texture.layerCount * texture.faceCount;
+		size_t dataSize = 0;
+		texture.imageOffsets.resize(imageCount);
+		for (uint32_t level = 0; level < texture.levelCount; level++) {
+			const size_t imageSize = transcodedImageSize(texture.format, std::max(1u, texture.width >> level), std::max(1u, texture.height >> level));
+			for (uint32_t layer = 0; layer < texture.layerCount; layer++) {
+				for (uint32_t face = 0; face < texture.faceCount; face++) {
+					texture.imageOffsets[texture.imageIndex(level, layer, face)] = dataSize;
+					dataSize = alignOffset(dataSize + imageSize);
+				}
+			}
+		}
+		texture.data.resize(dataSize);
+
+		// Every image is transcoded independently, each worker uses its own transcoder state
+		std::atomic<bool> failed(false);
+		runJobs(imageCount, [&](uint32_t index) {
+			const uint32_t face = index % texture.faceCount;
+			const uint32_t layer = (index / texture.faceCount) % texture.layerCount;
+			const uint32_t level = index / (texture.faceCount * texture.layerCount);
+			const uint32_t width = std::max(1u, texture.width >> level);
+			const uint32_t height = std::max(1u, texture.height >> level);
+			// The output size is given in pixels for uncompressed targets and in blocks otherwise
+			const uint32_t outputSize = isUncompressedTarget(texture.format) ? width * height : ((width + 3) / 4) * ((height + 3) / 4);
+			basist::ktx2_transcoder_state state;
+			if (!transcoder.transcode_image_level(level, layer, face, &texture.data[texture.imageOffsets[index]], outputSize, targetFormat, 0, 0, 0, -1, -1, &state)) {
+				failed = true;
+			}
+		});
+		if (failed) {
+			error = "Basis Universal transcoding failed";
+			return false;
+		}
+		return true;
+#else
+		(void)data;
+		(void)size;
+		(void)physicalDevice;
+		(void)srgb;
+		(void)texture;
+		error = "Basis Universal payloads require building with VKS_KTX2_BASISU";
+		return false;
+#endif
+	}
+}
+
+bool vks::ktx2::isKTX2File(const std::string& filename)
+{
+	const size_t pos = filename.find_last_of('.');
+	return (pos != std::string::npos) && (filename.substr(pos + 1) == "ktx2");
+}
+
+bool vks::ktx2::isKTX2(const uint8_t* data, size_t size)
+{
+	return (size >= sizeof(Header)) && (memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0);
+}
+
+VkFormat vks::ktx2::selectTranscodeFormat(VkPhysicalDevice physicalDevice, bool hasAlpha, bool srgb)
+{
+	const std::vector<VkFormat> candidates = srgb ?
+		std::vector<VkFormat>{
+			VK_FORMAT_BC7_SRGB_BLOCK,
+			VK_FORMAT_ASTC_4x4_SRGB_BLOCK,
+			hasAlpha ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK,
+			hasAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK,
+		} :
+		std::vector<VkFormat>{
+			VK_FORMAT_BC7_UNORM_BLOCK,
+			VK_FORMAT_ASTC_4x4_UNORM_BLOCK,
+			hasAlpha ? VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,
+			hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK,
+		};
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	for (VkFormat format : candidates) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+		if ((formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures) {
+			return format;
+		}
+	}
+	return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+bool vks::ktx2::load(const uint8_t* data, size_t size, VkPhysicalDevice physicalDevice, Texture& texture, std::string& error)
+{
+	if (!isKTX2(data, size)) {
+		error = "Not a KTX2 file";
+		return false;
+	}
+	Header header;
+	memcpy(&header, data, sizeof(Header));
+	if (header.pixelDepth > 1) {
+		error = "3D textures are not supported";
+		return false;
+	}
+	const uint32_t levelCount = std::max(header.levelCount, 1u);
+	if (sizeof(Header) + levelCount * sizeof(LevelIndex) > size) {
+		error = "Truncated level index";
+		return false;
+	}
+	std::vector<LevelIndex> levels(levelCount);
+	memcpy(levels.data(), data + sizeof(Header), levelCount * sizeof(LevelIndex));
+	for (const LevelIndex& level : levels) {
+		if (level.byteOffset + level.byteLength > size) {
+			error = "Truncated level data";
+			return false;
+		}
+	}
+
+	texture.width = header.pixelWidth;
+	texture.height = std::max(header.pixelHeight, 1u);
+	texture.levelCount = levelCount;
+	texture.layerCount = std::max(header.layerCount, 1u);
+	texture.faceCount = std::max(header.faceCount, 1u);
+	texture.transcoded = false;
+
+	// The color model and transfer function are stored in the first descriptor block, after the total size and the block header
+	uint32_t colorModel = 0;
+	uint32_t transferFunction = 0;
+	if ((header.dfdByteLength >= 16) && (header.dfdByteOffset + header.dfdByteLength <= size)) {
+		colorModel = data[header.dfdByteOffset + 12];
+		transferFunction = data[header.dfdByteOffset + 14];
+	}
+	if ((header.vkFormat == VK_FORMAT_UNDEFINED) && ((header.supercompressionScheme == SupercompressionBasisLZ) || (colorModel == colorModelETC1S) || (colorModel == colorModelUASTC))) {
+		return transcodeBasis(data, size, physicalDevice, transferFunction == transferFunctionSRGB, texture, error);
+	}
+
+	if (header.vkFormat == VK_FORMAT_UNDEFINED) {
+		error = "Unknown payload format";
+		return false;
+	}
+	if ((header.supercompressionScheme != SupercompressionNone) && (header.supercompressionScheme != SupercompressionZstd)) {
+		error = "Unsupported supercompression scheme " + std::to_string(header.supercompressionScheme);
+		return false;
+	}
+#if !defined(VKS_KTX2_ZSTD)
+	if (header.supercompressionScheme == SupercompressionZstd) {
+		error = "Zstd supercompression requires building with VKS_KTX2_ZSTD";
+		return false;
+	}
+#endif
+	texture.format = static_cast<VkFormat>(header.vkFormat);
+
+	const bool zstd = header.supercompressionScheme == SupercompressionZstd;
+	std::vector<size_t> levelOffsets(levelCount);
+	size_t dataSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		levelOffsets[level] = dataSize;
+		dataSize = alignOffset(dataSize + static_cast<size_t>(zstd ? levels[level].uncompressedByteLength : levels[level].byteLength));
+	}
+	texture.data.resize(dataSize);
+
+	// Levels are supercompressed independently, so they can be decoded in parallel
+	std::atomic<bool> failed(false);
+	runJobs(levelCount, [&](uint32_t level) {
+		const uint8_t* source = data + levels[level].byteOffset;
+		uint8_t* destination = texture.data.data() + levelOffsets[level];
+		if (zstd) {
+#if defined(VKS_KTX2_ZSTD)
+			const size_t decodedSize = ZSTD_decompress(destination, static_cast<size_t>(levels[level].uncompressedByteLength), source, static_cast<size_t>(levels[level].byteLength));
+			if (ZSTD_isError(decodedSize) || (decodedSize != levels[level].uncompressedByteLength)) {
+				failed = true;
+			}
+#endif
+		} else {
+			memcpy(destination, source, static_cast<size_t>(levels[level].byteLength));
+		}
+	});
+	if (failed) {
+		error = "Zstd decompression failed";
+		return false;
+	}
+
+	// Images of a level are stored tightly packed in layer, face order
+	texture.imageOffsets.resize(levelCount * texture.layerCount * texture.faceCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const size_t levelSize = static_cast<size_t>(zstd ? levels[level].uncompressedByteLength : levels[level].byteLength);
+		const size_t imageSize = levelSize / (texture.layerCount * texture.faceCount);
+		for (uint32_t layer = 0; layer < texture.layerCount; layer++) {
+			for (uint32_t face = 0; face < texture.faceCount; face++) {
+				texture.imageOffsets[texture.imageIndex(level, layer, face)] = levelOffsets[level] + (layer * texture.faceCount + face) * imageSize;
+			}
+		}
+	}
+	return true;
+}
+
+bool vks::ktx2::loadFromFile(const std::string& filename, VkPhysicalDevice physicalDevice, Texture& texture, std::string& error)
+{
+	std::vector<uint8_t> fileData;
+#if defined(__ANDROID__)
+	AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+	if (!asset) {
+		error = "Could not open " + filename;
+		return false;
+	}
+	fileData.resize(AAsset_getLength(asset));
+	AAsset_read(asset, fileData.data(), fileData.size());
+	AAsset_close(asset);
+#else
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		error = "Could not open " + filename;
+		return false;
+	}
+	fileData.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(fileData.data()), fileData.size());
+#endif
+	return load(fileData.data(), fileData.size(), physicalDevice, texture, error);
+}
+
+std::vector<uint8_t> vks::ktx2::save(const Texture& texture)
+{
+	// Basic data format descriptor with a single sample covering the whole block
+	uint32_t colorModel = 0;
+	uint32_t blockBytes = 0;
+	uint32_t transferFunction = 1;
+	switch (texture.format) {
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		transferFunction = transferFunctionSRGB;
+		// fall through
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		colorModel = 128;
+		blockBytes = 8;
+		break;
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		transferFunction = transferFunctionSRGB;
+		// fall through
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		colorModel = 130;
+		blockBytes = 16;
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		colorModel = 132;
+		blockBytes = 16;
+		break;
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		transferFunction = transferFunctionSRGB;
+		// fall through
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		colorModel = 134;
+		blockBytes = 16;
+		break;
+	default:
+		break;
+	}
+	const uint32_t dfd[11] = {
+		// Total size, descriptor type and version, descriptor block size
+		44, 0, 2 | (40 << 16),
+		// Color model, BT.709 primaries, linear or sRGB transfer, straight alpha
+		colorModel | (1 << 8) | (transferFunction << 16),
+		// Texel block dimensions minus one, bytes per plane
+		(blockBytes > 0) ? (3u | (3u << 8)) : 0u, blockBytes, 0,
+		// Sample: bit offset, bit length minus one, channel, positions, lower and upper
+		(blockBytes > 0) ? ((blockBytes * 8 - 1) << 16) : 0, 0, 0, 0xFFFFFFFF
+	};
+
+	Header header = {};
+	memcpy(header.identifier, ktx2Identifier, sizeof(ktx2Identifier));
+	header.vkFormat = texture.format;
+	header.typeSize = 1;
+	header.pixelWidth = texture.width;
+	header.pixelHeight = texture.height;
+	header.layerCount = (texture.layerCount > 1) ? texture.layerCount : 0;
+	header.faceCount = texture.faceCount;
+	header.levelCount = texture.levelCount;
+	header.supercompressionScheme = SupercompressionNone;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + texture.levelCount * sizeof(LevelIndex));
+	header.dfdByteLength = sizeof(dfd);
+
+	// Level sizes are derived from the image offsets, images of a level are contiguous
+	const uint32_t imagesPerLevel = texture.layerCount * texture.faceCount;
+	std::vector<LevelIndex> levels(texture.levelCount);
+	for (uint32_t level = 0; level < texture.levelCount; level++) {
+		const size_t levelStart = texture.imageOffsets[texture.imageIndex(level, 0, 0)];
+		const size_t levelEnd = (level + 1 < texture.levelCount) ? texture.imageOffsets[texture.imageIndex(level + 1, 0, 0)] : texture.data.size();
+		levels[level].byteLength = levelEnd - levelStart;
+		levels[level].uncompressedByteLength = levels[level].byteLength;
+		assert(levels[level].byteLength % imagesPerLevel == 0);
+	}
+	// Levels are stored from the smallest to the largest
+	size_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (uint32_t level = texture.levelCount; level-- > 0;) {
+		offset = alignOffset(offset);
+		levels[level].byteOffset = offset;
+		offset += static_cast<size_t>(levels[level].byteLength);
+	}
+
+	std::vector<uint8_t> fileData(offset, 0);
+	memcpy(fileData.data(), &header, sizeof(Header));
+	memcpy(fileData.data() + sizeof(Header), levels.data(), levels.size() * sizeof(LevelIndex));
+	memcpy(fileData.data() + header.dfdByteOffset, dfd, sizeof(dfd));
+	for (uint32_t level = 0; level < texture.levelCount; level++) {
+		memcpy(fileData.data() + levels[level].byteOffset, texture.data.data() + texture.imageOffsets[texture.imageIndex(level, 0, 0)], static_cast<size_t>(levels[level].byteLength));
+	}
+	return fileData;
+}
+
+void vks::ktx2::createImage(const Texture& texture, vks::VulkanDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, VkImage* image, VkDeviceMemory* memory)
+{
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		texture.data.size(),
+		&stagingBuffer,
+		&stagingMemory,
+		const_cast<uint8_t*>(texture.data.data())));
+
+	const uint32_t arrayLayers = texture.layerCount * texture.faceCount;
+	std::vector<VkBufferImageCopy> bufferCopyRegions;
+	for (uint32_t level = 0; level < texture.levelCount; level++) {
+		for (uint32_t layer = 0; layer < texture.layerCount; layer++) {
+			for (uint32_t face = 0; face < texture.faceCount; face++) {
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = level;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = layer * texture.faceCount + face;
+				bufferCopyRegion.imageSubresource.layerCount = 1;
+				bufferCopyRegion.imageExtent.width = std::max(1u, texture.width >> level);
+				bufferCopyRegion.imageExtent.height = std::max(1u, texture.height >> level);
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = texture.imageOffsets[texture.imageIndex(level, layer, face)];
+				bufferCopyRegions.push_back(bufferCopyRegion);
+			}
+		}
+	}
+
+	VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = texture.format;
+	imageCreateInfo.mipLevels = texture.levelCount;
+	imageCreateInfo.arrayLayers = arrayLayers;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent = { texture.width, texture.height, 1 };
+	imageCreateInfo.usage = imageUsageFlags | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	if (texture.faceCount == 6) {
+		imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+	}
+	VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, image));
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(device->logicalDevice, *image, &memReqs);
+	VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+	memAllocInfo.allocationSize = memReqs.size;
+	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, memory));
+	VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, *image, *memory, 0));
+
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.baseMipLevel = 0;
+	subresourceRange.levelCount = texture.levelCount;
+	subresourceRange.layerCount = arrayLayers;
+
+	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vks::tools::setImageLayout(copyCmd, *image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+	vkCmdCopyBufferToImage(copyCmd, stagingBuffer, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+	vks::tools::setImageLayout(copyCmd, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
+	device->flushCommandBuffer(copyCmd, copyQueue);
+
+	vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+	vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+}
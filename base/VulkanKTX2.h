@@ -0,0 +1,88 @@
+/*
+* KTX2 texture loading
+*
+* Parses KTX 2.0 containers, decompresses Zstd supercompressed levels and transcodes Basis Universal (ETC1S/UASTC)
+* payloads to the best block compressed format supported by the device. Images are decoded on worker threads
+*
+* Zstd support (VKS_KTX2_ZSTD) is always built from external/zstd, Basis Universal support (VKS_KTX2_BASISU) is enabled
+* if the transcoder is present in external/basisu or could be downloaded at configure time, see base/CMakeLists.txt
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace ktx2
+	{
+		enum SupercompressionScheme {
+			SupercompressionNone = 0,
+			SupercompressionBasisLZ = 1,
+			SupercompressionZstd = 2,
+			SupercompressionZlib = 3
+		};
+
+		/** @brief Decoded texture, images are tightly packed in level, layer, face order */
+		struct Texture {
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t levelCount = 0;
+			uint32_t layerCount = 0;
+			uint32_t faceCount = 0;
+			/** @brief True if the data has been transcoded from a Basis Universal payload */
+			bool transcoded = false;
+			std::vector<uint8_t> data;
+			/** @brief Offset of every image in data, see imageIndex */
+			std::vector<size_t> imageOffsets;
+
+			uint32_t imageIndex(uint32_t level, uint32_t layer, uint32_t face) const { return (level * layerCount + layer) * faceCount + face; }
+		};
+
+		/** @brief Number of worker threads used for decoding, 0 uses all hardware threads */
+		extern uint32_t workerThreadCount;
+
+		/** @brief Returns true if the file name has the .ktx2 extension */
+		bool isKTX2File(const std::string& filename);
+		/** @brief Returns true if the data starts with the KTX 2.0 identifier */
+		bool isKTX2(const uint8_t* data, size_t size);
+		/**
+		* Selects the format Basis Universal payloads are transcoded to
+		* Prefers BC7, then ASTC 4x4, ETC2, BC3 (BC1 without alpha) and falls back to uncompressed RGBA8
+		* The sRGB variants are selected for payloads with an sRGB transfer function (as stored in the data format descriptor)
+		*/
+		VkFormat selectTranscodeFormat(VkPhysicalDevice physicalDevice, bool hasAlpha, bool srgb = false);
+		/**
+		* Decodes a KTX2 file from memory
+		*
+		* @param data File contents
+		* @param size Size of the file contents
+		* @param physicalDevice Device used to select the transcode target format
+		* @param texture Receives the decoded texture
+		* @param error Receives a description of the error if decoding fails
+		*
+		* @return False if the file is invalid or uses a supercompression scheme that is not supported by this build
+		*/
+		bool load(const uint8_t* data, size_t size, VkPhysicalDevice physicalDevice, Texture& texture, std::string& error);
+		/** @brief Reads and decodes a KTX2 file (from the asset manager on Android) */
+		bool loadFromFile(const std::string& filename, VkPhysicalDevice physicalDevice, Texture& texture, std::string& error);
+		/**
+		* Serializes a texture as an uncompressed KTX2 file (no supercompression), e.g. to cache textures compressed at runtime
+		* The data format descriptor only describes block compressed formats in detail
+		*/
+		std::vector<uint8_t> save(const Texture& texture);
+		/**
+		* Creates an optimal tiled, device local image for a decoded texture and uploads all of its images using a staging buffer
+		* Textures with six faces are created cube compatible with six layers per array layer
+		*/
+		void createImage(const Texture& texture, vks::VulkanDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, VkImage* image, VkDeviceMemory* memory);
+	}
+}
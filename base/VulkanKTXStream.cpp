@@ -0,0 +1,259 @@
+/*
+* Streaming KTX texture loading
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanKTXStream.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include "VulkanBuffer.h"
+#include "VulkanTools.h"
+
+VkDeviceSize vks::ktx::stagingWindowSize = 32 * 1024 * 1024;
+
+namespace
+{
+	const uint8_t ktxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Header {
+		uint8_t identifier[12];
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	// Images and levels are padded to four bytes
+	uint32_t padding(uint32_t size)
+	{
+		return 3 - ((size + 3) % 4);
+	}
+}
+
+vks::ktx::Stream::~Stream()
+{
+	close();
+}
+
+bool vks::ktx::Stream::open(const std::string& filename)
+{
+	close();
+#if defined(__ANDROID__)
+	asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+	if (!asset) {
+		return false;
+	}
+#else
+	file = fopen(filename.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+#endif
+
+	Header header;
+	if (!read(&header, sizeof(header)) || (memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0)) {
+		close();
+		return false;
+	}
+	// Files with the opposite endianness would need their texel data to be swapped
+	if (header.endianness != 0x04030201) {
+		close();
+		return false;
+	}
+
+	width = std::max(header.pixelWidth, 1u);
+	height = std::max(header.pixelHeight, 1u);
+	depth = std::max(header.pixelDepth, 1u);
+	layerCount = std::max(header.numberOfArrayElements, 1u);
+	faceCount = std::max(header.numberOfFaces, 1u);
+	mipLevels = std::max(header.numberOfMipmapLevels, 1u);
+	// Non-array cubemaps store the size of a single face and pad every face
+	nonArrayCubemap = (header.numberOfFaces == 6) && (header.numberOfArrayElements == 0);
+	imagesRemaining = 0;
+
+	if (!skip(header.bytesOfKeyValueData)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void vks::ktx::Stream::close()
+{
+#if defined(__ANDROID__)
+	if (asset) {
+		AAsset_close(asset);
+		asset = nullptr;
+	}
+#else
+	if (file) {
+		fclose(file);
+		file = nullptr;
+	}
+#endif
+}
+
+bool vks::ktx::Stream::beginLevel(uint32_t& imageSize)
+{
+	if (!read(&levelImageSize, sizeof(levelImageSize))) {
+		return false;
+	}
+	this->imageSize = nonArrayCubemap ? levelImageSize : levelImageSize / (layerCount * faceCount);
+	imagesRemaining = layerCount * faceCount;
+	imageSize = this->imageSize;
+	return true;
+}
+
+bool vks::ktx::Stream::readImage(void* destination)
+{
+	if ((imagesRemaining == 0) || !read(destination, imageSize)) {
+		return false;
+	}
+	imagesRemaining--;
+	if (nonArrayCubemap) {
+		return skip(padding(imageSize));
+	}
+	// The padding of all other textures follows the last image of a level
+	return (imagesRemaining > 0) || skip(padding(levelImageSize));
+}
+
+bool vks::ktx::Stream::read(void* destination, size_t size)
+{
+#if defined(__ANDROID__)
+	uint8_t* data = static_cast<uint8_t*>(destination);
+	while (size > 0) {
+		int bytesRead = AAsset_read(asset, data, size);
+		if (bytesRead <= 0) {
+			return false;
+		}
+		data += bytesRead;
+		size -= bytesRead;
+	}
+	return true;
+#else
+	return fread(destination, 1, size, file) == size;
+#endif
+}
+
+bool vks::ktx::Stream::skip(size_t size)
+{
+	if (size == 0) {
+		return true;
+	}
+#if defined(__ANDROID__)
+	return AAsset_seek(asset, static_cast<off_t>(size), SEEK_CUR) != -1;
+#else
+	return fseek(file, static_cast<long>(size), SEEK_CUR) == 0;
+#endif
+}
+
+void vks::ktx::streamToImage(Stream& stream, vks::VulkanDevice* device, VkQueue copyQueue, VkImage image, VkImageLayout imageLayout, VkDeviceSize windowSize)
+{
+	const uint32_t layerCount = stream.layerCount * stream.faceCount;
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, stream.mipLevels, 0, layerCount };
+
+	// The first level has the largest images, the window needs to hold at least one of them
+	uint32_t imageSize;
+	if (!stream.beginLevel(imageSize)) {
+		vks::tools::exitFatal("Could not read the image data of a KTX file", -1);
+	}
+	vks::Buffer stagingBuffer;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&stagingBuffer,
+		std::max(windowSize, static_cast<VkDeviceSize>(imageSize))));
+	VK_CHECK_RESULT(stagingBuffer.map());
+
+	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+
+	std::vector<VkBufferImageCopy> bufferCopyRegions;
+	VkDeviceSize offset = 0;
+	for (uint32_t level = 0; level < stream.mipLevels; level++)
+	{
+		if ((level > 0) && !stream.beginLevel(imageSize)) {
+			vks::tools::exitFatal("Could not read the image data of a KTX file", -1);
+		}
+		for (uint32_t layer = 0; layer < layerCount; layer++)
+		{
+			// Once the window is full, the copies recorded so far are submitted and the window is reused
+			if (offset + imageSize > stagingBuffer.size) {
+				vkCmdCopyBufferToImage(copyCmd, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+				device->flushCommandBuffer(copyCmd, copyQueue);
+				copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+				bufferCopyRegions.clear();
+				offset = 0;
+			}
+
+			// Image data is read straight into the staging memory
+			if (!stream.readImage(static_cast<uint8_t*>(stagingBuffer.mapped) + offset)) {
+				vks::tools::exitFatal("Could not read the image data of a KTX file", -1);
+			}
+
+			VkBufferImageCopy bufferCopyRegion = {};
+			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			bufferCopyRegion.imageSubresource.mipLevel = level;
+			bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
+			bufferCopyRegion.imageSubresource.layerCount = 1;
+			bufferCopyRegion.imageExtent.width = std::max(1u, stream.width >> level);
+			bufferCopyRegion.imageExtent.height = std::max(1u, stream.height >> level);
+			bufferCopyRegion.imageExtent.depth = std::max(1u, stream.depth >> level);
+			bufferCopyRegion.bufferOffset = offset;
+			bufferCopyRegions.push_back(bufferCopyRegion);
+
+			// Buffer offsets need to be a multiple of the texel block size
+			offset = (offset + imageSize + 15) & ~static_cast<VkDeviceSize>(15);
+		}
+	}
+
+	if (!bufferCopyRegions.empty()) {
+		vkCmdCopyBufferToImage(copyCmd, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+	}
+	vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
+	device->flushCommandBuffer(copyCmd, copyQueue);
+
+	stagingBuffer.destroy();
+}
+
+void vks::ktx::hostCopyToImage(Stream& stream, vks::VulkanDevice* device, VkImage image, VkImageLayout imageLayout)
+{
+	const uint32_t layerCount = stream.layerCount * stream.faceCount;
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, stream.mipLevels, 0, layerCount };
+
+	// Host copies can write to images in their final layout, so no further transitions are required
+	device->transitionImageLayoutOnHost(image, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout, subresourceRange);
+
+	// Each image is read into host memory and copied before the next one is read, so the first level's image size bounds the memory use
+	std::vector<uint8_t> imageData;
+	for (uint32_t level = 0; level < stream.mipLevels; level++)
+	{
+		uint32_t imageSize;
+		if (!stream.beginLevel(imageSize)) {
+			vks::tools::exitFatal("Could not read the image data of a KTX file", -1);
+		}
+		imageData.resize(std::max(imageData.size(), static_cast<size_t>(imageSize)));
+		for (uint32_t layer = 0; layer < layerCount; layer++)
+		{
+			if (!stream.readImage(imageData.data())) {
+				vks::tools::exitFatal("Could not read the image data of a KTX file", -1);
+			}
+			VkImageSubresourceLayers subresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1 };
+			VkExtent3D extent = { std::max(1u, stream.width >> level), std::max(1u, stream.height >> level), std::max(1u, stream.depth >> level) };
+			device->copyMemoryToImage(imageData.data(), image, imageLayout, subresource, extent);
+		}
+	}
+}
@@ -0,0 +1,95 @@
+/*
+* Streaming KTX texture loading
+*
+* Reads the image data of KTX (version 1) files level by level straight into its destination, e.g. mapped staging
+* memory, instead of loading the whole payload into host memory and copying it again. Uploads go through a staging
+* window of bounded size, so the peak memory use doesn't depend on the size of the texture
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#endif
+
+namespace vks
+{
+	namespace ktx
+	{
+		/** @brief Default size of the staging window used by streamToImage, images larger than this get a window of their own size */
+		extern VkDeviceSize stagingWindowSize;
+
+		/**
+		* Sequential reader for the image data of a KTX file
+		*
+		* Images are stored level by level, within a level layer by layer and within a layer face by face:
+		*	for each level: beginLevel, then readImage for each layer and face
+		*/
+		class Stream
+		{
+		public:
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t depth = 0;
+			uint32_t layerCount = 0;
+			uint32_t faceCount = 0;
+			uint32_t mipLevels = 0;
+
+			~Stream();
+
+			/** @brief Opens the file and reads its header, returns false if the file can't be read or is not a little endian KTX file */
+			bool open(const std::string& filename);
+			void close();
+
+			/** @brief Starts reading the next mip level and returns the size of a single image (one layer or face) of that level */
+			bool beginLevel(uint32_t& imageSize);
+			/** @brief Reads the next image of the current level into destination, which must hold the size returned by beginLevel */
+			bool readImage(void* destination);
+
+		private:
+#if defined(__ANDROID__)
+			AAsset* asset = nullptr;
+#else
+			FILE* file = nullptr;
+#endif
+			bool nonArrayCubemap = false;
+			uint32_t levelImageSize = 0;
+			uint32_t imageSize = 0;
+			uint32_t imagesRemaining = 0;
+
+			bool read(void* destination, size_t size);
+			bool skip(size_t size);
+		};
+
+		/**
+		* Uploads all images of a stream to an image through a staging window of bounded size
+		*
+		* @param stream Opened stream, must not have been read from yet
+		* @param device Device the image has been created on
+		* @param copyQueue Queue used for the copy commands (must support transfer)
+		* @param image Image with at least the stream's levels and layers (cube faces count as layers), contents are discarded
+		* @param imageLayout Layout all subresources are transitioned to after the upload
+		* @param windowSize Size of the staging window
+		*/
+		void streamToImage(Stream& stream, vks::VulkanDevice* device, VkQueue copyQueue, VkImage image, VkImageLayout imageLayout, VkDeviceSize windowSize = stagingWindowSize);
+
+		/**
+		* Writes all images of a stream to an image from the host (VK_EXT_host_image_copy), without staging buffers or queue submissions
+		*
+		* @param stream Opened stream, must not have been read from yet
+		* @param device Device with host image copies enabled
+		* @param image Image created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT, contents are discarded
+		* @param imageLayout Layout all subresources are transitioned to, must be one of the device's host copy destination layouts
+		*/
+		void hostCopyToImage(Stream& stream, vks::VulkanDevice* device, VkImage image, VkImageLayout imageLayout);
+	}
+}
@@ -0,0 +1,154 @@
+/*
+* Clustered light culling
+*
+* The light assignment runs one invocation per cluster, every invocation tests all lights (loaded in batches through
+* shared memory and transformed to view space) against the view space bounding box of its cluster
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanLightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Needs to match the local size of lightclusters.comp
+	const uint32_t workGroupSize = 64;
+}
+
+vks::LightClusters::LightClusters(vks::VulkanDevice* device, uint32_t maxLights, const std::string& shadersPath)
+{
+	this->device = device;
+	this->maxLights = std::max(maxLights, 1u);
+
+	shader = vks::tools::loadOptionalShader(shadersPath + "lightclusters.comp.spv", device->logicalDevice);
+	if (shader == VK_NULL_HANDLE) {
+		std::cerr << "Clustered light culling is not available\n";
+		return;
+	}
+
+	const uint32_t clusterCount = gridSize.x * gridSize.y * gridSize.z;
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffers.uniforms, sizeof(UniformData)));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffers.lights, sizeof(Light) * this->maxLights));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffers.lightCounts, sizeof(uint32_t) * clusterCount));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffers.lightIndices, sizeof(uint32_t) * clusterCount * maxLightsPerCluster));
+	VK_CHECK_RESULT(buffers.uniforms.map());
+	VK_CHECK_RESULT(buffers.lights.map());
+	uniformsDescriptor = buffers.uniforms.descriptor;
+	lightsDescriptor = buffers.lights.descriptor;
+	lightCountsDescriptor = buffers.lightCounts.descriptor;
+	lightIndicesDescriptor = buffers.lightIndices.descriptor;
+
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+	getSetLayoutBindings(setLayoutBindings, 0, VK_SHADER_STAGE_COMPUTE_BIT);
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayout));
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+	computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computePipelineCreateInfo.stage.module = shader;
+	computePipelineCreateInfo.stage.pName = "main";
+	VK_CHECK_RESULT(vkCreateComputePipelines(device->logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3),
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+	VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets;
+	getWriteDescriptorSets(writeDescriptorSets, descriptorSet, 0);
+	vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+}
+
+vks::LightClusters::~LightClusters()
+{
+	if (pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device->logicalDevice, pipeline, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+		buffers.uniforms.destroy();
+		buffers.lights.destroy();
+		buffers.lightCounts.destroy();
+		buffers.lightIndices.destroy();
+	}
+	if (shader != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device->logicalDevice, shader, nullptr);
+	}
+}
+
+bool vks::LightClusters::isAvailable() const
+{
+	return pipeline != VK_NULL_HANDLE;
+}
+
+bool vks::LightClusters::isSupported(const std::string& shadersPath)
+{
+	return vks::tools::shaderAvailable(shadersPath + "lightclusters.comp.spv");
+}
+
+uint32_t vks::LightClusters::getLightCount() const
+{
+	return lightCount;
+}
+
+void vks::LightClusters::update(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar, float viewportWidth, float viewportHeight)
+{
+	if (!isAvailable()) {
+		return;
+	}
+	lightCount = std::min(static_cast<uint32_t>(lights.size()), maxLights);
+	uniformData.view = view;
+	uniformData.projInverse = glm::inverse(projection);
+	uniformData.gridSize = glm::uvec4(gridSize, lightCount);
+	uniformData.depthRange = glm::vec4(zNear, zFar, std::log(zFar / zNear), 0.0f);
+	uniformData.viewport = glm::vec4(viewportWidth, viewportHeight, 0.0f, 0.0f);
+	memcpy(buffers.uniforms.mapped, &uniformData, sizeof(UniformData));
+	if (lightCount > 0) {
+		memcpy(buffers.lights.mapped, lights.data(), sizeof(Light) * lightCount);
+	}
+}
+
+void vks::LightClusters::record(VkCommandBuffer commandBuffer)
+{
+	if (!isAvailable()) {
+		return;
+	}
+	const uint32_t clusterCount = gridSize.x * gridSize.y * gridSize.z;
+
+	// Fragment shaders of the previous frame may still read the light lists
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (clusterCount + workGroupSize - 1) / workGroupSize, 1, 1);
+
+	VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void vks::LightClusters::getSetLayoutBindings(std::vector<VkDescriptorSetLayoutBinding>& setLayoutBindings, uint32_t firstBinding, VkShaderStageFlags stageFlags) const
+{
+	setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, stageFlags, firstBinding));
+	setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stageFlags, firstBinding + 1));
+	setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stageFlags, firstBinding + 2));
+	setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stageFlags, firstBinding + 3));
+}
+
+void vks::LightClusters::getWriteDescriptorSets(std::vector<VkWriteDescriptorSet>& writeDescriptorSets, VkDescriptorSet descriptorSet, uint32_t firstBinding)
+{
+	writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, firstBinding, &uniformsDescriptor));
+	writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, firstBinding + 1, &lightsDescriptor));
+	writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, firstBinding + 2, &lightCountsDescriptor));
+	writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, firstBinding + 3, &lightIndicesDescriptor));
+}
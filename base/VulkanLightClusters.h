@@ -0,0 +1,115 @@
+/*
+* Clustered light culling
+*
+* Splits the view frustum into a grid of clusters (screen space tiles with exponentially distributed depth slices) and
+* assigns point lights to the clusters they overlap in a compute pass, so fragment shaders only evaluate the lights of
+* the cluster they are in instead of looping over all lights in the scene
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTools.h"
+
+#include <glm/glm.hpp>
+
+namespace vks
+{
+	class LightClusters
+	{
+	public:
+		/** @brief Light indices stored per cluster, lights exceeding this are dropped (needs to match the shaders) */
+		static const uint32_t maxLightsPerCluster = 256;
+
+		/** @brief Point light, the radius limits the range in which the light contributes to the shading */
+		struct Light {
+			glm::vec4 position;
+			glm::vec3 color;
+			float radius;
+		};
+
+		/** @brief Lights to assign to the clusters, at most maxLights of them are passed to the GPU with update() */
+		std::vector<Light> lights;
+
+		/** @brief Number of clusters along x and y (screen space tiles) and z (depth slices) */
+		const glm::uvec3 gridSize = glm::uvec3(16, 9, 24);
+
+		/*
+			Descriptors for the shaders reading the clusters (in this order if set up with getSetLayoutBindings)
+			uniforms: Cluster parameters, see lightclusters.comp
+			lights: Light array (std430)
+			lightCounts: Number of lights per cluster
+			lightIndices: Indices into the light array, maxLightsPerCluster entries per cluster
+		*/
+		VkDescriptorBufferInfo uniformsDescriptor{};
+		VkDescriptorBufferInfo lightsDescriptor{};
+		VkDescriptorBufferInfo lightCountsDescriptor{};
+		VkDescriptorBufferInfo lightIndicesDescriptor{};
+
+		/**
+		* @param device Device to create the resources on
+		* @param maxLights Size of the light buffer
+		* @param shadersPath Directory with the SPIR-V of the light assignment compute shader
+		*/
+		LightClusters(vks::VulkanDevice* device, uint32_t maxLights, const std::string& shadersPath = getAssetPath() + "shaders/glsl/base/");
+		~LightClusters();
+
+		/** @brief True if the compute shader could be loaded */
+		bool isAvailable() const;
+
+		/** @brief True if the SPIR-V of the compute shader exists in shadersPath, lets callers check this before creating any resources */
+		static bool isSupported(const std::string& shadersPath = getAssetPath() + "shaders/glsl/base/");
+
+		/** @brief Number of lights passed to the GPU with the last update */
+		uint32_t getLightCount() const;
+
+		/** @brief Uploads the lights and the camera used to build the clusters, the viewport size is that of the pass reading the clusters */
+		void update(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar, float viewportWidth, float viewportHeight);
+
+		/** @brief Records the light assignment, must be recorded outside of a render pass and before the passes reading the clusters */
+		void record(VkCommandBuffer commandBuffer);
+
+		/** @brief Appends the four bindings for the cluster descriptors starting at firstBinding */
+		void getSetLayoutBindings(std::vector<VkDescriptorSetLayoutBinding>& setLayoutBindings, uint32_t firstBinding, VkShaderStageFlags stageFlags) const;
+
+		/** @brief Appends the descriptor writes matching getSetLayoutBindings */
+		void getWriteDescriptorSets(std::vector<VkWriteDescriptorSet>& writeDescriptorSets, VkDescriptorSet descriptorSet, uint32_t firstBinding);
+
+	private:
+		struct UniformData {
+			glm::mat4 view;
+			glm::mat4 projInverse;
+			// xyz = grid size, w = light count
+			glm::uvec4 gridSize;
+			// x = near plane, y = far plane, z = log(far / near)
+			glm::vec4 depthRange;
+			// xy = viewport size
+			glm::vec4 viewport;
+		} uniformData;
+
+		vks::VulkanDevice* device;
+		uint32_t maxLights;
+		uint32_t lightCount = 0;
+
+		struct {
+			vks::Buffer uniforms;
+			vks::Buffer lights;
+			vks::Buffer lightCounts;
+			vks::Buffer lightIndices;
+		} buffers;
+
+		VkShaderModule shader = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+	};
+}
@@ -0,0 +1,245 @@
+/*
+* Batched mip chain generation
+*
+* All queued images are processed level by level: every step downsamples one level of all images (one dispatch or blit per image)
+* followed by a single barrier for all of them, so the number of barriers only depends on the largest mip chain
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanMipmapGenerator.h"
+
+#include <algorithm>
+
+namespace
+{
+	struct PushConstants {
+		int32_t srcSize[2];
+		int32_t dstSize[2];
+		int32_t filter;
+	};
+
+	// sRGB images are written through views with the matching UNORM format
+	VkFormat getStorageFormat(VkFormat format)
+	{
+		return (format == VK_FORMAT_R8G8B8A8_SRGB) ? VK_FORMAT_R8G8B8A8_UNORM : format;
+	}
+
+	VkImageMemoryBarrier levelBarrier(VkImage image, uint32_t baseMipLevel, uint32_t levelCount, uint32_t layerCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+	{
+		VkImageMemoryBarrier barrier = vks::initializers::imageMemoryBarrier();
+		barrier.image = image;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, levelCount, 0, layerCount };
+		return barrier;
+	}
+}
+
+vks::MipmapGenerator::MipmapGenerator(vks::VulkanDevice* device, const std::string& shadersPath)
+{
+	this->device = device;
+
+	const std::string shaderFile = shadersPath + "mipgen.comp.spv";
+
+	// The shader is optional, so it's probed first instead of letting the loader fail (which asserts on Android)
+	shaderModule = vks::tools::loadOptionalShader(shaderFile, device->logicalDevice);
+	if (shaderModule == VK_NULL_HANDLE) {
+		std::cout << "Mip generation shader " << shaderFile << " not found, generating mip chains with image blits\n";
+		return;
+	}
+
+	// Binding 0: Source level, binding 1: Destination level
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+	};
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayout));
+
+	VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(PushConstants), 0);
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+	computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computePipelineCreateInfo.stage.module = shaderModule;
+	computePipelineCreateInfo.stage.pName = "main";
+	VK_CHECK_RESULT(vkCreateComputePipelines(device->logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+}
+
+vks::MipmapGenerator::~MipmapGenerator()
+{
+	if (pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device->logicalDevice, pipeline, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayout, nullptr);
+	}
+	if (shaderModule != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device->logicalDevice, shaderModule, nullptr);
+	}
+}
+
+bool vks::MipmapGenerator::isComputeSupported(VkFormat format) const
+{
+	// The shader accesses the images as rgba8
+	if ((pipeline == VK_NULL_HANDLE) || ((format != VK_FORMAT_R8G8B8A8_UNORM) && (format != VK_FORMAT_R8G8B8A8_SRGB))) {
+		return false;
+	}
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device->physicalDevice, getStorageFormat(format), &formatProperties);
+	return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+void vks::MipmapGenerator::add(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount, VkImageLayout initialLayout, VkImageLayout finalLayout, Filter filter, bool computeCompatible)
+{
+	Request request{};
+	request.image = image;
+	request.format = format;
+	request.width = width;
+	request.height = height;
+	request.mipLevels = mipLevels;
+	request.layerCount = layerCount;
+	request.initialLayout = initialLayout;
+	request.finalLayout = finalLayout;
+	request.filter = filter;
+	request.compute = computeCompatible && isComputeSupported(format);
+	if (!request.compute) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+		if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+			vks::tools::exitFatal("Can't generate mip levels for an image of format " + std::to_string(format) + ", the format supports neither storage nor blit operations", -1);
+		}
+	}
+	requests.push_back(request);
+}
+
+void vks::MipmapGenerator::generate(VkQueue queue)
+{
+	if (requests.empty()) {
+		return;
+	}
+
+	// Views and descriptor sets for the compute path
+	uint32_t descriptorSetCount = 0;
+	uint32_t maxMipLevels = 0;
+	for (Request& request : requests) {
+		maxMipLevels = std::max(maxMipLevels, request.mipLevels);
+		if (request.compute && request.mipLevels > 1) {
+			descriptorSetCount += request.mipLevels - 1;
+		}
+	}
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	if (descriptorSetCount > 0) {
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, descriptorSetCount * 2)
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, descriptorSetCount);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+	}
+	for (Request& request : requests) {
+		if (!request.compute || request.mipLevels < 2) {
+			continue;
+		}
+		request.views.resize(request.mipLevels);
+		for (uint32_t level = 0; level < request.mipLevels; level++) {
+			VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
+			viewCreateInfo.image = request.image;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			viewCreateInfo.format = getStorageFormat(request.format);
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, request.layerCount };
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &request.views[level]));
+		}
+		request.descriptorSets.resize(request.mipLevels - 1);
+		for (uint32_t level = 1; level < request.mipLevels; level++) {
+			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &request.descriptorSets[level - 1]));
+			VkDescriptorImageInfo srcImageInfo = vks::initializers::descriptorImageInfo(VK_NULL_HANDLE, request.views[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+			VkDescriptorImageInfo dstImageInfo = vks::initializers::descriptorImageInfo(VK_NULL_HANDLE, request.views[level], VK_IMAGE_LAYOUT_GENERAL);
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(request.descriptorSets[level - 1], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &srcImageInfo),
+				vks::initializers::writeDescriptorSet(request.descriptorSets[level - 1], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &dstImageInfo),
+			};
+			vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+	}
+
+	VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	const VkPipelineStageFlags workStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+	// Compute images are kept in the general layout, blit images use the transfer layouts
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (Request& request : requests) {
+		if (request.compute) {
+			barriers.push_back(levelBarrier(request.image, 0, 1, request.layerCount, request.initialLayout, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+		} else {
+			barriers.push_back(levelBarrier(request.image, 0, 1, request.layerCount, request.initialLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+		}
+		if (request.mipLevels > 1) {
+			if (request.compute) {
+				barriers.push_back(levelBarrier(request.image, 1, request.mipLevels - 1, request.layerCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT));
+			} else {
+				barriers.push_back(levelBarrier(request.image, 1, request.mipLevels - 1, request.layerCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+			}
+		}
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, workStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	if (descriptorSetCount > 0) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	}
+	for (uint32_t level = 1; level < maxMipLevels; level++) {
+		barriers.clear();
+		for (Request& request : requests) {
+			if (level >= request.mipLevels) {
+				continue;
+			}
+			const int32_t srcWidth = std::max(1u, request.width >> (level - 1));
+			const int32_t srcHeight = std::max(1u, request.height >> (level - 1));
+			const int32_t dstWidth = std::max(1u, request.width >> level);
+			const int32_t dstHeight = std::max(1u, request.height >> level);
+			if (request.compute) {
+				PushConstants pushConstants = { { srcWidth, srcHeight }, { dstWidth, dstHeight }, request.filter };
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &request.descriptorSets[level - 1], 0, nullptr);
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+				vkCmdDispatch(commandBuffer, (dstWidth + 7) / 8, (dstHeight + 7) / 8, request.layerCount);
+				barriers.push_back(levelBarrier(request.image, level, 1, request.layerCount, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+			} else {
+				VkImageBlit imageBlit{};
+				imageBlit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, request.layerCount };
+				imageBlit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+				imageBlit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, request.layerCount };
+				imageBlit.dstOffsets[1] = { dstWidth, dstHeight, 1 };
+				vkCmdBlitImage(commandBuffer, request.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, request.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+				barriers.push_back(levelBarrier(request.image, level, 1, request.layerCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+			}
+		}
+		// One barrier for this level of all images
+		vkCmdPipelineBarrier(commandBuffer, workStages, workStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+	}
+
+	barriers.clear();
+	for (Request& request : requests) {
+		const VkImageLayout currentLayout = request.compute ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers.push_back(levelBarrier(request.image, 0, request.mipLevels, request.layerCount, currentLayout, request.finalLayout, 0, VK_ACCESS_SHADER_READ_BIT));
+	}
+	vkCmdPipelineBarrier(commandBuffer, workStages, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	device->flushCommandBuffer(commandBuffer, queue);
+
+	for (Request& request : requests) {
+		for (VkImageView view : request.views) {
+			vkDestroyImageView(device->logicalDevice, view, nullptr);
+		}
+	}
+	if (descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+	}
+	requests.clear();
+}
@@ -0,0 +1,93 @@
+/*
+* Batched mip chain generation
+*
+* Generates the mip chains of many images with a single command buffer submission. Images with a format that can be
+* written as a storage image are downsampled by a compute shader, all other images fall back to a chain of image blits
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	class MipmapGenerator
+	{
+	public:
+		enum Filter {
+			// Box filter on the stored values
+			FilterLinear = 0,
+			// Box filter in linear color space, for color data stored in sRGB (the alpha channel is filtered linearly)
+			FilterSRGB = 1,
+			// Averages tangent space normals and renormalizes the result
+			FilterNormalMap = 2
+		};
+
+		/** @brief Usage flags required for images downsampled by the compute path */
+		static const VkImageUsageFlags computeImageUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+		/**
+		* @param device Device to generate mip chains on
+		* @param shadersPath Base shader directory of the selected shading language (containing mipgen.comp.spv), only the blit path is used if the shader doesn't exist
+		* @note Loaders should use the generator shared by the device (VulkanDevice::getMipmapGenerator) instead of creating their own
+		*/
+		MipmapGenerator(vks::VulkanDevice* device, const std::string& shadersPath);
+		~MipmapGenerator();
+
+		/**
+		* Returns true if images of the given format can be downsampled by the compute path
+		* Such images need to be created with computeImageUsage, sRGB images also need VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT and VK_IMAGE_CREATE_EXTENDED_USAGE_BIT
+		*/
+		bool isComputeSupported(VkFormat format) const;
+
+		/**
+		* Queues an image for mip generation
+		*
+		* @param image Image with valid contents in the first mip level
+		* @param format Format the image has been created with
+		* @param width Width of the first mip level
+		* @param height Height of the first mip level
+		* @param mipLevels Number of mip levels of the image
+		* @param layerCount Number of array layers, all layers are downsampled
+		* @param initialLayout Layout of the first mip level, the other levels are discarded
+		* @param finalLayout Layout all mip levels are transitioned to
+		* @param filter Downsampling filter, only applied by the compute path (blits filter sRGB formats in linear space, and everything else as stored)
+		* @param computeCompatible True if the image has been created as required by the compute path (see isComputeSupported)
+		*/
+		void add(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount, VkImageLayout initialLayout, VkImageLayout finalLayout, Filter filter, bool computeCompatible);
+
+		/** @brief Records the mip generation of all queued images into one command buffer, submits it and waits for completion */
+		void generate(VkQueue queue);
+
+	private:
+		struct Request {
+			VkImage image;
+			VkFormat format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mipLevels;
+			uint32_t layerCount;
+			VkImageLayout initialLayout;
+			VkImageLayout finalLayout;
+			Filter filter;
+			bool compute;
+			// One view per mip level and one descriptor set per downsampling step (compute path only)
+			std::vector<VkImageView> views;
+			std::vector<VkDescriptorSet> descriptorSets;
+		};
+		std::vector<Request> requests;
+
+		vks::VulkanDevice* device;
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+	};
+}
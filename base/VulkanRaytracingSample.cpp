@@ -84,6 +84,11 @@ void VulkanRaytracingSample::updateRenderPass()
 	VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
 }
 
+VulkanRaytracingSample::~VulkanRaytracingSample()
+{
+	delete accelerationStructureBuilder;
+}
+
 void VulkanRaytracingSample::enableExtensions()
 {
 	// Require Vulkan 1.1
@@ -279,6 +284,7 @@ void VulkanRaytracingSample::prepare()
 	vkCmdTraceRaysKHR = reinterpret_cast<PFN_vkCmdTraceRaysKHR>(vkGetDeviceProcAddr(device, "vkCmdTraceRaysKHR"));
 	vkGetRayTracingShaderGroupHandlesKHR = reinterpret_cast<PFN_vkGetRayTracingShaderGroupHandlesKHR>(vkGetDeviceProcAddr(device, "vkGetRayTracingShaderGroupHandlesKHR"));
 	vkCreateRayTracingPipelinesKHR = reinterpret_cast<PFN_vkCreateRayTracingPipelinesKHR>(vkGetDeviceProcAddr(device, "vkCreateRayTracingPipelinesKHR"));
+	accelerationStructureBuilder = new vks::AccelerationStructureBuilder(vulkanDevice, queue);
 	// Update the render pass to keep the color attachment contents, so we can draw the UI on top of the ray traced output
 	if (!rayQueryOnly) {
 		updateRenderPass();
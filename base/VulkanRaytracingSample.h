@@ -12,6 +12,7 @@
 #include "vulkanexamplebase.h"
 #include "VulkanTools.h"
 #include "VulkanDevice.h"
+#include "VulkanAccelerationStructureBuilder.h"
 
 class VulkanRaytracingSample : public VulkanExampleBase
 {
@@ -49,12 +50,7 @@ public:
 	};
 
 	// Holds information for a ray tracing acceleration structure
-	struct AccelerationStructure {
-		VkAccelerationStructureKHR handle;
-		uint64_t deviceAddress = 0;
-		VkDeviceMemory memory;
-		VkBuffer buffer;
-	};
+	typedef vks::AccelerationStructure AccelerationStructure;
 
 	// Holds information for a storage image that the ray tracing shaders output to
 	struct StorageImage {
@@ -73,6 +69,11 @@ public:
 	// Set to true, to denote that the sample only uses ray queries (changes extension and render pass handling)
 	bool rayQueryOnly = false;
 
+	// Batches acceleration structure builds, shares scratch memory between them and compacts the results
+	vks::AccelerationStructureBuilder* accelerationStructureBuilder = nullptr;
+
+	~VulkanRaytracingSample();
+
 	void enableExtensions();
 	ScratchBuffer createScratchBuffer(VkDeviceSize size);
 	void deleteScratchBuffer(ScratchBuffer& scratchBuffer);
@@ -0,0 +1,662 @@
+/*
+* Render graph for multi pass rendering
+*
+* Barriers are derived by replaying the accesses of all passes that have not been culled in order, tracking the layout,
+* the last write and the stages that read since then for every image. The first use of an image in a frame starts from
+* an undefined layout and waits for the last use of the image and all images sharing its memory in the previous frame
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanRenderGraph.h"
+#include "VulkanDebug.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	bool isDepthFormat(VkFormat format)
+	{
+		return (format == VK_FORMAT_D16_UNORM) || (format == VK_FORMAT_X8_D24_UNORM_PACK32) || (format == VK_FORMAT_D32_SFLOAT) ||
+			(format == VK_FORMAT_D16_UNORM_S8_UINT) || (format == VK_FORMAT_D24_UNORM_S8_UINT) || (format == VK_FORMAT_D32_SFLOAT_S8_UINT);
+	}
+
+	bool hasStencil(VkFormat format)
+	{
+		return (format == VK_FORMAT_D16_UNORM_S8_UINT) || (format == VK_FORMAT_D24_UNORM_S8_UINT) || (format == VK_FORMAT_D32_SFLOAT_S8_UINT);
+	}
+
+	// Layout, stages and accesses of an image access
+	struct AccessInfo {
+		VkImageLayout layout;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		bool write;
+	};
+
+	// Tracked state of an image while replaying the passes
+	struct ImageState {
+		bool used = false;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// Last write and the stages it has been made visible to
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags visibleStages = 0;
+		// Stages that read the image since the last write
+		VkPipelineStageFlags readStages = 0;
+	};
+
+	AccessInfo getAccessInfo(bool clear, bool colorOutput, bool depthStencilOutput, bool storage, bool write, VkPipelineStageFlags stages)
+	{
+		AccessInfo info{};
+		info.stages = stages;
+		if (colorOutput) {
+			info.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			info.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+			info.write = true;
+		} else if (depthStencilOutput) {
+			info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			info.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+			info.write = true;
+		} else if (storage) {
+			info.layout = VK_IMAGE_LAYOUT_GENERAL;
+			info.access = VK_ACCESS_SHADER_READ_BIT | (write ? VK_ACCESS_SHADER_WRITE_BIT : 0);
+			info.write = write;
+		} else {
+			info.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			info.access = VK_ACCESS_SHADER_READ_BIT;
+			info.write = false;
+		}
+		return info;
+	}
+}
+
+vks::RenderGraph::Pass::Pass(const std::string& name, PassType type)
+{
+	this->name = name;
+	this->type = type;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::addColorOutput(Resource image, const VkClearColorValue* clearValue)
+{
+	assert(type == PassType::Graphics);
+	Access access{};
+	access.image = image;
+	access.type = AccessType::ColorOutput;
+	access.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	access.clear = (clearValue != nullptr);
+	if (clearValue) {
+		access.clearValue.color = *clearValue;
+	}
+	accesses.push_back(access);
+	return *this;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::setDepthStencilOutput(Resource image, const VkClearDepthStencilValue* clearValue)
+{
+	assert(type == PassType::Graphics);
+	Access access{};
+	access.image = image;
+	access.type = AccessType::DepthStencilOutput;
+	access.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	access.clear = (clearValue != nullptr);
+	if (clearValue) {
+		access.clearValue.depthStencil = *clearValue;
+	}
+	accesses.push_back(access);
+	return *this;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::addTextureInput(Resource image, VkPipelineStageFlags stages)
+{
+	Access access{};
+	access.image = image;
+	access.type = AccessType::TextureInput;
+	access.stages = stages;
+	accesses.push_back(access);
+	return *this;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::addStorageInput(Resource image, VkPipelineStageFlags stages)
+{
+	Access access{};
+	access.image = image;
+	access.type = AccessType::StorageInput;
+	access.stages = stages;
+	accesses.push_back(access);
+	return *this;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::addStorageOutput(Resource image, VkPipelineStageFlags stages)
+{
+	Access access{};
+	access.image = image;
+	access.type = AccessType::StorageOutput;
+	access.stages = stages;
+	accesses.push_back(access);
+	return *this;
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::Pass::setRecordFunction(RecordFunction recordFunction)
+{
+	this->recordFunction = recordFunction;
+	return *this;
+}
+
+VkRenderPass vks::RenderGraph::Pass::getRenderPass() const
+{
+	return renderPass;
+}
+
+VkExtent2D vks::RenderGraph::Pass::getExtent() const
+{
+	return extent;
+}
+
+bool vks::RenderGraph::Pass::isCulled() const
+{
+	return culled;
+}
+
+vks::RenderGraph::RenderGraph(vks::VulkanDevice* device)
+{
+	assert(device);
+	this->device = device;
+}
+
+vks::RenderGraph::~RenderGraph()
+{
+	for (auto& pass : passes) {
+		if (pass->framebuffer != VK_NULL_HANDLE) {
+			vkDestroyFramebuffer(device->logicalDevice, pass->framebuffer, nullptr);
+		}
+		if (pass->renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(device->logicalDevice, pass->renderPass, nullptr);
+		}
+	}
+	destroyImages(false);
+	destroyImages(true);
+}
+
+vks::RenderGraph::Resource vks::RenderGraph::createImage(const std::string& name, const ImageInfo& info)
+{
+	assert(!compiled);
+	Image image{};
+	image.name = name;
+	image.info = info;
+	images.push_back(image);
+	return static_cast<Resource>(images.size() - 1);
+}
+
+vks::RenderGraph::Pass& vks::RenderGraph::addPass(const std::string& name, PassType type)
+{
+	assert(!compiled);
+	passes.push_back(std::unique_ptr<Pass>(new Pass(name, type)));
+	return *passes.back();
+}
+
+void vks::RenderGraph::addOutput(Resource image, VkPipelineStageFlags stages)
+{
+	assert(!compiled);
+	images[image].output = true;
+	images[image].outputStages |= stages;
+}
+
+bool vks::RenderGraph::isRelativeSize(const Image& image) const
+{
+	return (image.info.width == 0) || (image.info.height == 0);
+}
+
+void vks::RenderGraph::cullPasses()
+{
+	// Walk the passes backwards from the outputs, a pass is only needed if it writes an image that is read later on
+	std::vector<bool> needed(images.size(), false);
+	for (size_t i = 0; i < images.size(); i++) {
+		needed[i] = images[i].output;
+	}
+	for (auto it = passes.rbegin(); it != passes.rend(); ++it) {
+		Pass& pass = **it;
+		pass.culled = true;
+		for (auto& access : pass.accesses) {
+			const bool write = (access.type == Pass::AccessType::ColorOutput) || (access.type == Pass::AccessType::DepthStencilOutput) || (access.type == Pass::AccessType::StorageOutput);
+			if (write && needed[access.image]) {
+				pass.culled = false;
+			}
+		}
+		if (pass.culled) {
+			continue;
+		}
+		// Cleared attachments don't depend on earlier writes, everything else this pass reads does
+		for (auto& access : pass.accesses) {
+			if (access.clear) {
+				needed[access.image] = false;
+			}
+		}
+		for (auto& access : pass.accesses) {
+			if (!access.clear) {
+				needed[access.image] = true;
+			}
+		}
+	}
+}
+
+void vks::RenderGraph::compile(uint32_t width, uint32_t height)
+{
+	assert(!compiled);
+	cullPasses();
+
+	// Usage and range of passes of all images
+	const uint32_t passCount = static_cast<uint32_t>(passes.size());
+	for (uint32_t i = 0; i < passCount; i++) {
+		if (passes[i]->culled) {
+			continue;
+		}
+		for (auto& access : passes[i]->accesses) {
+			Image& image = images[access.image];
+			if (!image.used) {
+				image.firstPass = i;
+				image.used = true;
+			}
+			image.lastPass = i;
+			switch (access.type) {
+			case Pass::AccessType::ColorOutput:
+				image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+				break;
+			case Pass::AccessType::DepthStencilOutput:
+				image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				break;
+			case Pass::AccessType::TextureInput:
+				image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+				break;
+			case Pass::AccessType::StorageInput:
+			case Pass::AccessType::StorageOutput:
+				image.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+				break;
+			}
+		}
+	}
+	for (auto& image : images) {
+		if (image.output) {
+			// Outputs are read after the last pass of the graph
+			if (!image.used) {
+				image.firstPass = passCount;
+				image.used = true;
+			}
+			image.lastPass = passCount;
+			image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		}
+	}
+
+	createImages(false, width, height);
+	createImages(true, width, height);
+	for (uint32_t i = 0; i < passCount; i++) {
+		if (!passes[i]->culled && (passes[i]->type == PassType::Graphics)) {
+			createRenderPass(*passes[i], i);
+			createFramebuffer(*passes[i]);
+		}
+	}
+	buildBarriers();
+	compiled = true;
+}
+
+void vks::RenderGraph::resize(uint32_t width, uint32_t height)
+{
+	assert(compiled);
+	// Only the framebuffers of passes using images with a relative size need to be recreated, render passes stay valid as formats don't change
+	std::vector<Pass*> affectedPasses;
+	for (auto& pass : passes) {
+		if (pass->framebuffer == VK_NULL_HANDLE) {
+			continue;
+		}
+		bool affected = std::any_of(pass->accesses.begin(), pass->accesses.end(), [this](const Pass::Access& access) { return isRelativeSize(images[access.image]); });
+		if (affected) {
+			vkDestroyFramebuffer(device->logicalDevice, pass->framebuffer, nullptr);
+			pass->framebuffer = VK_NULL_HANDLE;
+			affectedPasses.push_back(pass.get());
+		}
+	}
+	destroyImages(true);
+	createImages(true, width, height);
+	for (auto pass : affectedPasses) {
+		createFramebuffer(*pass);
+	}
+	// Barriers reference the images and may alias differently with the new sizes
+	buildBarriers();
+}
+
+void vks::RenderGraph::createImages(bool relativeSize, uint32_t width, uint32_t height)
+{
+	std::unique_ptr<vks::AliasedMemory>& memory = relativeSize ? relativeMemory : fixedMemory;
+	memory.reset(new vks::AliasedMemory(device));
+
+	std::vector<Image*> created;
+	for (auto& image : images) {
+		if (!image.used || (isRelativeSize(image) != relativeSize)) {
+			continue;
+		}
+		if (relativeSize) {
+			image.extent.width = std::max(static_cast<uint32_t>(std::floor(width * image.info.sizeScale)), 1u);
+			image.extent.height = std::max(static_cast<uint32_t>(std::floor(height * image.info.sizeScale)), 1u);
+		} else {
+			image.extent.width = image.info.width;
+			image.extent.height = image.info.height;
+		}
+
+		// Images that are only rendered to within a pass never need to be stored and can be transient
+		const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		const bool transient = ((image.usage & ~attachmentUsage) == 0) && (image.firstPass == image.lastPass);
+
+		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
+		imageCI.imageType = VK_IMAGE_TYPE_2D;
+		imageCI.format = image.info.format;
+		imageCI.extent = { image.extent.width, image.extent.height, 1 };
+		imageCI.mipLevels = 1;
+		imageCI.arrayLayers = 1;
+		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCI.usage = image.usage | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+		imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCI, nullptr, &image.image));
+		vks::debugmarker::setImageName(device->logicalDevice, image.image, image.name.c_str());
+		memory->addImage(image.image, image.firstPass, image.lastPass, transient);
+		created.push_back(&image);
+	}
+	memory->allocate();
+
+	for (auto image : created) {
+		VkImageViewCreateInfo viewCI = vks::initializers::imageViewCreateInfo();
+		viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCI.format = image->info.format;
+		// Only the depth aspect is used for both the attachment and sampling
+		viewCI.subresourceRange.aspectMask = isDepthFormat(image->info.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		viewCI.subresourceRange.levelCount = 1;
+		viewCI.subresourceRange.layerCount = 1;
+		viewCI.image = image->image;
+		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCI, nullptr, &image->view));
+	}
+}
+
+void vks::RenderGraph::destroyImages(bool relativeSize)
+{
+	for (auto& image : images) {
+		if ((image.image == VK_NULL_HANDLE) || (isRelativeSize(image) != relativeSize)) {
+			continue;
+		}
+		vkDestroyImageView(device->logicalDevice, image.view, nullptr);
+		vkDestroyImage(device->logicalDevice, image.image, nullptr);
+		image.view = VK_NULL_HANDLE;
+		image.image = VK_NULL_HANDLE;
+	}
+	if (relativeSize) {
+		relativeMemory.reset();
+	} else {
+		fixedMemory.reset();
+	}
+}
+
+void vks::RenderGraph::createRenderPass(Pass& pass, uint32_t passIndex)
+{
+	std::vector<VkAttachmentDescription> attachmentDescriptions;
+	std::vector<VkAttachmentReference> colorReferences;
+	VkAttachmentReference depthReference{};
+	bool hasDepth = false;
+	pass.clearValues.clear();
+
+	for (auto& access : pass.accesses) {
+		if ((access.type != Pass::AccessType::ColorOutput) && (access.type != Pass::AccessType::DepthStencilOutput)) {
+			continue;
+		}
+		const Image& image = images[access.image];
+		const bool depth = (access.type == Pass::AccessType::DepthStencilOutput);
+		const VkImageLayout layout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentDescription description{};
+		description.format = image.info.format;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		// Contents are only loaded if an earlier pass wrote them and only stored if a later pass or an output reads them
+		if (access.clear) {
+			description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		} else {
+			description.loadOp = (image.firstPass < passIndex) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		description.storeOp = (image.lastPass > passIndex) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		// Layout transitions are done by the barriers of the graph
+		description.initialLayout = layout;
+		description.finalLayout = layout;
+
+		const uint32_t attachmentIndex = static_cast<uint32_t>(attachmentDescriptions.size());
+		attachmentDescriptions.push_back(description);
+		pass.clearValues.push_back(access.clearValue);
+		if (depth) {
+			assert(!hasDepth);
+			depthReference = { attachmentIndex, layout };
+			hasDepth = true;
+		} else {
+			colorReferences.push_back({ attachmentIndex, layout });
+		}
+	}
+	assert(!attachmentDescriptions.empty());
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+	subpass.pColorAttachments = colorReferences.data();
+	subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+	// No subpass dependencies, all synchronization is done with the pipeline barriers recorded before the render pass
+	VkRenderPassCreateInfo renderPassCI = vks::initializers::renderPassCreateInfo();
+	renderPassCI.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
+	renderPassCI.pAttachments = attachmentDescriptions.data();
+	renderPassCI.subpassCount = 1;
+	renderPassCI.pSubpasses = &subpass;
+	VK_CHECK_RESULT(vkCreateRenderPass(device->logicalDevice, &renderPassCI, nullptr, &pass.renderPass));
+	vks::debugmarker::setRenderPassName(device->logicalDevice, pass.renderPass, pass.name.c_str());
+}
+
+void vks::RenderGraph::createFramebuffer(Pass& pass)
+{
+	std::vector<VkImageView> attachments;
+	pass.extent = {};
+	for (auto& access : pass.accesses) {
+		if ((access.type != Pass::AccessType::ColorOutput) && (access.type != Pass::AccessType::DepthStencilOutput)) {
+			continue;
+		}
+		const Image& image = images[access.image];
+		if (attachments.empty()) {
+			pass.extent = image.extent;
+		}
+		// All attachments of a pass need to have the same size
+		assert((image.extent.width == pass.extent.width) && (image.extent.height == pass.extent.height));
+		attachments.push_back(image.view);
+	}
+
+	VkFramebufferCreateInfo framebufferCI = vks::initializers::framebufferCreateInfo();
+	framebufferCI.renderPass = pass.renderPass;
+	framebufferCI.attachmentCount = static_cast<uint32_t>(attachments.size());
+	framebufferCI.pAttachments = attachments.data();
+	framebufferCI.width = pass.extent.width;
+	framebufferCI.height = pass.extent.height;
+	framebufferCI.layers = 1;
+	VK_CHECK_RESULT(vkCreateFramebuffer(device->logicalDevice, &framebufferCI, nullptr, &pass.framebuffer));
+}
+
+void vks::RenderGraph::buildBarriers()
+{
+	auto getInfo = [](const Pass::Access& access) {
+		return getAccessInfo(access.clear, access.type == Pass::AccessType::ColorOutput, access.type == Pass::AccessType::DepthStencilOutput,
+			(access.type == Pass::AccessType::StorageInput) || (access.type == Pass::AccessType::StorageOutput), access.type == Pass::AccessType::StorageOutput, access.stages);
+	};
+
+	auto getMemory = [this](const Image& image) {
+		return isRelativeSize(image) ? relativeMemory.get() : fixedMemory.get();
+	};
+
+	// Applies an access to the tracked state of an image, returns true if a barrier is needed and fills it
+	auto applyAccess = [](ImageState& state, const AccessInfo& info, VkImageMemoryBarrier& barrier, VkPipelineStageFlags& srcStages) {
+		bool needsBarrier;
+		if (!state.used) {
+			// First use in the frame, previous contents are discarded (source stages are added by the caller)
+			needsBarrier = true;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			srcStages = 0;
+			barrier.srcAccessMask = 0;
+		} else {
+			const bool layoutChange = (state.layout != info.layout);
+			// Read after write is only a hazard for stages the write has not been made visible to yet, write after read and write after write always are
+			const bool readAfterWrite = (state.writeAccess != 0) && ((info.stages & ~state.visibleStages) != 0);
+			const bool writeHazard = info.write && ((state.writeStages | state.readStages) != 0);
+			needsBarrier = layoutChange || readAfterWrite || writeHazard;
+			barrier.oldLayout = state.layout;
+			srcStages = state.writeStages | (info.write || layoutChange ? state.readStages : 0);
+			barrier.srcAccessMask = state.writeAccess;
+		}
+		barrier.newLayout = info.layout;
+		barrier.dstAccessMask = info.access;
+
+		state.used = true;
+		state.layout = info.layout;
+		if (info.write) {
+			state.writeStages = info.stages;
+			state.writeAccess = info.access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+			state.visibleStages = 0;
+			state.readStages = 0;
+		} else {
+			state.readStages |= info.stages;
+			if (needsBarrier) {
+				state.visibleStages |= info.stages;
+			}
+		}
+		return needsBarrier;
+	};
+
+	// Replays the frame, the first run only determines the state of all images at the end of the frame
+	std::vector<ImageState> finalStates;
+	for (uint32_t run = 0; run < 2; run++) {
+		std::vector<ImageState> states(images.size());
+		const bool emit = (run == 1);
+
+		auto addBarrier = [&](Resource resource, const AccessInfo& info, std::vector<VkImageMemoryBarrier>& barriers, VkPipelineStageFlags& srcStageMask, VkPipelineStageFlags& dstStageMask) {
+			const bool firstUse = !states[resource].used;
+			VkImageMemoryBarrier barrier = vks::initializers::imageMemoryBarrier();
+			VkPipelineStageFlags srcStages = 0;
+			if (!applyAccess(states[resource], info, barrier, srcStages) || !emit) {
+				return;
+			}
+			const Image& image = images[resource];
+			if (firstUse) {
+				// Wait for the last use of this image and of all images sharing its memory
+				for (size_t i = 0; i < images.size(); i++) {
+					if ((i == resource) || (images[i].used && (isRelativeSize(images[i]) == isRelativeSize(image)) && getMemory(image)->isAliased(image.image, images[i].image))) {
+						srcStages |= finalStates[i].writeStages | finalStates[i].readStages;
+						barrier.srcAccessMask |= finalStates[i].writeAccess;
+					}
+				}
+			}
+			barrier.image = image.image;
+			barrier.subresourceRange.aspectMask = isDepthFormat(image.info.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+			if (hasStencil(image.info.format)) {
+				barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+			}
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+			barriers.push_back(barrier);
+			srcStageMask |= srcStages;
+			dstStageMask |= info.stages;
+		};
+
+		for (auto& pass : passes) {
+			pass->barriers.clear();
+			pass->srcStageMask = 0;
+			pass->dstStageMask = 0;
+			if (pass->culled) {
+				continue;
+			}
+			for (auto& access : pass->accesses) {
+				addBarrier(access.image, getInfo(access), pass->barriers, pass->srcStageMask, pass->dstStageMask);
+			}
+		}
+
+		outputBarriers.clear();
+		outputSrcStageMask = 0;
+		outputDstStageMask = 0;
+		for (Resource i = 0; i < static_cast<Resource>(images.size()); i++) {
+			if (images[i].output) {
+				addBarrier(i, getAccessInfo(false, false, false, false, false, images[i].outputStages), outputBarriers, outputSrcStageMask, outputDstStageMask);
+			}
+		}
+
+		finalStates = states;
+	}
+}
+
+void vks::RenderGraph::record(VkCommandBuffer commandBuffer)
+{
+	assert(compiled);
+	for (auto& pass : passes) {
+		if (pass->culled) {
+			continue;
+		}
+		vks::debugmarker::beginRegion(commandBuffer, pass->name.c_str(), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+		if (!pass->barriers.empty()) {
+			const VkPipelineStageFlags srcStageMask = pass->srcStageMask != 0 ? pass->srcStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, srcStageMask, pass->dstStageMask, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(pass->barriers.size()), pass->barriers.data());
+		}
+		if (pass->type == PassType::Graphics) {
+			VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+			renderPassBeginInfo.renderPass = pass->renderPass;
+			renderPassBeginInfo.framebuffer = pass->framebuffer;
+			renderPassBeginInfo.renderArea.extent = pass->extent;
+			renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(pass->clearValues.size());
+			renderPassBeginInfo.pClearValues = pass->clearValues.data();
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			if (pass->recordFunction) {
+				pass->recordFunction(commandBuffer);
+			}
+			vkCmdEndRenderPass(commandBuffer);
+		} else if (pass->recordFunction) {
+			pass->recordFunction(commandBuffer);
+		}
+		vks::debugmarker::endRegion(commandBuffer);
+	}
+	if (!outputBarriers.empty()) {
+		const VkPipelineStageFlags srcStageMask = outputSrcStageMask != 0 ? outputSrcStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, srcStageMask, outputDstStageMask, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(outputBarriers.size()), outputBarriers.data());
+	}
+}
+
+VkImageView vks::RenderGraph::getImageView(Resource image) const
+{
+	return images[image].view;
+}
+
+VkDescriptorImageInfo vks::RenderGraph::getDescriptor(Resource image, VkSampler sampler) const
+{
+	return vks::initializers::descriptorImageInfo(sampler, images[image].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+uint32_t vks::RenderGraph::getCulledPassCount() const
+{
+	return static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(), [](const std::unique_ptr<Pass>& pass) { return pass->culled; }));
+}
+
+uint32_t vks::RenderGraph::getBarrierCount() const
+{
+	size_t count = outputBarriers.size();
+	for (auto& pass : passes) {
+		count += pass->barriers.size();
+	}
+	return static_cast<uint32_t>(count);
+}
+
+VkDeviceSize vks::RenderGraph::getAllocatedSize() const
+{
+	return (fixedMemory ? fixedMemory->getAllocatedSize() : 0) + (relativeMemory ? relativeMemory->getAllocatedSize() : 0);
+}
+
+VkDeviceSize vks::RenderGraph::getRequiredSize() const
+{
+	return (fixedMemory ? fixedMemory->getRequiredSize() : 0) + (relativeMemory ? relativeMemory->getRequiredSize() : 0);
+}
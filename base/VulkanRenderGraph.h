@@ -0,0 +1,191 @@
+/*
+* Render graph for multi pass rendering
+*
+* Passes declare the images they read and write instead of setting up render passes, framebuffers and barriers by hand.
+* On compile the graph culls passes that don't contribute to an output, creates the images with aliased memory based on
+* the range of passes they are used in, creates render passes and framebuffers, and derives one batched pipeline
+* barrier per pass with the exact stages and accesses of the previous and next use of each image
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include "VulkanTools.h"
+#include "VulkanAliasedMemory.h"
+
+namespace vks
+{
+	class RenderGraph
+	{
+	public:
+		/** @brief Handle of an image created by the graph */
+		typedef uint32_t Resource;
+
+		/** @brief Records the commands of a pass, graphics passes are recorded inside their render pass */
+		typedef std::function<void(VkCommandBuffer commandBuffer)> RecordFunction;
+
+		enum class PassType {
+			// Renders into color and depth attachments, the graph creates a render pass and framebuffer
+			Graphics = 0,
+			// Only reads and writes images through descriptors, e.g. a compute dispatch
+			Compute = 1
+		};
+
+		struct ImageInfo {
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			// Size relative to the size passed to compile and resize, used if no fixed size is set
+			float sizeScale = 1.0f;
+			// Fixed size, images with a fixed size are not recreated on resize
+			uint32_t width = 0;
+			uint32_t height = 0;
+		};
+
+		class Pass
+		{
+		public:
+			/** @brief Renders into the image as a color attachment, the attachment is cleared if a clear value is given and loaded otherwise */
+			Pass& addColorOutput(Resource image, const VkClearColorValue* clearValue = nullptr);
+			/** @brief Uses the image as the depth attachment, the attachment is cleared if a clear value is given and loaded otherwise (stencil contents are not preserved) */
+			Pass& setDepthStencilOutput(Resource image, const VkClearDepthStencilValue* clearValue = nullptr);
+			/** @brief Samples the image in the given shader stages */
+			Pass& addTextureInput(Resource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			/** @brief Reads the image as a storage image in the given shader stages */
+			Pass& addStorageInput(Resource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			/** @brief Writes the image as a storage image in the given shader stages, previous contents are preserved */
+			Pass& addStorageOutput(Resource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			/** @brief Sets the function recording the commands of this pass */
+			Pass& setRecordFunction(RecordFunction recordFunction);
+
+			/** @brief Render pass of a graphics pass for pipeline creation, valid after compile and kept on resize */
+			VkRenderPass getRenderPass() const;
+			/** @brief Size of the attachments of a graphics pass, valid after compile and resize */
+			VkExtent2D getExtent() const;
+			/** @brief True if the pass doesn't contribute to any output and is skipped */
+			bool isCulled() const;
+
+			Pass(const std::string& name, PassType type);
+
+		private:
+			friend class RenderGraph;
+
+			enum class AccessType {
+				ColorOutput,
+				DepthStencilOutput,
+				TextureInput,
+				StorageInput,
+				StorageOutput
+			};
+
+			struct Access {
+				Resource image;
+				AccessType type;
+				VkPipelineStageFlags stages;
+				bool clear;
+				VkClearValue clearValue;
+			};
+
+			std::string name;
+			PassType type;
+			std::vector<Access> accesses;
+			RecordFunction recordFunction;
+			bool culled = false;
+
+			VkRenderPass renderPass = VK_NULL_HANDLE;
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+			VkExtent2D extent{};
+			std::vector<VkClearValue> clearValues;
+			std::vector<VkImageMemoryBarrier> barriers;
+			VkPipelineStageFlags srcStageMask = 0;
+			VkPipelineStageFlags dstStageMask = 0;
+		};
+
+		/**
+		* @param device Device to create the images and render passes on
+		*/
+		RenderGraph(vks::VulkanDevice* device);
+		~RenderGraph();
+
+		/** @brief Declares an image, it's only created on compile if a pass that isn't culled uses it */
+		Resource createImage(const std::string& name, const ImageInfo& info);
+
+		/** @brief Adds a pass, passes are executed in the order they have been added */
+		Pass& addPass(const std::string& name, PassType type = PassType::Graphics);
+
+		/**
+		* Marks an image as read after the graph has been recorded (e.g. sampled by the pass rendering to the swap chain)
+		* Outputs are transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL at the end of the graph, passes that don't
+		* contribute to an output are culled
+		*/
+		void addOutput(Resource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+		/** @brief Culls passes and creates all images, render passes, framebuffers and barriers, relative image sizes are based on the given size */
+		void compile(uint32_t width, uint32_t height);
+
+		/** @brief Recreates the images with a relative size and the framebuffers using them, descriptors referencing these images need to be updated */
+		void resize(uint32_t width, uint32_t height);
+
+		/** @brief Records all passes that have not been culled with their barriers, must be recorded outside of a render pass */
+		void record(VkCommandBuffer commandBuffer);
+
+		/** @brief View of an image for use in descriptors, changes on resize for images with a relative size */
+		VkImageView getImageView(Resource image) const;
+
+		/** @brief Descriptor for sampling an image in a pass or from an output */
+		VkDescriptorImageInfo getDescriptor(Resource image, VkSampler sampler) const;
+
+		/** @brief Number of passes skipped as they don't contribute to an output */
+		uint32_t getCulledPassCount() const;
+
+		/** @brief Number of image barriers recorded per execution of the graph */
+		uint32_t getBarrierCount() const;
+
+		/** @brief Size of the image memory allocated for the graph */
+		VkDeviceSize getAllocatedSize() const;
+
+		/** @brief Size of the image memory without aliasing */
+		VkDeviceSize getRequiredSize() const;
+
+	private:
+		struct Image {
+			std::string name;
+			ImageInfo info;
+			VkImageUsageFlags usage = 0;
+			bool used = false;
+			// Range of passes (indices into passes) using the image, outputs stay alive until the end of the graph
+			uint32_t firstPass = 0;
+			uint32_t lastPass = 0;
+			bool output = false;
+			VkPipelineStageFlags outputStages = 0;
+			VkExtent2D extent{};
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+		};
+
+		vks::VulkanDevice* device;
+		std::vector<Image> images;
+		std::vector<std::unique_ptr<Pass>> passes;
+		// Images with a fixed size and images with a size relative to the graph are placed in separate memory, so a resize only reallocates the latter
+		std::unique_ptr<vks::AliasedMemory> fixedMemory;
+		std::unique_ptr<vks::AliasedMemory> relativeMemory;
+		std::vector<VkImageMemoryBarrier> outputBarriers;
+		VkPipelineStageFlags outputSrcStageMask = 0;
+		VkPipelineStageFlags outputDstStageMask = 0;
+		bool compiled = false;
+
+		void cullPasses();
+		void createRenderPass(Pass& pass, uint32_t passIndex);
+		void createImages(bool relativeSize, uint32_t width, uint32_t height);
+		void destroyImages(bool relativeSize);
+		void createFramebuffer(Pass& pass);
+		void buildBarriers();
+		bool isRelativeSize(const Image& image) const;
+	};
+}
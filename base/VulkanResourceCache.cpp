@@ -0,0 +1,323 @@
+/*
+* Shared texture and sampler cache
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanResourceCache.h"
+
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <sys/stat.h>
+#include <utility>
+
+#include "VulkanTools.h"
+
+bool vks::TextureCache::enabled = true;
+
+namespace
+{
+	// All parameters of a sampler create info, packed without padding so keys can be compared with memcmp
+	struct SamplerKey {
+		VkDevice device;
+		uint32_t values[16];
+		bool operator<(const SamplerKey& other) const
+		{
+			if (device != other.device) {
+				return device < other.device;
+			}
+			return memcmp(values, other.values, sizeof(values)) < 0;
+		}
+	};
+
+	struct CachedSampler {
+		VkSampler sampler;
+		uint32_t refCount;
+	};
+
+	struct CachedTexture {
+		vks::TextureCache::Entry entry;
+		uint32_t refCount;
+		// Secondary check of the key the image was inserted with
+		uint64_t dataSize;
+		uint64_t checkHash;
+	};
+
+	typedef std::pair<VkDevice, vks::TextureCache::Key> TextureKey;
+
+	std::mutex samplerMutex;
+	std::map<SamplerKey, CachedSampler> samplers;
+	std::map<VkSampler, SamplerKey> samplerKeys;
+
+	std::mutex textureMutex;
+	std::map<TextureKey, CachedTexture> textures;
+	std::map<VkImage, TextureKey> textureKeys;
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	SamplerKey samplerKey(VkDevice device, const VkSamplerCreateInfo& createInfo)
+	{
+		SamplerKey key;
+		key.device = device;
+		key.values[0] = createInfo.flags;
+		key.values[1] = createInfo.magFilter;
+		key.values[2] = createInfo.minFilter;
+		key.values[3] = createInfo.mipmapMode;
+		key.values[4] = createInfo.addressModeU;
+		key.values[5] = createInfo.addressModeV;
+		key.values[6] = createInfo.addressModeW;
+		key.values[7] = floatBits(createInfo.mipLodBias);
+		key.values[8] = createInfo.anisotropyEnable;
+		key.values[9] = floatBits(createInfo.maxAnisotropy);
+		key.values[10] = createInfo.compareEnable;
+		key.values[11] = createInfo.compareOp;
+		key.values[12] = floatBits(createInfo.minLod);
+		key.values[13] = floatBits(createInfo.maxLod);
+		key.values[14] = createInfo.borderColor;
+		key.values[15] = createInfo.unnormalizedCoordinates;
+		return key;
+	}
+
+	const uint64_t prime1 = 11400714785074694791ull;
+	const uint64_t prime2 = 14029467366897019727ull;
+	const uint64_t prime3 = 1609587929392839161ull;
+	const uint64_t prime4 = 9650029242287828579ull;
+	const uint64_t prime5 = 2870177450012600261ull;
+	// Seed of the secondary hash, any value different from the content hash's seed gives an independent hash
+	const uint64_t checkSeed = 0x9e3779b97f4a7c15ull;
+
+	uint64_t rotl(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	uint64_t read64(const uint8_t* bytes)
+	{
+		uint64_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	uint64_t read32(const uint8_t* bytes)
+	{
+		uint32_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	uint64_t hashRound(uint64_t acc, uint64_t input)
+	{
+		acc += input * prime2;
+		acc = rotl(acc, 31);
+		return acc * prime1;
+	}
+
+	uint64_t hashMerge(uint64_t acc, uint64_t value)
+	{
+		acc ^= hashRound(0, value);
+		return acc * prime1 + prime4;
+	}
+
+	void destroyTexture(VkDevice device, VkImage image, VkImageView view, VkDeviceMemory memory)
+	{
+		vkDestroyImageView(device, view, nullptr);
+		vkDestroyImage(device, image, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+	}
+}
+
+VkSampler vks::SamplerCache::acquire(VkDevice device, const VkSamplerCreateInfo& createInfo)
+{
+	VkSampler sampler;
+	// Extension structures can't be compared generically
+	if (createInfo.pNext) {
+		VK_CHECK_RESULT(vkCreateSampler(device, &createInfo, nullptr, &sampler));
+		return sampler;
+	}
+	const SamplerKey key = samplerKey(device, createInfo);
+	std::lock_guard<std::mutex> lock(samplerMutex);
+	auto cached = samplers.find(key);
+	if (cached != samplers.end()) {
+		cached->second.refCount++;
+		return cached->second.sampler;
+	}
+	VK_CHECK_RESULT(vkCreateSampler(device, &createInfo, nullptr, &sampler));
+	samplers[key] = { sampler, 1 };
+	samplerKeys[sampler] = key;
+	return sampler;
+}
+
+void vks::SamplerCache::release(VkDevice device, VkSampler sampler)
+{
+	if (sampler == VK_NULL_HANDLE) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(samplerMutex);
+	auto key = samplerKeys.find(sampler);
+	if (key == samplerKeys.end()) {
+		vkDestroySampler(device, sampler, nullptr);
+		return;
+	}
+	auto cached = samplers.find(key->second);
+	if (--cached->second.refCount == 0) {
+		vkDestroySampler(device, sampler, nullptr);
+		samplers.erase(cached);
+		samplerKeys.erase(key);
+	}
+}
+
+bool vks::TextureCache::Key::operator<(const Key& other) const
+{
+	if (contentHash != other.contentHash) {
+		return contentHash < other.contentHash;
+	}
+	if (format != other.format) {
+		return format < other.format;
+	}
+	if (usage != other.usage) {
+		return usage < other.usage;
+	}
+	if (layout != other.layout) {
+		return layout < other.layout;
+	}
+	if (viewType != other.viewType) {
+		return viewType < other.viewType;
+	}
+	return variant < other.variant;
+}
+
+void vks::TextureCache::Key::setContents(const void* data, size_t size, uint32_t width, uint32_t height)
+{
+	const uint32_t dimensions[2] = { width, height };
+	contentHash = TextureCache::hash(data, size, TextureCache::hash(dimensions, sizeof(dimensions)));
+	checkHash = TextureCache::hash(data, size, checkSeed);
+	dataSize = size;
+	this->width = width;
+	this->height = height;
+}
+
+uint64_t vks::TextureCache::hash(const void* data, size_t size, uint64_t seed)
+{
+	// XXH64, four independent lanes over 32 byte stripes followed by a final avalanche so high bits of the input reach the low bits of the hash
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+	uint64_t hash;
+	if (size >= 32) {
+		uint64_t lanes[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+		for (; bytes + 32 <= end; bytes += 32) {
+			for (uint32_t i = 0; i < 4; i++) {
+				lanes[i] = hashRound(lanes[i], read64(bytes + i * 8));
+			}
+		}
+		hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+		for (uint32_t i = 0; i < 4; i++) {
+			hash = hashMerge(hash, lanes[i]);
+		}
+	}
+	else {
+		hash = seed + prime5;
+	}
+	hash += static_cast<uint64_t>(size);
+	for (; bytes + 8 <= end; bytes += 8) {
+		hash ^= hashRound(0, read64(bytes));
+		hash = rotl(hash, 27) * prime1 + prime4;
+	}
+	if (bytes + 4 <= end) {
+		hash ^= read32(bytes) * prime1;
+		hash = rotl(hash, 23) * prime2 + prime3;
+		bytes += 4;
+	}
+	for (; bytes < end; bytes++) {
+		hash ^= (*bytes) * prime5;
+		hash = rotl(hash, 11) * prime1;
+	}
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t vks::TextureCache::hashFile(const std::string& filename)
+{
+	uint64_t hash = TextureCache::hash(filename.data(), filename.size());
+#if defined(__ANDROID__)
+	// Assets are read-only, so name and size identify them
+	AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_UNKNOWN);
+	if (!asset) {
+		return 0;
+	}
+	const uint64_t size = static_cast<uint64_t>(AAsset_getLength64(asset));
+	AAsset_close(asset);
+	return TextureCache::hash(&size, sizeof(size), hash);
+#else
+	struct stat fileStat;
+	if (stat(filename.c_str(), &fileStat) != 0) {
+		return 0;
+	}
+	const uint64_t values[2] = { static_cast<uint64_t>(fileStat.st_size), static_cast<uint64_t>(fileStat.st_mtime) };
+	return TextureCache::hash(values, sizeof(values), hash);
+#endif
+}
+
+bool vks::TextureCache::isCacheable(VkImageUsageFlags usage)
+{
+	return (usage & ~(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) == 0;
+}
+
+bool vks::TextureCache::acquire(VkDevice device, const Key& key, Entry& entry)
+{
+	if (!enabled || (key.contentHash == 0) || !isCacheable(key.usage)) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(textureMutex);
+	auto cached = textures.find(TextureKey(device, key));
+	if (cached == textures.end()) {
+		return false;
+	}
+	// Only share the image if the secondary check matches too, otherwise the key's content hash collided with another image
+	const CachedTexture& texture = cached->second;
+	if ((texture.dataSize != key.dataSize) || (texture.checkHash != key.checkHash) || (key.width && (texture.entry.width != key.width)) || (key.height && (texture.entry.height != key.height))) {
+		return false;
+	}
+	cached->second.refCount++;
+	entry = cached->second.entry;
+	return true;
+}
+
+void vks::TextureCache::insert(VkDevice device, const Key& key, const Entry& entry)
+{
+	if (!enabled || (key.contentHash == 0) || !isCacheable(key.usage)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(textureMutex);
+	const TextureKey textureKey(device, key);
+	if (textures.find(textureKey) != textures.end()) {
+		return;
+	}
+	textures[textureKey] = { entry, 1, key.dataSize, key.checkHash };
+	textureKeys[entry.image] = textureKey;
+}
+
+void vks::TextureCache::release(VkDevice device, VkImage image, VkImageView view, VkDeviceMemory memory)
+{
+	std::lock_guard<std::mutex> lock(textureMutex);
+	auto key = textureKeys.find(image);
+	if (key == textureKeys.end()) {
+		destroyTexture(device, image, view, memory);
+		return;
+	}
+	auto cached = textures.find(key->second);
+	if (--cached->second.refCount == 0) {
+		destroyTexture(device, image, view, memory);
+		textures.erase(cached);
+		textureKeys.erase(key);
+	}
+}
@@ -0,0 +1,91 @@
+/*
+* Shared texture and sampler cache
+*
+* Process-wide, reference counted caches that let texture loaders share GPU resources: images are keyed by a hash of
+* their contents plus everything that changes the uploaded data (format, usage, layout, view type), samplers are keyed
+* by their create info. Loading the same asset from multiple models or textures returns the existing image and sampler
+* instead of uploading another copy
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "vulkan/vulkan.h"
+
+namespace vks
+{
+	class SamplerCache
+	{
+	public:
+		/**
+		* Returns a sampler matching the create info, the sampler is created on the first request
+		* @note Create infos with a pNext chain are not cached, each request creates a new sampler
+		*/
+		static VkSampler acquire(VkDevice device, const VkSamplerCreateInfo& createInfo);
+		/** @brief Releases a reference, the sampler is destroyed with its last reference (samplers not created by the cache are destroyed immediately) */
+		static void release(VkDevice device, VkSampler sampler);
+	};
+
+	class TextureCache
+	{
+	public:
+		struct Key {
+			// Hash of the source data, zero disables caching for the image
+			uint64_t contentHash = 0;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			// Usage requested by the loader's caller, not including the flags the loader adds for its own uploads
+			VkImageUsageFlags usage = 0;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+			// Loader specific options that change the contents of the image (e.g. the mip generation filter)
+			uint32_t variant = 0;
+			// Not part of the lookup, compared on a hit so a collision of the content hash doesn't share an unrelated image
+			// Zero values (e.g. for keys identifying a file) are not checked
+			uint64_t dataSize = 0;
+			uint64_t checkHash = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			bool operator<(const Key& other) const;
+			/** @brief Identifies the image by its source data, sets the content hash and all values of the secondary check */
+			void setContents(const void* data, size_t size, uint32_t width, uint32_t height);
+		};
+
+		struct Entry {
+			VkImage image = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t mipLevels = 0;
+			uint32_t layerCount = 0;
+		};
+
+		/** @brief Globally enables or disables sharing images, images that are already shared stay valid */
+		static bool enabled;
+
+		/** @brief 64 bit xxHash of the data, every input bit affects all bits of the result */
+		static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+		/**
+		* Identifies a file by its name, size and modification time, so loaders that stream their data don't have to read the whole file up front
+		* Returns zero if the file doesn't exist
+		*/
+		static uint64_t hashFile(const std::string& filename);
+		/** @brief Only images that are never written after loading can be shared, i.e. images that are only sampled (and possibly copied from) */
+		static bool isCacheable(VkImageUsageFlags usage);
+
+		/** @brief Looks up an image, on a hit the entry is filled and a reference is added */
+		static bool acquire(VkDevice device, const Key& key, Entry& entry);
+		/**
+		* Adds a newly created image with one reference
+		* If the key is not cacheable or another image has been added for the key in the meantime, the image stays private and release destroys it directly
+		*/
+		static void insert(VkDevice device, const Key& key, const Entry& entry);
+		/** @brief Releases a reference, the image, its view and memory are destroyed with the last reference (images not in the cache are destroyed immediately) */
+		static void release(VkDevice device, VkImage image, VkImageView view, VkDeviceMemory memory);
+	};
+}
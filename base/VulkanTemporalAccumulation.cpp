@@ -0,0 +1,331 @@
+/*
+* Temporal accumulation and reprojection for ray traced effects
+*
+* Each frame runs one accumulation pass, which merges the new samples with the reprojected history (or reconstructs
+* pixels without a sample from their traced neighbours), copies the result to the history images for the next frame
+* and runs a number of a-trous filter iterations with growing step sizes, the last one writing to the output image
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanTemporalAccumulation.h"
+
+#include <algorithm>
+
+namespace
+{
+	struct FilterPushConstants {
+		int32_t stepSize;
+		int32_t firstIteration;
+		int32_t lastIteration;
+		float colorSigma;
+		float distanceSigma;
+	};
+
+	VkPipeline createComputePipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkShaderModule shaderModule)
+	{
+		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+		computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePipelineCreateInfo.stage.module = shaderModule;
+		computePipelineCreateInfo.stage.pName = "main";
+		VkPipeline pipeline;
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+		return pipeline;
+	}
+
+	void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+	{
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = srcAccessMask;
+		memoryBarrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+vks::TemporalAccumulation::TemporalAccumulation(vks::VulkanDevice* device, const std::string& shadersPath)
+{
+	this->device = device;
+
+	accumulationShader = vks::tools::loadOptionalShader(shadersPath + "temporalaccumulation.comp.spv", device->logicalDevice);
+	filterShader = vks::tools::loadOptionalShader(shadersPath + "atrousfilter.comp.spv", device->logicalDevice);
+	if ((accumulationShader == VK_NULL_HANDLE) || (filterShader == VK_NULL_HANDLE)) {
+		std::cerr << "Temporal accumulation is not available\n";
+		return;
+	}
+
+	// Accumulation pass
+	// Binding 0: New samples, binding 1: New distances, binding 2: History color, binding 3: History moments, binding 4: Accumulated color, binding 5: Accumulated moments, binding 6: Uniform buffer
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+	for (uint32_t i = 0; i < 6; i++) {
+		setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, i));
+	}
+	setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 6));
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayout, nullptr, &accumulation.descriptorSetLayout));
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&accumulation.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &accumulation.pipelineLayout));
+	accumulation.pipeline = createComputePipeline(device->logicalDevice, accumulation.pipelineLayout, accumulationShader);
+
+	// Filter pass
+	// Binding 0: Input color, binding 1: Accumulated moments, binding 2: Output color, binding 3: Final output
+	setLayoutBindings.clear();
+	for (uint32_t i = 0; i < 4; i++) {
+		setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, i));
+	}
+	descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayout, nullptr, &filter.descriptorSetLayout));
+	VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(FilterPushConstants), 0);
+	pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&filter.descriptorSetLayout, 1);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &filter.pipelineLayout));
+	filter.pipeline = createComputePipeline(device->logicalDevice, filter.pipelineLayout, filterShader);
+
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6 + 3 * 4),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 4);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+	VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &accumulation.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &accumulation.descriptorSet));
+	for (auto& descriptorSet : filter.descriptorSets) {
+		allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &filter.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+	}
+
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, sizeof(UniformData)));
+	VK_CHECK_RESULT(uniformBuffer.map());
+}
+
+vks::TemporalAccumulation::~TemporalAccumulation()
+{
+	destroyImages();
+	if (accumulation.pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device->logicalDevice, accumulation.pipeline, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, accumulation.pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, accumulation.descriptorSetLayout, nullptr);
+		vkDestroyPipeline(device->logicalDevice, filter.pipeline, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, filter.pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, filter.descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+		uniformBuffer.destroy();
+	}
+	if (accumulationShader != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device->logicalDevice, accumulationShader, nullptr);
+	}
+	if (filterShader != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device->logicalDevice, filterShader, nullptr);
+	}
+}
+
+bool vks::TemporalAccumulation::isAvailable() const
+{
+	return accumulation.pipeline != VK_NULL_HANDLE;
+}
+
+bool vks::TemporalAccumulation::isSupported(const std::string& shadersPath)
+{
+	return vks::tools::shaderAvailable(shadersPath + "temporalaccumulation.comp.spv") && vks::tools::shaderAvailable(shadersPath + "atrousfilter.comp.spv");
+}
+
+void vks::TemporalAccumulation::createImage(Image& image, VkFormat format, VkImageUsageFlags usage)
+{
+	VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.extent = { width, height, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | usage;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image.image));
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(device->logicalDevice, image.image, &memReqs);
+	VkMemoryAllocateInfo memoryAllocateInfo = vks::initializers::memoryAllocateInfo();
+	memoryAllocateInfo.allocationSize = memReqs.size;
+	memoryAllocateInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memoryAllocateInfo, nullptr, &image.memory));
+	VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image.image, image.memory, 0));
+
+	VkImageViewCreateInfo imageViewCreateInfo = vks::initializers::imageViewCreateInfo();
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = format;
+	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	imageViewCreateInfo.image = image.image;
+	VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &imageViewCreateInfo, nullptr, &image.view));
+}
+
+void vks::TemporalAccumulation::destroyImage(Image& image)
+{
+	if (image.image != VK_NULL_HANDLE) {
+		vkDestroyImageView(device->logicalDevice, image.view, nullptr);
+		vkDestroyImage(device->logicalDevice, image.image, nullptr);
+		vkFreeMemory(device->logicalDevice, image.memory, nullptr);
+		image = {};
+	}
+}
+
+void vks::TemporalAccumulation::destroyImages()
+{
+	destroyImage(images.sample);
+	destroyImage(images.distance);
+	destroyImage(images.color);
+	destroyImage(images.moments);
+	destroyImage(images.historyColor);
+	destroyImage(images.historyMoments);
+	destroyImage(images.filter[0]);
+	destroyImage(images.filter[1]);
+}
+
+void vks::TemporalAccumulation::create(uint32_t width, uint32_t height, VkImageView outputView, VkQueue queue)
+{
+	if (!isAvailable()) {
+		return;
+	}
+	destroyImages();
+	this->width = width;
+	this->height = height;
+
+	// Accumulated color stores the history length in the alpha channel, moments store the first two moments of the luminance and the distance
+	createImage(images.sample, VK_FORMAT_R16G16B16A16_SFLOAT, 0);
+	createImage(images.distance, VK_FORMAT_R32_SFLOAT, 0);
+	createImage(images.color, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	createImage(images.moments, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	createImage(images.historyColor, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+	createImage(images.historyMoments, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+	createImage(images.filter[0], VK_FORMAT_R16G16B16A16_SFLOAT, 0);
+	createImage(images.filter[1], VK_FORMAT_R16G16B16A16_SFLOAT, 0);
+
+	// All images stay in the general layout
+	VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	for (Image* image : { &images.sample, &images.distance, &images.color, &images.moments, &images.historyColor, &images.historyMoments, &images.filter[0], &images.filter[1] }) {
+		vks::tools::setImageLayout(commandBuffer, image->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+	}
+	device->flushCommandBuffer(commandBuffer, queue, true);
+
+	sampleDescriptor = { VK_NULL_HANDLE, images.sample.view, VK_IMAGE_LAYOUT_GENERAL };
+	distanceDescriptor = { VK_NULL_HANDLE, images.distance.view, VK_IMAGE_LAYOUT_GENERAL };
+	VkDescriptorImageInfo historyColorDescriptor = { VK_NULL_HANDLE, images.historyColor.view, VK_IMAGE_LAYOUT_GENERAL };
+	VkDescriptorImageInfo historyMomentsDescriptor = { VK_NULL_HANDLE, images.historyMoments.view, VK_IMAGE_LAYOUT_GENERAL };
+	VkDescriptorImageInfo colorDescriptor = { VK_NULL_HANDLE, images.color.view, VK_IMAGE_LAYOUT_GENERAL };
+	VkDescriptorImageInfo momentsDescriptor = { VK_NULL_HANDLE, images.moments.view, VK_IMAGE_LAYOUT_GENERAL };
+	VkDescriptorImageInfo filterDescriptors[2] = {
+		{ VK_NULL_HANDLE, images.filter[0].view, VK_IMAGE_LAYOUT_GENERAL },
+		{ VK_NULL_HANDLE, images.filter[1].view, VK_IMAGE_LAYOUT_GENERAL }
+	};
+	VkDescriptorImageInfo outputDescriptor = { VK_NULL_HANDLE, outputView, VK_IMAGE_LAYOUT_GENERAL };
+
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &sampleDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &distanceDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &historyColorDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3, &historyMomentsDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4, &colorDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &momentsDescriptor),
+		vks::initializers::writeDescriptorSet(accumulation.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 6, &uniformBuffer.descriptor),
+	};
+	// Iterations read the output of the previous one, the first one reads the accumulated color
+	VkDescriptorImageInfo* filterInputs[3] = { &colorDescriptor, &filterDescriptors[0], &filterDescriptors[1] };
+	VkDescriptorImageInfo* filterOutputs[3] = { &filterDescriptors[0], &filterDescriptors[1], &filterDescriptors[0] };
+	for (uint32_t i = 0; i < 3; i++) {
+		writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(filter.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, filterInputs[i]));
+		writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(filter.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &momentsDescriptor));
+		writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(filter.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, filterOutputs[i]));
+		writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(filter.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3, &outputDescriptor));
+	}
+	vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+	resetHistory();
+}
+
+void vks::TemporalAccumulation::update(const glm::mat4& view, const glm::mat4& projection)
+{
+	uniformData.prevViewProjection = viewProjection;
+	uniformData.prevCameraPos = glm::vec4(cameraPos, 1.0f);
+	viewProjection = projection * view;
+	uniformData.viewInverse = glm::inverse(view);
+	uniformData.projInverse = glm::inverse(projection);
+	cameraPos = glm::vec3(uniformData.viewInverse[3]);
+	uniformData.frame++;
+	uniformData.rayBudget = static_cast<uint32_t>(rayBudget);
+	uniformData.historyValid = historyReset ? 0 : 1;
+	uniformData.maxHistoryLength = std::max(settings.maxHistoryLength, 1u);
+	uniformData.distanceThreshold = settings.distanceThreshold;
+	historyReset = false;
+	if (uniformBuffer.mapped) {
+		memcpy(uniformBuffer.mapped, &uniformData, sizeof(UniformData));
+	}
+}
+
+uint32_t vks::TemporalAccumulation::getFrameIndex() const
+{
+	return uniformData.frame;
+}
+
+VkExtent2D vks::TemporalAccumulation::getTraceExtent() const
+{
+	switch (rayBudget) {
+	case RayBudgetHalf:
+		return { (width + 1) / 2, height };
+	case RayBudgetQuarter:
+		return { (width + 1) / 2, (height + 1) / 2 };
+	default:
+		return { width, height };
+	}
+}
+
+void vks::TemporalAccumulation::resetHistory()
+{
+	historyReset = true;
+}
+
+void vks::TemporalAccumulation::record(VkCommandBuffer commandBuffer)
+{
+	if (!isAvailable()) {
+		return;
+	}
+	const uint32_t groupCountX = (width + 15) / 16;
+	const uint32_t groupCountY = (height + 15) / 16;
+
+	// New samples and the history copied at the end of the last frame
+	computeBarrier(commandBuffer, srcStageMask | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, accumulation.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, accumulation.pipelineLayout, 0, 1, &accumulation.descriptorSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+	// The unfiltered result becomes the history of the next frame
+	computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT);
+	VkImageCopy copyRegion{};
+	copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.extent = { width, height, 1 };
+	vkCmdCopyImage(commandBuffer, images.color.image, VK_IMAGE_LAYOUT_GENERAL, images.historyColor.image, VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+	vkCmdCopyImage(commandBuffer, images.moments.image, VK_IMAGE_LAYOUT_GENERAL, images.historyMoments.image, VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+
+	// A single iteration with a step size of 0 passes the accumulated color through to the output
+	const uint32_t iterationCount = std::max(settings.filterIterations, 1u);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, filter.pipeline);
+	for (uint32_t i = 0; i < iterationCount; i++) {
+		const uint32_t setIndex = (i == 0) ? 0 : ((i % 2 == 1) ? 1 : 2);
+		FilterPushConstants pushConstants{};
+		pushConstants.stepSize = (settings.filterIterations == 0) ? 0 : (1 << i);
+		pushConstants.firstIteration = (i == 0) ? 1 : 0;
+		pushConstants.lastIteration = (i == iterationCount - 1) ? 1 : 0;
+		pushConstants.colorSigma = settings.colorSigma;
+		pushConstants.distanceSigma = settings.distanceSigma;
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, filter.pipelineLayout, 0, 1, &filter.descriptorSets[setIndex], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, filter.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+		if (i < iterationCount - 1) {
+			computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+		}
+	}
+
+	// The output is copied or sampled next, and the ray tracing pass of the next frame overwrites images read above
+	computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | srcStageMask, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
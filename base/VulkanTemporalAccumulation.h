@@ -0,0 +1,152 @@
+/*
+* Temporal accumulation and reprojection for ray traced effects
+*
+* Lets a ray tracing pass trace only a subset of the pixels per frame (see RayBudget) and reconstructs the full image by
+* reprojecting the accumulated history of the previous frames with the camera motion, rejecting history samples that
+* belong to a different surface and smoothing the result with a variance-guided a-trous filter
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTools.h"
+
+#include <glm/glm.hpp>
+
+namespace vks
+{
+	class TemporalAccumulation
+	{
+	public:
+		/*
+			Number of pixels sharing one ray per frame, the traced pixel of each group changes every frame
+			Ray tracing passes launch getTraceExtent() rays and map them to pixels with the same pattern as the accumulation shader:
+				RayBudgetHalf: pixels with ((x + y + frame) & 1) == 0
+				RayBudgetQuarter: pixels with (x & 1) + 2 * (y & 1) == { 0, 3, 1, 2 }[frame & 3]
+		*/
+		enum RayBudget {
+			RayBudgetFull = 1,
+			RayBudgetHalf = 2,
+			RayBudgetQuarter = 4
+		};
+
+		struct Settings {
+			/** @brief Maximum number of accumulated samples, limits the weight of the history */
+			uint32_t maxHistoryLength = 16;
+			/** @brief History samples whose distance to the camera differs by more than this fraction are rejected */
+			float distanceThreshold = 0.05f;
+			/** @brief Number of a-trous filter iterations, changes take effect when the command buffers are recorded again */
+			uint32_t filterIterations = 3;
+			/** @brief Edge stopping factors of the filter for luminance (scaled by the standard deviation) and distance */
+			float colorSigma = 4.0f;
+			float distanceSigma = 1.0f;
+		} settings;
+
+		RayBudget rayBudget = RayBudgetFull;
+		/** @brief Pipeline stages of the ray tracing pass writing the sample and distance images */
+		VkPipelineStageFlags srcStageMask = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+
+		/** @brief Written by the ray tracing pass (rgba16f): color of the traced pixels */
+		VkDescriptorImageInfo sampleDescriptor{};
+		/** @brief Written by the ray tracing pass (r32f): distance of the primary hit from the camera, negative for misses */
+		VkDescriptorImageInfo distanceDescriptor{};
+
+		/**
+		* @param device Device to create the resources on
+		* @param shadersPath Directory with the SPIR-V of the accumulation and filter compute shaders
+		*/
+		TemporalAccumulation(vks::VulkanDevice* device, const std::string& shadersPath = getAssetPath() + "shaders/glsl/base/");
+		~TemporalAccumulation();
+
+		/** @brief True if the compute shaders could be loaded */
+		bool isAvailable() const;
+
+		/** @brief True if the SPIR-V of the compute shaders exists in shadersPath, lets callers check this before creating any resources */
+		static bool isSupported(const std::string& shadersPath = getAssetPath() + "shaders/glsl/base/");
+
+		/**
+		* (Re)creates the images for the given size and discards the history, call again if the output is resized
+		*
+		* @param outputView View of the rgba8 storage image that receives the filtered result (in VK_IMAGE_LAYOUT_GENERAL)
+		*/
+		void create(uint32_t width, uint32_t height, VkImageView outputView, VkQueue queue);
+
+		/** @brief Advances to the next frame and passes the camera of that frame, the previous camera is used for reprojection */
+		void update(const glm::mat4& view, const glm::mat4& projection);
+
+		/** @brief Index of the current frame, ray tracing shaders need it to select the pixels to trace */
+		uint32_t getFrameIndex() const;
+
+		/** @brief Launch size of the ray tracing pass for the current ray budget */
+		VkExtent2D getTraceExtent() const;
+
+		/** @brief Discards the accumulated history with the next frame, e.g. if the scene changed in a way the reprojection can't follow */
+		void resetHistory();
+
+		/** @brief Records the accumulation and filter passes, must be recorded after the ray tracing pass */
+		void record(VkCommandBuffer commandBuffer);
+
+	private:
+		struct Image {
+			VkImage image = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+		};
+		struct {
+			Image sample;
+			Image distance;
+			Image color;
+			Image moments;
+			Image historyColor;
+			Image historyMoments;
+			Image filter[2];
+		} images;
+
+		struct UniformData {
+			glm::mat4 viewInverse;
+			glm::mat4 projInverse;
+			glm::mat4 prevViewProjection;
+			glm::vec4 prevCameraPos;
+			uint32_t frame = 0;
+			uint32_t rayBudget = 1;
+			uint32_t historyValid = 0;
+			uint32_t maxHistoryLength = 16;
+			float distanceThreshold = 0.05f;
+		} uniformData;
+		vks::Buffer uniformBuffer;
+
+		vks::VulkanDevice* device;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		bool historyReset = true;
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		glm::vec3 cameraPos = glm::vec3(0.0f);
+
+		VkShaderModule accumulationShader = VK_NULL_HANDLE;
+		VkShaderModule filterShader = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		struct {
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		} accumulation;
+		struct {
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			// Accumulated color to the first filter image, and between the filter images in both directions
+			VkDescriptorSet descriptorSets[3] = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+		} filter;
+
+		void createImage(Image& image, VkFormat format, VkImageUsageFlags usage);
+		void destroyImage(Image& image);
+		void destroyImages();
+	};
+}
@@ -8,6 +8,21 @@
 
 #include <VulkanTexture.h>
 
+namespace
+{
+	// File loaders identify their source by the file instead of its contents, as the data is streamed after the image has been created
+	vks::TextureCache::Key fileCacheKey(const std::string &filename, VkFormat format, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, VkImageViewType viewType)
+	{
+		vks::TextureCache::Key key;
+		key.contentHash = vks::TextureCache::hashFile(filename);
+		key.format = format;
+		key.usage = imageUsageFlags;
+		key.layout = imageLayout;
+		key.viewType = viewType;
+		return key;
+	}
+}
+
 namespace vks
 {
 	void Texture::updateDescriptor()
@@ -19,13 +34,45 @@ namespace vks
 
 	void Texture::destroy()
 	{
-		vkDestroyImageView(device->logicalDevice, view, nullptr);
-		vkDestroyImage(device->logicalDevice, image, nullptr);
+		// Images and samplers may be shared with other textures, so they are only destroyed with their last reference
+		TextureCache::release(device->logicalDevice, image, view, deviceMemory);
 		if (sampler)
 		{
-			vkDestroySampler(device->logicalDevice, sampler, nullptr);
+			SamplerCache::release(device->logicalDevice, sampler);
+		}
+	}
+
+	// Takes the image, memory and view of a texture with the same source from the cache
+	bool Texture::acquireCachedImage(const TextureCache::Key &key)
+	{
+		TextureCache::Entry entry;
+		if (!TextureCache::acquire(device->logicalDevice, key, entry))
+		{
+			return false;
 		}
-		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+		image = entry.image;
+		deviceMemory = entry.memory;
+		view = entry.view;
+		width = entry.width;
+		height = entry.height;
+		mipLevels = entry.mipLevels;
+		layerCount = entry.layerCount;
+		imageLayout = key.layout;
+		return true;
+	}
+
+	// Shares the image of a newly loaded texture with later loads of the same source
+	void Texture::insertCachedImage(const TextureCache::Key &key)
+	{
+		TextureCache::Entry entry;
+		entry.image = image;
+		entry.memory = deviceMemory;
+		entry.view = view;
+		entry.width = width;
+		entry.height = height;
+		entry.mipLevels = mipLevels;
+		entry.layerCount = layerCount;
+		TextureCache::insert(device->logicalDevice, key, entry);
 	}
 
 	ktxResult Texture::loadKTXFile(std::string filename, ktxTexture **target)
@@ -52,11 +99,80 @@ namespace vks
 		return result;
 	}
 
+	// Opens a KTX file for streaming its image data into staging memory
+	void Texture::openKTXStream(std::string filename, ktx::Stream &stream)
+	{
+		if (!stream.open(filename)) {
+			vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+		}
+	}
+
+	/**
+	* Load a KTX2 file, transcoding Basis Universal payloads to a format supported by the device
+	*
+	* @note The format of the image is taken from the file (or the transcode target), the format passed to loadFromFile is ignored
+	*/
+	void Texture::loadKTX2File(std::string filename, VkImageViewType viewType, VkSamplerAddressMode addressMode, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
+	{
+		this->device = device;
+		this->imageLayout = imageLayout;
+
+		// The transcode target only depends on the device, so a cache hit also skips transcoding
+		const TextureCache::Key cacheKey = fileCacheKey(filename, VK_FORMAT_UNDEFINED, imageUsageFlags, imageLayout, viewType);
+		const bool cached = acquireCachedImage(cacheKey);
+
+		ktx2::Texture ktx2Texture;
+		if (!cached)
+		{
+			std::string error;
+			if (!ktx2::loadFromFile(filename, device->physicalDevice, ktx2Texture, error)) {
+				vks::tools::exitFatal("Could not load texture from " + filename + "\n\n" + error, -1);
+			}
+
+			width = ktx2Texture.width;
+			height = ktx2Texture.height;
+			mipLevels = ktx2Texture.levelCount;
+			layerCount = ktx2Texture.layerCount * ktx2Texture.faceCount;
+
+			ktx2::createImage(ktx2Texture, device, copyQueue, imageUsageFlags, imageLayout, &image, &deviceMemory);
+		}
+
+		VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
+		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerCreateInfo.addressModeU = addressMode;
+		samplerCreateInfo.addressModeV = addressMode;
+		samplerCreateInfo.addressModeW = addressMode;
+		samplerCreateInfo.mipLodBias = 0.0f;
+		samplerCreateInfo.maxAnisotropy = device->enabledFeatures.samplerAnisotropy ? device->properties.limits.maxSamplerAnisotropy : 1.0f;
+		samplerCreateInfo.anisotropyEnable = device->enabledFeatures.samplerAnisotropy;
+		samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+		samplerCreateInfo.minLod = 0.0f;
+		samplerCreateInfo.maxLod = (float)mipLevels;
+		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		sampler = SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
+
+		if (!cached)
+		{
+			VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
+			viewCreateInfo.viewType = viewType;
+			viewCreateInfo.format = ktx2Texture.format;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, layerCount };
+			viewCreateInfo.image = image;
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+			insertCachedImage(cacheKey);
+		}
+
+		updateDescriptor();
+	}
+
 	/**
 	* Load a 2D texture including all mip levels
 	*
-	* @param filename File to load (supports .ktx)
-	* @param format Vulkan format of the image data stored in the file
+	* @param filename File to load (supports .ktx and .ktx2)
+	* @param format Vulkan format of the image data stored in the file (ignored for .ktx2)
 	* @param device Vulkan device to create the texture on
 	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -66,17 +182,12 @@ namespace vks
 	*/
 	void Texture2D::loadFromFile(std::string filename, VkFormat format, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, bool forceLinear)
 	{
-		ktxTexture* ktxTexture;
-		ktxResult result = loadKTXFile(filename, &ktxTexture);
-		assert(result == KTX_SUCCESS);
+		if (ktx2::isKTX2File(filename)) {
+			loadKTX2File(filename, VK_IMAGE_VIEW_TYPE_2D, VK_SAMPLER_ADDRESS_MODE_REPEAT, device, copyQueue, imageUsageFlags, imageLayout);
+			return;
+		}
 
 		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		mipLevels = ktxTexture->numLevels;
-
-		ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
 		// Get device properties for the requested texture format
 		VkFormatProperties formatProperties;
@@ -92,60 +203,27 @@ namespace vks
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
+		// Optimal tiled images can be shared with other textures loaded from the same file
+		TextureCache::Key cacheKey;
+		bool cached = false;
 		if (useStaging)
 		{
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-			bufferCreateInfo.size = ktxTextureSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, ktxTextureData, ktxTextureSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-			// Setup buffer copy regions for each mip level
-			std::vector<VkBufferImageCopy> bufferCopyRegions;
-
-			for (uint32_t i = 0; i < mipLevels; i++)
-			{
-				ktx_size_t offset;
-				KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, i, 0, 0, &offset);
-				assert(result == KTX_SUCCESS);
+			cacheKey = fileCacheKey(filename, format, imageUsageFlags, imageLayout, VK_IMAGE_VIEW_TYPE_2D);
+			cached = acquireCachedImage(cacheKey);
+		}
 
-				VkBufferImageCopy bufferCopyRegion = {};
-				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				bufferCopyRegion.imageSubresource.mipLevel = i;
-				bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-				bufferCopyRegion.imageSubresource.layerCount = 1;
-				bufferCopyRegion.imageExtent.width = std::max(1u, ktxTexture->baseWidth >> i);
-				bufferCopyRegion.imageExtent.height = std::max(1u, ktxTexture->baseHeight >> i);
-				bufferCopyRegion.imageExtent.depth = 1;
-				bufferCopyRegion.bufferOffset = offset;
+		if (useStaging && !cached)
+		{
+			// The image data is streamed from the file into a bounded staging window after the image has been created
+			ktx::Stream ktxStream;
+			openKTXStream(filename, ktxStream);
+			width = ktxStream.width;
+			height = ktxStream.height;
+			mipLevels = ktxStream.mipLevels;
+			layerCount = 1;
 
-				bufferCopyRegions.push_back(bufferCopyRegion);
-			}
+			// Images are written from the host without staging memory and queue submissions if the device supports it for this format
+			const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, 0, imageLayout);
 
 			// Create optimal tiled target image
 			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
@@ -159,8 +237,12 @@ namespace vks
 			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			imageCreateInfo.extent = { width, height, 1 };
 			imageCreateInfo.usage = imageUsageFlags;
-			// Ensure that the TRANSFER_DST bit is set for staging
-			if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			// Ensure that the TRANSFER_DST bit is set for staging, host copies need the HOST_TRANSFER bit instead
+			if (hostCopy)
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+			}
+			else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
 			{
 				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 			}
@@ -174,47 +256,17 @@ namespace vks
 			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
 			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
 
-			VkImageSubresourceRange subresourceRange = {};
-			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			subresourceRange.baseMipLevel = 0;
-			subresourceRange.levelCount = mipLevels;
-			subresourceRange.layerCount = 1;
-
-			// Image barrier for optimal image (target)
-			// Optimal image will be used as destination for the copy
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy mip levels from staging buffer
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data()
-			);
-
-			// Change texture image layout to shader read after all mip levels have been copied
 			this->imageLayout = imageLayout;
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
-
-			device->flushCommandBuffer(copyCmd, copyQueue);
-
-			// Clean up staging resources
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+			if (hostCopy)
+			{
+				ktx::hostCopyToImage(ktxStream, device, image, imageLayout);
+			}
+			else
+			{
+				ktx::streamToImage(ktxStream, device, copyQueue, image, imageLayout);
+			}
 		}
-		else
+		else if (!useStaging)
 		{
 			// Prefer using optimal tiling, as linear tiling 
 			// may support only a small set of features 
@@ -223,6 +275,17 @@ namespace vks
 			// Check if this support is supported for linear tiling
 			assert(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
+			ktxTexture* ktxTexture;
+			ktxResult result = loadKTXFile(filename, &ktxTexture);
+			assert(result == KTX_SUCCESS);
+			width = ktxTexture->baseWidth;
+			height = ktxTexture->baseHeight;
+			mipLevels = ktxTexture->numLevels;
+			ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
+
+			// Use a separate command buffer for texture loading
+			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
 			VkImage mappableImage;
 			VkDeviceMemory mappableMemory;
 
@@ -287,9 +350,9 @@ namespace vks
 			vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout);
 
 			device->flushCommandBuffer(copyCmd, copyQueue);
-		}
 
-		ktxTexture_Destroy(ktxTexture);
+			ktxTexture_Destroy(ktxTexture);
+		}
 
 		// Create a default sampler
 		VkSamplerCreateInfo samplerCreateInfo = {};
@@ -309,23 +372,27 @@ namespace vks
 		samplerCreateInfo.maxAnisotropy = device->enabledFeatures.samplerAnisotropy ? device->properties.limits.maxSamplerAnisotropy : 1.0f;
 		samplerCreateInfo.anisotropyEnable = device->enabledFeatures.samplerAnisotropy;
 		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
-
-		// Create image view
-		// Textures are not directly accessed by the shaders and
-		// are abstracted by image views containing additional
-		// information and sub resource ranges
-		VkImageViewCreateInfo viewCreateInfo = {};
-		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		viewCreateInfo.format = format;
-		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-		viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		// Linear tiling usually won't support mip maps
-		// Only set mip map count if optimal tiling is used
-		viewCreateInfo.subresourceRange.levelCount = (useStaging) ? mipLevels : 1;
-		viewCreateInfo.image = image;
-		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+		sampler = SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
+
+		if (!cached)
+		{
+			// Create image view
+			// Textures are not directly accessed by the shaders and
+			// are abstracted by image views containing additional
+			// information and sub resource ranges
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = format;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			// Linear tiling usually won't support mip maps
+			// Only set mip map count if optimal tiling is used
+			viewCreateInfo.subresourceRange.levelCount = (useStaging) ? mipLevels : 1;
+			viewCreateInfo.image = image;
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+			insertCachedImage(cacheKey);
+		}
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -353,117 +420,144 @@ namespace vks
 		width = texWidth;
 		height = texHeight;
 		mipLevels = 1;
+		layerCount = 1;
 
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
+		// Textures created from identical data share their image
+		TextureCache::Key cacheKey;
+		cacheKey.setContents(buffer, static_cast<size_t>(bufferSize), width, height);
+		cacheKey.format = format;
+		cacheKey.usage = imageUsageFlags;
+		cacheKey.layout = imageLayout;
+		const bool cached = acquireCachedImage(cacheKey);
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = bufferSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-		VkBufferImageCopy bufferCopyRegion = {};
-		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		bufferCopyRegion.imageSubresource.mipLevel = 0;
-		bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-		bufferCopyRegion.imageSubresource.layerCount = 1;
-		bufferCopyRegion.imageExtent.width = width;
-		bufferCopyRegion.imageExtent.height = height;
-		bufferCopyRegion.imageExtent.depth = 1;
-		bufferCopyRegion.bufferOffset = 0;
-
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+		if (!cached)
 		{
-			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		}
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 1;
-
-		// Image barrier for optimal image (target)
-		// Optimal image will be used as destination for the copy
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy mip levels from staging buffer
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion
-		);
-
-		// Change texture image layout to shader read after all mip levels have been copied
-		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
+			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+			VkMemoryRequirements memReqs;
+
+			// Images are written from the host without staging memory and queue submissions if the device supports it for this format
+			const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, 0, imageLayout);
+
+			// Create optimal tiled target image
+			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = format;
+			imageCreateInfo.mipLevels = mipLevels;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.extent = { width, height, 1 };
+			imageCreateInfo.usage = imageUsageFlags;
+			// Ensure that the TRANSFER_DST bit is set for staging, host copies need the HOST_TRANSFER bit instead
+			if (hostCopy)
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+			}
+			else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			}
+			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-		device->flushCommandBuffer(copyCmd, copyQueue);
+			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
 
-		// Clean up staging resources
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+			memAllocInfo.allocationSize = memReqs.size;
+
+			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+
+			VkImageSubresourceRange subresourceRange = {};
+			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			subresourceRange.baseMipLevel = 0;
+			subresourceRange.levelCount = mipLevels;
+			subresourceRange.layerCount = 1;
+
+			this->imageLayout = imageLayout;
+			if (hostCopy)
+			{
+				device->transitionImageLayoutOnHost(image, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout, subresourceRange);
+				device->copyMemoryToImage(buffer, image, imageLayout, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { width, height, 1 });
+			}
+			else
+			{
+				// Use a separate command buffer for texture loading
+				VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+				// Create a host-visible staging buffer that contains the raw image data
+				VkBuffer stagingBuffer;
+				VkDeviceMemory stagingMemory;
+
+				VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
+				bufferCreateInfo.size = bufferSize;
+				// This buffer is used as a transfer source for the buffer copy
+				bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+				bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+				VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+
+				// Get memory requirements for the staging buffer (alignment, memory type bits)
+				vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
+
+				memAllocInfo.allocationSize = memReqs.size;
+				// Get memory type index for a host visible buffer
+				memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
+				VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
+
+				// Copy texture data into staging buffer
+				uint8_t *data;
+				VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
+				memcpy(data, buffer, bufferSize);
+				vkUnmapMemory(device->logicalDevice, stagingMemory);
+
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = 0;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+				bufferCopyRegion.imageSubresource.layerCount = 1;
+				bufferCopyRegion.imageExtent.width = width;
+				bufferCopyRegion.imageExtent.height = height;
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = 0;
+
+				// Image barrier for optimal image (target)
+				// Optimal image will be used as destination for the copy
+				vks::tools::setImageLayout(
+					copyCmd,
+					image,
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					subresourceRange);
+
+				// Copy mip levels from staging buffer
+				vkCmdCopyBufferToImage(
+					copyCmd,
+					stagingBuffer,
+					image,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1,
+					&bufferCopyRegion
+				);
+
+				// Change texture image layout to shader read after all mip levels have been copied
+				vks::tools::setImageLayout(
+					copyCmd,
+					image,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					imageLayout,
+					subresourceRange);
+
+				device->flushCommandBuffer(copyCmd, copyQueue);
+
+				// Clean up staging resources
+				vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+				vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+			}
+		}
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = {};
@@ -479,19 +573,23 @@ namespace vks
 		samplerCreateInfo.minLod = 0.0f;
 		samplerCreateInfo.maxLod = 0.0f;
 		samplerCreateInfo.maxAnisotropy = 1.0f;
-		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
-
-		// Create image view
-		VkImageViewCreateInfo viewCreateInfo = {};
-		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		viewCreateInfo.pNext = NULL;
-		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		viewCreateInfo.format = format;
-		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-		viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		viewCreateInfo.subresourceRange.levelCount = 1;
-		viewCreateInfo.image = image;
-		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+		sampler = SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
+
+		if (!cached)
+		{
+			// Create image view
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.pNext = NULL;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = format;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			viewCreateInfo.subresourceRange.levelCount = 1;
+			viewCreateInfo.image = image;
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+			insertCachedImage(cacheKey);
+		}
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -500,8 +598,8 @@ namespace vks
 	/**
 	* Load a 2D texture array including all mip levels
 	*
-	* @param filename File to load (supports .ktx)
-	* @param format Vulkan format of the image data stored in the file
+	* @param filename File to load (supports .ktx and .ktx2)
+	* @param format Vulkan format of the image data stored in the file (ignored for .ktx2)
 	* @param device Vulkan device to create the texture on
 	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -510,141 +608,77 @@ namespace vks
 	*/
 	void Texture2DArray::loadFromFile(std::string filename, VkFormat format, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
 	{
-		ktxTexture* ktxTexture;
-		ktxResult result = loadKTXFile(filename, &ktxTexture);
-		assert(result == KTX_SUCCESS);
+		if (ktx2::isKTX2File(filename)) {
+			loadKTX2File(filename, VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, device, copyQueue, imageUsageFlags, imageLayout);
+			return;
+		}
 
 		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		layerCount = ktxTexture->numLayers;
-		mipLevels = ktxTexture->numLevels;
 
-		ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
+		// Images can be shared with other textures loaded from the same file
+		const TextureCache::Key cacheKey = fileCacheKey(filename, format, imageUsageFlags, imageLayout, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+		const bool cached = acquireCachedImage(cacheKey);
 
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
+		if (!cached)
+		{
+			// The image data is streamed from the file into a bounded staging window after the image has been created
+			ktx::Stream ktxStream;
+			openKTXStream(filename, ktxStream);
 
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
+			width = ktxStream.width;
+			height = ktxStream.height;
+			layerCount = ktxStream.layerCount;
+			mipLevels = ktxStream.mipLevels;
 
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			// Images are written from the host without staging memory and queue submissions if the device supports it for this format
+			const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, 0, imageLayout);
 
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+			VkMemoryRequirements memReqs;
 
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
+			// Create optimal tiled target image
+			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = format;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.extent = { width, height, 1 };
+			imageCreateInfo.usage = imageUsageFlags;
+			// Ensure that the TRANSFER_DST bit is set for staging, host copies need the HOST_TRANSFER bit instead
+			if (hostCopy)
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+			}
+			else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			}
+			imageCreateInfo.arrayLayers = layerCount;
+			imageCreateInfo.mipLevels = mipLevels;
 
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
+			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
 
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
+			memAllocInfo.allocationSize = memReqs.size;
+			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-		// Setup buffer copy regions for each layer including all of its miplevels
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
+			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
 
-		for (uint32_t layer = 0; layer < layerCount; layer++)
-		{
-			for (uint32_t level = 0; level < mipLevels; level++)
+			this->imageLayout = imageLayout;
+			if (hostCopy)
 			{
-				ktx_size_t offset;
-				KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, level, layer, 0, &offset);
-				assert(result == KTX_SUCCESS);
-
-				VkBufferImageCopy bufferCopyRegion = {};
-				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				bufferCopyRegion.imageSubresource.mipLevel = level;
-				bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
-				bufferCopyRegion.imageSubresource.layerCount = 1;
-				bufferCopyRegion.imageExtent.width = ktxTexture->baseWidth >> level;
-				bufferCopyRegion.imageExtent.height = ktxTexture->baseHeight >> level;
-				bufferCopyRegion.imageExtent.depth = 1;
-				bufferCopyRegion.bufferOffset = offset;
-
-				bufferCopyRegions.push_back(bufferCopyRegion);
+				ktx::hostCopyToImage(ktxStream, device, image, imageLayout);
+			}
+			else
+			{
+				ktx::streamToImage(ktxStream, device, copyQueue, image, imageLayout);
 			}
 		}
 
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
-		{
-			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		}
-		imageCreateInfo.arrayLayers = layerCount;
-		imageCreateInfo.mipLevels = mipLevels;
-
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Image barrier for optimal image (target)
-		// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = layerCount;
-
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy the layers and mip levels from the staging buffer to the optimal tiled image
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data());
-
-		// Change texture image layout to shader read after all faces have been copied
-		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
-
-		device->flushCommandBuffer(copyCmd, copyQueue);
-
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
 		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
@@ -660,23 +694,22 @@ namespace vks
 		samplerCreateInfo.minLod = 0.0f;
 		samplerCreateInfo.maxLod = (float)mipLevels;
 		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
-
-		// Create image view
-		VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
-		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
-		viewCreateInfo.format = format;
-		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-		viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		viewCreateInfo.subresourceRange.layerCount = layerCount;
-		viewCreateInfo.subresourceRange.levelCount = mipLevels;
-		viewCreateInfo.image = image;
-		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
-
-		// Clean up staging resources
-		ktxTexture_Destroy(ktxTexture);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+		sampler = SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
+
+		if (!cached)
+		{
+			// Create image view
+			VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			viewCreateInfo.format = format;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			viewCreateInfo.subresourceRange.layerCount = layerCount;
+			viewCreateInfo.subresourceRange.levelCount = mipLevels;
+			viewCreateInfo.image = image;
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+			insertCachedImage(cacheKey);
+		}
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -685,8 +718,8 @@ namespace vks
 	/**
 	* Load a cubemap texture including all mip levels from a single file
 	*
-	* @param filename File to load (supports .ktx)
-	* @param format Vulkan format of the image data stored in the file
+	* @param filename File to load (supports .ktx and .ktx2)
+	* @param format Vulkan format of the image data stored in the file (ignored for .ktx2)
 	* @param device Vulkan device to create the texture on
 	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -695,144 +728,81 @@ namespace vks
 	*/
 	void TextureCubeMap::loadFromFile(std::string filename, VkFormat format, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
 	{
-		ktxTexture* ktxTexture;
-		ktxResult result = loadKTXFile(filename, &ktxTexture);
-		assert(result == KTX_SUCCESS);
+		if (ktx2::isKTX2File(filename)) {
+			loadKTX2File(filename, VK_IMAGE_VIEW_TYPE_CUBE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, device, copyQueue, imageUsageFlags, imageLayout);
+			return;
+		}
 
 		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		mipLevels = ktxTexture->numLevels;
-
-		ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
+		// Images can be shared with other textures loaded from the same file
+		const TextureCache::Key cacheKey = fileCacheKey(filename, format, imageUsageFlags, imageLayout, VK_IMAGE_VIEW_TYPE_CUBE);
+		const bool cached = acquireCachedImage(cacheKey);
 
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
+		if (!cached)
+		{
+			// The image data is streamed from the file into a bounded staging window after the image has been created
+			ktx::Stream ktxStream;
+			openKTXStream(filename, ktxStream);
 
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			width = ktxStream.width;
+			height = ktxStream.height;
+			mipLevels = ktxStream.mipLevels;
+			layerCount = 6;
 
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+			// Images are written from the host without staging memory and queue submissions if the device supports it for this format
+			const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, imageLayout);
 
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
+			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+			VkMemoryRequirements memReqs;
 
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			// Create optimal tiled target image
+			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = format;
+			imageCreateInfo.mipLevels = mipLevels;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.extent = { width, height, 1 };
+			imageCreateInfo.usage = imageUsageFlags;
+			// Ensure that the TRANSFER_DST bit is set for staging, host copies need the HOST_TRANSFER bit instead
+			if (hostCopy)
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+			}
+			else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			}
+			// Cube faces count as array layers in Vulkan
+			imageCreateInfo.arrayLayers = 6;
+			// This flag is required for cube map images
+			imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
 
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
+			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-		// Setup buffer copy regions for each face including all of its mip levels
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
+			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
 
-		for (uint32_t face = 0; face < 6; face++)
-		{
-			for (uint32_t level = 0; level < mipLevels; level++)
-			{
-				ktx_size_t offset;
-				KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, level, 0, face, &offset);
-				assert(result == KTX_SUCCESS);
+			memAllocInfo.allocationSize = memReqs.size;
+			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-				VkBufferImageCopy bufferCopyRegion = {};
-				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				bufferCopyRegion.imageSubresource.mipLevel = level;
-				bufferCopyRegion.imageSubresource.baseArrayLayer = face;
-				bufferCopyRegion.imageSubresource.layerCount = 1;
-				bufferCopyRegion.imageExtent.width = ktxTexture->baseWidth >> level;
-				bufferCopyRegion.imageExtent.height = ktxTexture->baseHeight >> level;
-				bufferCopyRegion.imageExtent.depth = 1;
-				bufferCopyRegion.bufferOffset = offset;
+			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
 
-				bufferCopyRegions.push_back(bufferCopyRegion);
+			this->imageLayout = imageLayout;
+			if (hostCopy)
+			{
+				ktx::hostCopyToImage(ktxStream, device, image, imageLayout);
+			}
+			else
+			{
+				ktx::streamToImage(ktxStream, device, copyQueue, image, imageLayout);
 			}
 		}
 
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
-		{
-			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		}
-		// Cube faces count as array layers in Vulkan
-		imageCreateInfo.arrayLayers = 6;
-		// This flag is required for cube map images
-		imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-
-
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Image barrier for optimal image (target)
-		// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 6;
-
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy the cube map faces from the staging buffer to the optimal tiled image
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data());
-
-		// Change texture image layout to shader read after all faces have been copied
-		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
-
-		device->flushCommandBuffer(copyCmd, copyQueue);
-
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
 		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
@@ -848,23 +818,22 @@ namespace vks
 		samplerCreateInfo.minLod = 0.0f;
 		samplerCreateInfo.maxLod = (float)mipLevels;
 		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
-
-		// Create image view
-		VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
-		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
-		viewCreateInfo.format = format;
-		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-		viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		viewCreateInfo.subresourceRange.layerCount = 6;
-		viewCreateInfo.subresourceRange.levelCount = mipLevels;
-		viewCreateInfo.image = image;
-		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
-
-		// Clean up staging resources
-		ktxTexture_Destroy(ktxTexture);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+		sampler = SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
+
+		if (!cached)
+		{
+			// Create image view
+			VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+			viewCreateInfo.format = format;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			viewCreateInfo.subresourceRange.layerCount = 6;
+			viewCreateInfo.subresourceRange.levelCount = mipLevels;
+			viewCreateInfo.image = image;
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+			insertCachedImage(cacheKey);
+		}
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -20,6 +20,9 @@
 
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
+#include "VulkanKTX2.h"
+#include "VulkanKTXStream.h"
+#include "VulkanResourceCache.h"
 #include "VulkanTools.h"
 
 #if defined(__ANDROID__)
@@ -45,6 +48,10 @@ class Texture
 	void      updateDescriptor();
 	void      destroy();
 	ktxResult loadKTXFile(std::string filename, ktxTexture **target);
+	void      openKTXStream(std::string filename, ktx::Stream &stream);
+	void      loadKTX2File(std::string filename, VkImageViewType viewType, VkSamplerAddressMode addressMode, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout);
+	bool      acquireCachedImage(const TextureCache::Key &key);
+	void      insertCachedImage(const TextureCache::Key &key);
 };
 
 class Texture2D : public Texture
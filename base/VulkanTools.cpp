@@ -8,6 +8,12 @@
 
 #include "VulkanTools.h"
 
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 const std::string getAssetPath()
 {
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -25,6 +31,29 @@ namespace vks
 	{
 		bool errorModeSilent = false;
 
+		static std::string defaultCacheDirectory()
+		{
+#if defined(__ANDROID__)
+			// Assets are read-only on Android
+			return "";
+#elif defined(_WIN32)
+			const char* localAppData = getenv("LOCALAPPDATA");
+			return localAppData ? std::string(localAppData) + "/VulkanExamples" : "";
+#elif defined(__APPLE__)
+			const char* home = getenv("HOME");
+			return home ? std::string(home) + "/Library/Caches/VulkanExamples" : "";
+#else
+			const char* xdgCacheHome = getenv("XDG_CACHE_HOME");
+			if (xdgCacheHome && (xdgCacheHome[0] != '\0')) {
+				return std::string(xdgCacheHome) + "/vulkanexamples";
+			}
+			const char* home = getenv("HOME");
+			return home ? std::string(home) + "/.cache/vulkanexamples" : "";
+#endif
+		}
+
+		std::string cacheDirectory = defaultCacheDirectory();
+
 		std::string errorString(VkResult errorCode)
 		{
 			switch (errorCode)
@@ -101,6 +130,30 @@ namespace vks
 			return false;
 		}
 
+		VkBool32 getSupportedSampledDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat)
+		{
+			// Depth only formats, so the image can be sampled through a single aspect view
+			std::vector<VkFormat> depthFormats = {
+				VK_FORMAT_D32_SFLOAT,
+				VK_FORMAT_X8_D24_UNORM_PACK32,
+				VK_FORMAT_D16_UNORM
+			};
+
+			for (auto& format : depthFormats)
+			{
+				VkFormatProperties formatProps;
+				vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+				// Format must support depth stencil attachment and sampling for optimal tiling
+				if ((formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) && (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+				{
+					*depthFormat = format;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
 		// Returns if a given format support LINEAR filtering
 		VkBool32 formatIsFilterable(VkPhysicalDevice physicalDevice, VkFormat format, VkImageTiling tiling)
 		{
@@ -380,6 +433,54 @@ namespace vks
 			return !f.fail();
 		}
 
+		bool shaderAvailable(const std::string &fileName)
+		{
+#if defined(__ANDROID__)
+			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, fileName.c_str(), AASSET_MODE_STREAMING);
+			if (asset) {
+				AAsset_close(asset);
+				return true;
+			}
+			return false;
+#else
+			return fileExists(fileName);
+#endif
+		}
+
+		VkShaderModule loadOptionalShader(const std::string &fileName, VkDevice device)
+		{
+			// The Android loader asserts and the desktop loader reports an error on missing shaders, so probe first
+			if (!shaderAvailable(fileName)) {
+				return VK_NULL_HANDLE;
+			}
+#if defined(__ANDROID__)
+			return loadShader(androidApp->activity->assetManager, fileName.c_str(), device);
+#else
+			return loadShader(fileName.c_str(), device);
+#endif
+		}
+
+		std::string getCacheDirectory(const std::string &subDirectory)
+		{
+			if (cacheDirectory.empty()) {
+				return "";
+			}
+			const std::string path = cacheDirectory + "/" + subDirectory;
+			// Create all missing parent directories, existing ones are skipped
+			for (size_t pos = path.find_first_of("/\\", 1); ; pos = path.find_first_of("/\\", pos + 1)) {
+				const std::string directory = path.substr(0, pos);
+#if defined(_WIN32)
+				_mkdir(directory.c_str());
+#else
+				mkdir(directory.c_str(), 0755);
+#endif
+				if (pos == std::string::npos) {
+					break;
+				}
+			}
+			return path;
+		}
+
 		uint32_t alignedSize(uint32_t value, uint32_t alignment)
         {
 	        return (value + alignment - 1) & ~(alignment - 1);
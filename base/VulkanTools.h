@@ -68,6 +68,13 @@ namespace vks
 		/** @brief Disable message boxes on fatal errors */
 		extern bool errorModeSilent;
 
+		/**
+		* Root directory for files generated at runtime, e.g. compressed textures and precomputed lighting
+		* Defaults to the user's cache directory (%LOCALAPPDATA%/VulkanExamples, ~/Library/Caches/VulkanExamples or $XDG_CACHE_HOME/vulkanexamples)
+		* and can be changed with the --cachedir command line argument. Empty disables all disk caches (default on Android)
+		*/
+		extern std::string cacheDirectory;
+
 		/** @brief Returns an error code as a string */
 		std::string errorString(VkResult errorCode);
 
@@ -77,6 +84,9 @@ namespace vks
 		// Selected a suitable supported depth format starting with 32 bit down to 16 bit
 		// Returns false if none of the depth formats in the list is supported by the device
 		VkBool32 getSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat);
+		// Selects a depth format without stencil that can be used as an attachment and sampled in a shader
+		// Returns false if none of the depth formats in the list is supported by the device
+		VkBool32 getSupportedSampledDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat);
 
 		// Returns if a given format support LINEAR filtering
 		VkBool32 formatIsFilterable(VkPhysicalDevice physicalDevice, VkFormat format, VkImageTiling tiling);
@@ -126,6 +136,15 @@ namespace vks
 		/** @brief Checks if a file exists */
 		bool fileExists(const std::string &filename);
 
+		/** @brief Checks if a SPIR-V shader exists (as an asset on Android), used to probe for shaders of optional features */
+		bool shaderAvailable(const std::string &fileName);
+
+		/** @brief Loads a SPIR-V shader of an optional feature, returns VK_NULL_HANDLE without an error if the shader doesn't exist */
+		VkShaderModule loadOptionalShader(const std::string &fileName, VkDevice device);
+
+		/** @brief Returns the path of a sub directory of the cache directory and creates it if required, returns an empty string if caching is disabled */
+		std::string getCacheDirectory(const std::string &subDirectory);
+
 		uint32_t alignedSize(uint32_t value, uint32_t alignment);
 	}
 }
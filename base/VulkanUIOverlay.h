@@ -21,6 +21,7 @@
 #include "VulkanDebug.h"
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
+#include "VulkanResourceCache.h"
 
 #include "../external/imgui/imgui.h"
 
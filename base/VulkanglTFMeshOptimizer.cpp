@@ -0,0 +1,698 @@
+/*
+* Mesh optimization functions for vkglTF models
+*
+* Reorders triangles for the post-transform vertex cache and for reduced overdraw,
+* reorders vertices for linear vertex fetches, splits meshes into meshlets
+* and simplifies meshes for level-of-detail chains
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanglTFMeshOptimizer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+float vkglTF::meshoptimizer::calculateACMR(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	if (indexCount < 3) {
+		return 0.0f;
+	}
+	// Timestamp based FIFO: a vertex is in the cache if it has been inserted less than cacheSize misses ago
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		const uint32_t index = indices[i];
+		if ((insertedAt[index] == 0) || (misses - insertedAt[index] >= cacheSize)) {
+			misses++;
+			insertedAt[index] = misses;
+		}
+	}
+	return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
+
+namespace
+{
+	// Scoring parameters from Tom Forsyth's original article
+	const uint32_t maxCacheSize = 32;
+	const float cacheDecayPower = 1.5f;
+	const float lastTriangleScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	float vertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0) {
+			// No triangles left that use this vertex
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				// The vertices of the last triangle get a fixed score, so the next triangle doesn't favor either of its edges
+				score = lastTriangleScore;
+			} else {
+				const float scaler = 1.0f / static_cast<float>(maxCacheSize - 3);
+				score = powf(1.0f - static_cast<float>(cachePosition - 3) * scaler, cacheDecayPower);
+			}
+		}
+		// Boost vertices with only a few triangles left, so lone triangles don't get stranded
+		score += valenceBoostScale * powf(static_cast<float>(remainingTriangles), -valenceBoostPower);
+		return score;
+	}
+}
+
+void vkglTF::meshoptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	// Vertex to triangle adjacency
+	std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		remainingTriangles[indices[i]]++;
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		vertexScores[i] = vertexScore(-1, remainingTriangles[i]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	// Simulated LRU cache, three extra slots for the vertices pushed out by the last triangle
+	std::vector<uint32_t> cache;
+	cache.reserve(maxCacheSize + 3);
+	std::vector<uint32_t> newCache;
+	newCache.reserve(maxCacheSize + 3);
+
+	size_t scanPosition = 0;
+	int64_t bestTriangle = -1;
+	while (output.size() < triangleCount * 3) {
+		if (bestTriangle < 0) {
+			// No candidate in the cache, fall back to a linear scan for the best remaining triangle
+			float bestScore = -1.0f;
+			while ((scanPosition < triangleCount) && emitted[scanPosition]) {
+				scanPosition++;
+			}
+			for (size_t t = scanPosition; t < triangleCount; t++) {
+				if (!emitted[t] && (triangleScores[t] > bestScore)) {
+					bestScore = triangleScores[t];
+					bestTriangle = static_cast<int64_t>(t);
+				}
+			}
+		}
+
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		const uint32_t tri[3] = { triangle[0], triangle[1], triangle[2] };
+		output.insert(output.end(), tri, tri + 3);
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from the adjacency of its vertices
+		for (uint32_t v : tri) {
+			uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+			uint32_t* end = begin + remainingTriangles[v];
+			uint32_t* it = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			if (it != end) {
+				std::swap(*it, *(end - 1));
+				remainingTriangles[v]--;
+			}
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		newCache.clear();
+		newCache.insert(newCache.end(), tri, tri + 3);
+		for (uint32_t v : cache) {
+			if ((v != tri[0]) && (v != tri[1]) && (v != tri[2])) {
+				newCache.push_back(v);
+			}
+		}
+		cache.swap(newCache);
+
+		// Update scores of all vertices in the cache and pick the best triangle adjacent to them
+		for (uint32_t i = 0; i < cache.size(); i++) {
+			const uint32_t v = cache[i];
+			cachePosition[v] = (i < maxCacheSize) ? static_cast<int32_t>(i) : -1;
+			vertexScores[v] = vertexScore(cachePosition[v], remainingTriangles[v]);
+		}
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : cache) {
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++) {
+				const uint32_t t = adjacency[adjacencyOffsets[v] + i];
+				const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+		if (cache.size() > maxCacheSize) {
+			cache.resize(maxCacheSize);
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void vkglTF::meshoptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, uint32_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	/*
+		Split the triangle list into clusters at hard boundaries, i.e. triangles for which all vertices miss the simulated cache
+		These are the points where the cache optimizer restarted, so reordering clusters doesn't break up vertex reuse
+	*/
+	std::vector<size_t> clusters;
+	{
+		std::vector<uint32_t> insertedAt(vertexCount, 0);
+		uint32_t misses = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			uint32_t triangleMisses = 0;
+			for (uint32_t i = 0; i < 3; i++) {
+				const uint32_t index = indices[t * 3 + i];
+				if ((insertedAt[index] == 0) || (misses - insertedAt[index] >= fifoCacheSize)) {
+					misses++;
+					triangleMisses++;
+					insertedAt[index] = misses;
+				}
+			}
+			if ((t == 0) || (triangleMisses == 3)) {
+				clusters.push_back(t);
+			}
+		}
+	}
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	// Sort key: clusters facing away from the mesh center are more likely to occlude others and are drawn first
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCenters(clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.0f));
+	for (size_t c = 0; c < clusters.size(); c++) {
+		const size_t begin = clusters[c];
+		const size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		float clusterArea = 0.0f;
+		for (size_t t = begin; t < end; t++) {
+			const glm::vec3& p0 = positions[indices[t * 3]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			clusterCenters[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+		meshCenter += clusterCenters[c];
+		meshArea += clusterArea;
+		clusterCenters[c] = (clusterArea > 0.0f) ? clusterCenters[c] / clusterArea : positions[indices[begin * 3]];
+		const float normalLength = glm::length(clusterNormals[c]);
+		clusterNormals[c] = (normalLength > 0.0f) ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+	}
+	if (meshArea <= 0.0f) {
+		return;
+	}
+	meshCenter /= meshArea;
+
+	std::vector<float> sortKeys(clusters.size());
+	std::vector<uint32_t> clusterOrder(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++) {
+		sortKeys[c] = glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c]);
+		clusterOrder[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (uint32_t c : clusterOrder) {
+		const size_t begin = clusters[c];
+		const size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		output.insert(output.end(), indices + begin * 3, indices + end * 3);
+	}
+
+	// Reordering clusters can still cost some vertex reuse across cluster borders, only keep the new order if that cost is small
+	const float acmrBefore = calculateACMR(indices, triangleCount * 3, vertexCount);
+	const float acmrAfter = calculateACMR(output.data(), output.size(), vertexCount);
+	if (acmrAfter <= acmrBefore * threshold) {
+		std::copy(output.begin(), output.end(), indices);
+	}
+}
+
+void vkglTF::meshoptimizer::generateVertexFetchRemap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	const uint32_t unassigned = UINT32_MAX;
+	remap.assign(vertexCount, unassigned);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		if (remap[indices[i]] == unassigned) {
+			remap[indices[i]] = next++;
+		}
+	}
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		if (remap[i] == unassigned) {
+			remap[i] = next++;
+		}
+	}
+}
+
+void vkglTF::meshoptimizer::buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	assert((maxVertices < 256) && (maxTriangles > 0));
+	const uint8_t unused = 0xFF;
+	// Local index of each vertex in the current meshlet
+	std::vector<uint8_t> localIndex(vertexCount, unused);
+
+	Meshlet meshlet = { static_cast<uint32_t>(meshletVertices.size()), 0, static_cast<uint32_t>(meshletTriangles.size() / 3), 0 };
+	for (size_t t = 0; t < indexCount / 3; t++) {
+		const uint32_t a = indices[t * 3];
+		const uint32_t b = indices[t * 3 + 1];
+		const uint32_t c = indices[t * 3 + 2];
+		const uint32_t newVertices = (localIndex[a] == unused) + (localIndex[b] == unused) + (localIndex[c] == unused);
+		// Start a new meshlet if this triangle doesn't fit into the current one
+		if ((meshlet.vertexCount + newVertices > maxVertices) || (meshlet.triangleCount + 1 > maxTriangles)) {
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+				localIndex[meshletVertices[meshlet.vertexOffset + i]] = unused;
+			}
+			meshlets.push_back(meshlet);
+			meshlet = { static_cast<uint32_t>(meshletVertices.size()), 0, static_cast<uint32_t>(meshletTriangles.size() / 3), 0 };
+		}
+		for (uint32_t v : { a, b, c }) {
+			if (localIndex[v] == unused) {
+				localIndex[v] = static_cast<uint8_t>(meshlet.vertexCount++);
+				meshletVertices.push_back(v);
+			}
+			meshletTriangles.push_back(localIndex[v]);
+		}
+		meshlet.triangleCount++;
+	}
+	if (meshlet.triangleCount > 0) {
+		meshlets.push_back(meshlet);
+	}
+}
+
+vkglTF::meshoptimizer::MeshletBounds vkglTF::meshoptimizer::computeMeshletBounds(const Meshlet& meshlet, const std::vector<uint32_t>& meshletVertices, const std::vector<uint8_t>& meshletTriangles, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals)
+{
+	MeshletBounds bounds{};
+
+	// Bounding sphere around the center of the bounding box
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+		const glm::vec3& p = positions[meshletVertices[meshlet.vertexOffset + i]];
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+	bounds.center = (min + max) * 0.5f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+		bounds.radius = std::max(bounds.radius, glm::length(positions[meshletVertices[meshlet.vertexOffset + i]] - bounds.center));
+	}
+
+	// Normal cone around the average face normal
+	std::vector<glm::vec3> faceNormals;
+	faceNormals.reserve(meshlet.triangleCount);
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		const uint8_t* triangle = &meshletTriangles[(meshlet.triangleOffset + t) * 3];
+		uint32_t v[3];
+		for (uint32_t i = 0; i < 3; i++) {
+			v[i] = meshletVertices[meshlet.vertexOffset + triangle[i]];
+		}
+		glm::vec3 normal = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+		const float length = glm::length(normal);
+		if (length == 0.0f) {
+			continue;
+		}
+		normal /= length;
+		if (glm::dot(normal, normals[v[0]] + normals[v[1]] + normals[v[2]]) < 0.0f) {
+			normal = -normal;
+		}
+		faceNormals.push_back(normal);
+		axis += normal;
+	}
+	const float axisLength = glm::length(axis);
+	// Degenerate cones never cull
+	bounds.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	bounds.coneApex = bounds.center;
+	bounds.coneCutoff = 1.0f;
+	if (faceNormals.empty() || (axisLength == 0.0f)) {
+		return bounds;
+	}
+	axis /= axisLength;
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : faceNormals) {
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+	if (minDot <= 0.1f) {
+		// The cone spans (close to) a hemisphere or more, culling would hardly ever succeed
+		bounds.coneAxis = axis;
+		return bounds;
+	}
+
+	// Move the apex back along the axis until it's behind all triangle planes
+	float maxT = 0.0f;
+	size_t faceIndex = 0;
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		const uint8_t* triangle = &meshletTriangles[(meshlet.triangleOffset + t) * 3];
+		const glm::vec3& p0 = positions[meshletVertices[meshlet.vertexOffset + triangle[0]]];
+		const glm::vec3& p1 = positions[meshletVertices[meshlet.vertexOffset + triangle[1]]];
+		const glm::vec3& p2 = positions[meshletVertices[meshlet.vertexOffset + triangle[2]]];
+		if (glm::length(glm::cross(p1 - p0, p2 - p0)) == 0.0f) {
+			continue;
+		}
+		const glm::vec3& normal = faceNormals[faceIndex++];
+		const float dc = glm::dot(p0 - bounds.center, normal);
+		const float dn = glm::dot(axis, normal);
+		maxT = std::max(maxT, dc / dn);
+	}
+	bounds.coneApex = bounds.center - axis * maxT;
+	bounds.coneAxis = axis;
+	// sin of the cone's half angle
+	bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	return bounds;
+}
+
+namespace
+{
+	// Symmetric 4x4 error quadric, stores the upper triangle of A (3x3), b and c for the error p^T A p + 2 b^T p + c
+	struct Quadric {
+		float a00 = 0.0f, a01 = 0.0f, a02 = 0.0f, a11 = 0.0f, a12 = 0.0f, a22 = 0.0f;
+		float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+		float c = 0.0f;
+		// Sum of the plane weights, used to turn the error into an average squared distance
+		float w = 0.0f;
+	};
+
+	Quadric planeQuadric(const glm::vec3& n, float d, float weight)
+	{
+		Quadric q;
+		q.a00 = n.x * n.x * weight;
+		q.a01 = n.x * n.y * weight;
+		q.a02 = n.x * n.z * weight;
+		q.a11 = n.y * n.y * weight;
+		q.a12 = n.y * n.z * weight;
+		q.a22 = n.z * n.z * weight;
+		q.b0 = n.x * d * weight;
+		q.b1 = n.y * d * weight;
+		q.b2 = n.z * d * weight;
+		q.c = d * d * weight;
+		q.w = weight;
+		return q;
+	}
+
+	void addQuadric(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00;
+		q.a01 += r.a01;
+		q.a02 += r.a02;
+		q.a11 += r.a11;
+		q.a12 += r.a12;
+		q.a22 += r.a22;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.w += r.w;
+	}
+
+	float quadricError(const Quadric& q, const glm::vec3& p)
+	{
+		if (q.w == 0.0f) {
+			return 0.0f;
+		}
+		const float rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z;
+		const float ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z;
+		const float rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z;
+		const float error = rx * p.x + ry * p.y + rz * p.z + 2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+		return fabsf(error) / q.w;
+	}
+
+	struct Collapse {
+		uint32_t source;
+		uint32_t target;
+		float cost;
+	};
+}
+
+float vkglTF::meshoptimizer::simplify(std::vector<uint32_t>& destination, const uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs, uint32_t vertexCount, size_t targetIndexCount, float targetError)
+{
+	destination.assign(indices, indices + (indexCount / 3) * 3);
+	if ((destination.size() <= targetIndexCount) || (vertexCount == 0)) {
+		return 0.0f;
+	}
+
+	// Errors are calculated in normalized coordinates, so they are relative to the mesh extent
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+	glm::vec2 uvMin = glm::vec2(FLT_MAX);
+	glm::vec2 uvMax = glm::vec2(-FLT_MAX);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		min = glm::min(min, positions[i]);
+		max = glm::max(max, positions[i]);
+		uvMin = glm::min(uvMin, uvs[i]);
+		uvMax = glm::max(uvMax, uvs[i]);
+	}
+	const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	if (extent == 0.0f) {
+		return 0.0f;
+	}
+	const float uvExtent = std::max(uvMax.x - uvMin.x, uvMax.y - uvMin.y);
+	const float uvScale = (uvExtent > 0.0f) ? 1.0f / uvExtent : 0.0f;
+	std::vector<glm::vec3> points(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		points[i] = (positions[i] - min) / extent;
+	}
+
+	// Vertices with the same position but different attributes are welded, positionVertex maps every vertex to the first one at its position
+	std::vector<uint32_t> sortedVertices(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		sortedVertices[i] = i;
+	}
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&positions](uint32_t a, uint32_t b) {
+		const glm::vec3& pa = positions[a];
+		const glm::vec3& pb = positions[b];
+		return (pa.x < pb.x) || ((pa.x == pb.x) && ((pa.y < pb.y) || ((pa.y == pb.y) && (pa.z < pb.z))));
+	});
+	std::vector<uint32_t> positionVertex(vertexCount);
+	std::vector<uint32_t> wedgeCount(vertexCount, 0);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		const uint32_t vertex = sortedVertices[i];
+		if ((i > 0) && (positions[vertex] == positions[sortedVertices[i - 1]])) {
+			positionVertex[vertex] = positionVertex[sortedVertices[i - 1]];
+		} else {
+			positionVertex[vertex] = vertex;
+		}
+		wedgeCount[positionVertex[vertex]]++;
+	}
+
+	// Seam, border and non-manifold vertices are locked (indexed by position vertex)
+	std::vector<uint8_t> locked(vertexCount, 0);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		if (wedgeCount[positionVertex[i]] > 1) {
+			locked[positionVertex[i]] = 1;
+		}
+	}
+	// A border edge has no opposite half edge, a non-manifold edge is used more than once in the same direction
+	std::vector<uint64_t> halfEdges;
+	halfEdges.reserve(destination.size());
+	for (size_t i = 0; i < destination.size(); i += 3) {
+		for (uint32_t e = 0; e < 3; e++) {
+			const uint64_t a = positionVertex[destination[i + e]];
+			const uint64_t b = positionVertex[destination[i + (e + 1) % 3]];
+			halfEdges.push_back((a << 32) | b);
+		}
+	}
+	std::sort(halfEdges.begin(), halfEdges.end());
+	for (size_t i = 0; i < destination.size(); i += 3) {
+		for (uint32_t e = 0; e < 3; e++) {
+			const uint32_t a = positionVertex[destination[i + e]];
+			const uint32_t b = positionVertex[destination[i + (e + 1) % 3]];
+			const uint64_t edge = (static_cast<uint64_t>(a) << 32) | b;
+			const uint64_t opposite = (static_cast<uint64_t>(b) << 32) | a;
+			const auto range = std::equal_range(halfEdges.begin(), halfEdges.end(), edge);
+			if ((range.second - range.first > 1) || !std::binary_search(halfEdges.begin(), halfEdges.end(), opposite)) {
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+
+	// Area weighted plane quadrics of the adjacent triangles (indexed by position vertex)
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < destination.size(); i += 3) {
+		const glm::vec3& p0 = points[destination[i]];
+		const glm::vec3 normal = glm::cross(points[destination[i + 1]] - p0, points[destination[i + 2]] - p0);
+		const float length = glm::length(normal);
+		if (length == 0.0f) {
+			continue;
+		}
+		const glm::vec3 n = normal / length;
+		const Quadric quadric = planeQuadric(n, -glm::dot(n, p0), length * 0.5f);
+		for (uint32_t k = 0; k < 3; k++) {
+			addQuadric(quadrics[positionVertex[destination[i + k]]], quadric);
+		}
+	}
+
+	const float maxError = targetError * targetError;
+	float resultError = 0.0f;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<float> bestCost(vertexCount);
+	std::vector<uint32_t> bestTarget(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+
+	while (destination.size() > targetIndexCount) {
+		const uint32_t triangleCount = static_cast<uint32_t>(destination.size() / 3);
+
+		// Vertex to triangle adjacency of the current triangle list
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : destination) {
+			adjacencyOffsets[index + 1]++;
+		}
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		}
+		adjacency.resize(destination.size());
+		std::vector<uint32_t> writeOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				adjacency[writeOffsets[destination[t * 3 + k]]++] = t;
+			}
+		}
+
+		// Cheapest collapse of every movable vertex onto one of its neighbours
+		std::fill(bestCost.begin(), bestCost.end(), FLT_MAX);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (uint32_t e = 0; e < 6; e++) {
+				const uint32_t source = destination[t * 3 + e % 3];
+				const uint32_t target = destination[t * 3 + ((e < 3) ? (e + 1) % 3 : (e + 2) % 3)];
+				if (locked[positionVertex[source]]) {
+					continue;
+				}
+				// The collapsed vertex takes over the target's attributes, so weight their difference by the edge length
+				const glm::vec3 edge = points[target] - points[source];
+				const glm::vec3 normalDelta = normals[target] - normals[source];
+				const glm::vec2 uvDelta = (uvs[target] - uvs[source]) * uvScale;
+				const float attributeError = glm::dot(edge, edge) * (0.25f * glm::dot(normalDelta, normalDelta) + glm::dot(uvDelta, uvDelta));
+				const float cost = quadricError(quadrics[source], points[target]) + attributeError;
+				if (cost < bestCost[source]) {
+					bestCost[source] = cost;
+					bestTarget[source] = target;
+				}
+			}
+		}
+		collapses.clear();
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			if (bestCost[i] <= maxError) {
+				collapses.push_back({ i, bestTarget[i], bestCost[i] });
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// Apply the cheapest independent collapses, vertices around a collapse are not touched again in this pass so the adjacency stays valid
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			remap[i] = i;
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+		const size_t removableIndices = destination.size() - targetIndexCount;
+		size_t removedIndices = 0;
+		for (const Collapse& collapse : collapses) {
+			if (removedIndices >= removableIndices) {
+				break;
+			}
+			if (touched[collapse.source] || touched[collapse.target]) {
+				continue;
+			}
+			// Reject collapses that flip one of the remaining triangles
+			bool flipped = false;
+			uint32_t collapsedTriangles = 0;
+			for (uint32_t a = adjacencyOffsets[collapse.source]; a < adjacencyOffsets[collapse.source + 1]; a++) {
+				const uint32_t* triangle = &destination[adjacency[a] * 3];
+				if ((triangle[0] == collapse.target) || (triangle[1] == collapse.target) || (triangle[2] == collapse.target)) {
+					collapsedTriangles++;
+					continue;
+				}
+				glm::vec3 p[3];
+				for (uint32_t k = 0; k < 3; k++) {
+					p[k] = points[triangle[k]];
+				}
+				const glm::vec3 normalBefore = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (uint32_t k = 0; k < 3; k++) {
+					if (triangle[k] == collapse.source) {
+						p[k] = points[collapse.target];
+					}
+				}
+				const glm::vec3 normalAfter = glm::cross(p[1] - p[0], p[2] - p[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+					flipped = true;
+					break;
+				}
+			}
+			if (flipped) {
+				continue;
+			}
+			for (uint32_t a = adjacencyOffsets[collapse.source]; a < adjacencyOffsets[collapse.source + 1]; a++) {
+				const uint32_t* triangle = &destination[adjacency[a] * 3];
+				touched[triangle[0]] = 1;
+				touched[triangle[1]] = 1;
+				touched[triangle[2]] = 1;
+			}
+			touched[collapse.target] = 1;
+			remap[collapse.source] = collapse.target;
+			addQuadric(quadrics[positionVertex[collapse.target]], quadrics[collapse.source]);
+			resultError = std::max(resultError, collapse.cost);
+			removedIndices += collapsedTriangles * 3;
+		}
+		if (removedIndices == 0) {
+			break;
+		}
+
+		// Remove the triangles that became degenerate
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < destination.size(); i += 3) {
+			const uint32_t a = remap[destination[i]];
+			const uint32_t b = remap[destination[i + 1]];
+			const uint32_t c = remap[destination[i + 2]];
+			if ((a == b) || (b == c) || (a == c)) {
+				continue;
+			}
+			destination[writeIndex++] = a;
+			destination[writeIndex++] = b;
+			destination[writeIndex++] = c;
+		}
+		destination.resize(writeIndex);
+	}
+
+	return sqrtf(resultError);
+}
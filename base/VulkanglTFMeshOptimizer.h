@@ -0,0 +1,131 @@
+/*
+* Mesh optimization functions for vkglTF models
+*
+* Reorders triangles for the post-transform vertex cache and for reduced overdraw,
+* reorders vertices for linear vertex fetches, splits meshes into meshlets
+* and simplifies meshes for level-of-detail chains
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vkglTF
+{
+	namespace meshoptimizer
+	{
+		/** @brief Size of the FIFO cache used to simulate the post-transform vertex cache when measuring ACMR */
+		const uint32_t fifoCacheSize = 16;
+
+		/**
+		* Calculates the average cache miss ratio (transformed vertices per triangle) of a triangle list
+		*
+		* @param indices Triangle list indices (0..vertexCount-1)
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices referenced by the indices
+		* @param cacheSize Number of entries of the simulated FIFO cache
+		*
+		* @return ACMR, ranges from 0.5 (best case for regular grids) to 3.0 (no reuse at all)
+		*/
+		float calculateACMR(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = fifoCacheSize);
+
+		/**
+		* Reorders triangles to maximize post-transform vertex cache hits (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+		*
+		* @param indices Triangle list indices (0..vertexCount-1), reordered in place
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices referenced by the indices
+		*/
+		void optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+		/**
+		* Reorders clusters of a cache optimized triangle list so that outward facing clusters are drawn first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+		* The new order is only kept if it doesn't increase the ACMR by more than the given threshold
+		*
+		* @param indices Cache optimized triangle list indices (0..vertexCount-1), reordered in place
+		* @param indexCount Number of indices
+		* @param positions Vertex positions
+		* @param vertexCount Number of vertices
+		* @param threshold Maximum allowed ACMR ratio of the reordered list compared to the input
+		*/
+		void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, uint32_t vertexCount, float threshold = 1.05f);
+
+		/**
+		* Generates a vertex remap table that orders vertices by their first use in the index buffer, so vertex fetches become mostly linear
+		* Vertices not referenced by any index are moved to the end
+		*
+		* @param remap Receives the new position for every vertex
+		* @param indices Triangle list indices (0..vertexCount-1)
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices
+		*/
+		void generateVertexFetchRemap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+		/** @brief Meshlet limits, within the recommended output sizes of current mesh shader implementations */
+		const uint32_t maxMeshletVertices = 64;
+		const uint32_t maxMeshletTriangles = 124;
+
+		/** @brief A cluster of triangles referencing a bounded number of unique vertices */
+		struct Meshlet {
+			// Offset and count into the meshlet vertex list
+			uint32_t vertexOffset;
+			uint32_t vertexCount;
+			// Offset (in triangles) and count into the meshlet triangle list
+			uint32_t triangleOffset;
+			uint32_t triangleCount;
+		};
+
+		/** @brief Bounding sphere and normal cone of a meshlet used for culling */
+		struct MeshletBounds {
+			glm::vec3 center;
+			float radius;
+			glm::vec3 coneApex;
+			glm::vec3 coneAxis;
+			// The meshlet is back facing for all views with dot(normalize(coneApex - viewPos), coneAxis) >= coneCutoff
+			float coneCutoff;
+		};
+
+		/**
+		* Splits a triangle list into meshlets, keeping the order of the triangles (so it should be cache optimized first)
+		*
+		* @param meshlets Receives the meshlets
+		* @param meshletVertices Receives the vertex indices referenced by the meshlets
+		* @param meshletTriangles Receives three local (meshlet vertex list relative) 8 bit indices per triangle
+		* @param indices Triangle list indices (0..vertexCount-1)
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices
+		*/
+		void buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t maxVertices = maxMeshletVertices, uint32_t maxTriangles = maxMeshletTriangles);
+
+		/**
+		* Calculates the bounding sphere and normal cone of a meshlet
+		* Face normals are oriented to agree with the vertex normals, so the result doesn't depend on the winding convention
+		*/
+		MeshletBounds computeMeshletBounds(const Meshlet& meshlet, const std::vector<uint32_t>& meshletVertices, const std::vector<uint8_t>& meshletTriangles, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals);
+
+		/**
+		* Simplifies a triangle list by collapsing edges in order of their quadric error (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+		* Collapses move a vertex onto one of its neighbours, so the result indexes the input vertices and no new vertices are needed
+		* Border vertices and vertices on attribute seams (same position, different attributes) are never moved, and the normal and texture coordinate
+		* difference between the two vertices is added to the cost of a collapse
+		*
+		* @param destination Receives the simplified triangle list
+		* @param indices Triangle list indices (0..vertexCount-1)
+		* @param indexCount Number of indices
+		* @param positions Vertex positions
+		* @param normals Vertex normals
+		* @param uvs Vertex texture coordinates
+		* @param vertexCount Number of vertices
+		* @param targetIndexCount Simplification stops once the index count is at or below this
+		* @param targetError Simplification stops before exceeding this error, relative to the mesh extent
+		*
+		* @return Error of the simplified mesh relative to the mesh extent (multiply by the extent for model space units)
+		*/
+		float simplify(std::vector<uint32_t>& destination, const uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs, uint32_t vertexCount, size_t targetIndexCount, float targetError);
+	}
+}
@@ -12,11 +12,78 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "VulkanglTFModel.h"
+#include "VulkanglTFMeshOptimizer.h"
+#include "VulkanKTX2.h"
+#include "VulkanBlockCompression.h"
+
+#include <glm/gtc/packing.hpp>
 
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
+VkDescriptorSetLayout vkglTF::descriptorSetLayoutBindless = VK_NULL_HANDLE;
 VkMemoryPropertyFlags vkglTF::memoryPropertyFlags = 0;
 uint32_t vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor;
+uint32_t vkglTF::maxBindlessTextures = 1024;
+uint32_t vkglTF::bindlessUpdateAfterBindTextures = 0;
+namespace
+{
+	// Size of the bindless texture array, update-after-bind sets have their own limits
+	uint32_t bindlessTextureArraySize(const VkPhysicalDeviceLimits& limits)
+	{
+		if (vkglTF::bindlessUpdateAfterBindTextures > 0) {
+			return std::min(vkglTF::maxBindlessTextures, vkglTF::bindlessUpdateAfterBindTextures);
+		}
+		const uint32_t perStage = std::min(limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages);
+		const uint32_t perSet = std::min(limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages);
+		return std::min(vkglTF::maxBindlessTextures, std::min(perStage, perSet));
+	}
+
+	/*
+		Image loader state if textures are block compressed at load time
+		Source images are identified by a hash of their file contents, so compressed images can be read from the disk cache without decoding the source
+	*/
+	struct CompressedImageLoaderData {
+		std::string cacheSuffix;
+		// Empty if the disk cache is disabled
+		std::string cachePath;
+		std::map<int, uint64_t> sourceHashes;
+	};
+
+	// Identifies the compression mode in the cache file name
+	std::string textureCacheSuffix(uint32_t fileLoadingFlags)
+	{
+		return (fileLoadingFlags & vkglTF::FileLoadingFlags::CompressTexturesFast) ? "bc1bc3" : "bc7";
+	}
+
+	uint64_t hashImageData(const unsigned char* data, size_t size)
+	{
+		// 64 bit FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string textureCacheFileName(const std::string& cachePath, uint64_t hash, const std::string& suffix)
+	{
+		char hashString[17];
+		snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(hash));
+		return cachePath + "/" + hashString + "_" + suffix + ".ktx2";
+	}
+
+	/*
+		Textures using KHR_texture_basisu reference a KTX2 image in the extension, which takes precedence over the fallback source
+	*/
+	int textureSource(const tinygltf::Texture& texture)
+	{
+		auto extension = texture.extensions.find("KHR_texture_basisu");
+		if ((extension != texture.extensions.end()) && extension->second.Has("source")) {
+			return extension->second.Get("source").Get<int>();
+		}
+		return texture.source;
+	}
+}
 
 /*
 	We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
@@ -29,6 +96,29 @@ bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string
 			return true;
 		}
 	}
+	// KTX2 files (external or embedded) are kept as they are and transcoded when the image is created
+	if (vks::ktx2::isKTX2(bytes, size)) {
+		image->image.assign(bytes, bytes + size);
+		return true;
+	}
+	// Try to read a compressed version of the image from the texture cache
+	if (userData) {
+		CompressedImageLoaderData* loaderData = static_cast<CompressedImageLoaderData*>(userData);
+		const uint64_t hash = hashImageData(bytes, size);
+		loaderData->sourceHashes[imageIndex] = hash;
+		if (!loaderData->cachePath.empty()) {
+			std::ifstream file(textureCacheFileName(loaderData->cachePath, hash, loaderData->cacheSuffix), std::ios::binary | std::ios::ate);
+			if (file.is_open()) {
+				std::vector<unsigned char> cacheData(static_cast<size_t>(file.tellg()));
+				file.seekg(0, std::ios::beg);
+				file.read(reinterpret_cast<char*>(cacheData.data()), cacheData.size());
+				if (file && vks::ktx2::isKTX2(cacheData.data(), cacheData.size())) {
+					image->image.swap(cacheData);
+					return true;
+				}
+			}
+		}
+	}
 
 	return tinygltf::LoadImageData(image, imageIndex, error, warning, req_width, req_height, bytes, size, userData);
 }
@@ -55,14 +145,13 @@ void vkglTF::Texture::destroy()
 {
 	if (device)
 	{
-		vkDestroyImageView(device->logicalDevice, view, nullptr);
-		vkDestroyImage(device->logicalDevice, image, nullptr);
-		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
-		vkDestroySampler(device->logicalDevice, sampler, nullptr);
+		// Images and samplers may be shared with textures of other models
+		vks::TextureCache::release(device->logicalDevice, image, view, deviceMemory);
+		vks::SamplerCache::release(device->logicalDevice, sampler);
 	}
 }
 
-void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, vks::VulkanDevice *device, VkQueue copyQueue)
+void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, vks::VulkanDevice *device, VkQueue copyQueue, vks::MipmapGenerator* mipmapGenerator, vks::MipmapGenerator::Filter mipmapFilter)
 {
 	this->device = device;
 
@@ -74,9 +163,50 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		}
 	}
 
+	bool isKtx2 = vks::ktx2::isKTX2(gltfimage.image.data(), gltfimage.image.size());
+
+	// Images with the same source are shared across all models, external ktx files are identified by the file, all other images by their (encoded or decoded) data
+	vks::TextureCache::Key cacheKey;
+	if (isKtx) {
+		cacheKey.contentHash = vks::TextureCache::hashFile(path + "/" + gltfimage.uri);
+	}
+	else {
+		// Images tinygltf can't decode (e.g. embedded KTX2) have no dimensions, those are not checked
+		cacheKey.setContents(gltfimage.image.data(), gltfimage.image.size(), static_cast<uint32_t>(std::max(gltfimage.width, 0)), static_cast<uint32_t>(std::max(gltfimage.height, 0)));
+	}
+	cacheKey.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+	cacheKey.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	cacheKey.variant = mipmapFilter;
+	vks::TextureCache::Entry cacheEntry;
+	const bool cached = vks::TextureCache::acquire(device->logicalDevice, cacheKey, cacheEntry);
+
 	VkFormat format;
 
-	if (!isKtx) {
+	if (cached) {
+		// Image, memory and view are shared with a texture loaded before, its mip chain is generated (or queued) by that texture's loader
+		image = cacheEntry.image;
+		deviceMemory = cacheEntry.memory;
+		view = cacheEntry.view;
+		width = cacheEntry.width;
+		height = cacheEntry.height;
+		mipLevels = cacheEntry.mipLevels;
+		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	else if (isKtx2) {
+		// Texture is a KTX2 file, Basis Universal payloads are transcoded to a format supported by the device
+		vks::ktx2::Texture ktx2Texture;
+		std::string error;
+		if (!vks::ktx2::load(gltfimage.image.data(), gltfimage.image.size(), device->physicalDevice, ktx2Texture, error)) {
+			vks::tools::exitFatal("Could not load texture " + gltfimage.uri + "\n\n" + error, -1);
+		}
+		width = ktx2Texture.width;
+		height = ktx2Texture.height;
+		mipLevels = ktx2Texture.levelCount;
+		format = ktx2Texture.format;
+		vks::ktx2::createImage(ktx2Texture, device, copyQueue, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &image, &deviceMemory);
+		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	else if (!isKtx) {
 		// Texture was loaded using STB_Image
 
 		unsigned char* buffer = nullptr;
@@ -105,15 +235,16 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 
 		format = VK_FORMAT_R8G8B8A8_UNORM;
 
-		VkFormatProperties formatProperties;
-
 		width = gltfimage.width;
 		height = gltfimage.height;
 		mipLevels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
 
-		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
-		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT);
-		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+		// The mip chain is generated by the mip generator, if none is passed the device's generator is used for this texture only
+		const bool generateImmediately = (mipmapGenerator == nullptr);
+		if (!mipmapGenerator) {
+			mipmapGenerator = device->getMipmapGenerator();
+		}
+		const bool computeMipmaps = mipmapGenerator->isComputeSupported(format);
 
 		VkMemoryAllocateInfo memAllocInfo{};
 		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
@@ -152,6 +283,9 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		if (computeMipmaps) {
+			imageCreateInfo.usage |= vks::MipmapGenerator::computeImageUsage;
+		}
 		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
 		memAllocInfo.allocationSize = memReqs.size;
@@ -189,175 +323,36 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 
 		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
-		{
-			VkImageMemoryBarrier imageMemoryBarrier{};
-			imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			imageMemoryBarrier.image = image;
-			imageMemoryBarrier.subresourceRange = subresourceRange;
-			vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-		}
-
 		device->flushCommandBuffer(copyCmd, copyQueue, true);
 
 		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
 		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
 
 		// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-		VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			VkImageBlit imageBlit{};
-
-			imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.srcSubresource.layerCount = 1;
-			imageBlit.srcSubresource.mipLevel = i - 1;
-			imageBlit.srcOffsets[1].x = int32_t(width >> (i - 1));
-			imageBlit.srcOffsets[1].y = int32_t(height >> (i - 1));
-			imageBlit.srcOffsets[1].z = 1;
-
-			imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.dstSubresource.layerCount = 1;
-			imageBlit.dstSubresource.mipLevel = i;
-			imageBlit.dstOffsets[1].x = int32_t(width >> i);
-			imageBlit.dstOffsets[1].y = int32_t(height >> i);
-			imageBlit.dstOffsets[1].z = 1;
-
-			VkImageSubresourceRange mipSubRange = {};
-			mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			mipSubRange.baseMipLevel = i;
-			mipSubRange.levelCount = 1;
-			mipSubRange.layerCount = 1;
-
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = 0;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-			}
-
-			vkCmdBlitImage(blitCmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
-
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-			}
-		}
-
-		subresourceRange.levelCount = mipLevels;
 		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		{
-			VkImageMemoryBarrier imageMemoryBarrier{};
-			imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			imageMemoryBarrier.image = image;
-			imageMemoryBarrier.subresourceRange = subresourceRange;
-			vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		mipmapGenerator->add(image, format, width, height, mipLevels, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, mipmapFilter, computeMipmaps);
+		if (generateImmediately) {
+			mipmapGenerator->generate(copyQueue);
 		}
-
-		device->flushCommandBuffer(blitCmd, copyQueue, true);
 	}
 	else {
 		// Texture is stored in an external ktx file
 		std::string filename = path + "/" + gltfimage.uri;
 
-		ktxTexture* ktxTexture;
-
-		ktxResult result = KTX_SUCCESS;
-#if defined(__ANDROID__)
-		AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-		if (!asset) {
-			vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
-		}
-		size_t size = AAsset_getLength(asset);
-		assert(size > 0);
-		ktx_uint8_t* textureData = new ktx_uint8_t[size];
-		AAsset_read(asset, textureData, size);
-		AAsset_close(asset);
-		result = ktxTexture_CreateFromMemory(textureData, size, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture);
-		delete[] textureData;
-#else
-		if (!vks::tools::fileExists(filename)) {
+		// The image data is streamed from the file into a bounded staging window
+		vks::ktx::Stream ktxStream;
+		if (!ktxStream.open(filename)) {
 			vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
 		}
-		result = ktxTexture_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture);
-#endif		
-		assert(result == KTX_SUCCESS);
 
 		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		mipLevels = ktxTexture->numLevels;
+		width = ktxStream.width;
+		height = ktxStream.height;
+		mipLevels = ktxStream.mipLevels;
 
-		ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
-		// @todo: Use ktxTexture_GetVkFormat(ktxTexture)
+		// @todo: Use the format stored in the file
 		format = VK_FORMAT_R8G8B8A8_UNORM;
 
-		// Get device properties for the requested texture format
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
-
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		for (uint32_t i = 0; i < mipLevels; i++)
-		{
-			ktx_size_t offset;
-			KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, i, 0, 0, &offset);
-			assert(result == KTX_SUCCESS);
-			VkBufferImageCopy bufferCopyRegion = {};
-			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			bufferCopyRegion.imageSubresource.mipLevel = i;
-			bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-			bufferCopyRegion.imageSubresource.layerCount = 1;
-			bufferCopyRegion.imageExtent.width = std::max(1u, ktxTexture->baseWidth >> i);
-			bufferCopyRegion.imageExtent.height = std::max(1u, ktxTexture->baseHeight >> i);
-			bufferCopyRegion.imageExtent.depth = 1;
-			bufferCopyRegion.bufferOffset = offset;
-			bufferCopyRegions.push_back(bufferCopyRegion);
-		}
-
 		// Create optimal tiled target image
 		VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -372,28 +367,16 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
+		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+		VkMemoryRequirements memReqs;
 		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
 		memAllocInfo.allocationSize = memReqs.size;
 		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
 		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
 
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 1;
-
-		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
-		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-		device->flushCommandBuffer(copyCmd, copyQueue);
 		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
-		ktxTexture_Destroy(ktxTexture);
+		vks::ktx::streamToImage(ktxStream, device, copyQueue, image, imageLayout);
 	}
 
 	VkSamplerCreateInfo samplerInfo{};
@@ -411,18 +394,29 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 	samplerInfo.maxLod = (float)mipLevels;
 	samplerInfo.maxAnisotropy = 8.0f;
 	samplerInfo.anisotropyEnable = VK_TRUE;
-	VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerInfo, nullptr, &sampler));
-
-	VkImageViewCreateInfo viewInfo{};
-	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewInfo.image = image;
-	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = format;
-	viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	viewInfo.subresourceRange.layerCount = 1;
-	viewInfo.subresourceRange.levelCount = mipLevels;
-	VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &view));
+	sampler = vks::SamplerCache::acquire(device->logicalDevice, samplerInfo);
+
+	if (!cached) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.layerCount = 1;
+		viewInfo.subresourceRange.levelCount = mipLevels;
+		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &view));
+
+		cacheEntry.image = image;
+		cacheEntry.memory = deviceMemory;
+		cacheEntry.view = view;
+		cacheEntry.width = width;
+		cacheEntry.height = height;
+		cacheEntry.mipLevels = mipLevels;
+		cacheEntry.layerCount = 1;
+		vks::TextureCache::insert(device->logicalDevice, cacheKey, cacheEntry);
+	}
 
 	descriptor.sampler = sampler;
 	descriptor.imageView = view;
@@ -560,8 +554,8 @@ VkVertexInputBindingDescription vkglTF::Vertex::vertexInputBindingDescription;
 std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::vertexInputAttributeDescriptions;
 VkPipelineVertexInputStateCreateInfo vkglTF::Vertex::pipelineVertexInputStateCreateInfo;
 
-VkVertexInputBindingDescription vkglTF::Vertex::inputBindingDescription(uint32_t binding) {
-	return VkVertexInputBindingDescription({ binding, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX });
+VkVertexInputBindingDescription vkglTF::Vertex::inputBindingDescription(uint32_t binding, uint32_t stride) {
+	return VkVertexInputBindingDescription({ binding, stride, VK_VERTEX_INPUT_RATE_VERTEX });
 }
 
 VkVertexInputAttributeDescription vkglTF::Vertex::inputAttributeDescription(uint32_t binding, uint32_t location, VertexComponent component) {
@@ -585,20 +579,47 @@ VkVertexInputAttributeDescription vkglTF::Vertex::inputAttributeDescription(uint
 	}
 }
 
-std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components) {
+VkVertexInputAttributeDescription vkglTF::Vertex::compactInputAttributeDescription(uint32_t binding, uint32_t location, uint32_t offset, VertexComponent component) {
+	switch (component) {
+		case VertexComponent::Position:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R16G16B16A16_UNORM, offset });
+		case VertexComponent::Normal:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R16G16_SNORM, offset });
+		case VertexComponent::UV:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R16G16_SFLOAT, offset });
+		case VertexComponent::Color:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R8G8B8A8_UNORM, offset });
+		case VertexComponent::Tangent:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R8G8B8A8_SNORM, offset });
+		case VertexComponent::Joint0:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R8G8B8A8_UINT, offset });
+		case VertexComponent::Weight0:
+			return VkVertexInputAttributeDescription({ location, binding, VK_FORMAT_R8G8B8A8_UNORM, offset });
+		default:
+			return VkVertexInputAttributeDescription({});
+	}
+}
+
+std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components, VertexLayout layout) {
 	std::vector<VkVertexInputAttributeDescription> result;
 	uint32_t location = 0;
+	uint32_t offset = 0;
 	for (VertexComponent component : components) {
-		result.push_back(Vertex::inputAttributeDescription(binding, location, component));
+		if (layout == VertexLayout::Compact) {
+			result.push_back(Vertex::compactInputAttributeDescription(binding, location, offset, component));
+			offset += compactComponentSize(component);
+		} else {
+			result.push_back(Vertex::inputAttributeDescription(binding, location, component));
+		}
 		location++;
 	}
 	return result;
 }
 
 /** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
-VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const std::vector<VertexComponent> components) {
-	vertexInputBindingDescription = Vertex::inputBindingDescription(0);
-	Vertex::vertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, components);
+VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const std::vector<VertexComponent> components, VertexLayout layout) {
+	vertexInputBindingDescription = Vertex::inputBindingDescription(0, (layout == VertexLayout::Compact) ? compactStride(components) : sizeof(Vertex));
+	Vertex::vertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, components, layout);
 	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
 	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &Vertex::vertexInputBindingDescription;
@@ -607,6 +628,84 @@ VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputStat
 	return &pipelineVertexInputStateCreateInfo;
 }
 
+uint32_t vkglTF::Vertex::compactComponentSize(VertexComponent component) {
+	return (component == VertexComponent::Position) ? 8 : 4;
+}
+
+uint32_t vkglTF::Vertex::compactStride(const std::vector<VertexComponent>& components) {
+	uint32_t stride = 0;
+	for (VertexComponent component : components) {
+		stride += compactComponentSize(component);
+	}
+	return stride;
+}
+
+namespace
+{
+	// Octahedral mapping of a unit vector to [-1..1]^2
+	glm::vec2 encodeOctahedral(glm::vec3 v)
+	{
+		const float length = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+		if (length == 0.0f) {
+			return glm::vec2(0.0f);
+		}
+		v /= length;
+		glm::vec2 e = glm::vec2(v.x, v.y);
+		if (v.z < 0.0f) {
+			e.x = (1.0f - fabsf(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f);
+			e.y = (1.0f - fabsf(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return e;
+	}
+}
+
+void vkglTF::Vertex::packCompact(const std::vector<VertexComponent>& components, const glm::vec3& posMin, const glm::vec3& posScale, uint8_t* dst) const {
+	for (VertexComponent component : components) {
+		uint32_t packed = 0;
+		switch (component) {
+			case VertexComponent::Position: {
+				const glm::vec3 normalized = glm::clamp((pos - posMin) * posScale, glm::vec3(0.0f), glm::vec3(1.0f));
+				const uint16_t quantized[4] = {
+					static_cast<uint16_t>(normalized.x * 65535.0f + 0.5f),
+					static_cast<uint16_t>(normalized.y * 65535.0f + 0.5f),
+					static_cast<uint16_t>(normalized.z * 65535.0f + 0.5f),
+					65535
+				};
+				memcpy(dst, quantized, sizeof(quantized));
+				dst += sizeof(quantized);
+				continue;
+			}
+			case VertexComponent::Normal:
+				packed = glm::packSnorm2x16(encodeOctahedral(normal));
+				break;
+			case VertexComponent::UV:
+				packed = glm::packHalf2x16(uv);
+				break;
+			case VertexComponent::Color:
+				packed = glm::packUnorm4x8(color);
+				break;
+			case VertexComponent::Tangent: {
+				const glm::vec2 e = encodeOctahedral(glm::vec3(tangent));
+				packed = glm::packSnorm4x8(glm::vec4(e.x, e.y, 0.0f, tangent.w < 0.0f ? -1.0f : 1.0f));
+				break;
+			}
+			case VertexComponent::Joint0:
+				for (uint32_t i = 0; i < 4; i++) {
+					packed |= (static_cast<uint32_t>(joint0[i]) & 0xFF) << (i * 8);
+				}
+				break;
+			case VertexComponent::Weight0: {
+				// Renormalize, as rounding to 8 bits can change the sum of the weights
+				const float sum = weight0.x + weight0.y + weight0.z + weight0.w;
+				packed = glm::packUnorm4x8((sum > 0.0f) ? weight0 / sum : weight0);
+				break;
+			}
+		}
+		memcpy(dst, &packed, sizeof(packed));
+		dst += sizeof(packed);
+	}
+}
+
 vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
 {
 
@@ -616,6 +715,18 @@ vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
 	return nullptr;
 }
 
+int32_t vkglTF::Model::getTextureIndex(vkglTF::Texture* texture)
+{
+	if (texture == nullptr) {
+		return -1;
+	}
+	// The empty texture is stored after all model textures in the bindless texture array
+	if (texture == &emptyTexture) {
+		return static_cast<int32_t>(textures.size());
+	}
+	return static_cast<int32_t>(texture - textures.data());
+}
+
 void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 {
 	emptyTexture.device = device;
@@ -704,7 +815,7 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
 	samplerCreateInfo.maxAnisotropy = 1.0f;
-	VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &emptyTexture.sampler));
+	emptyTexture.sampler = vks::SamplerCache::acquire(device->logicalDevice, samplerCreateInfo);
 
 	VkImageViewCreateInfo viewCreateInfo = vks::initializers::imageViewCreateInfo();
 	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -729,6 +840,17 @@ vkglTF::Model::~Model()
 	vkFreeMemory(device->logicalDevice, vertices.memory, nullptr);
 	vkDestroyBuffer(device->logicalDevice, indices.buffer, nullptr);
 	vkFreeMemory(device->logicalDevice, indices.memory, nullptr);
+	for (auto batch : batches) {
+		delete batch;
+	}
+	meshlets.buffer.destroy();
+	meshlets.vertexBuffer.destroy();
+	meshlets.triangleBuffer.destroy();
+	destroyAccelerationStructures();
+	if (bindless.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, bindless.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, bindless.memory, nullptr);
+	}
 	for (auto texture : textures) {
 		texture.destroy();
 	}
@@ -743,6 +865,10 @@ vkglTF::Model::~Model()
 		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutImage, nullptr);
 		descriptorSetLayoutImage = VK_NULL_HANDLE;
 	}
+	if (descriptorSetLayoutBindless != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutBindless, nullptr);
+		descriptorSetLayoutBindless = VK_NULL_HANDLE;
+	}
 	vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
 	emptyTexture.destroy();
 }
@@ -791,6 +917,7 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 		const tinygltf::Mesh mesh = model.meshes[node.mesh];
 		Mesh *newMesh = new Mesh(device, newNode->matrix);
 		newMesh->name = mesh.name;
+		newMesh->index = node.mesh;
 		for (size_t j = 0; j < mesh.primitives.size(); j++) {
 			const tinygltf::Primitive &primitive = mesh.primitives[j];
 			if (primitive.indices < 0) {
@@ -979,25 +1106,95 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 
 void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue)
 {
-	for (tinygltf::Image &image : gltfModel.images) {
+	// Normal maps are downsampled with a filter that renormalizes the averaged normals, color images (base color and emissive, which are
+	// sRGB encoded as per the glTF spec) are averaged in linear color space, all other images are averaged as stored
+	std::vector<vks::MipmapGenerator::Filter> imageFilters(gltfModel.images.size(), vks::MipmapGenerator::FilterLinear);
+	auto setImageFilter = [&](const tinygltf::Parameter& parameter, vks::MipmapGenerator::Filter filter) {
+		const int source = textureSource(gltfModel.textures[parameter.TextureIndex()]);
+		if ((source >= 0) && (source < static_cast<int>(imageFilters.size())) && (imageFilters[source] != vks::MipmapGenerator::FilterNormalMap)) {
+			imageFilters[source] = filter;
+		}
+	};
+	for (tinygltf::Material &mat : gltfModel.materials) {
+		if (mat.values.find("baseColorTexture") != mat.values.end()) {
+			setImageFilter(mat.values["baseColorTexture"], vks::MipmapGenerator::FilterSRGB);
+		}
+		if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) {
+			setImageFilter(mat.additionalValues["emissiveTexture"], vks::MipmapGenerator::FilterSRGB);
+		}
+		if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) {
+			setImageFilter(mat.additionalValues["normalTexture"], vks::MipmapGenerator::FilterNormalMap);
+		}
+	}
+	// Mip chains of all images are generated with a single submission
+	vks::MipmapGenerator& mipmapGenerator = *device->getMipmapGenerator();
+	for (size_t i = 0; i < gltfModel.images.size(); i++) {
 		vkglTF::Texture texture;
-		texture.fromglTfImage(image, path, device, transferQueue);
+		texture.fromglTfImage(gltfModel.images[i], path, device, transferQueue, &mipmapGenerator, imageFilters[i]);
 		textures.push_back(texture);
 	}
+	mipmapGenerator.generate(transferQueue);
 	// Create an empty texture to be used for empty material images
 	createEmptyTexture(transferQueue);
 }
 
+/*
+	Block compresses all decoded images including their mip chains and replaces them with KTX2 data, which is also written to the texture cache
+	Images that are already compressed (KTX, KTX2 and cache hits) are left untouched
+*/
+void vkglTF::Model::compressImages(tinygltf::Model& gltfModel, const std::map<int, uint64_t>& sourceHashes, const std::string& cachePath)
+{
+	const bool fast = (fileLoadingFlags & FileLoadingFlags::CompressTexturesFast) != 0;
+	uint32_t cachedImageCount = 0;
+	for (size_t i = 0; i < gltfModel.images.size(); i++) {
+		tinygltf::Image& image = gltfModel.images[i];
+		if (image.image.empty() || vks::ktx2::isKTX2(image.image.data(), image.image.size()) || (image.bits != 8) || (image.component < 1) || (image.component > 4)) {
+			continue;
+		}
+
+		// Expand to RGBA
+		const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+		std::vector<uint8_t> rgba(pixelCount * 4);
+		bool hasAlpha = false;
+		for (size_t p = 0; p < pixelCount; p++) {
+			const unsigned char* src = &image.image[p * image.component];
+			uint8_t* dst = &rgba[p * 4];
+			dst[0] = src[0];
+			dst[1] = (image.component > 2) ? src[1] : src[0];
+			dst[2] = (image.component > 2) ? src[2] : src[0];
+			dst[3] = (image.component == 4) ? src[3] : ((image.component == 2) ? src[1] : 255);
+			hasAlpha |= dst[3] < 255;
+		}
+
+		vks::bc::Format format = fast ? (hasAlpha ? vks::bc::BC3 : vks::bc::BC1) : vks::bc::BC7;
+		vks::ktx2::Texture texture;
+		vks::bc::compressTexture(format, rgba.data(), image.width, image.height, true, texture);
+		image.image = vks::ktx2::save(texture);
+
+		auto hash = sourceHashes.find(static_cast<int>(i));
+		if (!cachePath.empty() && (hash != sourceHashes.end())) {
+			std::ofstream file(textureCacheFileName(cachePath, hash->second, textureCacheSuffix(fileLoadingFlags)), std::ios::binary);
+			if (file.is_open()) {
+				file.write(reinterpret_cast<const char*>(image.image.data()), image.image.size());
+				cachedImageCount++;
+			}
+		}
+	}
+	if (cachedImageCount > 0) {
+		std::cout << "Cached " << cachedImageCount << " compressed images in " << cachePath << std::endl;
+	}
+}
+
 void vkglTF::Model::loadMaterials(tinygltf::Model &gltfModel)
 {
 	for (tinygltf::Material &mat : gltfModel.materials) {
 		vkglTF::Material material(device);
 		if (mat.values.find("baseColorTexture") != mat.values.end()) {
-			material.baseColorTexture = getTexture(gltfModel.textures[mat.values["baseColorTexture"].TextureIndex()].source);
+			material.baseColorTexture = getTexture(textureSource(gltfModel.textures[mat.values["baseColorTexture"].TextureIndex()]));
 		}
 		// Metallic roughness workflow
 		if (mat.values.find("metallicRoughnessTexture") != mat.values.end()) {
-			material.metallicRoughnessTexture = getTexture(gltfModel.textures[mat.values["metallicRoughnessTexture"].TextureIndex()].source);
+			material.metallicRoughnessTexture = getTexture(textureSource(gltfModel.textures[mat.values["metallicRoughnessTexture"].TextureIndex()]));
 		}
 		if (mat.values.find("roughnessFactor") != mat.values.end()) {
 			material.roughnessFactor = static_cast<float>(mat.values["roughnessFactor"].Factor());
@@ -1009,15 +1206,15 @@ void vkglTF::Model::loadMaterials(tinygltf::Model &gltfModel)
 			material.baseColorFactor = glm::make_vec4(mat.values["baseColorFactor"].ColorFactor().data());
 		}				
 		if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) {
-			material.normalTexture = getTexture(gltfModel.textures[mat.additionalValues["normalTexture"].TextureIndex()].source);
+			material.normalTexture = getTexture(textureSource(gltfModel.textures[mat.additionalValues["normalTexture"].TextureIndex()]));
 		} else {
 			material.normalTexture = &emptyTexture;
 		}
 		if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) {
-			material.emissiveTexture = getTexture(gltfModel.textures[mat.additionalValues["emissiveTexture"].TextureIndex()].source);
+			material.emissiveTexture = getTexture(textureSource(gltfModel.textures[mat.additionalValues["emissiveTexture"].TextureIndex()]));
 		}
 		if (mat.additionalValues.find("occlusionTexture") != mat.additionalValues.end()) {
-			material.occlusionTexture = getTexture(gltfModel.textures[mat.additionalValues["occlusionTexture"].TextureIndex()].source);
+			material.occlusionTexture = getTexture(textureSource(gltfModel.textures[mat.additionalValues["occlusionTexture"].TextureIndex()]));
 		}
 		if (mat.additionalValues.find("alphaMode") != mat.additionalValues.end()) {
 			tinygltf::Parameter param = mat.additionalValues["alphaMode"];
@@ -1032,10 +1229,13 @@ void vkglTF::Model::loadMaterials(tinygltf::Model &gltfModel)
 			material.alphaCutoff = static_cast<float>(mat.additionalValues["alphaCutoff"].Factor());
 		}
 
+		material.index = static_cast<uint32_t>(materials.size());
 		materials.push_back(material);
 	}
 	// Push a default material at the end of the list for meshes with no material assigned
-	materials.push_back(Material(device));
+	Material defaultMaterial(device);
+	defaultMaterial.index = static_cast<uint32_t>(materials.size());
+	materials.push_back(defaultMaterial);
 }
 
 void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
@@ -1154,10 +1354,17 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 {
 	tinygltf::Model gltfModel;
 	tinygltf::TinyGLTF gltfContext;
+	// Images are only block compressed if the device supports sampling from BC formats
+	const bool compressTextures = (fileLoadingFlags & (FileLoadingFlags::CompressTextures | FileLoadingFlags::CompressTexturesFast)) && device->enabledFeatures.textureCompressionBC;
+	CompressedImageLoaderData compressedImageLoaderData;
+	compressedImageLoaderData.cacheSuffix = textureCacheSuffix(fileLoadingFlags);
+	if (compressTextures) {
+		compressedImageLoaderData.cachePath = vks::tools::getCacheDirectory("textures");
+	}
 	if (fileLoadingFlags & FileLoadingFlags::DontLoadImages) {
 		gltfContext.SetImageLoader(loadImageDataFuncEmpty, nullptr);
 	} else {
-		gltfContext.SetImageLoader(loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(loadImageDataFunc, compressTextures ? &compressedImageLoaderData : nullptr);
 	}
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
@@ -1170,6 +1377,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	std::string error, warning;
 
 	this->device = device;
+	this->fileLoadingFlags = fileLoadingFlags;
 
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
@@ -1183,6 +1391,9 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 
 	if (fileLoaded) {
 		if (!(fileLoadingFlags & FileLoadingFlags::DontLoadImages)) {
+			if (compressTextures) {
+				compressImages(gltfModel, compressedImageLoaderData.sourceHashes, compressedImageLoaderData.cachePath);
+			}
 			loadImages(gltfModel, device, transferQueue);
 		}
 		loadMaterials(gltfModel);
@@ -1244,6 +1455,36 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
+	// Reorder triangles and vertices of all primitives for better vertex cache and fetch efficiency
+	if (fileLoadingFlags & FileLoadingFlags::OptimizeMeshes) {
+		optimizeMeshes(indexBuffer, vertexBuffer);
+	}
+
+	// Merge static primitives sharing a material into a single draw
+	if (fileLoadingFlags & FileLoadingFlags::BatchStaticGeometry) {
+		if (fileLoadingFlags & FileLoadingFlags::PreTransformVertices) {
+			batchStaticPrimitives(indexBuffer, vertexBuffer);
+		} else {
+			std::cerr << "Static geometry batching requires pre-transformed vertices, skipping" << std::endl;
+		}
+	}
+
+	// Append simplified index ranges for each primitive
+	if (fileLoadingFlags & FileLoadingFlags::GenerateLods) {
+		generateLods(indexBuffer, vertexBuffer);
+	}
+
+	// Split primitives into meshlets for cluster culling
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+	if (fileLoadingFlags & FileLoadingFlags::GenerateMeshlets) {
+		if (fileLoadingFlags & FileLoadingFlags::PreTransformVertices) {
+			generateMeshlets(indexBuffer, vertexBuffer, meshletVertices, meshletTriangles);
+		} else {
+			std::cerr << "Meshlet generation requires pre-transformed vertices, skipping" << std::endl;
+		}
+	}
+
 	for (auto extension : gltfModel.extensionsUsed) {
 		if (extension == "KHR_materials_pbrSpecularGlossiness") {
 			std::cout << "Required extension: " << extension;
@@ -1251,8 +1492,36 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
-	size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
-	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
+	// Use 16 bit indices if all draw ranges allow it
+	std::vector<uint16_t> indexBuffer16;
+	if ((fileLoadingFlags & FileLoadingFlags::OptimizeMeshes) && convertIndicesTo16Bit(indexBuffer, indexBuffer16)) {
+		indices.type = VK_INDEX_TYPE_UINT16;
+	}
+	if (!meshletData.empty()) {
+		// Meshlets use the same (possibly rebased) indices as their primitive
+		for (Node* node : linearNodes) {
+			if (node->mesh) {
+				for (Primitive* primitive : node->mesh->primitives) {
+					for (uint32_t i = 0; i < primitive->meshletCount; i++) {
+						meshletData[primitive->firstMeshlet + i].vertexOffset = primitive->vertexOffset;
+					}
+				}
+			}
+		}
+		uploadMeshlets(meshletVertices, meshletTriangles, transferQueue);
+	}
+	const void* indexData = (indices.type == VK_INDEX_TYPE_UINT16) ? static_cast<const void*>(indexBuffer16.data()) : static_cast<const void*>(indexBuffer.data());
+
+	// Pack vertices into the compact layout
+	std::vector<uint8_t> compactVertexBuffer;
+	const void* vertexData = vertexBuffer.data();
+	if (fileLoadingFlags & FileLoadingFlags::CompactVertices) {
+		packCompactVertices(vertexBuffer, compactVertexBuffer);
+		vertexData = compactVertexBuffer.data();
+	}
+
+	size_t vertexBufferSize = vertexBuffer.size() * vertices.stride;
+	size_t indexBufferSize = indexBuffer.size() * ((indices.type == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t));
 	indices.count = static_cast<uint32_t>(indexBuffer.size());
 	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
 
@@ -1271,7 +1540,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		vertexBufferSize,
 		&vertexStaging.buffer,
 		&vertexStaging.memory,
-		vertexBuffer.data()));
+		const_cast<void*>(vertexData)));
 	// Index data
 	VK_CHECK_RESULT(device->createBuffer(
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -1279,7 +1548,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		indexBufferSize,
 		&indexStaging.buffer,
 		&indexStaging.memory,
-		indexBuffer.data()));
+		const_cast<void*>(indexData)));
 
 	// Create device local buffers
 	// Vertex buffer
@@ -1341,11 +1610,26 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
 		}
 	}
+	uint32_t bindlessSetCount{ 0 };
+	if (fileLoadingFlags & FileLoadingFlags::BindlessMaterials) {
+		// All model images plus the empty texture are stored in one texture array, materials are stored in a storage buffer
+		bindless.textureCount = static_cast<uint32_t>(textures.size()) + 1;
+		const uint32_t arraySize = bindlessTextureArraySize(device->properties.limits);
+		if (bindless.textureCount > arraySize) {
+			vks::tools::exitFatal("glTF model uses " + std::to_string(bindless.textureCount - 1) + " textures, but bindless materials support at most " + std::to_string(arraySize - 1) + " textures on this device", -1);
+		}
+		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bindless.textureCount });
+		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 });
+		bindlessSetCount = 1;
+	}
 	VkDescriptorPoolCreateInfo descriptorPoolCI{};
 	descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	descriptorPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	descriptorPoolCI.pPoolSizes = poolSizes.data();
-	descriptorPoolCI.maxSets = uboCount + imageCount;
+	descriptorPoolCI.maxSets = uboCount + imageCount + bindlessSetCount;
+	if (bindlessSetCount && (bindlessUpdateAfterBindTextures > 0)) {
+		descriptorPoolCI.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	}
 	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
 
 	// Descriptors for per-node uniform buffers
@@ -1389,41 +1673,581 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 			}
 		}
 	}
+
+	// Descriptors for bindless materials
+	if (fileLoadingFlags & FileLoadingFlags::BindlessMaterials) {
+		prepareBindlessMaterials(transferQueue);
+	}
+}
+
+/*
+	Sets up the material storage buffer and the descriptor set with the global texture array used for bindless rendering
+*/
+void vkglTF::Model::prepareBindlessMaterials(VkQueue transferQueue)
+{
+	// Material storage buffer
+	std::vector<ShaderMaterial> shaderMaterials(materials.size());
+	for (auto& material : materials) {
+		ShaderMaterial& shaderMaterial = shaderMaterials[material.index];
+		shaderMaterial = {};
+		shaderMaterial.baseColorFactor = material.baseColorFactor;
+		shaderMaterial.baseColorTextureIndex = getTextureIndex(material.baseColorTexture);
+		shaderMaterial.metallicRoughnessTextureIndex = getTextureIndex(material.metallicRoughnessTexture);
+		shaderMaterial.normalTextureIndex = getTextureIndex(material.normalTexture);
+		shaderMaterial.occlusionTextureIndex = getTextureIndex(material.occlusionTexture);
+		shaderMaterial.emissiveTextureIndex = getTextureIndex(material.emissiveTexture);
+		shaderMaterial.metallicFactor = material.metallicFactor;
+		shaderMaterial.roughnessFactor = material.roughnessFactor;
+		shaderMaterial.alphaCutoff = material.alphaCutoff;
+		shaderMaterial.alphaMode = static_cast<uint32_t>(material.alphaMode);
+	}
+
+	VkDeviceSize bufferSize = shaderMaterials.size() * sizeof(ShaderMaterial);
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		bufferSize,
+		&stagingBuffer,
+		&stagingMemory,
+		shaderMaterials.data()));
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		bufferSize,
+		&bindless.buffer,
+		&bindless.memory));
+	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	VkBufferCopy copyRegion{};
+	copyRegion.size = bufferSize;
+	vkCmdCopyBuffer(copyCmd, stagingBuffer, bindless.buffer, 1, &copyRegion);
+	device->flushCommandBuffer(copyCmd, transferQueue, true);
+	vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+	vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+	bindless.descriptor = { bindless.buffer, 0, bufferSize };
+
+	// Layout is global, so only create if it hasn't already been created before
+	if (descriptorSetLayoutBindless == VK_NULL_HANDLE) {
+		// The texture array size is an upper bound, the actual number of textures is set per model at allocation time
+		const uint32_t arraySize = bindlessTextureArraySize(device->properties.limits);
+		const bool updateAfterBind = (bindlessUpdateAfterBindTextures > 0);
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, arraySize),
+		};
+		// The texture array is the last binding of the set, so it can be of variable size
+		std::vector<VkDescriptorBindingFlagsEXT> bindingFlags = { 0, VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT };
+		if (updateAfterBind) {
+			bindingFlags[1] |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+		}
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT setLayoutBindingFlags{};
+		setLayoutBindingFlags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		setLayoutBindingFlags.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		setLayoutBindingFlags.pBindingFlags = bindingFlags.data();
+		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		descriptorLayoutCI.pNext = &setLayoutBindingFlags;
+		if (updateAfterBind) {
+			descriptorLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		}
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutBindless));
+	}
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableDescriptorCountAllocInfo{};
+	variableDescriptorCountAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+	variableDescriptorCountAllocInfo.descriptorSetCount = 1;
+	variableDescriptorCountAllocInfo.pDescriptorCounts = &bindless.textureCount;
+	VkDescriptorSetAllocateInfo descriptorSetAllocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayoutBindless, 1);
+	descriptorSetAllocInfo.pNext = &variableDescriptorCountAllocInfo;
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &bindless.descriptorSet));
+
+	std::vector<VkDescriptorImageInfo> textureDescriptors;
+	for (auto& texture : textures) {
+		textureDescriptors.push_back(texture.descriptor);
+	}
+	textureDescriptors.push_back(emptyTexture.descriptor);
+
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		vks::initializers::writeDescriptorSet(bindless.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bindless.descriptor),
+		vks::initializers::writeDescriptorSet(bindless.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, textureDescriptors.data(), static_cast<uint32_t>(textureDescriptors.size())),
+	};
+	vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+}
+
+/*
+	Reorders the index buffer so that the indices of all static primitives sharing a material are stored contiguously,
+	and creates one batch primitive per material spanning that range
+	Only valid for pre-transformed vertices, as batched primitives no longer have a node transform
+	Skinned primitives are excluded and keep their own index range after the batches
+*/
+void vkglTF::Model::batchStaticPrimitives(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer)
+{
+	std::vector<std::vector<Primitive*>> materialPrimitives(materials.size());
+	std::vector<Primitive*> dynamicPrimitives;
+	uint32_t primitiveCount = 0;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			if (node->skinIndex > -1) {
+				dynamicPrimitives.push_back(primitive);
+			} else {
+				materialPrimitives[primitive->material.index].push_back(primitive);
+			}
+			primitiveCount++;
+		}
+	}
+
+	std::vector<uint32_t> batchedIndices;
+	batchedIndices.reserve(indexBuffer.size());
+	for (auto& primitives : materialPrimitives) {
+		if (primitives.empty()) {
+			continue;
+		}
+		Primitive* batch = new Primitive(static_cast<uint32_t>(batchedIndices.size()), 0, primitives[0]->material);
+		batch->firstVertex = UINT32_MAX;
+		batch->vertexCount = 0;
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		uint32_t lastVertex = 0;
+		for (Primitive* primitive : primitives) {
+			const uint32_t firstIndex = static_cast<uint32_t>(batchedIndices.size());
+			batchedIndices.insert(batchedIndices.end(), indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+			primitive->firstIndex = firstIndex;
+			primitive->batched = true;
+			// Bounds need to be calculated from the pre-transformed vertices
+			for (uint32_t i = 0; i < primitive->vertexCount; i++) {
+				min = glm::min(min, vertexBuffer[primitive->firstVertex + i].pos);
+				max = glm::max(max, vertexBuffer[primitive->firstVertex + i].pos);
+			}
+			batch->firstVertex = std::min(batch->firstVertex, primitive->firstVertex);
+			lastVertex = std::max(lastVertex, primitive->firstVertex + primitive->vertexCount);
+			batch->indexCount += primitive->indexCount;
+		}
+		batch->vertexCount = lastVertex - batch->firstVertex;
+		batch->setDimensions(min, max);
+		batches.push_back(batch);
+	}
+	for (Primitive* primitive : dynamicPrimitives) {
+		const uint32_t firstIndex = static_cast<uint32_t>(batchedIndices.size());
+		batchedIndices.insert(batchedIndices.end(), indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+		primitive->firstIndex = firstIndex;
+	}
+	indexBuffer.swap(batchedIndices);
+
+	std::cout << "Batched " << (primitiveCount - dynamicPrimitives.size()) << " static primitives into " << batches.size() << " draws" << std::endl;
+}
+
+/*
+	Runs the mesh optimization stages on each primitive's index and vertex range:
+	vertex cache optimization, overdraw optimization and vertex fetch remapping
+	The post-transform cache efficiency is reported as the ACMR (average cache miss ratio, transformed vertices per triangle) before and after
+*/
+void vkglTF::Model::optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer)
+{
+	uint64_t triangleCount = 0;
+	double missesBefore = 0.0;
+	double missesAfter = 0.0;
+	std::vector<uint32_t> localIndices;
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> remap;
+	std::vector<Vertex> remappedVertices;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			const uint32_t triangles = primitive->indexCount / 3;
+			if (triangles == 0) {
+				continue;
+			}
+			// Work on indices relative to the primitive's first vertex
+			localIndices.resize(triangles * 3);
+			for (uint32_t i = 0; i < triangles * 3; i++) {
+				localIndices[i] = indexBuffer[primitive->firstIndex + i] - primitive->firstVertex;
+				assert(localIndices[i] < primitive->vertexCount);
+			}
+			positions.resize(primitive->vertexCount);
+			for (uint32_t i = 0; i < primitive->vertexCount; i++) {
+				positions[i] = vertexBuffer[primitive->firstVertex + i].pos;
+			}
+
+			missesBefore += meshoptimizer::calculateACMR(localIndices.data(), localIndices.size(), primitive->vertexCount) * triangles;
+
+			meshoptimizer::optimizeVertexCache(localIndices.data(), localIndices.size(), primitive->vertexCount);
+			meshoptimizer::optimizeOverdraw(localIndices.data(), localIndices.size(), positions, primitive->vertexCount);
+
+			// Reorder vertices by first use
+			meshoptimizer::generateVertexFetchRemap(remap, localIndices.data(), localIndices.size(), primitive->vertexCount);
+			remappedVertices.resize(primitive->vertexCount);
+			for (uint32_t i = 0; i < primitive->vertexCount; i++) {
+				remappedVertices[remap[i]] = vertexBuffer[primitive->firstVertex + i];
+			}
+			std::copy(remappedVertices.begin(), remappedVertices.end(), vertexBuffer.begin() + primitive->firstVertex);
+			for (uint32_t i = 0; i < triangles * 3; i++) {
+				localIndices[i] = remap[localIndices[i]];
+				indexBuffer[primitive->firstIndex + i] = localIndices[i] + primitive->firstVertex;
+			}
+
+			missesAfter += meshoptimizer::calculateACMR(localIndices.data(), localIndices.size(), primitive->vertexCount) * triangles;
+			triangleCount += triangles;
+		}
+	}
+	if (triangleCount > 0) {
+		std::cout << "Mesh optimization: " << triangleCount << " triangles, ACMR " << (missesBefore / triangleCount) << " -> " << (missesAfter / triangleCount) << " (FIFO cache size " << meshoptimizer::fifoCacheSize << ")" << std::endl;
+	}
+}
+
+/*
+	Converts the index buffer to 16 bits if every draw range references less than 65535 vertices
+	If the model has more vertices than that, the indices of each draw range are rebased to its lowest vertex and the primitive's vertex offset is set accordingly
+	Returns false if at least one draw range is too large, in which case the 32 bit index buffer is kept
+*/
+bool vkglTF::Model::convertIndicesTo16Bit(const std::vector<uint32_t>& indexBuffer, std::vector<uint16_t>& indexBuffer16)
+{
+	// 0xFFFF is reserved for primitive restart
+	const uint32_t maxIndex = 0xFFFE;
+	if (indexBuffer.empty()) {
+		return false;
+	}
+	const bool rebase = *std::max_element(indexBuffer.begin(), indexBuffer.end()) > maxIndex;
+
+	// Draw ranges are the batches and all primitives not part of a batch
+	std::vector<Primitive*> drawRanges(batches.begin(), batches.end());
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			for (Primitive* primitive : node->mesh->primitives) {
+				if (!primitive->batched) {
+					drawRanges.push_back(primitive);
+				}
+			}
+		}
+	}
+
+	std::vector<uint32_t> baseVertices(drawRanges.size(), 0);
+	for (size_t r = 0; r < drawRanges.size(); r++) {
+		const Primitive* range = drawRanges[r];
+		if (range->indexCount == 0) {
+			continue;
+		}
+		uint32_t minVertex = UINT32_MAX;
+		uint32_t maxVertex = 0;
+		for (uint32_t i = 0; i < range->indexCount; i++) {
+			minVertex = std::min(minVertex, indexBuffer[range->firstIndex + i]);
+			maxVertex = std::max(maxVertex, indexBuffer[range->firstIndex + i]);
+		}
+		if (rebase) {
+			if (maxVertex - minVertex > maxIndex) {
+				return false;
+			}
+			baseVertices[r] = minVertex;
+		}
+	}
+
+	indexBuffer16.resize(indexBuffer.size());
+	for (size_t i = 0; i < indexBuffer.size(); i++) {
+		indexBuffer16[i] = static_cast<uint16_t>(indexBuffer[i]);
+	}
+	if (rebase) {
+		for (size_t r = 0; r < drawRanges.size(); r++) {
+			Primitive* range = drawRanges[r];
+			for (uint32_t i = 0; i < range->indexCount; i++) {
+				indexBuffer16[range->firstIndex + i] = static_cast<uint16_t>(indexBuffer[range->firstIndex + i] - baseVertices[r]);
+			}
+			range->vertexOffset = static_cast<int32_t>(baseVertices[r]);
+			// Simplified levels only reference vertices of the full detail range
+			for (size_t l = 1; l < range->lods.size(); l++) {
+				const Primitive::Lod& lod = range->lods[l];
+				for (uint32_t i = 0; i < lod.indexCount; i++) {
+					indexBuffer16[lod.firstIndex + i] = static_cast<uint16_t>(indexBuffer[lod.firstIndex + i] - baseVertices[r]);
+				}
+			}
+		}
+		// Primitives merged into a batch share the batch's base vertex
+		for (size_t r = 0; r < batches.size(); r++) {
+			for (Node* node : linearNodes) {
+				if (node->mesh) {
+					for (Primitive* primitive : node->mesh->primitives) {
+						if (primitive->batched && (&primitive->material == &batches[r]->material)) {
+							primitive->vertexOffset = batches[r]->vertexOffset;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::cout << "Using 16 bit indices" << (rebase ? " with per draw vertex offsets" : "") << ", index buffer size reduced by " << (indexBuffer.size() * sizeof(uint16_t)) / 1024 << " KB" << std::endl;
+	return true;
+}
+
+/*
+	Builds a chain of simplified index ranges for all primitives not merged into a static batch
+	Each level is simplified from the previous one, so the errors of the steps are summed up to get a conservative error for the level
+*/
+void vkglTF::Model::generateLods(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer)
+{
+	std::vector<uint32_t> triangleCounts;
+	std::vector<uint32_t> localIndices;
+	std::vector<uint32_t> lodIndices;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			primitive->lods.clear();
+			primitive->lods.push_back({ primitive->firstIndex, primitive->indexCount, 0.0f });
+			if (primitive->batched || (primitive->indexCount < 3)) {
+				continue;
+			}
+			localIndices.resize(primitive->indexCount);
+			for (uint32_t i = 0; i < primitive->indexCount; i++) {
+				localIndices[i] = indexBuffer[primitive->firstIndex + i] - primitive->firstVertex;
+			}
+			positions.resize(primitive->vertexCount);
+			normals.resize(primitive->vertexCount);
+			uvs.resize(primitive->vertexCount);
+			glm::vec3 min = glm::vec3(FLT_MAX);
+			glm::vec3 max = glm::vec3(-FLT_MAX);
+			for (uint32_t i = 0; i < primitive->vertexCount; i++) {
+				const Vertex& vertex = vertexBuffer[primitive->firstVertex + i];
+				positions[i] = vertex.pos;
+				normals[i] = vertex.normal;
+				uvs[i] = vertex.uv;
+				min = glm::min(min, vertex.pos);
+				max = glm::max(max, vertex.pos);
+			}
+			const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+
+			float error = 0.0f;
+			for (uint32_t level = 1; level < lodLevels; level++) {
+				const size_t targetIndexCount = static_cast<size_t>(localIndices.size() / 3 * lodReductionFactor) * 3;
+				const float stepError = meshoptimizer::simplify(lodIndices, localIndices.data(), localIndices.size(), positions, normals, uvs, primitive->vertexCount, targetIndexCount, lodMaxError);
+				// Stop if the simplification stalls, e.g. because the remaining vertices are locked or the error limit has been reached
+				if ((lodIndices.size() < 3) || (lodIndices.size() > localIndices.size() * 9 / 10)) {
+					break;
+				}
+				meshoptimizer::optimizeVertexCache(lodIndices.data(), lodIndices.size(), primitive->vertexCount);
+				error += stepError * extent;
+				primitive->lods.push_back({ static_cast<uint32_t>(indexBuffer.size()), static_cast<uint32_t>(lodIndices.size()), error });
+				for (uint32_t index : lodIndices) {
+					indexBuffer.push_back(index + primitive->firstVertex);
+				}
+				localIndices.swap(lodIndices);
+			}
+
+			if (triangleCounts.size() < primitive->lods.size()) {
+				triangleCounts.resize(primitive->lods.size(), 0);
+			}
+			for (size_t l = 0; l < primitive->lods.size(); l++) {
+				triangleCounts[l] += primitive->lods[l].indexCount / 3;
+			}
+		}
+	}
+	if (!triangleCounts.empty()) {
+		std::cout << "Generated " << triangleCounts.size() << " levels of detail, triangles per level:";
+		for (uint32_t count : triangleCounts) {
+			std::cout << " " << count;
+		}
+		std::cout << std::endl;
+	}
+}
+
+/*
+	Splits all primitives into meshlets and calculates their culling bounds
+	The meshlet builder keeps the triangle order, so each meshlet maps to a contiguous range of its primitive's indices
+*/
+void vkglTF::Model::generateMeshlets(const std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles)
+{
+	std::vector<glm::vec3> positions(vertexBuffer.size());
+	std::vector<glm::vec3> normals(vertexBuffer.size());
+	for (size_t i = 0; i < vertexBuffer.size(); i++) {
+		positions[i] = vertexBuffer[i].pos;
+		normals[i] = vertexBuffer[i].normal;
+	}
+
+	std::vector<uint32_t> localIndices;
+	std::vector<meshoptimizer::Meshlet> primitiveMeshlets;
+	std::vector<uint32_t> localVertices;
+	std::vector<uint8_t> localTriangles;
+	uint32_t cullableMeshlets = 0;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			localIndices.resize(primitive->indexCount - primitive->indexCount % 3);
+			for (size_t i = 0; i < localIndices.size(); i++) {
+				localIndices[i] = indexBuffer[primitive->firstIndex + i] - primitive->firstVertex;
+			}
+			primitiveMeshlets.clear();
+			localVertices.clear();
+			localTriangles.clear();
+			meshoptimizer::buildMeshlets(primitiveMeshlets, localVertices, localTriangles, localIndices.data(), localIndices.size(), primitive->vertexCount);
+
+			// Convert to vertex buffer indices, so bounds can be calculated on the whole vertex buffer
+			for (uint32_t& vertex : localVertices) {
+				vertex += primitive->firstVertex;
+			}
+
+			primitive->firstMeshlet = static_cast<uint32_t>(meshletData.size());
+			primitive->meshletCount = static_cast<uint32_t>(primitiveMeshlets.size());
+			const uint32_t vertexBase = static_cast<uint32_t>(meshletVertices.size());
+			const uint32_t triangleBase = static_cast<uint32_t>(meshletTriangles.size());
+			for (const meshoptimizer::Meshlet& meshlet : primitiveMeshlets) {
+				const meshoptimizer::MeshletBounds bounds = meshoptimizer::computeMeshletBounds(meshlet, localVertices, localTriangles, positions, normals);
+				Meshlet gpuMeshlet{};
+				gpuMeshlet.boundingSphere = glm::vec4(bounds.center, bounds.radius);
+				gpuMeshlet.coneApex = glm::vec4(bounds.coneApex, 0.0f);
+				// Alpha masked and blended materials are usually rendered without back face culling, so their meshlets must not be cone culled either
+				const float coneCutoff = (primitive->material.alphaMode == Material::ALPHAMODE_OPAQUE) ? bounds.coneCutoff : 1.0f;
+				gpuMeshlet.cone = glm::vec4(bounds.coneAxis, coneCutoff);
+				gpuMeshlet.firstIndex = primitive->firstIndex + meshlet.triangleOffset * 3;
+				gpuMeshlet.indexCount = meshlet.triangleCount * 3;
+				gpuMeshlet.materialIndex = primitive->material.index;
+				gpuMeshlet.meshletVertexOffset = vertexBase + meshlet.vertexOffset;
+				gpuMeshlet.meshletVertexCount = meshlet.vertexCount;
+				gpuMeshlet.meshletTriangleOffset = triangleBase + meshlet.triangleOffset;
+				gpuMeshlet.meshletTriangleCount = meshlet.triangleCount;
+				meshletData.push_back(gpuMeshlet);
+				if (coneCutoff < 1.0f) {
+					cullableMeshlets++;
+				}
+			}
+			meshletVertices.insert(meshletVertices.end(), localVertices.begin(), localVertices.end());
+			for (size_t t = 0; t < localTriangles.size() / 3; t++) {
+				meshletTriangles.push_back(localTriangles[t * 3] | (localTriangles[t * 3 + 1] << 8) | (localTriangles[t * 3 + 2] << 16));
+			}
+		}
+	}
+
+	std::cout << "Generated " << meshletData.size() << " meshlets (" << cullableMeshlets << " with a normal cone suitable for back face culling)" << std::endl;
+}
+
+void vkglTF::Model::uploadMeshlets(const std::vector<uint32_t>& meshletVertices, const std::vector<uint32_t>& meshletTriangles, VkQueue transferQueue)
+{
+	meshlets.count = static_cast<uint32_t>(meshletData.size());
+	struct Upload {
+		vks::Buffer* target;
+		const void* data;
+		VkDeviceSize size;
+	};
+	const Upload uploads[3] = {
+		{ &meshlets.buffer, meshletData.data(), meshletData.size() * sizeof(Meshlet) },
+		{ &meshlets.vertexBuffer, meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t) },
+		{ &meshlets.triangleBuffer, meshletTriangles.data(), meshletTriangles.size() * sizeof(uint32_t) },
+	};
+	for (const Upload& upload : uploads) {
+		vks::Buffer stagingBuffer;
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&stagingBuffer,
+			upload.size,
+			const_cast<void*>(upload.data)));
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			upload.target,
+			upload.size));
+		device->copyBuffer(&stagingBuffer, upload.target, transferQueue);
+		stagingBuffer.destroy();
+	}
+}
+
+/*
+	Packs the vertex buffer into the compact vertex layout for the components in compactVertexComponents
+	Positions are normalized to the bounds of all vertices, positionDequantization maps them back
+*/
+void vkglTF::Model::packCompactVertices(const std::vector<Vertex>& vertexBuffer, std::vector<uint8_t>& compactVertexBuffer)
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+	bool jointsInRange = true;
+	bool uvsInRange = true;
+	for (const Vertex& vertex : vertexBuffer) {
+		min = glm::min(min, vertex.pos);
+		max = glm::max(max, vertex.pos);
+		jointsInRange &= (glm::max(glm::max(vertex.joint0.x, vertex.joint0.y), glm::max(vertex.joint0.z, vertex.joint0.w)) < 256.0f);
+		// Half floats lose sub-texel precision on large textures outside of this range
+		uvsInRange &= (glm::max(fabsf(vertex.uv.x), fabsf(vertex.uv.y)) <= 64.0f);
+	}
+	const glm::vec3 extent = max - min;
+	const glm::vec3 scale = glm::vec3(
+		extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+		extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+	positionDequantization = glm::scale(glm::translate(glm::mat4(1.0f), min), extent);
+
+	const bool hasJoints = std::find(compactVertexComponents.begin(), compactVertexComponents.end(), VertexComponent::Joint0) != compactVertexComponents.end();
+	const bool hasUVs = std::find(compactVertexComponents.begin(), compactVertexComponents.end(), VertexComponent::UV) != compactVertexComponents.end();
+	if (hasJoints && !jointsInRange) {
+		std::cerr << "Compact vertex layout only supports up to 256 joints, joint indices will be truncated" << std::endl;
+	}
+	if (hasUVs && !uvsInRange) {
+		std::cerr << "Texture coordinates exceed the precise range of half floats" << std::endl;
+	}
+
+	vertices.stride = Vertex::compactStride(compactVertexComponents);
+	compactVertexBuffer.resize(vertexBuffer.size() * vertices.stride);
+	for (size_t i = 0; i < vertexBuffer.size(); i++) {
+		vertexBuffer[i].packCompact(compactVertexComponents, min, scale, &compactVertexBuffer[i * vertices.stride]);
+	}
+
+	std::cout << "Compact vertex layout: " << vertices.stride << " bytes per vertex (default " << sizeof(Vertex) << "), vertex buffer size " << (vertexBuffer.size() * sizeof(Vertex)) / 1024 << " KB -> " << compactVertexBuffer.size() / 1024 << " KB" << std::endl;
 }
 
 void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
 {
 	const VkDeviceSize offsets[1] = {0};
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
 	buffersBound = true;
 }
 
+void vkglTF::Model::drawPrimitive(Primitive* primitive, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+{
+	bool skip = false;
+	const vkglTF::Material& material = primitive->material;
+	if (renderFlags & RenderFlags::RenderOpaqueNodes) {
+		skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
+	}
+	if (renderFlags & RenderFlags::RenderAlphaMaskedNodes) {
+		skip = (material.alphaMode != Material::ALPHAMODE_MASK);
+	}
+	if (renderFlags & RenderFlags::RenderAlphaBlendedNodes) {
+		skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
+	}
+	if (skip) {
+		return;
+	}
+	if (renderFlags & RenderFlags::Bindless) {
+		// The material set has been bound once for the whole model, the material index is passed as the instance index
+		vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->vertexOffset, material.index);
+		return;
+	}
+	if (renderFlags & RenderFlags::BindImages) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
+	}
+	vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->vertexOffset, 0);
+}
+
 void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
 {
 	if (node->mesh) {
 		for (Primitive* primitive : node->mesh->primitives) {
-			bool skip = false;
-			const vkglTF::Material& material = primitive->material;
-			if (renderFlags & RenderFlags::RenderOpaqueNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
-			}
-			if (renderFlags & RenderFlags::RenderAlphaMaskedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_MASK);
-			}
-			if (renderFlags & RenderFlags::RenderAlphaBlendedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
-			}
-			if (!skip) {
-				if (renderFlags & RenderFlags::BindImages) {
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
-				}
-				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+			// Batched primitives are drawn as part of their material's batch
+			if (!primitive->batched) {
+				drawPrimitive(primitive, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 			}
 		}
 	}
 	for (auto& child : node->children) {
-		drawNode(child, commandBuffer, renderFlags);
+		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 	}
 }
 
@@ -1432,7 +2256,14 @@ void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, Vk
 	if (!buffersBound) {
 		const VkDeviceSize offsets[1] = {0};
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+	}
+	if (renderFlags & RenderFlags::Bindless) {
+		assert(bindless.descriptorSet != VK_NULL_HANDLE);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &bindless.descriptorSet, 0, nullptr);
+	}
+	for (auto& batch : batches) {
+		drawPrimitive(batch, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 	}
 	for (auto& node : nodes) {
 		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
@@ -1577,4 +2408,136 @@ void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLay
 	for (auto& child : node->children) {
 		prepareNodeDescriptor(child, descriptorSetLayout);
 	}
-}
\ No newline at end of file
+}
+void vkglTF::Model::createAccelerationStructures(vks::AccelerationStructureBuilder* builder)
+{
+	destroyAccelerationStructures();
+
+	const VkFormat vertexFormat = (fileLoadingFlags & FileLoadingFlags::CompactVertices) ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device->physicalDevice, vertexFormat, &formatProperties);
+	if (!(formatProperties.bufferFeatures & VK_FORMAT_FEATURE_ACCELERATION_STRUCTURE_VERTEX_BUFFER_BIT_KHR)) {
+		std::cerr << "Vertex format " << vertexFormat << " not supported for acceleration structure builds, skipping" << std::endl;
+		return;
+	}
+
+	// Pre-transformed vertices are unique to their node, otherwise all nodes instancing a glTF mesh share the same vertices
+	const bool preTransformed = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
+	std::map<int32_t, uint32_t> meshStructureIndices;
+	std::vector<Mesh*> structureMeshes;
+	std::vector<std::pair<Node*, uint32_t>> instanceNodes;
+	for (Node* node : linearNodes) {
+		if (!node->mesh || node->mesh->primitives.empty()) {
+			continue;
+		}
+		uint32_t structureIndex = static_cast<uint32_t>(structureMeshes.size());
+		if (!preTransformed) {
+			auto meshStructureIndex = meshStructureIndices.find(node->mesh->index);
+			if (meshStructureIndex != meshStructureIndices.end()) {
+				structureIndex = meshStructureIndex->second;
+			} else {
+				meshStructureIndices[node->mesh->index] = structureIndex;
+			}
+		}
+		if (structureIndex == structureMeshes.size()) {
+			structureMeshes.push_back(node->mesh);
+		}
+		instanceNodes.push_back(std::make_pair(node, structureIndex));
+	}
+	if (instanceNodes.empty()) {
+		return;
+	}
+
+	// Bottom level structures, all geometries source the model's shared vertex and index buffers
+	VkDeviceOrHostAddressConstKHR vertexDataDeviceAddress{};
+	vertexDataDeviceAddress.deviceAddress = builder->getBufferDeviceAddress(vertices.buffer);
+	VkDeviceOrHostAddressConstKHR indexDataDeviceAddress{};
+	indexDataDeviceAddress.deviceAddress = builder->getBufferDeviceAddress(indices.buffer);
+	const uint32_t indexSize = (indices.type == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	accelerationStructures.bottomLevel.resize(structureMeshes.size());
+	for (size_t i = 0; i < structureMeshes.size(); i++) {
+		std::vector<VkAccelerationStructureGeometryKHR> geometries;
+		std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges;
+		for (Primitive* primitive : structureMeshes[i]->primitives) {
+			VkAccelerationStructureGeometryKHR geometry = vks::initializers::accelerationStructureGeometryKHR();
+			// Alpha masked and blended geometries need to be visible to any hit shaders
+			geometry.flags = (primitive->material.alphaMode == Material::ALPHAMODE_OPAQUE) ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
+			geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+			geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+			geometry.geometry.triangles.vertexFormat = vertexFormat;
+			geometry.geometry.triangles.vertexData = vertexDataDeviceAddress;
+			geometry.geometry.triangles.vertexStride = vertices.stride;
+			geometry.geometry.triangles.maxVertex = std::max(vertices.count, 1) - 1;
+			geometry.geometry.triangles.indexType = indices.type;
+			geometry.geometry.triangles.indexData = indexDataDeviceAddress;
+			geometries.push_back(geometry);
+			VkAccelerationStructureBuildRangeInfoKHR buildRange{};
+			buildRange.primitiveCount = primitive->indexCount / 3;
+			buildRange.primitiveOffset = primitive->firstIndex * indexSize;
+			// Added to the index values, so it also covers indices rebased to 16 bits
+			buildRange.firstVertex = static_cast<uint32_t>(primitive->vertexOffset);
+			buildRanges.push_back(buildRange);
+		}
+		builder->add(accelerationStructures.bottomLevel[i], VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, geometries, buildRanges);
+	}
+	// Built before the instances are set up, as compaction changes the device addresses of the structures
+	builder->build();
+
+	// Top level structure with one instance per node
+	std::vector<VkAccelerationStructureInstanceKHR> instances;
+	for (auto& instanceNode : instanceNodes) {
+		const glm::mat4 transform = (preTransformed ? glm::mat4(1.0f) : instanceNode.first->getMatrix()) * positionDequantization;
+		VkAccelerationStructureInstanceKHR instance{};
+		// VkTransformMatrixKHR is a row-major 3x4 matrix
+		for (uint32_t row = 0; row < 3; row++) {
+			for (uint32_t column = 0; column < 4; column++) {
+				instance.transform.matrix[row][column] = transform[column][row];
+			}
+		}
+		instance.instanceCustomIndex = instanceNode.first->index;
+		instance.mask = 0xFF;
+		instance.instanceShaderBindingTableRecordOffset = 0;
+		instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+		instance.accelerationStructureReference = accelerationStructures.bottomLevel[instanceNode.second].deviceAddress;
+		instances.push_back(instance);
+	}
+	vks::Buffer instanceBuffer;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&instanceBuffer,
+		instances.size() * sizeof(VkAccelerationStructureInstanceKHR),
+		instances.data()));
+
+	VkAccelerationStructureGeometryKHR geometry = vks::initializers::accelerationStructureGeometryKHR();
+	geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+	geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+	geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+	geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+	geometry.geometry.instances.data.deviceAddress = builder->getBufferDeviceAddress(instanceBuffer.buffer);
+	VkAccelerationStructureBuildRangeInfoKHR buildRange{};
+	buildRange.primitiveCount = static_cast<uint32_t>(instances.size());
+	builder->add(accelerationStructures.topLevel, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, { geometry }, { buildRange });
+	builder->build();
+
+	// The builder waits for the builds to finish
+	instanceBuffer.destroy();
+}
+
+void vkglTF::Model::destroyAccelerationStructures()
+{
+	if (accelerationStructures.bottomLevel.empty() && (accelerationStructures.topLevel.handle == VK_NULL_HANDLE)) {
+		return;
+	}
+	PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(device->logicalDevice, "vkDestroyAccelerationStructureKHR"));
+	accelerationStructures.bottomLevel.push_back(accelerationStructures.topLevel);
+	for (auto& accelerationStructure : accelerationStructures.bottomLevel) {
+		if (accelerationStructure.handle != VK_NULL_HANDLE) {
+			vkDestroyAccelerationStructureKHR(device->logicalDevice, accelerationStructure.handle, nullptr);
+			vkDestroyBuffer(device->logicalDevice, accelerationStructure.buffer, nullptr);
+			vkFreeMemory(device->logicalDevice, accelerationStructure.memory, nullptr);
+		}
+	}
+	accelerationStructures.bottomLevel.clear();
+	accelerationStructures.topLevel = {};
+}
@@ -11,10 +11,15 @@
 #include <stdlib.h>
 #include <string>
 #include <fstream>
+#include <map>
 #include <vector>
 
 #include "vulkan/vulkan.h"
+#include "VulkanAccelerationStructureBuilder.h"
 #include "VulkanDevice.h"
+#include "VulkanKTXStream.h"
+#include "VulkanMipmapGenerator.h"
+#include "VulkanResourceCache.h"
 
 #include <ktx.h>
 #include <ktxvulkan.h>
@@ -44,8 +49,17 @@ namespace vkglTF
 
 	extern VkDescriptorSetLayout descriptorSetLayoutImage;
 	extern VkDescriptorSetLayout descriptorSetLayoutUbo;
+	extern VkDescriptorSetLayout descriptorSetLayoutBindless;
 	extern VkMemoryPropertyFlags memoryPropertyFlags;
 	extern uint32_t descriptorBindingFlags;
+	/** @brief Upper bound for the size of the runtime texture array used in bindless mode (clamped against device limits) */
+	extern uint32_t maxBindlessTextures;
+	/**
+	* Texture limit of update-after-bind descriptor sets (the smallest of the maxPerStageDescriptorUpdateAfterBind and maxDescriptorSetUpdateAfterBind
+	* sampler and sampled image limits), usually much higher than the limits of regular sets
+	* If not zero, the bindless texture array is created with update-after-bind and this limit, which requires descriptorBindingSampledImageUpdateAfterBind
+	*/
+	extern uint32_t bindlessUpdateAfterBindTextures;
 
 	struct Node;
 
@@ -65,7 +79,11 @@ namespace vkglTF
 		VkSampler sampler;
 		void updateDescriptor();
 		void destroy();
-		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vks::VulkanDevice* device, VkQueue copyQueue);
+		/**
+		* Creates the texture from a glTF image, images decoded from PNG or JPEG get a generated mip chain
+		* If a mip generator is passed, the mip chain is only queued and the texture is valid after the generator's generate call
+		*/
+		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vks::VulkanDevice* device, VkQueue copyQueue, vks::MipmapGenerator* mipmapGenerator = nullptr, vks::MipmapGenerator::Filter mipmapFilter = vks::MipmapGenerator::FilterLinear);
 	};
 
 	/*
@@ -89,11 +107,31 @@ namespace vkglTF
 		vkglTF::Texture* diffuseTexture;
 
 		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		/** @brief Index of this material in the model's material storage buffer (bindless mode) */
+		uint32_t index = 0;
 
 		Material(vks::VulkanDevice* device) : device(device) {};
 		void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
 	};
 
+	/*
+		glTF material as stored in the material storage buffer for bindless rendering (std430 layout)
+		Texture indices refer to the model's global texture array, -1 means not set
+	*/
+	struct ShaderMaterial {
+		glm::vec4 baseColorFactor;
+		int32_t baseColorTextureIndex;
+		int32_t metallicRoughnessTextureIndex;
+		int32_t normalTextureIndex;
+		int32_t occlusionTextureIndex;
+		int32_t emissiveTextureIndex;
+		float metallicFactor;
+		float roughnessFactor;
+		float alphaCutoff;
+		uint32_t alphaMode;
+		uint32_t padding[3];
+	};
+
 	/*
 		glTF primitive
 	*/
@@ -103,6 +141,20 @@ namespace vkglTF
 		uint32_t firstVertex;
 		uint32_t vertexCount;
 		Material& material;
+		/** @brief True if this primitive's indices are drawn as part of a static batch */
+		bool batched = false;
+		/** @brief Added to the indices when drawing, non-zero if the indices have been rebased to fit into 16 bits */
+		int32_t vertexOffset = 0;
+		/** @brief Range of this primitive's meshlets in Model::meshletData (FileLoadingFlags::GenerateMeshlets) */
+		uint32_t firstMeshlet = 0;
+		uint32_t meshletCount = 0;
+		/** @brief Index range and model space error of each level of detail, level 0 is the full detail range (FileLoadingFlags::GenerateLods) */
+		struct Lod {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			float error;
+		};
+		std::vector<Lod> lods;
 
 		struct Dimensions {
 			glm::vec3 min = glm::vec3(FLT_MAX);
@@ -124,6 +176,8 @@ namespace vkglTF
 
 		std::vector<Primitive*> primitives;
 		std::string name;
+		/** @brief Index of the glTF mesh, nodes instancing the same mesh share its bottom level acceleration structure */
+		int32_t index = -1;
 
 		struct UniformBuffer {
 			VkBuffer buffer;
@@ -207,8 +261,27 @@ namespace vkglTF
 
 	/*
 		glTF default vertex layout with easy Vulkan mapping functions
+
+		Compact vertex layout:
+		If loaded with FileLoadingFlags::CompactVertices, the vertex buffer only stores the components listed in Model::compactVertexComponents
+		(in that order) using quantized formats. The same list has to be passed to getPipelineVertexInputState with VertexLayout::Compact
+			Position: R16G16B16A16_UNORM within the model's bounds (w = 1.0), multiply with Model::positionDequantization before any other transform
+			Normal: R16G16_SNORM octahedral encoding
+			UV: R16G16_SFLOAT
+			Color: R8G8B8A8_UNORM
+			Tangent: R8G8B8A8_SNORM, octahedral encoding in xy, handedness in w
+			Joint0: R8G8B8A8_UINT (uvec4 in the shader)
+			Weight0: R8G8B8A8_UNORM
+		Octahedral vectors are decoded in the shader with:
+			vec3 decodeOctahedral(vec2 e) {
+				vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+				float t = max(-v.z, 0.0);
+				v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+				return normalize(v);
+			}
 	*/
 	enum class VertexComponent { Position, Normal, UV, Color, Tangent, Joint0, Weight0 };
+	enum class VertexLayout { Default, Compact };
 
 	struct Vertex {
 		glm::vec3 pos;
@@ -221,11 +294,17 @@ namespace vkglTF
 		static VkVertexInputBindingDescription vertexInputBindingDescription;
 		static std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
 		static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
-		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding);
+		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding, uint32_t stride = sizeof(Vertex));
 		static VkVertexInputAttributeDescription inputAttributeDescription(uint32_t binding, uint32_t location, VertexComponent component);
-		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components);
+		static VkVertexInputAttributeDescription compactInputAttributeDescription(uint32_t binding, uint32_t location, uint32_t offset, VertexComponent component);
+		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components, VertexLayout layout = VertexLayout::Default);
 		/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
-		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
+		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components, VertexLayout layout = VertexLayout::Default);
+		/** @brief Size of a single component in the compact vertex layout */
+		static uint32_t compactComponentSize(VertexComponent component);
+		static uint32_t compactStride(const std::vector<VertexComponent>& components);
+		/** @brief Writes the requested components of this vertex in the compact layout, positions are normalized using posMin and posScale */
+		void packCompact(const std::vector<VertexComponent>& components, const glm::vec3& posMin, const glm::vec3& posScale, uint8_t* dst) const;
 	};
 
 	enum FileLoadingFlags {
@@ -233,24 +312,105 @@ namespace vkglTF
 		PreTransformVertices = 0x00000001,
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
-		DontLoadImages = 0x00000008
+		DontLoadImages = 0x00000008,
+		BindlessMaterials = 0x00000010,
+		BatchStaticGeometry = 0x00000020,
+		OptimizeMeshes = 0x00000040,
+		CompactVertices = 0x00000080,
+		GenerateMeshlets = 0x00000100,
+		GenerateLods = 0x00000200,
+		CompressTextures = 0x00000400,
+		CompressTexturesFast = 0x00000800
+	};
+
+	/*
+		Meshlet as stored in the meshlet storage buffer (std430)
+		Each meshlet is a contiguous range of its primitive's indices, so it can be drawn with an indexed (indirect) draw,
+		or by a mesh shader using the meshlet vertex and triangle lists
+	*/
+	struct Meshlet {
+		// xyz = center, w = radius
+		glm::vec4 boundingSphere;
+		// xyz = apex, w = unused
+		glm::vec4 coneApex;
+		// xyz = axis, w = cutoff, back facing if dot(normalize(coneApex - viewPos), axis) >= cutoff
+		glm::vec4 cone;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t materialIndex;
+		// Offsets into the meshlet vertex list (vertex buffer indices) and the meshlet triangle list (three 8 bit local indices per uint)
+		uint32_t meshletVertexOffset;
+		uint32_t meshletVertexCount;
+		uint32_t meshletTriangleOffset;
+		uint32_t meshletTriangleCount;
 	};
 
 	enum RenderFlags {
 		BindImages = 0x00000001,
 		RenderOpaqueNodes = 0x00000002,
 		RenderAlphaMaskedNodes = 0x00000004,
-		RenderAlphaBlendedNodes = 0x00000008
+		RenderAlphaBlendedNodes = 0x00000008,
+		Bindless = 0x00000010
 	};
 
 	/*
 		glTF model loading and rendering class
+
+		Bindless materials:
+		If loaded with FileLoadingFlags::BindlessMaterials, all images of the model are put into a single runtime sized texture array
+		and all materials are stored in a storage buffer. Both are stored in a single descriptor set using descriptorSetLayoutBindless:
+			layout (set = n, binding = 0) readonly buffer Materials { ShaderMaterial materials[]; };
+			layout (set = n, binding = 1) uniform sampler2D textures[];
+		Drawing with RenderFlags::Bindless binds this set once and passes the material index of each primitive as the first instance,
+		so shaders fetch the material via gl_InstanceIndex (passed as a flat varying to the fragment shader) instead of rebinding image sets per draw
+		Requires the runtimeDescriptorArray and descriptorBindingVariableDescriptorCount features of VK_EXT_descriptor_indexing
+		Models with more textures than the texture array can hold (see maxBindlessTextures and bindlessUpdateAfterBindTextures) can't be loaded in this mode
+
+		Mesh optimization:
+		If loaded with FileLoadingFlags::OptimizeMeshes, the triangles of each primitive are reordered for the post-transform vertex cache
+		and for reduced overdraw, and the vertices are reordered by first use so vertex fetches are mostly linear
+		If all draw ranges fit, the index buffer is stored with 16 bit indices, so external users of the index buffer need to use indices.type
+
+		Meshlets:
+		If loaded with FileLoadingFlags::GenerateMeshlets, all primitives are split into meshlets of at most 64 vertices and 124 triangles
+		with a bounding sphere and normal cone for culling. The meshlets are uploaded to storage buffers (see meshlets) for GPU culling and mesh shaders
+		Requires pre-transformed vertices, as the bounds are calculated in model space
+
+		Levels of detail:
+		If loaded with FileLoadingFlags::GenerateLods, each primitive not part of a static batch gets a chain of simplified index ranges (see Primitive::lods)
+		appended to the index buffer. The simplified levels reuse the primitive's vertices, so a level is selected by just changing the index range
+		The error of each level is an upper bound for the geometric deviation in model space and can be projected to select levels by screen space error
+
+		Texture compression:
+		If loaded with FileLoadingFlags::CompressTextures (BC7) or FileLoadingFlags::CompressTexturesFast (BC1, or BC3 for images with alpha),
+		PNG and JPEG images are block compressed including a CPU generated mip chain on first load and stored as KTX2 files in the "textures" sub directory of vks::tools::cacheDirectory
+		The cache is keyed by a hash of the source image file, so later loads read the compressed image without decoding the source
+		Requires the textureCompressionBC feature, images are uploaded uncompressed if it's not enabled
+
+		Ray tracing:
+		createAccelerationStructures builds one bottom level acceleration structure per glTF mesh with one geometry per primitive,
+		straight from the model's vertex and index buffers, and a top level acceleration structure with one instance per node
+		Nodes instancing the same mesh share its bottom level structure, with pre-transformed vertices every node gets its own
+		Geometries are flagged opaque unless their material is alpha masked or blended, instance custom indices are the glTF node indices
+		Requires VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT and VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR in memoryPropertyFlags
 	*/
 	class Model {
 	private:
 		vkglTF::Texture* getTexture(uint32_t index);
+		int32_t getTextureIndex(vkglTF::Texture* texture);
 		vkglTF::Texture emptyTexture;
 		void createEmptyTexture(VkQueue transferQueue);
+		void prepareBindlessMaterials(VkQueue transferQueue);
+		void batchStaticPrimitives(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer);
+		void optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer);
+		bool convertIndicesTo16Bit(const std::vector<uint32_t>& indexBuffer, std::vector<uint16_t>& indexBuffer16);
+		void packCompactVertices(const std::vector<Vertex>& vertexBuffer, std::vector<uint8_t>& compactVertexBuffer);
+		void generateMeshlets(const std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles);
+		void uploadMeshlets(const std::vector<uint32_t>& meshletVertices, const std::vector<uint32_t>& meshletTriangles, VkQueue transferQueue);
+		void generateLods(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer);
+		void compressImages(tinygltf::Model& gltfModel, const std::map<int, uint64_t>& sourceHashes, const std::string& cachePath);
+		void drawPrimitive(Primitive* primitive, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet);
 	public:
 		vks::VulkanDevice* device;
 		VkDescriptorPool descriptorPool;
@@ -259,15 +419,54 @@ namespace vkglTF
 			int count;
 			VkBuffer buffer;
 			VkDeviceMemory memory;
+			uint32_t stride = sizeof(Vertex);
 		} vertices;
 		struct Indices {
 			int count;
 			VkBuffer buffer;
 			VkDeviceMemory memory;
+			VkIndexType type = VK_INDEX_TYPE_UINT32;
 		} indices;
 
+		struct BindlessResources {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDescriptorBufferInfo descriptor;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			uint32_t textureCount = 0;
+		} bindless;
+
+		/** @brief Meshlet storage buffers (FileLoadingFlags::GenerateMeshlets) */
+		struct Meshlets {
+			uint32_t count = 0;
+			// Meshlet descriptions
+			vks::Buffer buffer;
+			// Vertex buffer indices referenced by the meshlets
+			vks::Buffer vertexBuffer;
+			// Packed local triangle indices
+			vks::Buffer triangleBuffer;
+		} meshlets;
+		std::vector<Meshlet> meshletData;
+
 		std::vector<Node*> nodes;
 		std::vector<Node*> linearNodes;
+		/** @brief Components stored in the vertex buffer if loaded with FileLoadingFlags::CompactVertices */
+		std::vector<VertexComponent> compactVertexComponents = { VertexComponent::Position, VertexComponent::Normal, VertexComponent::UV };
+		/** @brief Maps the normalized compact vertex positions back to model space (identity for the default layout) */
+		glm::mat4 positionDequantization = glm::mat4(1.0f);
+		/** @brief Maximum number of levels of detail per primitive including the full detail level (FileLoadingFlags::GenerateLods) */
+		uint32_t lodLevels = 6;
+		/** @brief Target triangle count of each level relative to the previous level */
+		float lodReductionFactor = 0.5f;
+		/** @brief Maximum error of a single simplification step relative to the primitive's extent */
+		float lodMaxError = 0.1f;
+		/** @brief Merged per-material index ranges of all static primitives (FileLoadingFlags::BatchStaticGeometry) */
+		std::vector<Primitive*> batches;
+		/** @brief Ray tracing acceleration structures (createAccelerationStructures) */
+		struct AccelerationStructures {
+			std::vector<vks::AccelerationStructure> bottomLevel;
+			vks::AccelerationStructure topLevel;
+		} accelerationStructures;
 
 		std::vector<Skin*> skins;
 
@@ -285,6 +484,8 @@ namespace vkglTF
 
 		bool metallicRoughnessWorkflow = true;
 		bool buffersBound = false;
+		/** @brief FileLoadingFlags the model has been loaded with */
+		uint32_t fileLoadingFlags = FileLoadingFlags::None;
 		std::string path;
 
 		Model() {};
@@ -304,5 +505,8 @@ namespace vkglTF
 		Node* findNode(Node* parent, uint32_t index);
 		Node* nodeFromIndex(uint32_t index);
 		void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
+		/** @brief Creates the bottom level acceleration structures of all meshes and the top level acceleration structure of the scene, skinned meshes are built in their bind pose */
+		void createAccelerationStructures(vks::AccelerationStructureBuilder* builder);
+		void destroyAccelerationStructures();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+* Sort key based render queue for vkglTF models
+*
+* Flattens the visible primitives of a model into a list of 64 bit sort keys, sorts them with a radix sort
+* and records the draws with redundant pipeline and descriptor set binds removed
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanglTFRenderQueue.h"
+#include "frustum.hpp"
+
+void vkglTF::RenderQueue::setPipeline(Pass pass, VkPipeline pipeline)
+{
+	passPipelines[pass] = pipeline;
+	// Pipelines are identified by their index in the list of unique pipelines, so passes sharing a pipeline also share the key bits
+	pipelines.clear();
+	for (uint32_t i = 0; i < PassCount; i++) {
+		if ((passPipelines[i] != VK_NULL_HANDLE) && (std::find(pipelines.begin(), pipelines.end(), passPipelines[i]) == pipelines.end())) {
+			pipelines.push_back(passPipelines[i]);
+		}
+	}
+	assert(pipelines.size() <= 64);
+}
+
+/*
+	Positive floats keep their ordering when their bit pattern is interpreted as an unsigned integer,
+	so the upper 24 bits of the view depth can be used directly as a key without knowing the depth range
+*/
+uint64_t vkglTF::RenderQueue::depthKey(float depth)
+{
+	depth = std::max(depth, 0.0f);
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(float));
+	return static_cast<uint64_t>(bits >> 8);
+}
+
+void vkglTF::RenderQueue::addPrimitive(vkglTF::Primitive* primitive, const glm::vec3& center, float radius, vks::Frustum& frustum, const glm::mat4& view, bool frustumCulling)
+{
+	Pass pass = PassOpaque;
+	switch (primitive->material.alphaMode) {
+	case Material::ALPHAMODE_MASK:
+		pass = PassAlphaMask;
+		break;
+	case Material::ALPHAMODE_BLEND:
+		pass = PassAlphaBlend;
+		break;
+	default:
+		break;
+	}
+	if (passPipelines[pass] == VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (frustumCulling && !frustum.checkSphere(center, radius)) {
+		stats.culled++;
+		return;
+	}
+
+	const float depth = glm::length(glm::vec3(view * glm::vec4(center, 1.0f)));
+	const uint64_t pipelineIndex = static_cast<uint64_t>(std::find(pipelines.begin(), pipelines.end(), passPipelines[pass]) - pipelines.begin());
+	const uint64_t materialIndex = static_cast<uint64_t>(primitive->material.index & 0xFFFF);
+
+	uint64_t key = (static_cast<uint64_t>(pass) << 62) | (pipelineIndex << 56);
+	if (pass == PassAlphaBlend) {
+		// Back to front, material only breaks ties
+		key |= ((~depthKey(depth) & 0xFFFFFF) << 32) | (materialIndex << 16);
+	} else {
+		// Group by material first, then front to back within each material
+		key |= (materialIndex << 40) | (depthKey(depth) << 16);
+	}
+	items.push_back({ key, primitive });
+}
+
+void vkglTF::RenderQueue::build(vkglTF::Model& model, const glm::mat4& projection, const glm::mat4& view, bool frustumCulling)
+{
+	this->model = &model;
+	items.clear();
+	stats = {};
+
+	vks::Frustum frustum;
+	frustum.update(projection * view);
+
+	const bool flipY = model.fileLoadingFlags & FileLoadingFlags::FlipY;
+
+	// Static batches store pre-transformed bounds
+	for (Primitive* batch : model.batches) {
+		addPrimitive(batch, batch->dimensions.center, batch->dimensions.radius, frustum, view, frustumCulling);
+	}
+
+	for (auto node : model.linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		const glm::mat4 matrix = node->getMatrix();
+		const float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+		for (Primitive* primitive : node->mesh->primitives) {
+			if (primitive->batched) {
+				continue;
+			}
+			glm::vec3 center = glm::vec3(matrix * glm::vec4(primitive->dimensions.center, 1.0f));
+			if (flipY) {
+				center.y *= -1.0f;
+			}
+			addPrimitive(primitive, center, primitive->dimensions.radius * scale, frustum, view, frustumCulling);
+		}
+	}
+
+	radixSort();
+}
+
+/*
+	LSD radix sort over the 64 bit keys using 8 bit digits
+	Digits that are the same for all items (e.g. unused key bits) are skipped
+*/
+void vkglTF::RenderQueue::radixSort()
+{
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+	sortBuffer.resize(count);
+	Item* src = items.data();
+	Item* dst = sortBuffer.data();
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++) {
+			histogram[(src[i].key >> shift) & 0xFF]++;
+		}
+		if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+			continue;
+		}
+		size_t offset = 0;
+		for (uint32_t i = 0; i < 256; i++) {
+			size_t bucketSize = histogram[i];
+			histogram[i] = offset;
+			offset += bucketSize;
+		}
+		for (size_t i = 0; i < count; i++) {
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+	if (src != items.data()) {
+		memcpy(items.data(), src, count * sizeof(Item));
+	}
+}
+
+void vkglTF::RenderQueue::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+{
+	assert(model);
+	const VkDeviceSize offsets[1] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &model->vertices.buffer, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, model->indices.buffer, 0, model->indices.type);
+
+	const bool bindless = renderFlags & RenderFlags::Bindless;
+	const bool bindImages = renderFlags & RenderFlags::BindImages;
+	if (bindless) {
+		assert(model->bindless.descriptorSet != VK_NULL_HANDLE);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &model->bindless.descriptorSet, 0, nullptr);
+		stats.descriptorSetBinds = 1;
+	} else {
+		stats.descriptorSetBinds = 0;
+	}
+	stats.draws = 0;
+	stats.pipelineBinds = 0;
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkDescriptorSet boundSet = VK_NULL_HANDLE;
+	uint32_t passMask = 0;
+	for (const Item& item : items) {
+		VkPipeline pipeline = pipelines[(item.key >> 56) & 0x3F];
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			stats.pipelineBinds++;
+		}
+		passMask |= 1u << (item.key >> 62);
+		const Material& material = item.primitive->material;
+		if (bindless) {
+			vkCmdDrawIndexed(commandBuffer, item.primitive->indexCount, 1, item.primitive->firstIndex, item.primitive->vertexOffset, material.index);
+		} else {
+			if (bindImages && (material.descriptorSet != boundSet)) {
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
+				boundSet = material.descriptorSet;
+				stats.descriptorSetBinds++;
+			}
+			vkCmdDrawIndexed(commandBuffer, item.primitive->indexCount, 1, item.primitive->firstIndex, item.primitive->vertexOffset, 0);
+		}
+		stats.draws++;
+	}
+
+	// Compare against Model::draw, which is called once per pass and binds the material's image set for every primitive
+	uint32_t traversalPipelineBinds = 0;
+	for (uint32_t i = 0; i < PassCount; i++) {
+		if (passMask & (1u << i)) {
+			traversalPipelineBinds++;
+		}
+	}
+	stats.pipelineBindsSaved = traversalPipelineBinds - std::min(traversalPipelineBinds, stats.pipelineBinds);
+	stats.descriptorSetBindsSaved = (bindless || bindImages) ? stats.draws - std::min(stats.draws, stats.descriptorSetBinds) : 0;
+}
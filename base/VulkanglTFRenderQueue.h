@@ -0,0 +1,77 @@
+/*
+* Sort key based render queue for vkglTF models
+*
+* Flattens the visible primitives of a model into a list of 64 bit sort keys, sorts them with a radix sort
+* and records the draws with redundant pipeline and descriptor set binds removed
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanglTFModel.h"
+
+namespace vks
+{
+	class Frustum;
+}
+
+namespace vkglTF
+{
+	/*
+		Render queue for a single glTF model
+
+		Sort key layout (most significant bits first):
+			[63..62] Pass (opaque, alpha masked, alpha blended)
+			[61..56] Pipeline index
+			Opaque and masked passes:
+				[55..40] Material index
+				[39..16] View depth (front to back for early depth rejection)
+			Blended pass:
+				[55..32] Inverted view depth (back to front for correct blending)
+				[31..16] Material index
+			[15..0] Unused
+	*/
+	class RenderQueue {
+	public:
+		enum Pass { PassOpaque = 0, PassAlphaMask = 1, PassAlphaBlend = 2, PassCount = 3 };
+
+		struct Item {
+			uint64_t key;
+			vkglTF::Primitive* primitive;
+		};
+
+		struct Stats {
+			uint32_t draws = 0;
+			uint32_t culled = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t descriptorSetBinds = 0;
+			// Binds a scene graph traversal (one per pass, one image set per draw) would have issued
+			uint32_t pipelineBindsSaved = 0;
+			uint32_t descriptorSetBindsSaved = 0;
+		};
+
+		/** @brief Items of the last build call, sorted by their key */
+		std::vector<Item> items;
+		Stats stats;
+
+		/** @brief Sets the pipeline used for all primitives of the given pass (VK_NULL_HANDLE skips the pass) */
+		void setPipeline(Pass pass, VkPipeline pipeline);
+		/** @brief Flattens and sorts all primitives of the model visible in the given view */
+		void build(vkglTF::Model& model, const glm::mat4& projection, const glm::mat4& view, bool frustumCulling = true);
+		/** @brief Records the sorted draws, binding pipelines and material sets only if they change */
+		void draw(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1);
+
+	private:
+		vkglTF::Model* model = nullptr;
+		VkPipeline passPipelines[PassCount] = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+		std::vector<VkPipeline> pipelines;
+		std::vector<Item> sortBuffer;
+		uint64_t depthKey(float depth);
+		void addPrimitive(vkglTF::Primitive* primitive, const glm::vec3& center, float radius, vks::Frustum& frustum, const glm::mat4& view, bool frustumCulling);
+		void radixSort();
+	};
+}
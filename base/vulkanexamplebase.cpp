@@ -70,6 +70,15 @@ VkResult VulkanExampleBase::createInstance(bool enableValidation)
 		}
 	}
 
+	// Checking for host image copy support (see VulkanDevice::requestHostImageCopy) needs extended device feature queries, which Vulkan 1.0 instances only have with this extension
+	if ((apiVersion < VK_API_VERSION_1_1) && (std::find(supportedInstanceExtensions.begin(), supportedInstanceExtensions.end(), VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) != supportedInstanceExtensions.end()))
+	{
+		if (std::find_if(enabledInstanceExtensions.begin(), enabledInstanceExtensions.end(), [](const char* extension) { return strcmp(extension, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0; }) == enabledInstanceExtensions.end())
+		{
+			enabledInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		}
+	}
+
 	// Enabled requested instance extensions
 	if (enabledInstanceExtensions.size() > 0) 
 	{
@@ -791,6 +800,9 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 	if (commandLineParser.isSet("benchmarkframes")) {
 		benchmark.outputFrames = commandLineParser.getValueAsInt("benchmarkframes", benchmark.outputFrames);
 	}
+	if (commandLineParser.isSet("cachedir")) {
+		vks::tools::cacheDirectory = commandLineParser.getValueAsString("cachedir", vks::tools::cacheDirectory);
+	}
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	// Vulkan library is loaded dynamically on Android
@@ -990,6 +1002,9 @@ bool VulkanExampleBase::initVulkan()
 	// This is handled by a separate class that gets a logical device representation
 	// and encapsulates functions related to a device
 	vulkanDevice = new vks::VulkanDevice(physicalDevice);
+	vulkanDevice->shadersPath = getShadersPath();
+	// Textures are written from the host without staging buffers if the device supports it
+	vulkanDevice->requestHostImageCopy(instance);
 	VkResult res = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, deviceCreatepNextChain);
 	if (res != VK_SUCCESS) {
 		vks::tools::exitFatal("Could not create Vulkan device: \n" + vks::tools::errorString(res), res);
@@ -2788,6 +2803,9 @@ CommandLineParser::CommandLineParser()
 	add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for benchmark results");
 	add("benchmarkresultframes", { "-bt", "--benchframetimes" }, 0, "Save frame times to benchmark results file");
 	add("benchmarkframes", { "-bfs", "--benchmarkframes" }, 1, "Only render the given number of frames");
+	add("gbuffer", { "-gb", "--gbuffer" }, 1, "Select G-Buffer layout of the deferred shading examples (full or packed)");
+	add("texturecompression", { "-tc", "--texturecompression" }, 0, "Block compress glTF textures at load time in examples that support it");
+	add("cachedir", { "-cd", "--cachedir" }, 1, "Set the directory for files generated at runtime (compressed textures, precomputed lighting)");
 }
 
 void CommandLineParser::add(std::string name, std::vector<std::string> commands, bool hasValue, std::string help)
@@ -0,0 +1,86 @@
+# Compiles shaders that don't have committed SPIR-V binaries
+#
+# The SPIR-V is written next to the shader source in data/shaders, where the examples load it from, so the binaries only
+# need to be built once (and are picked up by the resource install). GLSL shaders are compiled with glslangValidator and
+# HLSL shaders with DXC using the same options as data/shaders/glsl/compileshaders.py and data/shaders/hlsl/compile.py
+# If a compiler can't be found, the affected shaders are listed and skipped, examples check for optional shaders at runtime
+
+find_program(GLSLANG_VALIDATOR NAMES glslangValidator glslangvalidator HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+find_program(DXC_EXECUTABLE NAMES dxc HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+
+# Adds build rules for the given shaders (relative to data/shaders/glsl and data/shaders/hlsl) to the target
+function(compileShaders TARGET_NAME)
+	set(SHADER_ROOT ${CMAKE_SOURCE_DIR}/data/shaders)
+	set(SPIRV_FILES "")
+	set(SKIPPED_GLSL "")
+	set(SKIPPED_HLSL "")
+	foreach(SHADER ${ARGN})
+		string(REGEX MATCH "[^.]+$" SHADER_STAGE ${SHADER})
+		# GLSL
+		set(SHADER_SOURCE ${SHADER_ROOT}/glsl/${SHADER})
+		if(EXISTS ${SHADER_SOURCE})
+			if(GLSLANG_VALIDATOR)
+				set(GLSLANG_PARAMS "")
+				if(SHADER_STAGE MATCHES "^(rgen|rchit|rmiss)$")
+					set(GLSLANG_PARAMS --target-env vulkan1.2)
+				endif()
+				add_custom_command(
+					OUTPUT ${SHADER_SOURCE}.spv
+					COMMAND ${GLSLANG_VALIDATOR} -V ${SHADER_SOURCE} -o ${SHADER_SOURCE}.spv ${GLSLANG_PARAMS}
+					DEPENDS ${SHADER_SOURCE}
+					COMMENT "Compiling glsl/${SHADER}")
+				list(APPEND SPIRV_FILES ${SHADER_SOURCE}.spv)
+			else()
+				list(APPEND SKIPPED_GLSL ${SHADER})
+			endif()
+		endif()
+		# HLSL
+		set(SHADER_SOURCE ${SHADER_ROOT}/hlsl/${SHADER})
+		if(EXISTS ${SHADER_SOURCE})
+			if(DXC_EXECUTABLE)
+				if(SHADER_STAGE STREQUAL "vert")
+					set(DXC_PROFILE vs_6_1)
+				elseif(SHADER_STAGE STREQUAL "frag")
+					set(DXC_PROFILE ps_6_1)
+				elseif(SHADER_STAGE STREQUAL "comp")
+					set(DXC_PROFILE cs_6_1)
+				elseif(SHADER_STAGE STREQUAL "geom")
+					set(DXC_PROFILE gs_6_1)
+				elseif(SHADER_STAGE STREQUAL "tesc")
+					set(DXC_PROFILE hs_6_1)
+				elseif(SHADER_STAGE STREQUAL "tese")
+					set(DXC_PROFILE ds_6_1)
+				elseif(SHADER_STAGE STREQUAL "mesh")
+					set(DXC_PROFILE ms_6_5)
+				elseif(SHADER_STAGE STREQUAL "task")
+					set(DXC_PROFILE as_6_5)
+				else()
+					set(DXC_PROFILE lib_6_3)
+				endif()
+				add_custom_command(
+					OUTPUT ${SHADER_SOURCE}.spv
+					COMMAND ${DXC_EXECUTABLE} -spirv -T ${DXC_PROFILE} -E main
+						-fspv-extension=SPV_NV_ray_tracing
+						-fspv-extension=SPV_KHR_multiview
+						-fspv-extension=SPV_KHR_shader_draw_parameters
+						-fspv-extension=SPV_EXT_descriptor_indexing
+						-fspv-extension=SPV_NV_mesh_shader
+						${SHADER_SOURCE} -Fo ${SHADER_SOURCE}.spv
+					DEPENDS ${SHADER_SOURCE}
+					COMMENT "Compiling hlsl/${SHADER}")
+				list(APPEND SPIRV_FILES ${SHADER_SOURCE}.spv)
+			else()
+				list(APPEND SKIPPED_HLSL ${SHADER})
+			endif()
+		endif()
+	endforeach()
+	if(SKIPPED_GLSL)
+		string(REPLACE ";" ", " SKIPPED_GLSL "${SKIPPED_GLSL}")
+		message(WARNING "glslangValidator not found, these GLSL shaders won't be available: ${SKIPPED_GLSL}")
+	endif()
+	if(SKIPPED_HLSL)
+		string(REPLACE ";" ", " SKIPPED_HLSL "${SKIPPED_HLSL}")
+		message(STATUS "DXC not found, these HLSL shaders won't be available: ${SKIPPED_HLSL}")
+	endif()
+	add_custom_target(${TARGET_NAME} ALL DEPENDS ${SPIRV_FILES})
+endfunction()
@@ -0,0 +1,168 @@
+#version 450
+
+// Depth with the packed G-Buffer layout
+layout (binding = 1) uniform sampler2D samplerposition;
+layout (binding = 2) uniform sampler2D samplerNormal;
+layout (binding = 3) uniform sampler2D samplerAlbedo;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragcolor;
+
+struct Light {
+	vec4 position;
+	vec3 color;
+	float radius;
+};
+
+layout (binding = 4) uniform UBO
+{
+	Light lights[6];
+	vec4 viewPos;
+	int displayDebugTarget;
+	mat4 invViewProjection;
+} ubo;
+
+// Positions are reconstructed from depth and normals are octahedron encoded with the packed G-Buffer layout
+layout (constant_id = 0) const bool PACKED_GBUFFER = false;
+
+// Lights assigned to clusters by the base light clustering compute pass
+
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+layout (binding = 5) uniform UBOClusters
+{
+	mat4 view;
+	mat4 projInverse;
+	uvec4 gridSize;
+	vec4 depthRange;
+	vec4 viewport;
+} clusters;
+
+layout (std430, binding = 6) readonly buffer Lights
+{
+	Light lights[ ];
+};
+
+layout (std430, binding = 7) readonly buffer LightCounts
+{
+	uint lightCounts[ ];
+};
+
+layout (std430, binding = 8) readonly buffer LightIndices
+{
+	uint lightIndices[ ];
+};
+
+vec3 decodeNormal(vec2 f)
+{
+	f = f * 2.0 - 1.0;
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+vec3 worldPosFromDepth(vec2 uv, float depth)
+{
+	vec4 pos = ubo.invViewProjection * vec4(uv * 2.0 - 1.0, depth, 1.0);
+	return pos.xyz / pos.w;
+}
+
+uint getClusterIndex(vec3 worldPos)
+{
+	vec2 uv = gl_FragCoord.xy / clusters.viewport.xy;
+	float depth = -(clusters.view * vec4(worldPos, 1.0)).z;
+	float slice = log(max(depth, clusters.depthRange.x) / clusters.depthRange.x) / clusters.depthRange.z * float(clusters.gridSize.z);
+	uvec3 cluster = min(uvec3(uv * vec2(clusters.gridSize.xy), slice), clusters.gridSize.xyz - 1);
+	return cluster.x + clusters.gridSize.x * (cluster.y + clusters.gridSize.y * cluster.z);
+}
+
+void main()
+{
+	// Get G-Buffer values
+	vec3 fragPos;
+	vec3 normal;
+	if (PACKED_GBUFFER) {
+		float depth = texture(samplerposition, inUV).r;
+		fragPos = depth < 1.0 ? worldPosFromDepth(inUV, depth) : vec3(0.0);
+		normal = depth < 1.0 ? decodeNormal(texture(samplerNormal, inUV).rg) : vec3(0.0);
+	} else {
+		fragPos = texture(samplerposition, inUV).rgb;
+		normal = texture(samplerNormal, inUV).rgb;
+	}
+	vec4 albedo = texture(samplerAlbedo, inUV);
+
+	// Debug display
+	if (ubo.displayDebugTarget > 0) {
+		switch (ubo.displayDebugTarget) {
+			case 1:
+				outFragcolor.rgb = fragPos;
+				break;
+			case 2:
+				outFragcolor.rgb = normal;
+				break;
+			case 3:
+				outFragcolor.rgb = albedo.rgb;
+				break;
+			case 4:
+				outFragcolor.rgb = albedo.aaa;
+				break;
+			case 5:
+				// Number of lights in the cluster of this fragment
+				outFragcolor.rgb = mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), clamp(float(lightCounts[getClusterIndex(fragPos)]) / 32.0, 0.0, 1.0));
+				break;
+		}
+		outFragcolor.a = 1.0;
+		return;
+	}
+
+	// Render-target composition
+
+	#define ambient 0.0
+
+	// Ambient part
+	vec3 fragcolor  = albedo.rgb * ambient;
+
+	vec3 N = normalize(normal);
+
+	// Viewer to fragment
+	vec3 V = ubo.viewPos.xyz - fragPos;
+	V = normalize(V);
+
+	// Only the lights of the cluster this fragment is in
+	uint clusterIndex = getClusterIndex(fragPos);
+	uint lightCount = lightCounts[clusterIndex];
+
+	for(uint i = 0; i < lightCount; ++i)
+	{
+		Light light = lights[lightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+
+		// Vector to light
+		vec3 L = light.position.xyz - fragPos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Light to fragment
+		L = normalize(L);
+
+		// Attenuation, windowed to reach zero at the light's radius so lights only affect the clusters they were assigned to
+		float window = clamp(1.0 - pow(dist / light.radius, 4.0), 0.0, 1.0);
+		float atten = light.radius / (pow(dist, 2.0) + 1.0) * window * window;
+
+		// Diffuse part
+		float NdotL = max(0.0, dot(N, L));
+		vec3 diff = light.color * albedo.rgb * NdotL * atten;
+
+		// Specular part
+		// Specular map values are stored in alpha of albedo mrt
+		vec3 R = reflect(-L, N);
+		float NdotR = max(0.0, dot(R, V));
+		vec3 spec = light.color * albedo.a * pow(NdotR, 16.0) * atten;
+
+		fragcolor += diff + spec;
+	}
+
+  outFragcolor = vec4(fragcolor, 1.0);
+}
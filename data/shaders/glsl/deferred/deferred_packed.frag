@@ -0,0 +1,119 @@
+#version 450
+
+// Packed G-Buffer layout: Positions are reconstructed from depth, normals are octahedron encoded
+
+layout (binding = 1) uniform sampler2D samplerDepth;
+layout (binding = 2) uniform sampler2D samplerNormal;
+layout (binding = 3) uniform sampler2D samplerAlbedo;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragcolor;
+
+struct Light {
+	vec4 position;
+	vec3 color;
+	float radius;
+};
+
+layout (binding = 4) uniform UBO 
+{
+	Light lights[6];
+	vec4 viewPos;
+	int displayDebugTarget;
+	mat4 invViewProjection;
+} ubo;
+
+vec3 decodeNormal(vec2 f)
+{
+	f = f * 2.0 - 1.0;
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+vec3 worldPosFromDepth(vec2 uv, float depth)
+{
+	vec4 pos = ubo.invViewProjection * vec4(uv * 2.0 - 1.0, depth, 1.0);
+	return pos.xyz / pos.w;
+}
+
+void main() 
+{
+	// Get G-Buffer values
+	float depth = texture(samplerDepth, inUV).r;
+	vec3 fragPos = worldPosFromDepth(inUV, depth);
+	vec3 normal = decodeNormal(texture(samplerNormal, inUV).rg);
+	// Match the cleared targets of the full layout for the background
+	if (depth == 1.0) {
+		fragPos = vec3(0.0);
+		normal = vec3(0.0);
+	}
+	vec4 albedo = texture(samplerAlbedo, inUV);
+	
+	// Debug display
+	if (ubo.displayDebugTarget > 0) {
+		switch (ubo.displayDebugTarget) {
+			case 1: 
+				outFragcolor.rgb = fragPos;
+				break;
+			case 2: 
+				outFragcolor.rgb = normal;
+				break;
+			case 3: 
+				outFragcolor.rgb = albedo.rgb;
+				break;
+			case 4: 
+				outFragcolor.rgb = albedo.aaa;
+				break;
+		}		
+		outFragcolor.a = 1.0;
+		return;
+	}
+
+	// Render-target composition
+
+	#define lightCount 6
+	#define ambient 0.0
+	
+	// Ambient part
+	vec3 fragcolor  = albedo.rgb * ambient;
+	
+	for(int i = 0; i < lightCount; ++i)
+	{
+		// Vector to light
+		vec3 L = ubo.lights[i].position.xyz - fragPos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Viewer to fragment
+		vec3 V = ubo.viewPos.xyz - fragPos;
+		V = normalize(V);
+		
+		//if(dist < ubo.lights[i].radius)
+		{
+			// Light to fragment
+			L = normalize(L);
+
+			// Attenuation
+			float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
+
+			// Diffuse part
+			vec3 N = normalize(normal);
+			float NdotL = max(0.0, dot(N, L));
+			vec3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
+
+			// Specular part
+			// Specular map values are stored in alpha of albedo mrt
+			vec3 R = reflect(-L, N);
+			float NdotR = max(0.0, dot(R, V));
+			vec3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 16.0) * atten;
+
+			fragcolor += diff + spec;	
+		}	
+	}    	
+   
+  outFragcolor = vec4(fragcolor, 1.0);	
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#version 450
+
+// Packed G-Buffer layout: Positions are reconstructed from depth, normals are octahedron encoded
+
+layout (binding = 1) uniform sampler2DMS samplerDepth;
+layout (binding = 2) uniform sampler2DMS samplerNormal;
+layout (binding = 3) uniform sampler2DMS samplerAlbedo;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragcolor;
+
+struct Light {
+	vec4 position;
+	vec3 color;
+	float radius;
+};
+
+layout (binding = 4) uniform UBO 
+{
+	Light lights[6];
+	vec4 viewPos;
+	int debugDisplayTarget;
+	mat4 invViewProjection;
+} ubo;
+
+layout (constant_id = 0) const int NUM_SAMPLES = 8;
+
+#define NUM_LIGHTS 6
+
+// Manual resolve for MSAA samples 
+vec4 resolve(sampler2DMS tex, ivec2 uv)
+{
+	vec4 result = vec4(0.0);	   
+	for (int i = 0; i < NUM_SAMPLES; i++)
+	{
+		vec4 val = texelFetch(tex, uv, i); 
+		result += val;
+	}    
+	// Average resolved samples
+	return result / float(NUM_SAMPLES);
+}
+
+vec3 decodeNormal(vec2 f)
+{
+	f = f * 2.0 - 1.0;
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+vec3 worldPosFromDepth(vec2 uv, float depth)
+{
+	vec4 pos = ubo.invViewProjection * vec4(uv * 2.0 - 1.0, depth, 1.0);
+	return pos.xyz / pos.w;
+}
+
+// Fetches position and normal of a single sample, the background matches the cleared targets of the full layout
+void fetchSample(ivec2 UV, vec2 uv, int index, out vec3 pos, out vec3 normal)
+{
+	float depth = texelFetch(samplerDepth, UV, index).r;
+	pos = depth < 1.0 ? worldPosFromDepth(uv, depth) : vec3(0.0);
+	normal = depth < 1.0 ? decodeNormal(texelFetch(samplerNormal, UV, index).rg) : vec3(0.0);
+}
+
+vec3 calculateLighting(vec3 pos, vec3 normal, vec4 albedo)
+{
+	vec3 result = vec3(0.0);
+
+	for(int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		// Vector to light
+		vec3 L = ubo.lights[i].position.xyz - pos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Viewer to fragment
+		vec3 V = ubo.viewPos.xyz - pos;
+		V = normalize(V);
+		
+		// Light to fragment
+		L = normalize(L);
+
+		// Attenuation
+		float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
+
+		// Diffuse part
+		vec3 N = normalize(normal);
+		float NdotL = max(0.0, dot(N, L));
+		vec3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
+
+		// Specular part
+		vec3 R = reflect(-L, N);
+		float NdotR = max(0.0, dot(R, V));
+		vec3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 8.0) * atten;
+
+		result += diff + spec;	
+	}
+	return result;
+}
+
+void main() 
+{
+	ivec2 attDim = textureSize(samplerDepth);
+	ivec2 UV = ivec2(inUV * attDim);
+	// Reconstruct at the texel center, as the position was written there
+	vec2 uv = (vec2(UV) + 0.5) / vec2(attDim);
+	vec3 pos, normal;
+	
+	// Debug display
+	if (ubo.debugDisplayTarget > 0) {
+		switch (ubo.debugDisplayTarget) {
+			case 1: 
+				fetchSample(UV, uv, 0, pos, normal);
+				outFragcolor.rgb = pos;
+				break;
+			case 2: 
+				fetchSample(UV, uv, 0, pos, normal);
+				outFragcolor.rgb = normal;
+				break;
+			case 3: 
+				outFragcolor.rgb = texelFetch(samplerAlbedo, UV, 0).rgb;
+				break;
+			case 4: 
+				outFragcolor.rgb = texelFetch(samplerAlbedo, UV, 0).aaa;
+				break;
+		}		
+		outFragcolor.a = 1.0;
+		return;
+	}
+
+	#define ambient 0.15
+
+	// Ambient part
+	vec4 alb = resolve(samplerAlbedo, UV);
+	vec3 fragColor = vec3(0.0);
+	
+	// Calualte lighting for every MSAA sample
+	for (int i = 0; i < NUM_SAMPLES; i++)
+	{ 
+		fetchSample(UV, uv, i, pos, normal);
+		vec4 albedo = texelFetch(samplerAlbedo, UV, i);
+		fragColor += calculateLighting(pos, normal, albedo);
+	}
+
+	fragColor = (alb.rgb * ambient) + fragColor / float(NUM_SAMPLES);
+   
+	outFragcolor = vec4(fragColor, 1.0);	
+}
\ No newline at end of file
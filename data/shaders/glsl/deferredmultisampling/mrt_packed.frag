@@ -0,0 +1,42 @@
+#version 450
+
+// Packed G-Buffer layout: The position is reconstructed from depth in the composition pass, normals are stored octahedron encoded
+
+layout (binding = 1) uniform sampler2D samplerColor;
+layout (binding = 2) uniform sampler2D samplerNormalMap;
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec3 inColor;
+layout (location = 3) in vec3 inWorldPos;
+layout (location = 4) in vec3 inTangent;
+
+layout (location = 0) out vec4 outNormal;
+layout (location = 1) out vec4 outAlbedo;
+
+vec2 octWrap(vec2 v)
+{
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Maps a unit vector onto the octahedron and unfolds it into [0..1] range
+vec2 encodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+	return n.xy * 0.5 + 0.5;
+}
+
+void main() 
+{
+	// Calculate normal in tangent space
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent);
+	vec3 B = cross(N, T);
+	mat3 TBN = mat3(T, B, N);
+	vec3 tnorm = TBN * normalize(texture(samplerNormalMap, inUV).xyz * 2.0 - vec3(1.0));
+	// Alpha to coverage uses the alpha of the first attachment
+	outNormal = vec4(encodeNormal(normalize(tnorm)), 0.0, 1.0);
+
+	outAlbedo = texture(samplerColor, inUV);
+}
@@ -0,0 +1,102 @@
+#version 450
+
+layout (set = 1, binding = 0) uniform sampler2D samplerColorMap;
+layout (set = 1, binding = 1) uniform sampler2D samplerNormalMap;
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inViewVec;
+layout (location = 4) in vec3 inLightVec;
+layout (location = 5) in vec4 inTangent;
+layout (location = 6) in vec3 inWorldPos;
+
+layout (location = 0) out vec4 outFragColor;
+
+// Point lights assigned to clusters by the base light clustering compute pass
+
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct Light {
+	vec4 position;
+	vec3 color;
+	float radius;
+};
+
+layout (set = 0, binding = 1) uniform UBOClusters
+{
+	mat4 view;
+	mat4 projInverse;
+	uvec4 gridSize;
+	vec4 depthRange;
+	vec4 viewport;
+} clusters;
+
+layout (std430, set = 0, binding = 2) readonly buffer Lights
+{
+	Light lights[ ];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer LightCounts
+{
+	uint lightCounts[ ];
+};
+
+layout (std430, set = 0, binding = 4) readonly buffer LightIndices
+{
+	uint lightIndices[ ];
+};
+
+layout (constant_id = 0) const bool ALPHA_MASK = false;
+layout (constant_id = 1) const float ALPHA_MASK_CUTOFF = 0.0f;
+
+uint getClusterIndex(vec3 worldPos)
+{
+	vec2 uv = gl_FragCoord.xy / clusters.viewport.xy;
+	float depth = -(clusters.view * vec4(worldPos, 1.0)).z;
+	float slice = log(max(depth, clusters.depthRange.x) / clusters.depthRange.x) / clusters.depthRange.z * float(clusters.gridSize.z);
+	uvec3 cluster = min(uvec3(uv * vec2(clusters.gridSize.xy), slice), clusters.gridSize.xyz - 1);
+	return cluster.x + clusters.gridSize.x * (cluster.y + clusters.gridSize.y * cluster.z);
+}
+
+void main() 
+{
+	vec4 color = texture(samplerColorMap, inUV) * vec4(inColor, 1.0);
+
+	if (ALPHA_MASK) {
+		if (color.a < ALPHA_MASK_CUTOFF) {
+			discard;
+		}
+	}
+
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = cross(inNormal, inTangent.xyz) * inTangent.w;
+	mat3 TBN = mat3(T, B, N);
+	N = TBN * normalize(texture(samplerNormalMap, inUV).xyz * 2.0 - vec3(1.0));
+
+	const float ambient = 0.1;
+	vec3 L = normalize(inLightVec);
+	vec3 V = normalize(inViewVec);
+	vec3 R = reflect(-L, N);
+	vec3 diffuse = max(dot(N, L), ambient).rrr;
+	float specular = pow(max(dot(R, V), 0.0), 32.0);
+	vec3 lighting = diffuse * color.rgb + specular;
+
+	// Only the point lights of the cluster this fragment is in
+	uint clusterIndex = getClusterIndex(inWorldPos);
+	uint lightCount = lightCounts[clusterIndex];
+	for (uint i = 0; i < lightCount; i++) {
+		Light light = lights[lightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+		vec3 lightVec = light.position.xyz - inWorldPos;
+		float dist = length(lightVec);
+		L = lightVec / dist;
+		R = reflect(-L, N);
+		// Attenuation, windowed to reach zero at the light's radius so lights only affect the clusters they were assigned to
+		float window = clamp(1.0 - pow(dist / light.radius, 4.0), 0.0, 1.0);
+		float atten = window * window / (dist * dist + 1.0);
+		lighting += light.color * atten * (max(dot(N, L), 0.0) * color.rgb + pow(max(dot(R, V), 0.0), 32.0));
+	}
+
+	outFragColor = vec4(lighting, color.a);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 450
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 view;
+	vec4 frustumPlanes[6];
+	vec4 cullingViewPos;
+	vec4 viewPos;
+	uint meshletCount;
+	uint frustumCulling;
+	uint coneCulling;
+	uint colorMeshlets;
+} ubo;
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec3 inViewVec;
+layout (location = 3) flat in uint inMeshletIndex;
+
+layout (location = 0) out vec4 outFragColor;
+
+vec3 meshletColor(uint index)
+{
+	uint hash = index * 2654435761u;
+	return vec3(float(hash & 255u), float((hash >> 8) & 255u), float((hash >> 16) & 255u)) / 255.0;
+}
+
+void main() 
+{
+	vec3 color = (ubo.colorMeshlets == 1) ? meshletColor(inMeshletIndex) : inColor;
+	vec3 N = normalize(inNormal);
+	vec3 V = normalize(inViewVec);
+	// Double sided lighting, back face culling is disabled
+	if (dot(N, V) < 0.0) {
+		N = -N;
+	}
+	float diffuse = max(dot(N, normalize(vec3(0.25, 1.0, 0.5))), 0.0);
+	outFragColor = vec4(color * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,37 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec4 inColor;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 view;
+	vec4 frustumPlanes[6];
+	vec4 cullingViewPos;
+	vec4 viewPos;
+	uint meshletCount;
+	uint frustumCulling;
+	uint coneCulling;
+	uint colorMeshlets;
+} ubo;
+
+layout (push_constant) uniform PushConsts {
+	uint meshletIndexOffset;
+} pushConsts;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec3 outViewVec;
+layout (location = 3) flat out uint outMeshletIndex;
+
+void main() 
+{
+	outNormal = inNormal;
+	outColor = inColor.rgb;
+	outViewVec = ubo.viewPos.xyz - inPos;
+	// The meshlet index is stored as the first instance, or passed as a push constant if drawIndirectFirstInstance is not supported
+	outMeshletIndex = gl_InstanceIndex + pushConsts.meshletIndexOffset;
+	gl_Position = ubo.projection * ubo.view * vec4(inPos, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 450
+
+// Compact vertex layout, see vkglTF::Vertex
+layout (location = 0) in vec4 inPos;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec2 inNormal;
+layout (location = 3) in vec4 inTangent;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 view;
+	mat4 model;
+	vec4 lightPos;
+	vec4 cameraPos;
+	mat4 positionDequantization;
+} ubo;
+
+layout (location = 0) out vec2 outUV;
+layout (location = 1) out vec3 outTangentLightPos;
+layout (location = 2) out vec3 outTangentViewPos;
+layout (location = 3) out vec3 outTangentFragPos;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0);
+	v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+	return normalize(v);
+}
+
+void main(void) 
+{
+	// Positions are normalized to the model's bounds
+	vec4 pos = ubo.positionDequantization * inPos;
+	gl_Position = ubo.projection * ubo.view * ubo.model * pos;
+	outTangentFragPos = vec3(ubo.model * pos);
+	outUV = inUV;
+
+	vec3 N = normalize(mat3(ubo.model) * decodeOctahedral(inNormal));
+	vec3 T = normalize(mat3(ubo.model) * decodeOctahedral(inTangent.xy));
+	vec3 B = normalize(cross(N, T));
+	mat3 TBN = transpose(mat3(T, B, N));
+
+	outTangentLightPos = TBN * ubo.lightPos.xyz;
+	outTangentViewPos  = TBN * ubo.cameraPos.xyz;
+	outTangentFragPos  = TBN * outTangentFragPos;
+}
@@ -0,0 +1,82 @@
+#version 450
+
+#extension GL_ARB_sparse_texture2 : enable
+#extension GL_ARB_sparse_texture_clamp : enable
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 model;
+	vec4 viewPos;
+	float lodBias;
+	uint frameIndex;
+	ivec2 pageExtent;
+	int mipTailStart;
+} ubo;
+
+layout (binding = 1) uniform sampler2D samplerColor;
+
+// One entry per virtual page outside of the mip tail, set to the current frame index for every page that's sampled
+layout (binding = 2) buffer Feedback
+{
+	uint pageRequests[];
+};
+
+layout (location = 0) in vec2 inUV;
+layout (location = 1) in float inLodBias;
+
+layout (location = 0) out vec4 outFragColor;
+
+void requestPage(int mipLevel)
+{
+	if (mipLevel >= ubo.mipTailStart) {
+		return;
+	}
+	// Pages are stored level by level in row order, same as on the host
+	ivec2 textureExtent = textureSize(samplerColor, 0);
+	uint pageIndex = 0;
+	for (int i = 0; i < mipLevel; i++) {
+		ivec2 pageCount = (max(textureExtent >> i, ivec2(1)) + ubo.pageExtent - 1) / ubo.pageExtent;
+		pageIndex += uint(pageCount.x * pageCount.y);
+	}
+	ivec2 levelExtent = max(textureExtent >> mipLevel, ivec2(1));
+	ivec2 pageCount = (levelExtent + ubo.pageExtent - 1) / ubo.pageExtent;
+	ivec2 page = clamp(ivec2(clamp(inUV, 0.0, 1.0) * vec2(levelExtent)) / ubo.pageExtent, ivec2(0), pageCount - 1);
+	pageIndex += uint(page.y * pageCount.x + page.x);
+	// Skip redundant writes for pages already requested by other fragments
+	if (pageRequests[pageIndex] != ubo.frameIndex) {
+		pageRequests[pageIndex] = ubo.frameIndex;
+	}
+}
+
+void main() 
+{
+	vec4 color = vec4(0.0);
+
+	// Request the pages for the level(s) nearest mip filtering may select
+	float lod = max(textureQueryLod(samplerColor, inUV).y + inLodBias, 0.0);
+	requestPage(int(floor(lod)));
+	requestPage(int(floor(lod)) + 1);
+
+	// Get residency code for current texel
+	int residencyCode = sparseTextureARB(samplerColor, inUV, color, inLodBias);
+
+	// Fall back to coarser levels until a resident texel is found, the mip tail is always resident
+	float minLod = floor(lod) + 1.0;
+	float maxLod = float(textureQueryLevels(samplerColor) - 1);
+	while (!sparseTexelsResidentARB(residencyCode) && (minLod <= maxLod))
+	{
+		residencyCode = sparseTextureClampARB(samplerColor, inUV, minLod, color, inLodBias);
+		minLod += 1.0;
+	}
+
+	// Check if texel is resident
+	bool texelResident = sparseTexelsResidentARB(residencyCode);
+
+	if (!texelResident)
+	{
+		color = vec4(0.0, 0.0, 0.0, 0.0);
+	}
+
+	outFragColor = color;
+}
@@ -33,7 +33,7 @@ dir_path = os.path.dirname(os.path.realpath(__file__))
 dir_path = dir_path.replace('\\', '/')
 for root, dirs, files in os.walk(dir_path):
     for file in files:
-        if file.endswith(".vert") or file.endswith(".frag") or file.endswith(".comp") or file.endswith(".geom") or file.endswith(".tesc") or file.endswith(".tese") or file.endswith(".rgen") or file.endswith(".rchit") or file.endswith(".rmiss"):
+        if file.endswith(".vert") or file.endswith(".frag") or file.endswith(".comp") or file.endswith(".geom") or file.endswith(".tesc") or file.endswith(".tese") or file.endswith(".rgen") or file.endswith(".rchit") or file.endswith(".rmiss") or file.endswith(".mesh") or file.endswith(".task"):
             hlsl_file = os.path.join(root, file)
             spv_out = hlsl_file + ".spv"
 
@@ -54,6 +54,10 @@ for root, dirs, files in os.walk(dir_path):
 				hlsl_file.find('.rchit') != -1 or
 				hlsl_file.find('.rmiss') != -1):
                 profile = 'lib_6_3'
+            elif(hlsl_file.find('.mesh') != -1):
+                profile = 'ms_6_5'
+            elif(hlsl_file.find('.task') != -1):
+                profile = 'as_6_5'
 
             print('Compiling %s' % (hlsl_file))
             subprocess.check_output([
@@ -65,5 +69,6 @@ for root, dirs, files in os.walk(dir_path):
                 '-fspv-extension=SPV_KHR_multiview',
                 '-fspv-extension=SPV_KHR_shader_draw_parameters',
                 '-fspv-extension=SPV_EXT_descriptor_indexing',
+                '-fspv-extension=SPV_NV_mesh_shader',
                 hlsl_file,
                 '-Fo', spv_out])
@@ -0,0 +1,161 @@
+// Copyright 2020 Google LLC
+
+// Depth with the packed G-Buffer layout
+Texture2D textureposition : register(t1);
+SamplerState samplerposition : register(s1);
+Texture2D textureNormal : register(t2);
+SamplerState samplerNormal : register(s2);
+Texture2D textureAlbedo : register(t3);
+SamplerState samplerAlbedo : register(s3);
+
+struct Light {
+	float4 position;
+	float3 color;
+	float radius;
+};
+
+struct UBO
+{
+	Light lights[6];
+	float4 viewPos;
+	int displayDebugTarget;
+	float4x4 invViewProjection;
+};
+
+cbuffer ubo : register(b4) { UBO ubo; }
+
+// Positions are reconstructed from depth and normals are octahedron encoded with the packed G-Buffer layout
+[[vk::constant_id(0)]] const bool PACKED_GBUFFER = false;
+
+// Lights assigned to clusters by the base light clustering compute pass
+
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct UBOClusters
+{
+	float4x4 view;
+	float4x4 projInverse;
+	uint4 gridSize;
+	float4 depthRange;
+	float4 viewport;
+};
+
+cbuffer clusters : register(b5) { UBOClusters clusters; }
+
+StructuredBuffer<Light> lights : register(t6);
+StructuredBuffer<uint> lightCounts : register(t7);
+StructuredBuffer<uint> lightIndices : register(t8);
+
+float3 decodeNormal(float2 f)
+{
+	f = f * 2.0 - 1.0;
+	float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+float3 worldPosFromDepth(float2 uv, float depth)
+{
+	float4 pos = mul(ubo.invViewProjection, float4(uv * 2.0 - 1.0, depth, 1.0));
+	return pos.xyz / pos.w;
+}
+
+uint getClusterIndex(float2 fragCoord, float3 worldPos)
+{
+	float2 uv = fragCoord / clusters.viewport.xy;
+	float depth = -mul(clusters.view, float4(worldPos, 1.0)).z;
+	float slice = log(max(depth, clusters.depthRange.x) / clusters.depthRange.x) / clusters.depthRange.z * float(clusters.gridSize.z);
+	uint3 cluster = min(uint3(uv * float2(clusters.gridSize.xy), slice), clusters.gridSize.xyz - 1);
+	return cluster.x + clusters.gridSize.x * (cluster.y + clusters.gridSize.y * cluster.z);
+}
+
+float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0, float4 fragCoord : SV_POSITION) : SV_TARGET
+{
+	// Get G-Buffer values
+	float3 fragPos;
+	float3 normal;
+	if (PACKED_GBUFFER) {
+		float depth = textureposition.Sample(samplerposition, inUV).r;
+		fragPos = depth < 1.0 ? worldPosFromDepth(inUV, depth) : float3(0.0, 0.0, 0.0);
+		normal = depth < 1.0 ? decodeNormal(textureNormal.Sample(samplerNormal, inUV).rg) : float3(0.0, 0.0, 0.0);
+	} else {
+		fragPos = textureposition.Sample(samplerposition, inUV).rgb;
+		normal = textureNormal.Sample(samplerNormal, inUV).rgb;
+	}
+	float4 albedo = textureAlbedo.Sample(samplerAlbedo, inUV);
+
+	float3 fragcolor;
+
+	// Debug display
+	if (ubo.displayDebugTarget > 0) {
+		switch (ubo.displayDebugTarget) {
+			case 1:
+				fragcolor.rgb = fragPos;
+				break;
+			case 2:
+				fragcolor.rgb = normal;
+				break;
+			case 3:
+				fragcolor.rgb = albedo.rgb;
+				break;
+			case 4:
+				fragcolor.rgb = albedo.aaa;
+				break;
+			case 5:
+				// Number of lights in the cluster of this fragment
+				fragcolor.rgb = lerp(float3(0.0, 0.0, 1.0), float3(1.0, 0.0, 0.0), clamp(float(lightCounts[getClusterIndex(fragCoord.xy, fragPos)]) / 32.0, 0.0, 1.0));
+				break;
+		}
+		return float4(fragcolor, 1.0);
+	}
+
+	// Render-target composition
+
+	#define ambient 0.0
+
+	// Ambient part
+	fragcolor = albedo.rgb * ambient;
+
+	float3 N = normalize(normal);
+
+	// Viewer to fragment
+	float3 V = ubo.viewPos.xyz - fragPos;
+	V = normalize(V);
+
+	// Only the lights of the cluster this fragment is in
+	uint clusterIndex = getClusterIndex(fragCoord.xy, fragPos);
+	uint lightCount = lightCounts[clusterIndex];
+
+	for(uint i = 0; i < lightCount; ++i)
+	{
+		Light light = lights[lightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+
+		// Vector to light
+		float3 L = light.position.xyz - fragPos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Light to fragment
+		L = normalize(L);
+
+		// Attenuation, windowed to reach zero at the light's radius so lights only affect the clusters they were assigned to
+		float window = clamp(1.0 - pow(dist / light.radius, 4.0), 0.0, 1.0);
+		float atten = light.radius / (pow(dist, 2.0) + 1.0) * window * window;
+
+		// Diffuse part
+		float NdotL = max(0.0, dot(N, L));
+		float3 diff = light.color * albedo.rgb * NdotL * atten;
+
+		// Specular part
+		// Specular map values are stored in alpha of albedo mrt
+		float3 R = reflect(-L, N);
+		float NdotR = max(0.0, dot(R, V));
+		float3 spec = light.color * albedo.a * pow(NdotR, 16.0) * atten;
+
+		fragcolor += diff + spec;
+	}
+
+  return float4(fragcolor, 1.0);
+}
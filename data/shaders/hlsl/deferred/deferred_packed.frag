@@ -0,0 +1,120 @@
+// Copyright 2020 Google LLC
+
+// Packed G-Buffer layout: Positions are reconstructed from depth, normals are octahedron encoded
+
+Texture2D textureDepth : register(t1);
+SamplerState samplerDepth : register(s1);
+Texture2D textureNormal : register(t2);
+SamplerState samplerNormal : register(s2);
+Texture2D textureAlbedo : register(t3);
+SamplerState samplerAlbedo : register(s3);
+
+struct Light {
+	float4 position;
+	float3 color;
+	float radius;
+};
+
+struct UBO
+{
+	Light lights[6];
+	float4 viewPos;
+	int displayDebugTarget;
+	float4x4 invViewProjection;
+};
+
+cbuffer ubo : register(b4) { UBO ubo; }
+
+float3 decodeNormal(float2 f)
+{
+	f = f * 2.0 - 1.0;
+	float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+float3 worldPosFromDepth(float2 uv, float depth)
+{
+	float4 pos = mul(ubo.invViewProjection, float4(uv * 2.0 - 1.0, depth, 1.0));
+	return pos.xyz / pos.w;
+}
+
+
+float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
+{
+	// Get G-Buffer values
+	float depth = textureDepth.Sample(samplerDepth, inUV).r;
+	float3 fragPos = worldPosFromDepth(inUV, depth);
+	float3 normal = decodeNormal(textureNormal.Sample(samplerNormal, inUV).rg);
+	// Match the cleared targets of the full layout for the background
+	if (depth == 1.0) {
+		fragPos = float3(0.0, 0.0, 0.0);
+		normal = float3(0.0, 0.0, 0.0);
+	}
+	float4 albedo = textureAlbedo.Sample(samplerAlbedo, inUV);
+
+	float3 fragcolor;
+
+	// Debug display
+	if (ubo.displayDebugTarget > 0) {
+		switch (ubo.displayDebugTarget) {
+			case 1: 
+				fragcolor.rgb = fragPos;
+				break;
+			case 2: 
+				fragcolor.rgb = normal;
+				break;
+			case 3: 
+				fragcolor.rgb = albedo.rgb;
+				break;
+			case 4: 
+				fragcolor.rgb = albedo.aaa;
+				break;
+		}		
+		return float4(fragcolor, 1.0);
+	}
+
+	#define lightCount 6
+	#define ambient 0.0
+
+	// Ambient part
+	fragcolor = albedo.rgb * ambient;
+
+	for(int i = 0; i < lightCount; ++i)
+	{
+		// Vector to light
+		float3 L = ubo.lights[i].position.xyz - fragPos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Viewer to fragment
+		float3 V = ubo.viewPos.xyz - fragPos;
+		V = normalize(V);
+
+		//if(dist < ubo.lights[i].radius)
+		{
+			// Light to fragment
+			L = normalize(L);
+
+			// Attenuation
+			float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
+
+			// Diffuse part
+			float3 N = normalize(normal);
+			float NdotL = max(0.0, dot(N, L));
+			float3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
+
+			// Specular part
+			// Specular map values are stored in alpha of albedo mrt
+			float3 R = reflect(-L, N);
+			float NdotR = max(0.0, dot(R, V));
+			float3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 16.0) * atten;
+
+			fragcolor += diff + spec;
+		}
+	}
+
+  return float4(fragcolor, 1.0);
+}
@@ -0,0 +1,157 @@
+// Copyright 2020 Google LLC
+
+// Packed G-Buffer layout: Positions are reconstructed from depth, normals are octahedron encoded
+
+Texture2DMS<float> textureDepth : register(t1);
+SamplerState samplerDepth : register(s1);
+Texture2DMS<float4> textureNormal : register(t2);
+SamplerState samplerNormal : register(s2);
+Texture2DMS<float4> textureAlbedo : register(t3);
+SamplerState samplerAlbedo : register(s3);
+
+struct Light {
+	float4 position;
+	float3 color;
+	float radius;
+};
+
+struct UBO
+{
+	Light lights[6];
+	float4 viewPos;
+	int debugDisplayTarget;
+	float4x4 invViewProjection;
+};
+
+cbuffer ubo : register(b4) { UBO ubo; }
+
+[[vk::constant_id(0)]] const int NUM_SAMPLES = 8;
+
+#define NUM_LIGHTS 6
+
+float3 decodeNormal(float2 f)
+{
+	f = f * 2.0 - 1.0;
+	float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+float3 worldPosFromDepth(float2 uv, float depth)
+{
+	float4 pos = mul(ubo.invViewProjection, float4(uv * 2.0 - 1.0, depth, 1.0));
+	return pos.xyz / pos.w;
+}
+
+// Fetches position and normal of a single sample, the background matches the cleared targets of the full layout
+void fetchSample(int2 UV, float2 uv, int index, out float3 pos, out float3 normal)
+{
+	uint status = 0;
+	float depth = textureDepth.Load(UV, index, int2(0, 0), status).r;
+	pos = depth < 1.0 ? worldPosFromDepth(uv, depth) : float3(0.0, 0.0, 0.0);
+	normal = depth < 1.0 ? decodeNormal(textureNormal.Load(UV, index, int2(0, 0), status).rg) : float3(0.0, 0.0, 0.0);
+}
+
+// Manual resolve for MSAA samples
+float4 resolve(Texture2DMS<float4> tex, int2 uv)
+{
+	float4 result = float4(0.0, 0.0, 0.0, 0.0);
+	for (int i = 0; i < NUM_SAMPLES; i++)
+	{
+		uint status = 0;
+		float4 val = tex.Load(uv, i, int2(0, 0), status);
+		result += val;
+	}
+	// Average resolved samples
+	return result / float(NUM_SAMPLES);
+}
+
+float3 calculateLighting(float3 pos, float3 normal, float4 albedo)
+{
+	float3 result = float3(0.0, 0.0, 0.0);
+
+	for(int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		// Vector to light
+		float3 L = ubo.lights[i].position.xyz - pos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+		// Viewer to fragment
+		float3 V = ubo.viewPos.xyz - pos;
+		V = normalize(V);
+
+		// Light to fragment
+		L = normalize(L);
+
+		// Attenuation
+		float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
+
+		// Diffuse part
+		float3 N = normalize(normal);
+		float NdotL = max(0.0, dot(N, L));
+		float3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
+
+		// Specular part
+		float3 R = reflect(-L, N);
+		float NdotR = max(0.0, dot(R, V));
+		float3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 8.0) * atten;
+
+		result += diff + spec;
+	}
+	return result;
+}
+
+float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
+{
+	int2 attDim; int sampleCount;
+	textureDepth.GetDimensions(attDim.x, attDim.y, sampleCount);
+	int2 UV = int2(inUV * attDim);
+	// Reconstruct at the texel center, as the position was written there
+	float2 uv = (float2(UV) + 0.5) / float2(attDim);
+	float3 pos, normal;
+
+	float3 fragColor;
+	uint status = 0;
+
+	// Debug display
+	if (ubo.debugDisplayTarget > 0) {
+		switch (ubo.debugDisplayTarget) {
+			case 1: 
+				fetchSample(UV, uv, 0, pos, normal);
+				fragColor.rgb = pos;
+				break;
+			case 2: 
+				fetchSample(UV, uv, 0, pos, normal);
+				fragColor.rgb = normal;
+				break;
+			case 3: 
+				fragColor.rgb = textureAlbedo.Load(UV, 0, int2(0, 0), status).rgb;
+				break;
+			case 4: 
+				fragColor.rgb = textureAlbedo.Load(UV, 0, int2(0, 0), status).aaa;
+				break;
+		}		
+		return float4(fragColor, 1.0);
+	}
+
+	#define ambient 0.15
+
+	// Ambient part
+	float4 alb = resolve(textureAlbedo, UV);
+	fragColor = float3(0.0, 0.0, 0.0);
+
+	// Calualte lighting for every MSAA sample
+	for (int i = 0; i < NUM_SAMPLES; i++)
+	{
+		fetchSample(UV, uv, i, pos, normal);
+		float4 albedo = textureAlbedo.Load(UV, i, int2(0, 0), status);
+		fragColor += calculateLighting(pos, normal, albedo);
+	}
+
+	fragColor = (alb.rgb * ambient) + fragColor / float(NUM_SAMPLES);
+
+	return float4(fragColor, 1.0);
+}
@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC
+
+Texture2D textureColorMap : register(t0, space1);
+SamplerState samplerColorMap : register(s0, space1);
+Texture2D textureNormalMap : register(t1, space1);
+SamplerState samplerNormalMap : register(s1, space1);
+
+// Point lights assigned to clusters by the base light clustering compute pass
+
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct Light {
+	float4 position;
+	float3 color;
+	float radius;
+};
+
+struct UBOClusters
+{
+	float4x4 view;
+	float4x4 projInverse;
+	uint4 gridSize;
+	float4 depthRange;
+	float4 viewport;
+};
+
+cbuffer clusters : register(b1) { UBOClusters clusters; }
+
+StructuredBuffer<Light> lights : register(t2);
+StructuredBuffer<uint> lightCounts : register(t3);
+StructuredBuffer<uint> lightIndices : register(t4);
+
+[[vk::constant_id(0)]] const bool ALPHA_MASK = false;
+[[vk::constant_id(1)]] const float ALPHA_MASK_CUTOFF = 0.0;
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float2 UV : TEXCOORD0;
+[[vk::location(3)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(4)]] float3 LightVec : TEXCOORD2;
+[[vk::location(5)]] float4 Tangent : TEXCOORD3;
+[[vk::location(6)]] float3 WorldPos : POSITION0;
+};
+
+uint getClusterIndex(float2 fragCoord, float3 worldPos)
+{
+	float2 uv = fragCoord / clusters.viewport.xy;
+	float depth = -mul(clusters.view, float4(worldPos, 1.0)).z;
+	float slice = log(max(depth, clusters.depthRange.x) / clusters.depthRange.x) / clusters.depthRange.z * float(clusters.gridSize.z);
+	uint3 cluster = min(uint3(uv * float2(clusters.gridSize.xy), slice), clusters.gridSize.xyz - 1);
+	return cluster.x + clusters.gridSize.x * (cluster.y + clusters.gridSize.y * cluster.z);
+}
+
+float4 main(VSOutput input) : SV_TARGET
+{
+	float4 color = textureColorMap.Sample(samplerColorMap, input.UV) * float4(input.Color, 1.0);
+
+	if (ALPHA_MASK) {
+		if (color.a < ALPHA_MASK_CUTOFF) {
+			discard;
+		}
+	}
+
+	float3 N = normalize(input.Normal);
+	float3 T = normalize(input.Tangent.xyz);
+	float3 B = cross(input.Normal, input.Tangent.xyz) * input.Tangent.w;
+	float3x3 TBN = float3x3(T, B, N);
+	N = mul(normalize(textureNormalMap.Sample(samplerNormalMap, input.UV).xyz * 2.0 - float3(1.0, 1.0, 1.0)), TBN);
+
+	const float ambient = 0.1;
+	float3 L = normalize(input.LightVec);
+	float3 V = normalize(input.ViewVec);
+	float3 R = reflect(-L, N);
+	float3 diffuse = max(dot(N, L), ambient).rrr;
+	float specular = pow(max(dot(R, V), 0.0), 32.0);
+	float3 lighting = diffuse * color.rgb + specular;
+
+	// Only the point lights of the cluster this fragment is in
+	uint clusterIndex = getClusterIndex(input.Pos.xy, input.WorldPos);
+	uint lightCount = lightCounts[clusterIndex];
+	for (uint i = 0; i < lightCount; i++) {
+		Light light = lights[lightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+		float3 lightVec = light.position.xyz - input.WorldPos;
+		float dist = length(lightVec);
+		L = lightVec / dist;
+		R = reflect(-L, N);
+		// Attenuation, windowed to reach zero at the light's radius so lights only affect the clusters they were assigned to
+		float window = clamp(1.0 - pow(dist / light.radius, 4.0), 0.0, 1.0);
+		float atten = window * window / (dist * dist + 1.0);
+		lighting += light.color * atten * (max(dot(N, L), 0.0) * color.rgb + pow(max(dot(R, V), 0.0), 32.0));
+	}
+
+	return float4(lighting, color.a);
+}
\ No newline at end of file
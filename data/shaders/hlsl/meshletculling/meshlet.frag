@@ -0,0 +1,43 @@
+// Copyright 2020 Google LLC
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4 frustumPlanes[6];
+	float4 cullingViewPos;
+	float4 viewPos;
+	uint meshletCount;
+	uint frustumCulling;
+	uint coneCulling;
+	uint colorMeshlets;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+struct VSOutput
+{
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(3)]] nointerpolation uint MeshletIndex : TEXCOORD2;
+};
+
+float3 meshletColor(uint index)
+{
+	uint hash = index * 2654435761u;
+	return float3(float(hash & 255u), float((hash >> 8) & 255u), float((hash >> 16) & 255u)) / 255.0;
+}
+
+float4 main(VSOutput input) : SV_TARGET
+{
+	float3 color = (ubo.colorMeshlets == 1) ? meshletColor(input.MeshletIndex) : input.Color;
+	float3 N = normalize(input.Normal);
+	float3 V = normalize(input.ViewVec);
+	// Double sided lighting, back face culling is disabled
+	if (dot(N, V) < 0.0) {
+		N = -N;
+	}
+	float diffuse = max(dot(N, normalize(float3(0.25, 1.0, 0.5))), 0.0);
+	return float4(color * (0.25 + 0.75 * diffuse), 1.0);
+}
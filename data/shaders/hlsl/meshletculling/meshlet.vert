@@ -0,0 +1,50 @@
+// Copyright 2020 Google LLC
+
+struct VSInput
+{
+[[vk::location(0)]] float3 Pos : POSITION0;
+[[vk::location(1)]] float3 Normal : NORMAL0;
+[[vk::location(2)]] float4 Color : COLOR0;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4 frustumPlanes[6];
+	float4 cullingViewPos;
+	float4 viewPos;
+	uint meshletCount;
+	uint frustumCulling;
+	uint coneCulling;
+	uint colorMeshlets;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+struct PushConsts {
+	uint meshletIndexOffset;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(3)]] nointerpolation uint MeshletIndex : TEXCOORD2;
+};
+
+// SV_InstanceID doesn't include the first instance of the draw, so it's added explicitly
+VSOutput main(VSInput input, uint InstanceIndex : SV_InstanceID, [[vk::builtin("BaseInstance")]] uint BaseInstance : BASEINSTANCE)
+{
+	VSOutput output = (VSOutput)0;
+	output.Normal = input.Normal;
+	output.Color = input.Color.rgb;
+	output.ViewVec = ubo.viewPos.xyz - input.Pos;
+	// The meshlet index is stored as the first instance, or passed as a push constant if drawIndirectFirstInstance is not supported
+	output.MeshletIndex = BaseInstance + InstanceIndex + pushConsts.meshletIndexOffset;
+	output.Pos = mul(ubo.projection, mul(ubo.view, float4(input.Pos, 1.0)));
+	return output;
+}
@@ -0,0 +1,58 @@
+// Copyright 2020 Google LLC
+
+// Compact vertex layout, see vkglTF::Vertex
+struct VSInput
+{
+[[vk::location(0)]] float4 Pos : POSITION0;
+[[vk::location(1)]] float2 UV : TEXCOORD0;
+[[vk::location(2)]] float2 Normal : NORMAL0;
+[[vk::location(3)]] float4 Tangent : TEXCOORD1;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4x4 model;
+	float4 lightPos;
+	float4 cameraPos;
+	float4x4 positionDequantization;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float2 UV : TEXCOORD0;
+[[vk::location(1)]] float3 TangentLightPos : TEXCOORD1;
+[[vk::location(2)]] float3 TangentViewPos : TEXCOORD2;
+[[vk::location(3)]] float3 TangentFragPos : TEXCOORD3;
+};
+
+float3 decodeOctahedral(float2 e)
+{
+	float3 v = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0);
+	v.xy += float2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+	return normalize(v);
+}
+
+VSOutput main(VSInput input)
+{
+	VSOutput output = (VSOutput)0;
+	// Positions are normalized to the model's bounds
+	float4 pos = mul(ubo.positionDequantization, input.Pos);
+	output.Pos = mul(ubo.projection, mul(ubo.view, mul(ubo.model, pos)));
+	output.UV = input.UV;
+
+	float3 N = normalize(decodeOctahedral(input.Normal));
+	float3 T = normalize(decodeOctahedral(input.Tangent.xy));
+	float3 B = normalize(cross(N, T));
+	float3x3 TBN = float3x3(T, B, N);
+
+	output.TangentLightPos = mul(TBN, ubo.lightPos.xyz);
+	output.TangentViewPos  = mul(TBN, ubo.cameraPos.xyz);
+	output.TangentFragPos  = mul(TBN, mul(ubo.model, pos).xyz);
+	return output;
+}
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC
+// Non-uniform access is enabled at compile time via SPV_EXT_descriptor_indexing (see compile.py)
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float2 UV : TEXCOORD0;
+[[vk::location(2)]] float3 Color : COLOR0;
+[[vk::location(3)]] float3 WorldPos : POSITION0;
+[[vk::location(4)]] nointerpolation uint MaterialIndex : MATERIALINDEX0;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 model;
+	float4x4 view;
+	float nearPlane;
+	float farPlane;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+// Matches vkglTF::ShaderMaterial
+struct ShaderMaterial
+{
+	float4 baseColorFactor;
+	int baseColorTextureIndex;
+	int metallicRoughnessTextureIndex;
+	int normalTextureIndex;
+	int occlusionTextureIndex;
+	int emissiveTextureIndex;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint alphaMode;
+};
+
+// All materials and images of the model are bound once with a single set
+StructuredBuffer<ShaderMaterial> materials : register(t0, space1);
+Texture2D textures[] : register(t1, space1);
+SamplerState samplers[] : register(s1, space1);
+
+struct FSOutput
+{
+	float4 Position : SV_TARGET0;
+	float4 Normal : SV_TARGET1;
+	float4 Albedo : SV_TARGET2;
+};
+
+float linearDepth(float depth)
+{
+	float z = depth * 2.0f - 1.0f;
+	return (2.0f * ubo.nearPlane * ubo.farPlane) / (ubo.farPlane + ubo.nearPlane - z * (ubo.farPlane - ubo.nearPlane));
+}
+
+FSOutput main(VSOutput input)
+{
+	ShaderMaterial material = materials[input.MaterialIndex];
+	float4 color = material.baseColorFactor;
+	if (material.baseColorTextureIndex > -1) {
+		uint textureIndex = NonUniformResourceIndex(material.baseColorTextureIndex);
+		color *= textures[textureIndex].Sample(samplers[textureIndex], input.UV);
+	}
+
+	FSOutput output = (FSOutput)0;
+	output.Position = float4(input.WorldPos, linearDepth(input.Pos.z));
+	output.Normal = float4(normalize(input.Normal) * 0.5 + 0.5, 1.0);
+	output.Albedo = color * float4(input.Color, 1.0);
+	return output;
+}
@@ -0,0 +1,83 @@
+// Copyright 2020 Google LLC
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 model;
+	float4 viewPos;
+	float lodBias;
+	uint frameIndex;
+	int2 pageExtent;
+	int mipTailStart;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+Texture2D textureColor : register(t1);
+SamplerState samplerColor : register(s1);
+
+// One entry per virtual page outside of the mip tail, set to the current frame index for every page that's sampled
+RWStructuredBuffer<uint> pageRequests : register(u2);
+
+struct VSOutput
+{
+[[vk::location(0)]] float2 UV : TEXCOORD0;
+[[vk::location(1)]] float LodBias : TEXCOORD3;
+};
+
+void requestPage(int mipLevel, float2 uv)
+{
+	if (mipLevel >= ubo.mipTailStart) {
+		return;
+	}
+	// Pages are stored level by level in row order, same as on the host
+	uint width, height, levels;
+	textureColor.GetDimensions(0, width, height, levels);
+	int2 textureExtent = int2(width, height);
+	uint pageIndex = 0;
+	for (int i = 0; i < mipLevel; i++) {
+		int2 pageCount = (max(textureExtent >> i, int2(1, 1)) + ubo.pageExtent - 1) / ubo.pageExtent;
+		pageIndex += uint(pageCount.x * pageCount.y);
+	}
+	int2 levelExtent = max(textureExtent >> mipLevel, int2(1, 1));
+	int2 pageCount = (levelExtent + ubo.pageExtent - 1) / ubo.pageExtent;
+	int2 page = clamp(int2(saturate(uv) * float2(levelExtent)) / ubo.pageExtent, int2(0, 0), pageCount - 1);
+	pageIndex += uint(page.y * pageCount.x + page.x);
+	// Skip redundant writes for pages already requested by other fragments
+	if (pageRequests[pageIndex] != ubo.frameIndex) {
+		pageRequests[pageIndex] = ubo.frameIndex;
+	}
+}
+
+float4 main(VSOutput input) : SV_TARGET
+{
+	float4 color = float4(0.0, 0.0, 0.0, 0.0);
+
+	// Request the pages for the level(s) nearest mip filtering may select
+	float lod = max(textureColor.CalculateLevelOfDetailUnclamped(samplerColor, input.UV) + input.LodBias, 0.0);
+	requestPage(int(floor(lod)), input.UV);
+	requestPage(int(floor(lod)) + 1, input.UV);
+
+	// Get residency status for current texel
+	uint status;
+	color = textureColor.SampleBias(samplerColor, input.UV, input.LodBias, int2(0, 0), 0.0, status);
+
+	// Fall back to coarser levels until a resident texel is found, the mip tail is always resident
+	uint width, height, levels;
+	textureColor.GetDimensions(0, width, height, levels);
+	float minLod = floor(lod) + 1.0;
+	float maxLod = float(levels - 1);
+	while (!CheckAccessFullyMapped(status) && (minLod <= maxLod))
+	{
+		color = textureColor.SampleBias(samplerColor, input.UV, input.LodBias, int2(0, 0), minLod, status);
+		minLod += 1.0;
+	}
+
+	// Check if texel is resident
+	if (!CheckAccessFullyMapped(status))
+	{
+		color = float4(0.0, 0.0, 0.0, 0.0);
+	}
+
+	return color;
+}
@@ -8,6 +8,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanAliasedMemory.h"
 
 #define ENABLE_VALIDATION false
 
@@ -76,10 +77,10 @@ public:
 	} descriptorSetLayouts;
 
 	// Framebuffer for offscreen rendering
+	// Memory of the attachments is owned by offscreenMemory
 	struct FrameBufferAttachment {
-		VkImage image;
-		VkDeviceMemory mem;
-		VkImageView view;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
 	};
 	struct FrameBuffer {
 		VkFramebuffer framebuffer;
@@ -89,10 +90,15 @@ public:
 	struct OffscreenPass {
 		int32_t width, height;
 		VkRenderPass renderPass;
+		// The vertical blur doesn't use depth, so it's rendered with a color only render pass
+		VkRenderPass blurRenderPass;
 		VkSampler sampler;
 		std::array<FrameBuffer, 2> framebuffers;
 	} offscreenPass;
 
+	// Memory shared by the attachments of the offscreen framebuffers
+	vks::AliasedMemory* offscreenMemory = nullptr;
+
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
 	{
 		title = "Bloom (offscreen rendering)";
@@ -116,14 +122,14 @@ public:
 			// Attachments
 			vkDestroyImageView(device, framebuffer.color.view, nullptr);
 			vkDestroyImage(device, framebuffer.color.image, nullptr);
-			vkFreeMemory(device, framebuffer.color.mem, nullptr);
 			vkDestroyImageView(device, framebuffer.depth.view, nullptr);
 			vkDestroyImage(device, framebuffer.depth.image, nullptr);
-			vkFreeMemory(device, framebuffer.depth.mem, nullptr);
 
 			vkDestroyFramebuffer(device, framebuffer.framebuffer, nullptr);
 		}
 		vkDestroyRenderPass(device, offscreenPass.renderPass, nullptr);
+		vkDestroyRenderPass(device, offscreenPass.blurRenderPass, nullptr);
+		delete offscreenMemory;
 
 		vkDestroyPipeline(device, pipelines.blurHorz, nullptr);
 		vkDestroyPipeline(device, pipelines.blurVert, nullptr);
@@ -147,25 +153,10 @@ public:
 
 	// Setup the offscreen framebuffer for rendering the mirrored scene
 	// The color attachment of this framebuffer will then be sampled from
+	// The images have been created and bound to memory in prepareOffscreen, framebuffers without a depth image are used with the color only render pass
 	void prepareOffscreenFramebuffer(FrameBuffer *frameBuf, VkFormat colorFormat, VkFormat depthFormat)
 	{
 		// Color attachment
-		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
-		image.imageType = VK_IMAGE_TYPE_2D;
-		image.format = colorFormat;
-		image.extent.width = FB_DIM;
-		image.extent.height = FB_DIM;
-		image.extent.depth = 1;
-		image.mipLevels = 1;
-		image.arrayLayers = 1;
-		image.samples = VK_SAMPLE_COUNT_1_BIT;
-		image.tiling = VK_IMAGE_TILING_OPTIMAL;
-		// We will sample directly from the color attachment
-		image.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
 		VkImageViewCreateInfo colorImageView = vks::initializers::imageViewCreateInfo();
 		colorImageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		colorImageView.format = colorFormat;
@@ -176,54 +167,40 @@ public:
 		colorImageView.subresourceRange.levelCount = 1;
 		colorImageView.subresourceRange.baseArrayLayer = 0;
 		colorImageView.subresourceRange.layerCount = 1;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &frameBuf->color.image));
-		vkGetImageMemoryRequirements(device, frameBuf->color.image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &frameBuf->color.mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, frameBuf->color.image, frameBuf->color.mem, 0));
-
 		colorImageView.image = frameBuf->color.image;
 		VK_CHECK_RESULT(vkCreateImageView(device, &colorImageView, nullptr, &frameBuf->color.view));
 
-		// Depth stencil attachment
-		image.format = depthFormat;
-		image.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-		VkImageViewCreateInfo depthStencilView = vks::initializers::imageViewCreateInfo();
-		depthStencilView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		depthStencilView.format = depthFormat;
-		depthStencilView.flags = 0;
-		depthStencilView.subresourceRange = {};
-		depthStencilView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-		depthStencilView.subresourceRange.baseMipLevel = 0;
-		depthStencilView.subresourceRange.levelCount = 1;
-		depthStencilView.subresourceRange.baseArrayLayer = 0;
-		depthStencilView.subresourceRange.layerCount = 1;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &frameBuf->depth.image));
-		vkGetImageMemoryRequirements(device, frameBuf->depth.image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &frameBuf->depth.mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, frameBuf->depth.image, frameBuf->depth.mem, 0));
-
-		depthStencilView.image = frameBuf->depth.image;
-		VK_CHECK_RESULT(vkCreateImageView(device, &depthStencilView, nullptr, &frameBuf->depth.view));
-
 		VkImageView attachments[2];
 		attachments[0] = frameBuf->color.view;
-		attachments[1] = frameBuf->depth.view;
 
 		VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
-		fbufCreateInfo.renderPass = offscreenPass.renderPass;
-		fbufCreateInfo.attachmentCount = 2;
+		fbufCreateInfo.renderPass = offscreenPass.blurRenderPass;
+		fbufCreateInfo.attachmentCount = 1;
 		fbufCreateInfo.pAttachments = attachments;
 		fbufCreateInfo.width = FB_DIM;
 		fbufCreateInfo.height = FB_DIM;
 		fbufCreateInfo.layers = 1;
 
+		// Depth stencil attachment
+		if (frameBuf->depth.image != VK_NULL_HANDLE) {
+			VkImageViewCreateInfo depthStencilView = vks::initializers::imageViewCreateInfo();
+			depthStencilView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			depthStencilView.format = depthFormat;
+			depthStencilView.flags = 0;
+			depthStencilView.subresourceRange = {};
+			depthStencilView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			depthStencilView.subresourceRange.baseMipLevel = 0;
+			depthStencilView.subresourceRange.levelCount = 1;
+			depthStencilView.subresourceRange.baseArrayLayer = 0;
+			depthStencilView.subresourceRange.layerCount = 1;
+			depthStencilView.image = frameBuf->depth.image;
+			VK_CHECK_RESULT(vkCreateImageView(device, &depthStencilView, nullptr, &frameBuf->depth.view));
+
+			attachments[1] = frameBuf->depth.view;
+			fbufCreateInfo.renderPass = offscreenPass.renderPass;
+			fbufCreateInfo.attachmentCount = 2;
+		}
+
 		VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &frameBuf->framebuffer));
 
 		// Fill a descriptor for later use in a descriptor set
@@ -279,11 +256,13 @@ public:
 
 		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		// The offscreen attachments share memory with targets of the other passes, so their reads and writes need to finish first
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		// The aliased memory is sampled at other locations (and resolutions) than it's written, so this can't be a framebuffer local dependency
+		dependencies[0].dependencyFlags = 0;
 
 		dependencies[1].srcSubpass = 0;
 		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
@@ -305,6 +284,11 @@ public:
 
 		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &offscreenPass.renderPass));
 
+		// Color only render pass for the vertical blur
+		subpassDescription.pDepthStencilAttachment = nullptr;
+		renderPassInfo.attachmentCount = 1;
+		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &offscreenPass.blurRenderPass));
+
 		// Create sampler to sample from the color attachments
 		VkSamplerCreateInfo sampler = vks::initializers::samplerCreateInfo();
 		sampler.magFilter = VK_FILTER_LINEAR;
@@ -320,6 +304,43 @@ public:
 		sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 		VK_CHECK_RESULT(vkCreateSampler(device, &sampler, nullptr, &offscreenPass.sampler));
 
+		// All offscreen attachments are placed in aliased memory, with the passes of a frame being the glow pass (0), the vertical blur (1)
+		// and the scene with the horizontal blur (2)
+		// Depth is only needed by the glow pass and is never stored, so it's created as a transient attachment. The target of the vertical blur
+		// is only used after the glow pass, so it can reuse the depth attachment's memory
+		offscreenMemory = new vks::AliasedMemory(vulkanDevice);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(offscreenPass.framebuffers.size()); i++) {
+			VkImageCreateInfo image = vks::initializers::imageCreateInfo();
+			image.imageType = VK_IMAGE_TYPE_2D;
+			image.format = FB_COLOR_FORMAT;
+			image.extent.width = FB_DIM;
+			image.extent.height = FB_DIM;
+			image.extent.depth = 1;
+			image.mipLevels = 1;
+			image.arrayLayers = 1;
+			image.samples = VK_SAMPLE_COUNT_1_BIT;
+			image.tiling = VK_IMAGE_TILING_OPTIMAL;
+			// We will sample directly from the color attachment
+			image.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &offscreenPass.framebuffers[i].color.image));
+			// Written by pass i and sampled by the pass after it
+			offscreenMemory->addImage(offscreenPass.framebuffers[i].color.image, i, i + 1);
+		}
+		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
+		image.imageType = VK_IMAGE_TYPE_2D;
+		image.format = fbDepthFormat;
+		image.extent.width = FB_DIM;
+		image.extent.height = FB_DIM;
+		image.extent.depth = 1;
+		image.mipLevels = 1;
+		image.arrayLayers = 1;
+		image.samples = VK_SAMPLE_COUNT_1_BIT;
+		image.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &offscreenPass.framebuffers[0].depth.image));
+		offscreenMemory->addImage(offscreenPass.framebuffers[0].depth.image, 0, 0, true);
+		offscreenMemory->allocate();
+
 		// Create two frame buffers
 		prepareOffscreenFramebuffer(&offscreenPass.framebuffers[0], FB_COLOR_FORMAT, fbDepthFormat);
 		prepareOffscreenFramebuffer(&offscreenPass.framebuffers[1], FB_COLOR_FORMAT, fbDepthFormat);
@@ -380,7 +401,9 @@ public:
 					This is the first blur pass, the horizontal blur is applied when rendering on top of the scene
 				*/
 
+				renderPassBeginInfo.renderPass = offscreenPass.blurRenderPass;
 				renderPassBeginInfo.framebuffer = offscreenPass.framebuffers[1].framebuffer;
+				renderPassBeginInfo.clearValueCount = 1;
 
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -586,7 +609,7 @@ public:
 		VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(uint32_t), &blurdirection);
 		shaderStages[1].pSpecializationInfo = &specializationInfo;
 		// Vertical blur pipeline
-		pipelineCI.renderPass = offscreenPass.renderPass;
+		pipelineCI.renderPass = offscreenPass.blurRenderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.blurVert));
 		// Horizontal blur pipeline
 		blurdirection = 1;
@@ -724,6 +747,10 @@ public:
 				updateUniformBuffersBlur();
 			}
 		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Offscreen targets: %d KB (%d KB without aliasing)", static_cast<uint32_t>(offscreenMemory->getAllocatedSize() / 1024), static_cast<uint32_t>(offscreenMemory->getRequiredSize() / 1024));
+			overlay->text(offscreenMemory->usesLazilyAllocatedMemory() ? "Depth in lazily allocated memory" : "Device local memory");
+		}
 	}
 };
 
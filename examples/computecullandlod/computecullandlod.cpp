@@ -28,9 +28,14 @@ class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool fixedFrustum = false;
+	// Maximum projected error (in pixels) of the selected level of detail
+	float lodErrorThreshold = 1.0f;
+	// Select the levels of detail by their projected error (if the shader is available) instead of fixed distances
+	bool errorLodSelection = false;
 
-	// The model contains multiple versions of a single object with different levels of detail
+	// The levels of detail are generated at load time by simplifying the model's mesh
 	vkglTF::Model lodModel;
+	vkglTF::Primitive* lodPrimitive = nullptr;
 
 	// Per-instance data block
 	struct InstanceData {
@@ -58,6 +63,9 @@ public:
 		glm::mat4 modelview;
 		glm::vec4 cameraPos;
 		glm::vec4 frustumPlanes[6];
+		// Converts an error at a distance of one unit to pixels, only used by the error based LOD selection
+		float projectionScale;
+		float lodErrorThreshold;
 	} uboScene;
 
 	struct {
@@ -165,7 +173,7 @@ public:
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &lodModel.vertices.buffer, offsets);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], INSTANCE_BUFFER_BIND_ID, 1, &instanceBuffer.buffer, offsets);
 
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], lodModel.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(drawCmdBuffers[i], lodModel.indices.buffer, 0, lodModel.indices.type);
 
 			if (vulkanDevice->features.multiDrawIndirect)
 			{
@@ -190,8 +198,22 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
-		lodModel.loadFromFile(getAssetPath() + "models/suzanne_lods.gltf", vulkanDevice, queue, glTFLoadingFlags);
+		errorLodSelection = vks::tools::shaderAvailable(getShadersPath() + "computecullandlod/cull_error.comp.spv");
+		if (!errorLodSelection) {
+			std::cout << "Error based LOD selection shader not found, selecting the levels of detail by distance" << std::endl;
+		}
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::OptimizeMeshes | vkglTF::FileLoadingFlags::GenerateLods;
+		lodModel.lodLevels = MAX_LOD_LEVEL + 1;
+		lodModel.loadFromFile(getAssetPath() + "models/suzanne.gltf", vulkanDevice, queue, glTFLoadingFlags);
+		for (auto node : lodModel.linearNodes) {
+			if (node->mesh && !node->mesh->primitives.empty()) {
+				lodPrimitive = node->mesh->primitives[0];
+				break;
+			}
+		}
+		if (!lodPrimitive) {
+			vks::tools::exitFatal("The model does not contain any mesh", -1);
+		}
 	}
 
 	void buildComputeCommandBuffer()
@@ -364,6 +386,8 @@ public:
 					uint32_t index = x + y * OBJECT_COUNT + z * OBJECT_COUNT * OBJECT_COUNT;
 					indirectCommands[index].instanceCount = 1;
 					indirectCommands[index].firstInstance = index;
+					// The distance based LOD selection doesn't write the vertex offset
+					indirectCommands[index].vertexOffset = lodPrimitive->vertexOffset;
 					// firstIndex and indexCount are written by the compute shader
 				}
 			}
@@ -433,20 +457,23 @@ public:
 		{
 			uint32_t firstIndex;
 			uint32_t indexCount;
-			float distance;
-			float _pad0;
+			// Model space error for the error based selection, starting distance (to viewer) for the distance based selection
+			float errorOrDistance;
+			int32_t vertexOffset;
 		};
 		std::vector<LOD> LODLevels;
 		uint32_t n = 0;
-		for (auto node : lodModel.nodes)
+		for (auto& primitiveLod : lodPrimitive->lods)
 		{
 			LOD lod;
-			lod.firstIndex = node->mesh->primitives[0]->firstIndex;	// First index for this LOD
-			lod.indexCount = node->mesh->primitives[0]->indexCount;	// Index count for this LOD
-			lod.distance = 5.0f + n * 5.0f;							// Starting distance (to viewer) for this LOD
-			n++;
+			lod.firstIndex = primitiveLod.firstIndex;		// First index for this LOD
+			lod.indexCount = primitiveLod.indexCount;		// Index count for this LOD
+			lod.errorOrDistance = errorLodSelection ? primitiveLod.error : 5.0f + n * 5.0f;
+			lod.vertexOffset = lodPrimitive->vertexOffset;	// Non-zero if the indices have been rebased to 16 bits
 			LODLevels.push_back(lod);
+			n++;
 		}
+		std::cout << "Using " << LODLevels.size() << " levels of detail" << std::endl;
 
 		VK_CHECK_RESULT(vulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -573,7 +600,7 @@ public:
 
 		// Create pipeline
 		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(compute.pipelineLayout, 0);
-		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecullandlod/cull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		computePipelineCreateInfo.stage = loadShader(getShadersPath() + (errorLodSelection ? "computecullandlod/cull_error.comp.spv" : "computecullandlod/cull.comp.spv"), VK_SHADER_STAGE_COMPUTE_BIT);
 
 		// Use specialization constants to pass max. level of detail (determined by no. of meshes)
 		VkSpecializationMapEntry specializationEntry{};
@@ -581,7 +608,7 @@ public:
 		specializationEntry.offset = 0;
 		specializationEntry.size = sizeof(uint32_t);
 
-		uint32_t specializationData = static_cast<uint32_t>(lodModel.nodes.size()) - 1;
+		uint32_t specializationData = static_cast<uint32_t>(lodPrimitive->lods.size()) - 1;
 
 		VkSpecializationInfo specializationInfo;
 		specializationInfo.mapEntryCount = 1;
@@ -633,6 +660,9 @@ public:
 				memcpy(uboScene.frustumPlanes, frustum.planes.data(), sizeof(glm::vec4) * 6);
 			}
 		}
+		// Depends on the window height, so it also needs to be updated on resize
+		uboScene.projectionScale = camera.matrices.perspective[1][1] * (float)height * 0.5f;
+		uboScene.lodErrorThreshold = lodErrorThreshold;
 
 		memcpy(uniformData.scene.mapped, &uboScene, sizeof(uboScene));
 	}
@@ -710,17 +740,28 @@ public:
 		}
 	}
 
+	virtual void windowResized()
+	{
+		// The projection scale used for the LOD selection depends on the window height
+		updateUniformBuffer(true);
+	}
+
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
 			if (overlay->checkBox("Freeze frustum", &fixedFrustum)) {
 				updateUniformBuffer(true);
 			}
+			if (errorLodSelection) {
+				if (overlay->sliderFloat("LOD error (px)", &lodErrorThreshold, 0.25f, 16.0f)) {
+					updateUniformBuffer(false);
+				}
+			}
 		}
 		if (overlay->header("Statistics")) {
 			overlay->text("Visible objects: %d", indirectStats.drawCount);
-			for (uint32_t i = 0; i < MAX_LOD_LEVEL + 1; i++) {
-				overlay->text("LOD %d: %d", i, indirectStats.lodCount[i]);
+			for (uint32_t i = 0; i < lodPrimitive->lods.size(); i++) {
+				overlay->text("LOD %d (%d tris): %d", i, lodPrimitive->lods[i].indexCount / 3, indirectStats.lodCount[i]);
 			}
 		}
 	}
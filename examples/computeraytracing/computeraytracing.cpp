@@ -7,6 +7,7 @@
 */
 
 #include "vulkanexamplebase.h"
+#include "VulkanBVH.h"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define ENABLE_VALIDATION false
@@ -17,6 +18,9 @@
 #define TEX_DIM 2048
 #endif
 
+// Scenes with more spheres are only traced with the bounding volume hierarchy, testing all spheres per ray would take too long
+#define LINEAR_SPHERE_LIMIT 1000
+
 class VulkanExample : public VulkanExampleBase
 {
 public:
@@ -36,6 +40,7 @@ public:
 		struct {
 			vks::Buffer spheres;						// (Shader) storage buffer object with scene spheres
 			vks::Buffer planes;						// (Shader) storage buffer object with scene planes
+			vks::Buffer bvhNodes;					// (Shader) storage buffer object with the flattened bounding volume hierarchy over the spheres
 		} storageBuffers;
 		vks::Buffer uniformBuffer;					// Uniform buffer object containing scene data
 		VkQueue queue;								// Separate queue for compute commands (queue family may differ from the one used for graphics)
@@ -45,7 +50,9 @@ public:
 		VkDescriptorSetLayout descriptorSetLayout;	// Compute shader binding layout
 		VkDescriptorSet descriptorSet;				// Compute shader bindings
 		VkPipelineLayout pipelineLayout;			// Layout of the compute pipeline
-		VkPipeline pipeline;						// Compute raytracing pipeline
+		VkPipeline pipeline;						// Compute raytracing pipeline testing every sphere
+		VkPipeline pipelineBVH = VK_NULL_HANDLE;	// Compute raytracing pipeline traversing the bounding volume hierarchy
+		VkQueryPool queryPool = VK_NULL_HANDLE;		// Timestamps around the dispatch (if supported by the compute queue)
 		struct UBOCompute {							// Compute shader uniform block object
 			glm::vec3 lightPos;
 			float aspectRatio;						// Aspect ratio of the viewport
@@ -78,6 +85,18 @@ public:
 		glm::ivec3 _pad;
 	};
 
+	// The BVH pipeline needs the SPIR-V of raytracingbvh.comp
+	bool bvhAvailable = false;
+	bool useBVH = true;
+	// Number of spheres in the scene, the first one is the original scene
+	const std::vector<uint32_t> sceneSizes = { 3, 1000, 10000, 50000 };
+	int32_t sceneIndex = 0;
+	vks::bvh::Statistics bvhStatistics;
+
+	bool computeSubmitted = false;
+	float dispatchTime = 0.0f;
+	std::vector<std::string> benchmarkResults;
+
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
 	{
 		title = "Compute shader ray tracing";
@@ -101,6 +120,12 @@ public:
 
 		// Compute
 		vkDestroyPipeline(device, compute.pipeline, nullptr);
+		if (compute.pipelineBVH != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, compute.pipelineBVH, nullptr);
+		}
+		if (compute.queryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, compute.queryPool, nullptr);
+		}
 		vkDestroyPipelineLayout(device, compute.pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, compute.descriptorSetLayout, nullptr);
 		vkDestroyFence(device, compute.fence, nullptr);
@@ -108,6 +133,7 @@ public:
 		compute.uniformBuffer.destroy();
 		compute.storageBuffers.spheres.destroy();
 		compute.storageBuffers.planes.destroy();
+		compute.storageBuffers.bvhNodes.destroy();
 
 		textureComputeTarget.destroy();
 	}
@@ -263,11 +289,20 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(compute.commandBuffer, &cmdBufInfo));
 
-		vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
+		if (compute.queryPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(compute.commandBuffer, compute.queryPool, 0, 2);
+			vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, compute.queryPool, 0);
+		}
+
+		vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, useBVH ? compute.pipelineBVH : compute.pipeline);
 		vkCmdBindDescriptorSets(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSet, 0, 0);
 
 		vkCmdDispatch(compute.commandBuffer, textureComputeTarget.width / 16, textureComputeTarget.height / 16, 1);
 
+		if (compute.queryPool != VK_NULL_HANDLE) {
+			vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, compute.queryPool, 1);
+		}
+
 		vkEndCommandBuffer(compute.commandBuffer);
 	}
 
@@ -295,16 +330,9 @@ public:
 		return plane;
 	}
 
-	// Setup and fill the compute shader storage buffers containing primitives for the raytraced scene
-	void prepareStorageBuffers()
+	// Copy data to a new device local storage buffer
+	void createStorageBuffer(vks::Buffer* buffer, VkDeviceSize size, void* data)
 	{
-		// Spheres
-		std::vector<Sphere> spheres;
-		spheres.push_back(newSphere(glm::vec3(1.75f, -0.5f, 0.0f), 1.0f, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f));
-		spheres.push_back(newSphere(glm::vec3(0.0f, 1.0f, -0.5f), 1.0f, glm::vec3(0.65f, 0.77f, 0.97f), 32.0f));
-		spheres.push_back(newSphere(glm::vec3(-1.75f, -0.75f, -0.5f), 1.25f, glm::vec3(0.9f, 0.76f, 0.46f), 32.0f));
-		VkDeviceSize storageBufferSize = spheres.size() * sizeof(Sphere);
-
 		// Stage
 		vks::Buffer stagingBuffer;
 
@@ -312,25 +340,70 @@ public:
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			&stagingBuffer,
-			storageBufferSize,
-			spheres.data());
+			size,
+			data);
 
 		vulkanDevice->createBuffer(
 			// The SSBO will be used as a storage buffer for the compute pipeline and as a vertex buffer in the graphics pipeline
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&compute.storageBuffers.spheres,
-			storageBufferSize);
+			buffer,
+			size);
 
 		// Copy to staging buffer
 		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 		VkBufferCopy copyRegion = {};
-		copyRegion.size = storageBufferSize;
-		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, compute.storageBuffers.spheres.buffer, 1, &copyRegion);
+		copyRegion.size = size;
+		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, buffer->buffer, 1, &copyRegion);
 		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
 
 		stagingBuffer.destroy();
+	}
+
+	// Setup and fill the storage buffers with the spheres of the current scene and the bounding volume hierarchy over them
+	void prepareSpheres()
+	{
+		// Planes use the first ids
+		currentId = 6;
+
+		std::vector<Sphere> spheres;
+		spheres.push_back(newSphere(glm::vec3(1.75f, -0.5f, 0.0f), 1.0f, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f));
+		spheres.push_back(newSphere(glm::vec3(0.0f, 1.0f, -0.5f), 1.0f, glm::vec3(0.65f, 0.77f, 0.97f), 32.0f));
+		spheres.push_back(newSphere(glm::vec3(-1.75f, -0.75f, -0.5f), 1.25f, glm::vec3(0.9f, 0.76f, 0.46f), 32.0f));
+
+		// Larger scenes add small spheres scattered across the room, with a fixed seed so benchmark runs are comparable
+		const uint32_t sphereCount = sceneSizes[sceneIndex];
+		std::default_random_engine rndEngine(0);
+		std::uniform_real_distribution<float> rndPos(-3.5f, 3.5f);
+		std::uniform_real_distribution<float> rndColor(0.1f, 1.0f);
+		const float radius = glm::clamp(0.8f / std::cbrt(static_cast<float>(sphereCount)), 0.02f, 0.3f);
+		while (spheres.size() < sphereCount) {
+			const glm::vec3 pos(rndPos(rndEngine), rndPos(rndEngine), rndPos(rndEngine) * 0.7f - 1.0f);
+			const glm::vec3 color(rndColor(rndEngine), rndColor(rndEngine), rndColor(rndEngine));
+			spheres.push_back(newSphere(pos, radius, color, 32.0f));
+		}
 
+		// Build the hierarchy and store the spheres in its leaf order
+		std::vector<vks::bvh::Bounds> sphereBounds(spheres.size());
+		for (size_t i = 0; i < spheres.size(); i++) {
+			sphereBounds[i].min = spheres[i].pos - glm::vec3(spheres[i].radius);
+			sphereBounds[i].max = spheres[i].pos + glm::vec3(spheres[i].radius);
+		}
+		std::vector<uint32_t> sphereOrder;
+		std::vector<vks::bvh::Node> nodes = vks::bvh::build(sphereBounds, sphereOrder, vks::bvh::BuildSettings(), &bvhStatistics);
+		std::vector<Sphere> orderedSpheres(spheres.size());
+		for (size_t i = 0; i < sphereOrder.size(); i++) {
+			orderedSpheres[i] = spheres[sphereOrder[i]];
+		}
+		std::cout << "BVH over " << spheres.size() << " spheres: " << bvhStatistics.nodeCount << " nodes, " << bvhStatistics.leafCount << " leaves, depth " << bvhStatistics.depth << ", SAH cost " << bvhStatistics.sahCost << ", built in " << bvhStatistics.buildTime << " ms" << std::endl;
+
+		createStorageBuffer(&compute.storageBuffers.spheres, orderedSpheres.size() * sizeof(Sphere), orderedSpheres.data());
+		createStorageBuffer(&compute.storageBuffers.bvhNodes, nodes.size() * sizeof(vks::bvh::Node), nodes.data());
+	}
+
+	// Setup and fill the compute shader storage buffers containing primitives for the raytraced scene
+	void prepareStorageBuffers()
+	{
 		// Planes
 		std::vector<Plane> planes;
 		const float roomDim = 4.0f;
@@ -340,30 +413,39 @@ public:
 		planes.push_back(newPlane(glm::vec3(0.0f, 0.0f, -1.0f), roomDim, glm::vec3(0.0f), 32.0f));
 		planes.push_back(newPlane(glm::vec3(-1.0f, 0.0f, 0.0f), roomDim, glm::vec3(1.0f, 0.0f, 0.0f), 32.0f));
 		planes.push_back(newPlane(glm::vec3(1.0f, 0.0f, 0.0f), roomDim, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f));
-		storageBufferSize = planes.size() * sizeof(Plane);
-
-		// Stage
-		vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			storageBufferSize,
-			planes.data());
+		createStorageBuffer(&compute.storageBuffers.planes, planes.size() * sizeof(Plane), planes.data());
 
-		vulkanDevice->createBuffer(
-			// The SSBO will be used as a storage buffer for the compute pipeline and as a vertex buffer in the graphics pipeline
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&compute.storageBuffers.planes,
-			storageBufferSize);
-
-		// Copy to staging buffer
-		copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		copyRegion.size = storageBufferSize;
-		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, compute.storageBuffers.planes.buffer, 1, &copyRegion);
-		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
+		// Spheres
+		prepareSpheres();
+	}
 
-		stagingBuffer.destroy();
+	// Recreates the sphere and hierarchy buffers after the scene size changed
+	void changeScene()
+	{
+		vkWaitForFences(device, 1, &compute.fence, VK_TRUE, UINT64_MAX);
+		compute.storageBuffers.spheres.destroy();
+		compute.storageBuffers.bvhNodes.destroy();
+		prepareSpheres();
+		std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets =
+		{
+			// Binding 2: Shader storage buffer for the spheres
+			vks::initializers::writeDescriptorSet(
+				compute.descriptorSet,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				2,
+				&compute.storageBuffers.spheres.descriptor),
+			// Binding 4: Shader storage buffer for the bounding volume hierarchy
+			vks::initializers::writeDescriptorSet(
+				compute.descriptorSet,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				4,
+				&compute.storageBuffers.bvhNodes.descriptor)
+		};
+		vkUpdateDescriptorSets(device, computeWriteDescriptorSets.size(), computeWriteDescriptorSets.data(), 0, NULL);
+		if (sceneSizes[sceneIndex] > LINEAR_SPHERE_LIMIT) {
+			useBVH = true;
+		}
+		buildComputeCommandBuffer();
 	}
 
 	void setupDescriptorPool()
@@ -373,7 +455,7 @@ public:
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),			// Compute UBO
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4),	// Graphics image samplers
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1),				// Storage image for ray traced image output
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2),			// Storage buffer for the scene primitives
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3),			// Storage buffers for the scene primitives and the bounding volume hierarchy
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolInfo =
@@ -551,7 +633,12 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
-				3)
+				3),
+			// Binding 4: Shader storage buffer for the bounding volume hierarchy
+			vks::initializers::descriptorSetLayoutBinding(
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				4)
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout =
@@ -601,7 +688,13 @@ public:
 				compute.descriptorSet,
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				3,
-				&compute.storageBuffers.planes.descriptor)
+				&compute.storageBuffers.planes.descriptor),
+			// Binding 4: Shader storage buffer for the bounding volume hierarchy
+			vks::initializers::writeDescriptorSet(
+				compute.descriptorSet,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				4,
+				&compute.storageBuffers.bvhNodes.descriptor)
 		};
 
 		vkUpdateDescriptorSets(device, computeWriteDescriptorSets.size(), computeWriteDescriptorSets.data(), 0, NULL);
@@ -615,6 +708,23 @@ public:
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computeraytracing/raytracing.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipeline));
 
+		const std::string bvhShader = getShadersPath() + "computeraytracing/raytracingbvh.comp.spv";
+		bvhAvailable = vks::tools::shaderAvailable(bvhShader);
+		if (bvhAvailable) {
+			computePipelineCreateInfo.stage = loadShader(bvhShader, VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineBVH));
+		}
+		useBVH = bvhAvailable;
+
+		// Timestamps are only written if the compute queue family supports them
+		if (vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.compute].timestampValidBits > 0) {
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = 2;
+			VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &compute.queryPool));
+		}
+
 		// Separate command pool as queue family for compute may be different than graphics
 		VkCommandPoolCreateInfo cmdPoolInfo = {};
 		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -677,6 +787,9 @@ public:
 		// Submit compute commands
 		// Use a fence to ensure that compute command buffer has finished executing before using it again
 		vkWaitForFences(device, 1, &compute.fence, VK_TRUE, UINT64_MAX);
+		if (computeSubmitted) {
+			getDispatchTime();
+		}
 		vkResetFences(device, 1, &compute.fence);
 
 		VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
@@ -684,6 +797,79 @@ public:
 		computeSubmitInfo.pCommandBuffers = &compute.commandBuffer;
 
 		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, compute.fence));
+		computeSubmitted = true;
+	}
+
+	// Reads the timestamps of the last finished dispatch
+	void getDispatchTime()
+	{
+		if (compute.queryPool == VK_NULL_HANDLE) {
+			return;
+		}
+		uint64_t timestamps[2] = { 0, 0 };
+		if (vkGetQueryPoolResults(device, compute.queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+			return;
+		}
+		const uint32_t validBits = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.compute].timestampValidBits;
+		const uint64_t mask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+		const uint64_t ticks = ((timestamps[1] & mask) - (timestamps[0] & mask)) & mask;
+		dispatchTime = static_cast<float>(ticks * static_cast<double>(deviceProperties.limits.timestampPeriod) / 1000000.0);
+	}
+
+	// Submits the compute command buffer and waits for it, returns the duration of the dispatch in ms (measured on the host if there are no timestamps)
+	double dispatchAndWait()
+	{
+		vkWaitForFences(device, 1, &compute.fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(device, 1, &compute.fence);
+		VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
+		computeSubmitInfo.commandBufferCount = 1;
+		computeSubmitInfo.pCommandBuffers = &compute.commandBuffer;
+		auto tStart = std::chrono::high_resolution_clock::now();
+		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, compute.fence));
+		vkWaitForFences(device, 1, &compute.fence, VK_TRUE, UINT64_MAX);
+		if (compute.queryPool == VK_NULL_HANDLE) {
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		}
+		getDispatchTime();
+		return dispatchTime;
+	}
+
+	// Traces every scene size with linear sphere tests and with the hierarchy and reports the average dispatch times
+	void runScalingBenchmark()
+	{
+		const uint32_t warmupRuns = 2;
+		const uint32_t measuredRuns = 8;
+		const int32_t previousSceneIndex = sceneIndex;
+		const bool previousUseBVH = useBVH;
+		benchmarkResults.clear();
+		std::cout << "Compute ray tracing scaling benchmark (" << textureComputeTarget.width << "x" << textureComputeTarget.height << ", " << (compute.queryPool != VK_NULL_HANDLE ? "GPU timestamps" : "host time") << ")" << std::endl;
+		for (int32_t i = 0; i < static_cast<int32_t>(sceneSizes.size()); i++) {
+			sceneIndex = i;
+			changeScene();
+			for (uint32_t mode = 0; mode < 2; mode++) {
+				const bool bvh = (mode == 1);
+				if ((bvh && !bvhAvailable) || (!bvh && sceneSizes[i] > LINEAR_SPHERE_LIMIT)) {
+					continue;
+				}
+				useBVH = bvh;
+				buildComputeCommandBuffer();
+				double totalTime = 0.0;
+				for (uint32_t run = 0; run < warmupRuns + measuredRuns; run++) {
+					const double time = dispatchAndWait();
+					if (run >= warmupRuns) {
+						totalTime += time;
+					}
+				}
+				std::stringstream result;
+				result << sceneSizes[i] << " spheres, " << (bvh ? "BVH" : "linear") << ": " << std::fixed << std::setprecision(3) << totalTime / measuredRuns << " ms";
+				std::cout << result.str() << std::endl;
+				benchmarkResults.push_back(result.str());
+			}
+		}
+		sceneIndex = previousSceneIndex;
+		changeScene();
+		useBVH = previousUseBVH;
+		buildComputeCommandBuffer();
 	}
 
 	void prepare()
@@ -717,6 +903,44 @@ public:
 		compute.ubo.aspectRatio = (float)width / (float)height;
 		updateUniformBuffers();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			// Without the hierarchy only scenes that can be traced linearly are offered
+			std::vector<std::string> sceneItems;
+			for (auto sceneSize : sceneSizes) {
+				if (bvhAvailable || (sceneSize <= LINEAR_SPHERE_LIMIT)) {
+					sceneItems.push_back(std::to_string(sceneSize) + " spheres");
+				}
+			}
+			if (overlay->comboBox("Scene", &sceneIndex, sceneItems)) {
+				changeScene();
+			}
+			if (bvhAvailable) {
+				if (overlay->checkBox("BVH traversal", &useBVH)) {
+					if (sceneSizes[sceneIndex] > LINEAR_SPHERE_LIMIT) {
+						useBVH = true;
+					}
+					vkWaitForFences(device, 1, &compute.fence, VK_TRUE, UINT64_MAX);
+					buildComputeCommandBuffer();
+				}
+			}
+			if (overlay->button("Run scaling benchmark")) {
+				runScalingBenchmark();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			if (compute.queryPool != VK_NULL_HANDLE) {
+				overlay->text("Dispatch: %.2f ms", dispatchTime);
+			}
+			overlay->text("BVH: %d nodes, depth %d", bvhStatistics.nodeCount, bvhStatistics.depth);
+			overlay->text("BVH build: %.2f ms", bvhStatistics.buildTime);
+			for (auto& result : benchmarkResults) {
+				overlay->text("%s", result.c_str());
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
\ No newline at end of file
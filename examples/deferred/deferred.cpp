@@ -8,6 +8,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanLightClusters.h"
 
 #define ENABLE_VALIDATION false
 
@@ -18,6 +19,9 @@
 // Offscreen frame buffer properties
 #define FB_DIM TEX_DIM
 
+// Maximum number of lights with clustered shading
+#define MAX_LIGHT_COUNT 4096
+
 class VulkanExample : public VulkanExampleBase
 {
 public:
@@ -56,6 +60,8 @@ public:
 		Light lights[6];
 		glm::vec4 viewPos;
 		int debugDisplayTarget = 0;
+		// Used to reconstruct positions from depth with the packed G-Buffer layout
+		alignas(16) glm::mat4 invViewProjection;
 	} uboComposition;
 
 	struct {
@@ -63,6 +69,19 @@ public:
 		vks::Buffer composition;
 	} uniformBuffers;
 
+	// With clustered shading lights are assigned to clusters of the view frustum in a compute pass, and the composition only evaluates the lights of a fragment's cluster
+	vks::LightClusters* lightClusters = nullptr;
+	bool clusteredShading = false;
+	int32_t lightCount = 6;
+	// Additional lights for clustered shading, w is the phase of the animation
+	std::vector<vks::LightClusters::Light> additionalLights;
+
+	// The packed G-Buffer layout (selected with "-gb packed") drops the position target and reconstructs positions from depth instead,
+	// normals are octahedron encoded into a 10 bit per channel target
+	bool packedGBuffer = false;
+	// Size of the G-Buffer color targets in bytes per pixel
+	uint32_t gBufferColorSize = 0;
+
 	struct {
 		VkPipeline offscreen;
 		VkPipeline composition;
@@ -111,6 +130,7 @@ public:
 		camera.position = { 2.15f, 0.3f, -8.75f };
 		camera.setRotation(glm::vec3(-0.75f, 12.5f, 0.0f));
 		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
+		packedGBuffer = (commandLineParser.getValueAsString("gbuffer", "full") == "packed");
 	}
 
 	~VulkanExample()
@@ -123,9 +143,11 @@ public:
 		// Frame buffer
 
 		// Color attachments
-		vkDestroyImageView(device, offScreenFrameBuf.position.view, nullptr);
-		vkDestroyImage(device, offScreenFrameBuf.position.image, nullptr);
-		vkFreeMemory(device, offScreenFrameBuf.position.mem, nullptr);
+		if (!packedGBuffer) {
+			vkDestroyImageView(device, offScreenFrameBuf.position.view, nullptr);
+			vkDestroyImage(device, offScreenFrameBuf.position.image, nullptr);
+			vkFreeMemory(device, offScreenFrameBuf.position.mem, nullptr);
+		}
 
 		vkDestroyImageView(device, offScreenFrameBuf.normal.view, nullptr);
 		vkDestroyImage(device, offScreenFrameBuf.normal.image, nullptr);
@@ -161,6 +183,8 @@ public:
 		textures.floor.normalMap.destroy();
 
 		vkDestroySemaphore(device, offscreenSemaphore, nullptr);
+
+		delete lightClusters;
 	}
 
 	// Enable physical device features required for this example
@@ -190,7 +214,11 @@ public:
 		}
 		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
 		{
-			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			// Only add the stencil aspect for formats that have one, as depth only formats can be sampled through this view
+			if (format >= VK_FORMAT_D16_UNORM_S8_UINT) {
+				aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+			}
 			imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		}
 
@@ -239,17 +267,28 @@ public:
 
 		// Color attachments
 
-		// (World space) Positions
-		createAttachment(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			&offScreenFrameBuf.position);
-
-		// (World space) Normals
-		createAttachment(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			&offScreenFrameBuf.normal);
+		if (packedGBuffer)
+		{
+			// Octahedron encoded (world space) normals
+			createAttachment(
+				VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				&offScreenFrameBuf.normal);
+		}
+		else
+		{
+			// (World space) Positions
+			createAttachment(
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				&offScreenFrameBuf.position);
+
+			// (World space) Normals
+			createAttachment(
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				&offScreenFrameBuf.normal);
+		}
 
 		// Albedo (color)
 		createAttachment(
@@ -260,8 +299,9 @@ public:
 		// Depth attachment
 
 		// Find a suitable depth format
+		// The packed layout samples depth in the composition, which requires a depth only format
 		VkFormat attDepthFormat;
-		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
+		VkBool32 validDepthFormat = packedGBuffer ? vks::tools::getSupportedSampledDepthFormat(physicalDevice, &attDepthFormat) : vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
 		createAttachment(
@@ -269,42 +309,48 @@ public:
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 			&offScreenFrameBuf.depth);
 
+		std::vector<FrameBufferAttachment*> colorAttachments;
+		if (!packedGBuffer) {
+			colorAttachments.push_back(&offScreenFrameBuf.position);
+		}
+		colorAttachments.push_back(&offScreenFrameBuf.normal);
+		colorAttachments.push_back(&offScreenFrameBuf.albedo);
+		const uint32_t depthAttachmentIndex = static_cast<uint32_t>(colorAttachments.size());
+		gBufferColorSize = packedGBuffer ? 4 + 4 : 8 + 8 + 4;
+
 		// Set up separate renderpass with references to the color and depth attachments
-		std::array<VkAttachmentDescription, 4> attachmentDescs = {};
+		std::vector<VkAttachmentDescription> attachmentDescs(colorAttachments.size() + 1);
 
 		// Init attachment properties
-		for (uint32_t i = 0; i < 4; ++i)
+		for (uint32_t i = 0; i < attachmentDescs.size(); ++i)
 		{
 			attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
 			attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 			attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			if (i == 3)
+			if (i == depthAttachmentIndex)
 			{
+				attachmentDescs[i].format = offScreenFrameBuf.depth.format;
 				attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				attachmentDescs[i].finalLayout = packedGBuffer ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 			}
 			else
 			{
+				attachmentDescs[i].format = colorAttachments[i]->format;
 				attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 				attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 			}
 		}
 
-		// Formats
-		attachmentDescs[0].format = offScreenFrameBuf.position.format;
-		attachmentDescs[1].format = offScreenFrameBuf.normal.format;
-		attachmentDescs[2].format = offScreenFrameBuf.albedo.format;
-		attachmentDescs[3].format = offScreenFrameBuf.depth.format;
-
 		std::vector<VkAttachmentReference> colorReferences;
-		colorReferences.push_back({ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+		for (uint32_t i = 0; i < depthAttachmentIndex; ++i)
+		{
+			colorReferences.push_back({ i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+		}
 
 		VkAttachmentReference depthReference = {};
-		depthReference.attachment = 3;
+		depthReference.attachment = depthAttachmentIndex;
 		depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 		VkSubpassDescription subpass = {};
@@ -332,6 +378,15 @@ public:
 		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
+		// With the packed layout the depth attachment is also sampled by the composition
+		if (packedGBuffer)
+		{
+			dependencies[0].dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[1].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[1].srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		}
+
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.pAttachments = attachmentDescs.data();
@@ -343,11 +398,12 @@ public:
 
 		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &offScreenFrameBuf.renderPass));
 
-		std::array<VkImageView,4> attachments;
-		attachments[0] = offScreenFrameBuf.position.view;
-		attachments[1] = offScreenFrameBuf.normal.view;
-		attachments[2] = offScreenFrameBuf.albedo.view;
-		attachments[3] = offScreenFrameBuf.depth.view;
+		std::vector<VkImageView> attachments;
+		for (auto attachment : colorAttachments)
+		{
+			attachments.push_back(attachment->view);
+		}
+		attachments.push_back(offScreenFrameBuf.depth.view);
 
 		VkFramebufferCreateInfo fbufCreateInfo = {};
 		fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -391,11 +447,12 @@ public:
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		// Clear values for all attachments written in the fragment shader
-		std::array<VkClearValue,4> clearValues;
-		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[3].depthStencil = { 1.0f, 0 };
+		std::vector<VkClearValue> clearValues(packedGBuffer ? 3 : 4);
+		for (size_t i = 0; i < clearValues.size() - 1; i++)
+		{
+			clearValues[i].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		}
+		clearValues.back().depthStencil = { 1.0f, 0 };
 
 		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
 		renderPassBeginInfo.renderPass =  offScreenFrameBuf.renderPass;
@@ -407,6 +464,11 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(offScreenCmdBuffer, &cmdBufInfo));
 
+		// Assign the lights to clusters, the results are read by the composition pass
+		if (clusteredShading) {
+			lightClusters->record(offScreenCmdBuffer);
+		}
+
 		vkCmdBeginRenderPass(offScreenCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		VkViewport viewport = vks::initializers::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
@@ -491,8 +553,10 @@ public:
 	void setupDescriptorPool()
 	{
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 8),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 9)
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 9),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 9),
+			// All sets share the layout with the light cluster bindings
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 9)
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 3);
@@ -505,7 +569,7 @@ public:
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 			// Binding 0 : Vertex shader uniform buffer
 			vks::initializers::descriptorSetLayoutBinding( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-			// Binding 1 : Position texture target / Scene colormap
+			// Binding 1 : Position (depth with the packed layout) texture target / Scene colormap
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
 			// Binding 2 : Normals texture target
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
@@ -514,6 +578,10 @@ public:
 			// Binding 4 : Fragment shader uniform buffer
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
 		};
+		// Binding 5..8 : Light clusters
+		if (clusteredShading) {
+			lightClusters->getSetLayoutBindings(setLayoutBindings, 5, VK_SHADER_STAGE_FRAGMENT_BIT);
+		}
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &descriptorSetLayout));
@@ -529,11 +597,12 @@ public:
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
 		// Image descriptors for the offscreen color attachments
+		// The packed layout reconstructs positions from depth
 		VkDescriptorImageInfo texDescriptorPosition =
 			vks::initializers::descriptorImageInfo(
 				colorSampler,
-				offScreenFrameBuf.position.view,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				packedGBuffer ? offScreenFrameBuf.depth.view : offScreenFrameBuf.position.view,
+				packedGBuffer ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorNormal =
 			vks::initializers::descriptorImageInfo(
@@ -559,6 +628,10 @@ public:
 			// Binding 4 : Fragment shader uniform buffer
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &uniformBuffers.composition.descriptor),
 		};
+		// Binding 5..8 : Light clusters
+		if (clusteredShading) {
+			lightClusters->getWriteDescriptorSets(writeDescriptorSets, descriptorSet, 5);
+		}
 		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
 		// Offscreen (scene)
@@ -615,7 +688,18 @@ public:
 		// Final fullscreen composition pass pipeline
 		rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
 		shaderStages[0] = loadShader(getShadersPath() + "deferred/deferred.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferred/deferred.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		if (clusteredShading) {
+			shaderStages[1] = loadShader(getShadersPath() + "deferred/deferred_clustered.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		} else {
+			shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferred/deferred_packed.frag.spv" : "deferred/deferred.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
+		}
+		// The clustered composition selects the G-Buffer layout with a specialization constant
+		VkBool32 specializationData = packedGBuffer;
+		VkSpecializationMapEntry specializationEntry = vks::initializers::specializationMapEntry(0, 0, sizeof(VkBool32));
+		VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationEntry, sizeof(specializationData), &specializationData);
+		if (clusteredShading) {
+			shaderStages[1].pSpecializationInfo = &specializationInfo;
+		}
 		// Empty vertex input state, vertices are generated by the vertex shader
 		VkPipelineVertexInputStateCreateInfo emptyInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
 		pipelineCI.pVertexInputState = &emptyInputState;
@@ -627,7 +711,7 @@ public:
 
 		// Offscreen pipeline
 		shaderStages[0] = loadShader(getShadersPath() + "deferred/mrt.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferred/mrt.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferred/mrt_packed.frag.spv" : "deferred/mrt.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 
 		// Separate render pass
 		pipelineCI.renderPass = offScreenFrameBuf.renderPass;
@@ -635,11 +719,7 @@ public:
 		// Blend attachment states required for all color attachments
 		// This is important, as color write mask will otherwise be 0x0 and you
 		// won't see anything rendered to the attachment
-		std::array<VkPipelineColorBlendAttachmentState, 3> blendAttachmentStates = {
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE)
-		};
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachmentStates(packedGBuffer ? 2 : 3, vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE));
 
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
@@ -735,7 +815,47 @@ public:
 
 		uboComposition.debugDisplayTarget = debugDisplayTarget;
 
+		uboComposition.invViewProjection = glm::inverse(camera.matrices.perspective * camera.matrices.view);
+
 		memcpy(uniformBuffers.composition.mapped, &uboComposition, sizeof(uboComposition));
+
+		if (clusteredShading) {
+			// The first lights are those of the regular composition, the additional ones float up and down around their origin
+			lightClusters->lights.resize(lightCount);
+			for (int32_t i = 0; i < lightCount; i++) {
+				if (i < 6) {
+					lightClusters->lights[i] = { uboComposition.lights[i].position, uboComposition.lights[i].color, uboComposition.lights[i].radius };
+				} else {
+					vks::LightClusters::Light light = additionalLights[i - 6];
+					light.position.y += sin(glm::radians(360.0f * timer) + light.position.w) * 0.5f;
+					light.position.w = 0.0f;
+					lightClusters->lights[i] = light;
+				}
+			}
+			updateLightClusters();
+		}
+	}
+
+	void updateLightClusters()
+	{
+		lightClusters->update(camera.matrices.view, camera.matrices.perspective, camera.getNearClip(), camera.getFarClip(), (float)width, (float)height);
+	}
+
+	// Randomly distribute the additional lights used with clustered shading over the scene
+	void prepareAdditionalLights()
+	{
+		std::default_random_engine rndEngine(benchmark.active ? 0 : (unsigned)time(nullptr));
+		std::uniform_real_distribution<float> rndPosition(-8.0f, 8.0f);
+		std::uniform_real_distribution<float> rndHeight(-2.0f, -0.2f);
+		std::uniform_real_distribution<float> rndColor(0.2f, 1.0f);
+		std::uniform_real_distribution<float> rndRadius(1.0f, 3.0f);
+		std::uniform_real_distribution<float> rndPhase(0.0f, glm::radians(360.0f));
+		additionalLights.resize(MAX_LIGHT_COUNT - 6);
+		for (auto& light : additionalLights) {
+			light.position = glm::vec4(rndPosition(rndEngine), rndHeight(rndEngine), rndPosition(rndEngine) - 2.0f, rndPhase(rndEngine));
+			light.color = glm::vec3(rndColor(rndEngine), rndColor(rndEngine), rndColor(rndEngine));
+			light.radius = rndRadius(rndEngine);
+		}
 	}
 
 	void draw()
@@ -783,7 +903,23 @@ public:
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
+		if (packedGBuffer && !(vks::tools::shaderAvailable(getShadersPath() + "deferred/mrt_packed.frag.spv") && vks::tools::shaderAvailable(getShadersPath() + "deferred/deferred_packed.frag.spv"))) {
+			std::cerr << "Packed G-Buffer shaders not found, using the full G-Buffer layout\n";
+			packedGBuffer = false;
+		}
 		prepareOffscreenFramebuffer();
+		// Clustered shading needs the light assignment compute shader and the clustered variant of the composition shader
+		// Both are checked first, so no cluster resources are created if either is missing
+		clusteredShading = vks::LightClusters::isSupported(getShadersPath() + "base/") && vks::tools::shaderAvailable(getShadersPath() + "deferred/deferred_clustered.frag.spv");
+		if (clusteredShading) {
+			lightClusters = new vks::LightClusters(vulkanDevice, MAX_LIGHT_COUNT, getShadersPath() + "base/");
+			clusteredShading = lightClusters->isAvailable();
+		}
+		if (clusteredShading) {
+			prepareAdditionalLights();
+		} else {
+			std::cerr << "Clustered shading shaders not found, using the six composition lights\n";
+		}
 		prepareUniformBuffers();
 		setupDescriptorSetLayout();
 		preparePipelines();
@@ -805,14 +941,30 @@ public:
 		}
 		if (camera.updated)
 		{
-			updateUniformBufferOffscreen();	
+			updateUniformBufferOffscreen();
+			if (clusteredShading) {
+				updateLightClusters();
+			}	
+			// Positions are reconstructed with the inverse view projection of the composition
+			if (packedGBuffer) {
+				updateUniformBufferComposition();
+			}
 		}
 	}
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
-			if (overlay->comboBox("Display", &debugDisplayTarget, {"Final composition", "Position", "Normals", "Albedo", "Specular" }))
+			overlay->text("G-Buffer: %s layout, %d bytes per pixel + depth", packedGBuffer ? "packed" : "full", gBufferColorSize);
+			std::vector<std::string> displayTargets = { "Final composition", "Position", "Normals", "Albedo", "Specular" };
+			if (clusteredShading) {
+				displayTargets.push_back("Lights per cluster");
+			}
+			if (overlay->comboBox("Display", &debugDisplayTarget, displayTargets))
+			{
+				updateUniformBufferComposition();
+			}
+			if (clusteredShading && overlay->sliderInt("Lights", &lightCount, 6, MAX_LIGHT_COUNT))
 			{
 				updateUniformBufferComposition();
 			}
@@ -27,6 +27,12 @@ public:
 	bool useSampleShading = true;
 	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
 
+	// The packed G-Buffer layout (selected with "-gb packed") drops the position target and reconstructs positions from depth instead,
+	// normals are octahedron encoded into a 10 bit per channel target
+	bool packedGBuffer = false;
+	// Size of the G-Buffer color targets in bytes per sample
+	uint32_t gBufferColorSize = 0;
+
 	struct {
 		struct {
 			vks::Texture2D colorMap;
@@ -60,6 +66,8 @@ public:
 		Light lights[6];
 		glm::vec4 viewPos;
 		int32_t debugDisplayTarget = 0;
+		// Used to reconstruct positions from depth with the packed G-Buffer layout
+		alignas(16) glm::mat4 invViewProjection;
 	} uboComposition;
 
 	struct {
@@ -102,6 +110,7 @@ public:
 		camera.setRotation(glm::vec3(-0.75f, 12.5f, 0.0f));
 		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
 		paused = true;
+		packedGBuffer = (commandLineParser.getValueAsString("gbuffer", "full") == "packed");
 	}
 
 	~VulkanExample()
@@ -157,7 +166,7 @@ public:
 		offscreenframeBuffers->width = FB_DIM;
 		offscreenframeBuffers->height = FB_DIM;
 
-		// Four attachments (3 color, 1 depth)
+		// Four attachments (3 color, 1 depth) or three with the packed layout (2 color, 1 depth)
 		vks::AttachmentCreateInfo attachmentInfo = {};
 		attachmentInfo.width = FB_DIM;
 		attachmentInfo.height = FB_DIM;
@@ -166,26 +175,38 @@ public:
 		attachmentInfo.imageSampleCount = sampleCount;
 
 		// Color attachments
-		// Attachment 0: (World space) Positions
-		attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		offscreenframeBuffers->addAttachment(attachmentInfo);
+		if (packedGBuffer)
+		{
+			// Attachment 0: Octahedron encoded (world space) normals
+			attachmentInfo.format = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+			offscreenframeBuffers->addAttachment(attachmentInfo);
+		}
+		else
+		{
+			// Attachment 0: (World space) Positions
+			attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			offscreenframeBuffers->addAttachment(attachmentInfo);
 
-		// Attachment 1: (World space) Normals
-		attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		offscreenframeBuffers->addAttachment(attachmentInfo);
+			// Attachment 1: (World space) Normals
+			attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			offscreenframeBuffers->addAttachment(attachmentInfo);
+		}
 
-		// Attachment 2: Albedo (color)
+		// Attachment 2 (1 with the packed layout): Albedo (color)
 		attachmentInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
 		offscreenframeBuffers->addAttachment(attachmentInfo);
 
+		gBufferColorSize = packedGBuffer ? 4 + 4 : 8 + 8 + 4;
+
 		// Depth attachment
 		// Find a suitable depth format
+		// The packed layout fetches depth samples in the composition to reconstruct positions, which requires a depth only format
 		VkFormat attDepthFormat;
-		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
+		VkBool32 validDepthFormat = packedGBuffer ? vks::tools::getSupportedSampledDepthFormat(physicalDevice, &attDepthFormat) : vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
 		attachmentInfo.format = attDepthFormat;
-		attachmentInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		attachmentInfo.usage = packedGBuffer ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 		offscreenframeBuffers->addAttachment(attachmentInfo);
 
 		// Create sampler to sample from the color attachments
@@ -211,10 +232,15 @@ public:
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		// Clear values for all attachments written in the fragment shader
-		std::array<VkClearValue,4> clearValues;
-		clearValues[0].color = clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[3].depthStencil = { 1.0f, 0 };
+		std::vector<VkClearValue> clearValues(offscreenframeBuffers->attachments.size());
+		for (size_t i = 0; i < clearValues.size(); i++)
+		{
+			if (offscreenframeBuffers->attachments[i].isDepthStencil()) {
+				clearValues[i].depthStencil = { 1.0f, 0 };
+			} else {
+				clearValues[i].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+			}
+		}
 
 		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
 		renderPassBeginInfo.renderPass = offscreenframeBuffers->renderPass;
@@ -351,28 +377,29 @@ public:
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
 		// Image descriptors for the offscreen color attachments
+		// The packed layout has no position attachment, positions are reconstructed from depth (the last attachment)
 		VkDescriptorImageInfo texDescriptorPosition =
 			vks::initializers::descriptorImageInfo(
 				offscreenframeBuffers->sampler,
-				offscreenframeBuffers->attachments[0].view,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				packedGBuffer ? offscreenframeBuffers->attachments[2].view : offscreenframeBuffers->attachments[0].view,
+				packedGBuffer ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorNormal =
 			vks::initializers::descriptorImageInfo(
 				offscreenframeBuffers->sampler,
-				offscreenframeBuffers->attachments[1].view,
+				offscreenframeBuffers->attachments[packedGBuffer ? 0 : 1].view,
 				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorAlbedo =
 			vks::initializers::descriptorImageInfo(
 				offscreenframeBuffers->sampler,
-				offscreenframeBuffers->attachments[2].view,
+				offscreenframeBuffers->attachments[packedGBuffer ? 1 : 2].view,
 				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		// Deferred composition
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
 		writeDescriptorSets = {
-			// Binding 1: World space position texture
+			// Binding 1: World space position texture (depth with the packed layout)
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &texDescriptorPosition),
 			// Binding 2: World space normals texture
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &texDescriptorNormal),
@@ -458,7 +485,7 @@ public:
 
 		// With MSAA
 		shaderStages[0] = loadShader(getShadersPath() + "deferredmultisampling/deferred.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferredmultisampling/deferred.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferredmultisampling/deferred_packed.frag.spv" : "deferredmultisampling/deferred.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 		shaderStages[1].pSpecializationInfo = &specializationInfo;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.deferred));
 
@@ -475,7 +502,7 @@ public:
 		pipelineCI.renderPass = offscreenframeBuffers->renderPass;
 
 		shaderStages[0] = loadShader(getShadersPath() + "deferredmultisampling/mrt.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferredmultisampling/mrt.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferredmultisampling/mrt_packed.frag.spv" : "deferredmultisampling/mrt.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 
 		//rasterizationState.polygonMode = VK_POLYGON_MODE_LINE;
 		//rasterizationState.lineWidth = 2.0f;
@@ -485,11 +512,7 @@ public:
 		// Blend attachment states required for all color attachments
 		// This is important, as color write mask will otherwise be 0x0 and you
 		// won't see anything rendered to the attachment
-		std::array<VkPipelineColorBlendAttachmentState, 3> blendAttachmentStates = {
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE)
-		};
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachmentStates(packedGBuffer ? 2 : 3, vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE));
 
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
@@ -586,6 +609,7 @@ public:
 		// Current view position
 		uboComposition.viewPos = glm::vec4(camera.position, 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 		uboComposition.debugDisplayTarget = debugDisplayTarget;
+		uboComposition.invViewProjection = glm::inverse(camera.matrices.perspective * camera.matrices.view);
 
 		memcpy(uniformBuffers.composition.mapped, &uboComposition, sizeof(uboComposition));
 	}
@@ -623,6 +647,10 @@ public:
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
+		if (packedGBuffer && !(vks::tools::shaderAvailable(getShadersPath() + "deferredmultisampling/mrt_packed.frag.spv") && vks::tools::shaderAvailable(getShadersPath() + "deferredmultisampling/deferred_packed.frag.spv"))) {
+			std::cerr << "Packed G-Buffer shaders not found, using the full G-Buffer layout\n";
+			packedGBuffer = false;
+		}
 		sampleCount = getMaxUsableSampleCount();
 		loadAssets();
 		deferredSetup();
@@ -644,12 +672,17 @@ public:
 		if (camera.updated) 
 		{
 			updateUniformBufferOffscreen();
+			// Positions are reconstructed with the inverse view projection of the composition
+			if (packedGBuffer) {
+				updateUniformBufferDeferredLights();
+			}
 		}
 	}
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
+			overlay->text("G-Buffer: %s layout, %d bytes per sample + depth", packedGBuffer ? "packed" : "full", gBufferColorSize);
 			if (overlay->comboBox("Display", &debugDisplayTarget, { "Final composition", "Position", "Normals", "Albedo", "Specular" }))
 			{
 				updateUniformBufferDeferredLights();
@@ -669,6 +702,10 @@ public:
 	VkSampleCountFlagBits getMaxUsableSampleCount()
 	{
 		VkSampleCountFlags counts = std::min(deviceProperties.limits.framebufferColorSampleCounts, deviceProperties.limits.framebufferDepthSampleCounts);
+		// The packed G-Buffer layout samples the multi sampled depth attachment
+		if (packedGBuffer) {
+			counts &= deviceProperties.limits.sampledImageDepthSampleCounts;
+		}
 		if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
 		if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
 		if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
@@ -48,6 +48,12 @@ public:
 	float depthBiasConstant = 1.25f;
 	float depthBiasSlope = 1.75f;
 
+	// The packed G-Buffer layout (selected with "-gb packed") drops the position target and reconstructs positions from depth instead,
+	// normals are octahedron encoded into a 10 bit per channel target
+	bool packedGBuffer = false;
+	// Size of the G-Buffer color targets in bytes per pixel
+	uint32_t gBufferColorSize = 0;
+
 	struct {
 		struct {
 			vks::Texture2D colorMap;
@@ -92,6 +98,8 @@ public:
 		Light lights[LIGHT_COUNT];
 		uint32_t useShadows = 1;
 		int32_t debugDisplayTarget = 0;
+		// Used to reconstruct positions from depth with the packed G-Buffer layout
+		alignas(16) glm::mat4 invViewProjection;
 	} uboComposition;
 
 	struct {
@@ -146,6 +154,7 @@ public:
 		camera.setPerspective(60.0f, (float)width / (float)height, zNear, zFar);
 		timerSpeed *= 0.25f;
 		paused = true;
+		packedGBuffer = (commandLineParser.getValueAsString("gbuffer", "full") == "packed");
 	}
 
 	~VulkanExample()
@@ -246,7 +255,7 @@ public:
 		frameBuffers.deferred->width = FB_DIM;
 		frameBuffers.deferred->height = FB_DIM;
 
-		// Four attachments (3 color, 1 depth)
+		// Four attachments (3 color, 1 depth) or three with the packed layout (2 color, 1 depth)
 		vks::AttachmentCreateInfo attachmentInfo = {};
 		attachmentInfo.width = FB_DIM;
 		attachmentInfo.height = FB_DIM;
@@ -254,26 +263,38 @@ public:
 		attachmentInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
 		// Color attachments
-		// Attachment 0: (World space) Positions
-		attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		frameBuffers.deferred->addAttachment(attachmentInfo);
+		if (packedGBuffer)
+		{
+			// Attachment 0: Octahedron encoded (world space) normals
+			attachmentInfo.format = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+			frameBuffers.deferred->addAttachment(attachmentInfo);
+		}
+		else
+		{
+			// Attachment 0: (World space) Positions
+			attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			frameBuffers.deferred->addAttachment(attachmentInfo);
 
-		// Attachment 1: (World space) Normals
-		attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		frameBuffers.deferred->addAttachment(attachmentInfo);
+			// Attachment 1: (World space) Normals
+			attachmentInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			frameBuffers.deferred->addAttachment(attachmentInfo);
+		}
 
-		// Attachment 2: Albedo (color)
+		// Attachment 2 (1 with the packed layout): Albedo (color)
 		attachmentInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
 		frameBuffers.deferred->addAttachment(attachmentInfo);
 
+		gBufferColorSize = packedGBuffer ? 4 + 4 : 8 + 8 + 4;
+
 		// Depth attachment
 		// Find a suitable depth format
+		// The packed layout samples depth in the composition to reconstruct positions, which requires a depth only format
 		VkFormat attDepthFormat;
-		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
+		VkBool32 validDepthFormat = packedGBuffer ? vks::tools::getSupportedSampledDepthFormat(physicalDevice, &attDepthFormat) : vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
 		attachmentInfo.format = attDepthFormat;
-		attachmentInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		attachmentInfo.usage = packedGBuffer ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 		frameBuffers.deferred->addAttachment(attachmentInfo);
 
 		// Create sampler to sample from the color attachments
@@ -353,16 +374,20 @@ public:
 		// -------------------------------------------------------------------------------------------------------
 
 		// Clear values for all attachments written in the fragment shader
-		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		clearValues[3].depthStencil = { 1.0f, 0 };
+		for (size_t i = 0; i < frameBuffers.deferred->attachments.size(); i++)
+		{
+			if (frameBuffers.deferred->attachments[i].isDepthStencil()) {
+				clearValues[i].depthStencil = { 1.0f, 0 };
+			} else {
+				clearValues[i].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+			}
+		}
 
 		renderPassBeginInfo.renderPass = frameBuffers.deferred->renderPass;
 		renderPassBeginInfo.framebuffer = frameBuffers.deferred->framebuffer;
 		renderPassBeginInfo.renderArea.extent.width = frameBuffers.deferred->width;
 		renderPassBeginInfo.renderArea.extent.height = frameBuffers.deferred->height;
-		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(frameBuffers.deferred->attachments.size());
 		renderPassBeginInfo.pClearValues = clearValues.data();
 
 		vkCmdBeginRenderPass(commandBuffers.deferred, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -487,22 +512,23 @@ public:
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
 		// Image descriptors for the offscreen color attachments
+		// The packed layout has no position attachment, positions are reconstructed from depth (the last attachment)
 		VkDescriptorImageInfo texDescriptorPosition =
 			vks::initializers::descriptorImageInfo(
 				frameBuffers.deferred->sampler,
-				frameBuffers.deferred->attachments[0].view,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				packedGBuffer ? frameBuffers.deferred->attachments[2].view : frameBuffers.deferred->attachments[0].view,
+				packedGBuffer ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorNormal =
 			vks::initializers::descriptorImageInfo(
 				frameBuffers.deferred->sampler,
-				frameBuffers.deferred->attachments[1].view,
+				frameBuffers.deferred->attachments[packedGBuffer ? 0 : 1].view,
 				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorAlbedo =
 			vks::initializers::descriptorImageInfo(
 				frameBuffers.deferred->sampler,
-				frameBuffers.deferred->attachments[2].view,
+				frameBuffers.deferred->attachments[packedGBuffer ? 1 : 2].view,
 				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		VkDescriptorImageInfo texDescriptorShadowMap =
@@ -514,7 +540,7 @@ public:
 		// Deferred composition
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
 		writeDescriptorSets = {
-			// Binding 1: World space position texture
+			// Binding 1: World space position texture (depth with the packed layout)
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &texDescriptorPosition),
 			// Binding 2: World space normals texture
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &texDescriptorNormal),
@@ -589,7 +615,7 @@ public:
 		// Final fullscreen composition pass pipeline
 		rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
 		shaderStages[0] = loadShader(getShadersPath() + "deferredshadows/deferred.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferredshadows/deferred.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferredshadows/deferred_packed.frag.spv" : "deferredshadows/deferred.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 		// Empty vertex input state, vertices are generated by the vertex shader
 		VkPipelineVertexInputStateCreateInfo emptyInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
 		pipelineCI.pVertexInputState = &emptyInputState;
@@ -606,17 +632,12 @@ public:
 		// Blend attachment states required for all color attachments
 		// This is important, as color write mask will otherwise be 0x0 and you
 		// won't see anything rendered to the attachment
-		std::array<VkPipelineColorBlendAttachmentState, 3> blendAttachmentStates =
-		{
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE)
-		};
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachmentStates(packedGBuffer ? 2 : 3, vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE));
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
 
 		shaderStages[0] = loadShader(getShadersPath() + "deferredshadows/mrt.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "deferredshadows/mrt.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (packedGBuffer ? "deferredshadows/mrt_packed.frag.spv" : "deferredshadows/mrt.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreen));
 
 		// Shadow mapping pipeline
@@ -740,6 +761,7 @@ public:
 
 		uboComposition.viewPos = glm::vec4(camera.position, 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);;
 		uboComposition.debugDisplayTarget = debugDisplayTarget;
+		uboComposition.invViewProjection = glm::inverse(camera.matrices.perspective * camera.matrices.view);
 
 		memcpy(uniformBuffers.composition.mapped, &uboComposition, sizeof(uboComposition));
 	}
@@ -780,6 +802,10 @@ public:
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
+		if (packedGBuffer && !(vks::tools::shaderAvailable(getShadersPath() + "deferredshadows/mrt_packed.frag.spv") && vks::tools::shaderAvailable(getShadersPath() + "deferredshadows/deferred_packed.frag.spv"))) {
+			std::cerr << "Packed G-Buffer shaders not found, using the full G-Buffer layout\n";
+			packedGBuffer = false;
+		}
 		deferredSetup();
 		shadowSetup();
 		initLights();
@@ -808,6 +834,7 @@ public:
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
+			overlay->text("G-Buffer: %s layout, %d bytes per pixel + depth", packedGBuffer ? "packed" : "full", gBufferColorSize);
 			if (overlay->comboBox("Display", &debugDisplayTarget, { "Final composition", "Shadows", "Position", "Normals", "Albedo", "Specular" }))
 			{
 				updateUniformBufferDeferredLights();
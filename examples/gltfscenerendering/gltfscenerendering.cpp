@@ -26,10 +26,7 @@ VulkanglTFScene::~VulkanglTFScene()
 	vkDestroyBuffer(vulkanDevice->logicalDevice, indices.buffer, nullptr);
 	vkFreeMemory(vulkanDevice->logicalDevice, indices.memory, nullptr);
 	for (Image image : images) {
-		vkDestroyImageView(vulkanDevice->logicalDevice, image.texture.view, nullptr);
-		vkDestroyImage(vulkanDevice->logicalDevice, image.texture.image, nullptr);
-		vkDestroySampler(vulkanDevice->logicalDevice, image.texture.sampler, nullptr);
-		vkFreeMemory(vulkanDevice->logicalDevice, image.texture.deviceMemory, nullptr);
+		image.texture.destroy();
 	}
 	for (Material material : materials) {
 		vkDestroyPipeline(vulkanDevice->logicalDevice, material.pipeline, nullptr);
@@ -299,6 +296,7 @@ VulkanExample::~VulkanExample()
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.matrices, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.textures, nullptr);
 	shaderData.buffer.destroy();
+	delete lightClusters;
 }
 
 void VulkanExample::getEnabledFeatures()
@@ -331,6 +329,10 @@ void VulkanExample::buildCommandBuffers()
 	{
 		renderPassBeginInfo.framebuffer = frameBuffers[i];
 		VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+		// POI: Assign the point lights to clusters before rendering the scene
+		if (clusteredShading) {
+			lightClusters->record(drawCmdBuffers[i]);
+		}
 		vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 		vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 		vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
@@ -472,9 +474,11 @@ void VulkanExample::setupDescriptors()
 
 	// One ubo to pass dynamic data to the shader
 	// Two combined image samplers per material as each material uses color and normal maps
+	// One ubo and three storage buffers for the light clusters
 	std::vector<VkDescriptorPoolSize> poolSizes = {
-		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
 		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(glTFScene.materials.size()) * 2),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3),
 	};
 	// One set for matrices and one per model image/texture
 	const uint32_t maxSetCount = static_cast<uint32_t>(glTFScene.images.size()) + 1;
@@ -485,6 +489,10 @@ void VulkanExample::setupDescriptors()
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0)
 	};
+	// The light clusters are read by the fragment shader (bindings 1..4)
+	if (clusteredShading) {
+		lightClusters->getSetLayoutBindings(setLayoutBindings, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
+	}
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
 
 	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayouts.matrices));
@@ -513,8 +521,13 @@ void VulkanExample::setupDescriptors()
 	// Descriptor set for scene matrices
 	VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.matrices, 1);
 	VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
-	VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &shaderData.buffer.descriptor);
-	vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &shaderData.buffer.descriptor)
+	};
+	if (clusteredShading) {
+		lightClusters->getWriteDescriptorSets(writeDescriptorSets, descriptorSet, 1);
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
 	// Descriptor sets for materials
 	for (auto& material : glTFScene.materials) {
@@ -567,8 +580,9 @@ void VulkanExample::preparePipelines()
 	pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineCI.pStages = shaderStages.data();
 
-	shaderStages[0] = loadShader(getShadersPath() + "gltfscenerendering/scene.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-	shaderStages[1] = loadShader(getShadersPath() + "gltfscenerendering/scene.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+	const std::string shaderName = clusteredShading ? "scene_clustered" : "scene";
+	shaderStages[0] = loadShader(getShadersPath() + "gltfscenerendering/" + shaderName + ".vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+	shaderStages[1] = loadShader(getShadersPath() + "gltfscenerendering/" + shaderName + ".frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	// POI: Instead if using a few fixed pipelines, we create one pipeline for each material using the properties of that material
 	for (auto &material : glTFScene.materials) {
@@ -613,12 +627,50 @@ void VulkanExample::updateUniformBuffers()
 	shaderData.values.view = camera.matrices.view;
 	shaderData.values.viewPos = camera.viewPos;
 	memcpy(shaderData.buffer.mapped, &shaderData.values, sizeof(shaderData.values));
+	if (clusteredShading) {
+		updateLightClusters();
+	}
+}
+
+// Randomly distribute point lights inside the Sponza atrium
+void VulkanExample::prepareLights()
+{
+	std::default_random_engine rndEngine(benchmark.active ? 0 : (unsigned)time(nullptr));
+	std::uniform_real_distribution<float> rndX(-11.0f, 10.0f);
+	std::uniform_real_distribution<float> rndY(0.25f, 8.0f);
+	std::uniform_real_distribution<float> rndZ(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> rndColor(0.0f, 1.0f);
+	std::uniform_real_distribution<float> rndRadius(1.0f, 2.5f);
+	lights.resize(MAX_LIGHT_COUNT);
+	for (auto& light : lights) {
+		light.position = glm::vec4(rndX(rndEngine), rndY(rndEngine), rndZ(rndEngine), 1.0f);
+		light.color = glm::vec3(rndColor(rndEngine), rndColor(rndEngine), rndColor(rndEngine)) * 2.0f;
+		light.radius = rndRadius(rndEngine);
+	}
+}
+
+void VulkanExample::updateLightClusters()
+{
+	lightClusters->lights.assign(lights.begin(), lights.begin() + lightCount);
+	lightClusters->update(camera.matrices.view, camera.matrices.perspective, camera.getNearClip(), camera.getFarClip(), (float)width, (float)height);
 }
 
 void VulkanExample::prepare()
 {
 	VulkanExampleBase::prepare();
 	loadAssets();
+	// Clustered shading needs the light assignment compute shader and the clustered variants of the scene shaders
+	// All of them are checked first, so no cluster resources are created if any of them is missing
+	clusteredShading = vks::LightClusters::isSupported(getShadersPath() + "base/") && vks::tools::shaderAvailable(getShadersPath() + "gltfscenerendering/scene_clustered.vert.spv") && vks::tools::shaderAvailable(getShadersPath() + "gltfscenerendering/scene_clustered.frag.spv");
+	if (clusteredShading) {
+		lightClusters = new vks::LightClusters(vulkanDevice, MAX_LIGHT_COUNT, getShadersPath() + "base/");
+		clusteredShading = lightClusters->isAvailable();
+	}
+	if (clusteredShading) {
+		prepareLights();
+	} else {
+		std::cerr << "Clustered shading shaders not found, rendering without point lights\n";
+	}
 	prepareUniformBuffers();
 	setupDescriptors();
 	preparePipelines();
@@ -636,6 +688,11 @@ void VulkanExample::render()
 
 void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay* overlay)
 {
+	if (clusteredShading && overlay->header("Lights")) {
+		if (overlay->sliderInt("Point lights", &lightCount, 0, MAX_LIGHT_COUNT)) {
+			updateLightClusters();
+		}
+	}
 	if (overlay->header("Visibility")) {
 
 		if (overlay->button("All")) {
@@ -23,9 +23,13 @@
 #include "tiny_gltf.h"
 
 #include "vulkanexamplebase.h"
+#include "VulkanLightClusters.h"
 
 #define ENABLE_VALIDATION false
 
+// Maximum number of point lights with clustered shading
+#define MAX_LIGHT_COUNT 4096
+
  // Contains everything required to render a basic glTF scene in Vulkan
  // This class is heavily simplified (compared to glTF's feature set) but retains the basic glTF structure
 class VulkanglTFScene
@@ -142,6 +146,12 @@ public:
 		} values;
 	} shaderData;
 
+	// Point lights are assigned to clusters of the view frustum in a compute pass, so fragments only evaluate the lights of their cluster
+	vks::LightClusters* lightClusters = nullptr;
+	bool clusteredShading = false;
+	int32_t lightCount = 256;
+	std::vector<vks::LightClusters::Light> lights;
+
 	VkPipelineLayout pipelineLayout;
 	VkDescriptorSet descriptorSet;
 
@@ -160,6 +170,8 @@ public:
 	void preparePipelines();
 	void prepareUniformBuffers();
 	void updateUniformBuffers();
+	void prepareLights();
+	void updateLightClusters();
 	void prepare();
 	virtual void render();
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay);
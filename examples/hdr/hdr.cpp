@@ -10,6 +10,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanAliasedMemory.h"
 
 #define ENABLE_VALIDATION false
 
@@ -71,16 +72,15 @@ public:
 	} descriptorSetLayouts;
 
 	// Framebuffer for offscreen rendering
+	// Memory of the attachments is owned by attachmentMemory
 	struct FrameBufferAttachment {
 		VkImage image;
-		VkDeviceMemory mem;
 		VkImageView view;
 		VkFormat format;
 		void destroy(VkDevice device)
 		{
 			vkDestroyImageView(device, view, nullptr);
 			vkDestroyImage(device, image, nullptr);
-			vkFreeMemory(device, mem, nullptr);
 		}
 	};
 	struct FrameBuffer {
@@ -100,6 +100,9 @@ public:
 		VkSampler sampler;
 	} filterPass;
 
+	// Memory shared by the attachments of the offscreen and bloom filter passes
+	vks::AliasedMemory* attachmentMemory = nullptr;
+
 	std::vector<std::string> objectNames;
 
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
@@ -141,6 +144,7 @@ public:
 		offscreen.color[1].destroy(device);
 
 		filterPass.color[0].destroy(device);
+		delete attachmentMemory;
 
 		uniformBuffers.matrices.destroy();
 		uniformBuffers.params.destroy();
@@ -300,26 +304,12 @@ public:
 		}
 	}
 
-	void createAttachment(VkFormat format, VkImageUsageFlagBits usage, FrameBufferAttachment *attachment)
+	// Creates the image of an attachment and adds it to the aliased memory
+	// firstPass and lastPass are the passes of a frame that use the attachment: offscreen (0), bloom filter (1) and composition (2)
+	void createAttachment(VkFormat format, VkImageUsageFlagBits usage, FrameBufferAttachment *attachment, uint32_t firstPass, uint32_t lastPass)
 	{
-		VkImageAspectFlags aspectMask = 0;
-		VkImageLayout imageLayout;
-
 		attachment->format = format;
 
-		if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		}
-		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-			imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		}
-
-		assert(aspectMask > 0);
-
 		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
 		image.imageType = VK_IMAGE_TYPE_2D;
 		image.format = format;
@@ -330,21 +320,20 @@ public:
 		image.arrayLayers = 1;
 		image.samples = VK_SAMPLE_COUNT_1_BIT;
 		image.tiling = VK_IMAGE_TILING_OPTIMAL;
-		image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
+		// Depth is only used by the offscreen pass and never stored, so it's a transient attachment
+		const bool transient = (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0;
+		image.usage = usage | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : VK_IMAGE_USAGE_SAMPLED_BIT);
 
 		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &attachment->image));
-		vkGetImageMemoryRequirements(device, attachment->image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &attachment->mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, attachment->image, attachment->mem, 0));
+		attachmentMemory->addImage(attachment->image, firstPass, lastPass, transient);
+	}
 
+	// Creates the view of an attachment once its image has been bound to memory
+	void createAttachmentView(FrameBufferAttachment *attachment, VkImageAspectFlags aspectMask)
+	{
 		VkImageViewCreateInfo imageView = vks::initializers::imageViewCreateInfo();
 		imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageView.format = format;
+		imageView.format = attachment->format;
 		imageView.subresourceRange = {};
 		imageView.subresourceRange.aspectMask = aspectMask;
 		imageView.subresourceRange.baseMipLevel = 0;
@@ -358,18 +347,29 @@ public:
 	// Prepare a new framebuffer and attachments for offscreen rendering (G-Buffer)
 	void prepareoffscreenfer()
 	{
+		offscreen.width = width;
+		offscreen.height = height;
+		filterPass.width = width;
+		filterPass.height = height;
+
+		// All attachments are placed in aliased memory, the depth attachment is only used by the offscreen pass
+		// and the bloom filter target only after it, so both can share the same memory
+		attachmentMemory = new vks::AliasedMemory(vulkanDevice);
+		// Two floating point color buffers
+		createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &offscreen.color[0], 0, 2);
+		createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &offscreen.color[1], 0, 1);
+		// Depth attachment
+		createAttachment(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &offscreen.depth, 0, 0);
+		// Bloom filter target
+		createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &filterPass.color[0], 1, 2);
+		attachmentMemory->allocate();
+		createAttachmentView(&offscreen.color[0], VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&offscreen.color[1], VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&offscreen.depth, VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
+		createAttachmentView(&filterPass.color[0], VK_IMAGE_ASPECT_COLOR_BIT);
+
+		// Offscreen scene pass
 		{
-			offscreen.width = width;
-			offscreen.height = height;
-
-			// Color attachments
-
-			// Two floating point color buffers
-			createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &offscreen.color[0]);
-			createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &offscreen.color[1]);
-			// Depth attachment
-			createAttachment(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &offscreen.depth);
-
 			// Set up separate renderpass with references to the color and depth attachments
 			std::array<VkAttachmentDescription, 3> attachmentDescs = {};
 
@@ -383,6 +383,7 @@ public:
 				attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 				if (i == 2)
 				{
+					attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 					attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 					attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 				}
@@ -415,13 +416,15 @@ public:
 			// Use subpass dependencies for attachment layout transitions
 			std::array<VkSubpassDependency, 2> dependencies;
 
+			// The depth attachment shares memory with the bloom filter target sampled by the composition of the previous frame
+			// Sampling reads other locations than the ones written here, so this can't be a framebuffer local dependency
 			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 			dependencies[0].dstSubpass = 0;
-			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[0].dependencyFlags = 0;
 
 			dependencies[1].srcSubpass = 0;
 			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
@@ -476,14 +479,6 @@ public:
 
 		// Bloom separable filter pass
 		{
-			filterPass.width = width;
-			filterPass.height = height;
-
-			// Color attachments
-
-			// Two floating point color buffers
-			createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &filterPass.color[0]);
-
 			// Set up separate renderpass with references to the color and depth attachments
 			std::array<VkAttachmentDescription, 1> attachmentDescs = {};
 
@@ -508,13 +503,14 @@ public:
 			// Use subpass dependencies for attachment layout transitions
 			std::array<VkSubpassDependency, 2> dependencies;
 
+			// The filter target shares memory with the depth attachment written by the offscreen pass
 			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 			dependencies[0].dstSubpass = 0;
-			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+			dependencies[0].dependencyFlags = 0;
 
 			dependencies[1].srcSubpass = 0;
 			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
@@ -887,6 +883,10 @@ public:
 				buildCommandBuffers();
 			}
 		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Render targets: %d MB (%d MB without aliasing)", static_cast<uint32_t>(attachmentMemory->getAllocatedSize() / (1024 * 1024)), static_cast<uint32_t>(attachmentMemory->getRequiredSize() / (1024 * 1024)));
+			overlay->text(attachmentMemory->usesLazilyAllocatedMemory() ? "Depth in lazily allocated memory" : "Device local memory");
+		}
 	}
 };
 
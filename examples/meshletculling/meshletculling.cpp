@@ -0,0 +1,468 @@
+/*
+* Vulkan Example - Meshlet generation and cluster culling
+*
+* The glTF model is split into meshlets (small clusters of triangles) at load time, each with a bounding sphere and a normal cone
+* A compute shader culls the meshlets against the view frustum and discards clusters that are completely back facing,
+* writing one indirect draw command per meshlet. If VK_NV_mesh_shader is supported, the same culling can be done in a task shader
+* with the surviving meshlets being emitted by a mesh shader
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
+#include "frustum.hpp"
+
+#define ENABLE_VALIDATION false
+
+// Number of meshlets processed by a single task shader workgroup
+#define TASK_GROUP_SIZE 32
+
+class VulkanExample : public VulkanExampleBase
+{
+public:
+	vkglTF::Model scene;
+
+	enum RenderMode { RenderModeIndirect = 0, RenderModeMeshShader = 1 };
+	int32_t renderMode = RenderModeIndirect;
+	bool frustumCulling = true;
+	bool coneCulling = true;
+	bool colorMeshlets = true;
+	bool fixedFrustum = false;
+
+	bool meshShaderSupported = false;
+	// If first instance can't be set by indirect draws, the meshlet index is passed as a push constant with one draw per meshlet
+	bool firstInstanceSupported = false;
+	VkPhysicalDeviceMeshShaderFeaturesNV enabledMeshShaderFeatures{};
+	PFN_vkCmdDrawMeshTasksNV vkCmdDrawMeshTasksNV = VK_NULL_HANDLE;
+
+	struct UniformData {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec4 frustumPlanes[6];
+		// Position used for the normal cone test
+		glm::vec4 cullingViewPos;
+		glm::vec4 viewPos;
+		uint32_t meshletCount;
+		uint32_t frustumCulling;
+		uint32_t coneCulling;
+		uint32_t colorMeshlets;
+	} uniformData;
+	vks::Buffer uniformBuffer;
+
+	// One indexed indirect draw per meshlet, instance count is zero for culled meshlets
+	vks::Buffer indirectCommandsBuffer;
+
+	// Culling statistics written by the compute and task shaders
+	struct Statistics {
+		uint32_t visibleMeshlets;
+		uint32_t visibleTriangles;
+	} statistics{};
+	vks::Buffer statisticsBuffer;
+
+	struct {
+		VkPipeline indirect = VK_NULL_HANDLE;
+		VkPipeline meshShader = VK_NULL_HANDLE;
+		VkPipeline cull = VK_NULL_HANDLE;
+	} pipelines;
+
+	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout computePipelineLayout;
+	VkDescriptorSet descriptorSet;
+	VkDescriptorSetLayout descriptorSetLayout;
+
+	vks::Frustum frustum;
+
+	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
+	{
+		title = "Meshlet culling";
+		camera.type = Camera::CameraType::firstperson;
+		camera.flipY = true;
+		camera.setPosition(glm::vec3(0.0f, 1.0f, 0.0f));
+		camera.setRotation(glm::vec3(0.0f, -90.0f, 0.0f));
+		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
+		camera.setRotationSpeed(0.25f);
+		camera.movementSpeed = 2.5f;
+		enabledInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
+	~VulkanExample()
+	{
+		vkDestroyPipeline(device, pipelines.indirect, nullptr);
+		vkDestroyPipeline(device, pipelines.meshShader, nullptr);
+		vkDestroyPipeline(device, pipelines.cull, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+		uniformBuffer.destroy();
+		indirectCommandsBuffer.destroy();
+		statisticsBuffer.destroy();
+	}
+
+	virtual void getEnabledFeatures()
+	{
+		if (deviceFeatures.multiDrawIndirect) {
+			enabledFeatures.multiDrawIndirect = VK_TRUE;
+		}
+		// The vertex shader gets the meshlet index from the first instance of the indirect draw
+		firstInstanceSupported = deviceFeatures.drawIndirectFirstInstance;
+		if (firstInstanceSupported) {
+			enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+		} else {
+			std::cout << "drawIndirectFirstInstance not supported, issuing one indirect draw per meshlet" << std::endl;
+		}
+		// The mesh shader path is optional, check if the extension is present
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+		for (auto extension : extensions) {
+			if (strcmp(extension.extensionName, VK_NV_MESH_SHADER_EXTENSION_NAME) == 0) {
+				meshShaderSupported = true;
+				break;
+			}
+		}
+		if (meshShaderSupported) {
+			enabledDeviceExtensions.push_back(VK_NV_MESH_SHADER_EXTENSION_NAME);
+			enabledMeshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV;
+			enabledMeshShaderFeatures.taskShader = VK_TRUE;
+			enabledMeshShaderFeatures.meshShader = VK_TRUE;
+			deviceCreatepNextChain = &enabledMeshShaderFeatures;
+		} else {
+			std::cout << VK_NV_MESH_SHADER_EXTENSION_NAME << " not supported, only the compute culling path is available" << std::endl;
+		}
+	}
+
+	void buildCommandBuffers()
+	{
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+
+		VkClearValue clearValues[2];
+		clearValues[0].color = { { 0.25f, 0.25f, 0.25f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = renderPass;
+		renderPassBeginInfo.renderArea.extent.width = width;
+		renderPassBeginInfo.renderArea.extent.height = height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		const VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+		const VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+
+		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
+		{
+			renderPassBeginInfo.framebuffer = frameBuffers[i];
+			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+
+			// Reset the statistics
+			vkCmdFillBuffer(drawCmdBuffers[i], statisticsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+			bufferBarrier.buffer = statisticsBuffer.buffer;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			const VkPipelineStageFlags statisticsStage = (renderMode == RenderModeMeshShader) ? VK_PIPELINE_STAGE_TASK_SHADER_BIT_NV : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, statisticsStage, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+			if (renderMode == RenderModeIndirect) {
+				// Cull the meshlets and write the indirect draw commands
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.cull);
+				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+				vkCmdDispatch(drawCmdBuffers[i], (scene.meshlets.count + 63) / 64, 1, 1);
+
+				// Make sure the draw commands have been written before they are consumed
+				bufferBarrier.buffer = indirectCommandsBuffer.buffer;
+				bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				bufferBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+				vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+			}
+
+			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+			if (renderMode == RenderModeIndirect) {
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.indirect);
+				const VkDeviceSize offsets[1] = { 0 };
+				vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &scene.vertices.buffer, offsets);
+				vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, scene.indices.type);
+				const uint32_t meshletIndexOffset = 0;
+				vkCmdPushConstants(drawCmdBuffers[i], pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &meshletIndexOffset);
+				if (firstInstanceSupported && vulkanDevice->features.multiDrawIndirect && (scene.meshlets.count <= deviceProperties.limits.maxDrawIndirectCount)) {
+					vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, 0, scene.meshlets.count, sizeof(VkDrawIndexedIndirectCommand));
+				} else {
+					// If multi draw or first instance is not available, we must issue separate draw commands
+					for (uint32_t j = 0; j < scene.meshlets.count; j++) {
+						if (!firstInstanceSupported) {
+							vkCmdPushConstants(drawCmdBuffers[i], pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &j);
+						}
+						vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+					}
+				}
+			} else {
+				// Each task shader workgroup culls TASK_GROUP_SIZE meshlets and launches one mesh shader workgroup per visible meshlet
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.meshShader);
+				vkCmdDrawMeshTasksNV(drawCmdBuffers[i], (scene.meshlets.count + TASK_GROUP_SIZE - 1) / TASK_GROUP_SIZE, 0);
+			}
+
+			drawUI(drawCmdBuffers[i]);
+			vkCmdEndRenderPass(drawCmdBuffers[i]);
+			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+		}
+	}
+
+	void loadAssets()
+	{
+		// The mesh shader fetches vertices and indices from storage buffers
+		vkglTF::memoryPropertyFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::DontLoadImages | vkglTF::FileLoadingFlags::OptimizeMeshes | vkglTF::FileLoadingFlags::GenerateMeshlets;
+		scene.loadFromFile(getAssetPath() + "models/sponza/sponza.gltf", vulkanDevice, queue, glTFLoadingFlags);
+	}
+
+	void prepareBuffers()
+	{
+		// Instance count is written by the culling shader, first instance is the meshlet index (if supported)
+		std::vector<VkDrawIndexedIndirectCommand> indirectCommands(scene.meshlets.count);
+		for (uint32_t i = 0; i < scene.meshlets.count; i++) {
+			const vkglTF::Meshlet& meshlet = scene.meshletData[i];
+			indirectCommands[i].indexCount = meshlet.indexCount;
+			indirectCommands[i].instanceCount = 0;
+			indirectCommands[i].firstIndex = meshlet.firstIndex;
+			indirectCommands[i].vertexOffset = meshlet.vertexOffset;
+			indirectCommands[i].firstInstance = firstInstanceSupported ? i : 0;
+		}
+
+		vks::Buffer stagingBuffer;
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&stagingBuffer,
+			indirectCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
+			indirectCommands.data()));
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&indirectCommandsBuffer,
+			stagingBuffer.size));
+		vulkanDevice->copyBuffer(&stagingBuffer, &indirectCommandsBuffer, queue);
+		stagingBuffer.destroy();
+
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&statisticsBuffer,
+			sizeof(Statistics)));
+		VK_CHECK_RESULT(statisticsBuffer.map());
+
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&uniformBuffer,
+			sizeof(UniformData)));
+		VK_CHECK_RESULT(uniformBuffer.map());
+		updateUniformBuffers();
+	}
+
+	void setupDescriptors()
+	{
+		// Pool
+		const std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
+
+		// Layout
+		// All stages share a single set, the mesh shader stages are only added if supported
+		VkShaderStageFlags cullStages = VK_SHADER_STAGE_COMPUTE_BIT;
+		VkShaderStageFlags meshStages = 0;
+		if (meshShaderSupported) {
+			cullStages |= VK_SHADER_STAGE_TASK_BIT_NV;
+			meshStages = VK_SHADER_STAGE_MESH_BIT_NV;
+		}
+		const std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			// Binding 0: Scene uniform buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, cullStages | meshStages | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			// Binding 1: Meshlets
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullStages | meshStages, 1),
+			// Binding 2: Indirect draw commands
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			// Binding 3: Culling statistics
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullStages, 3),
+			// Binding 4: Meshlet vertex list
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshStages, 4),
+			// Binding 5: Meshlet triangle list
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshStages, 5),
+			// Binding 6: Model vertex buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshStages, 6),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &descriptorSetLayout));
+
+		// Set
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+		VkDescriptorBufferInfo vertexBufferDescriptor = { scene.vertices.buffer, 0, VK_WHOLE_SIZE };
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &scene.meshlets.buffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &indirectCommandsBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &statisticsBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &scene.meshlets.vertexBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &scene.meshlets.triangleBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &vertexBufferDescriptor),
+		};
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	void preparePipelines()
+	{
+		// Layouts
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &computePipelineLayout));
+		// Offset added to the instance index to get the meshlet index in the vertex shader
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(uint32_t), 0);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+
+		// Compute culling pipeline
+		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(computePipelineLayout, 0);
+		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "meshletculling/cull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipelines.cull));
+
+		// Graphics pipelines
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+		// Meshlets of double sided (alpha masked) materials are never cone culled, so back face culling is disabled for the whole scene
+		VkPipelineRasterizationStateCreateInfo rasterizationStateCI = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+		VkPipelineColorBlendAttachmentState blendAttachmentStateCI = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
+		VkPipelineColorBlendStateCreateInfo colorBlendStateCI = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentStateCI);
+		VkPipelineDepthStencilStateCreateInfo depthStencilStateCI = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+		VkPipelineViewportStateCreateInfo viewportStateCI = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+		VkPipelineMultisampleStateCreateInfo multisampleStateCI = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+		const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicStateCI = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+		std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+		VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::pipelineCreateInfo(pipelineLayout, renderPass, 0);
+		pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
+		pipelineCI.pRasterizationState = &rasterizationStateCI;
+		pipelineCI.pColorBlendState = &colorBlendStateCI;
+		pipelineCI.pMultisampleState = &multisampleStateCI;
+		pipelineCI.pViewportState = &viewportStateCI;
+		pipelineCI.pDepthStencilState = &depthStencilStateCI;
+		pipelineCI.pDynamicState = &dynamicStateCI;
+
+		// Indirect draws of the meshlets culled by the compute shader
+		shaderStages = {
+			loadShader(getShadersPath() + "meshletculling/meshlet.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+			loadShader(getShadersPath() + "meshletculling/meshlet.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+		};
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::Color });
+		pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCI.pStages = shaderStages.data();
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.indirect));
+
+		// Task and mesh shaders, no vertex input or input assembly state
+		if (meshShaderSupported) {
+			shaderStages = {
+				loadShader(getShadersPath() + "meshletculling/meshlet.task.spv", VK_SHADER_STAGE_TASK_BIT_NV),
+				loadShader(getShadersPath() + "meshletculling/meshlet.mesh.spv", VK_SHADER_STAGE_MESH_BIT_NV),
+				loadShader(getShadersPath() + "meshletculling/meshlet.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+			};
+			pipelineCI.pVertexInputState = nullptr;
+			pipelineCI.pInputAssemblyState = nullptr;
+			pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+			pipelineCI.pStages = shaderStages.data();
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.meshShader));
+		}
+	}
+
+	void updateUniformBuffers()
+	{
+		uniformData.projection = camera.matrices.perspective;
+		uniformData.view = camera.matrices.view;
+		uniformData.viewPos = camera.viewPos;
+		// Keep the culling results of the frozen view, so they can be inspected from another position
+		if (!fixedFrustum) {
+			frustum.update(camera.matrices.perspective * camera.matrices.view);
+			memcpy(uniformData.frustumPlanes, frustum.planes.data(), sizeof(glm::vec4) * 6);
+			uniformData.cullingViewPos = camera.viewPos;
+		}
+		uniformData.meshletCount = scene.meshlets.count;
+		uniformData.frustumCulling = frustumCulling;
+		uniformData.coneCulling = coneCulling;
+		uniformData.colorMeshlets = colorMeshlets;
+		memcpy(uniformBuffer.mapped, &uniformData, sizeof(UniformData));
+	}
+
+	void prepare()
+	{
+		VulkanExampleBase::prepare();
+		loadAssets();
+		if (scene.meshlets.count == 0) {
+			vks::tools::exitFatal("The model does not contain any meshlets", -1);
+		}
+		// The mesh shader path also needs the task and mesh shader binaries, which not every shader set ships
+		if (meshShaderSupported && !(vks::tools::shaderAvailable(getShadersPath() + "meshletculling/meshlet.task.spv") && vks::tools::shaderAvailable(getShadersPath() + "meshletculling/meshlet.mesh.spv"))) {
+			std::cout << "Task or mesh shader not found in \"" << getShadersPath() << "meshletculling\", only the compute culling path is available" << std::endl;
+			meshShaderSupported = false;
+		}
+		if (meshShaderSupported) {
+			vkCmdDrawMeshTasksNV = reinterpret_cast<PFN_vkCmdDrawMeshTasksNV>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksNV"));
+		}
+		prepareBuffers();
+		setupDescriptors();
+		preparePipelines();
+		buildCommandBuffers();
+		prepared = true;
+	}
+
+	virtual void render()
+	{
+		if (!prepared) {
+			return;
+		}
+		renderFrame();
+		// Statistics of the last submitted frame
+		memcpy(&statistics, statisticsBuffer.mapped, sizeof(Statistics));
+		if (camera.updated) {
+			updateUniformBuffers();
+		}
+	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			if (meshShaderSupported) {
+				if (overlay->comboBox("Render mode", &renderMode, { "Compute culling + indirect", "Task + mesh shaders" })) {
+					buildCommandBuffers();
+				}
+			}
+			if (overlay->checkBox("Frustum culling", &frustumCulling)) {
+				updateUniformBuffers();
+			}
+			if (overlay->checkBox("Normal cone culling", &coneCulling)) {
+				updateUniformBuffers();
+			}
+			if (overlay->checkBox("Color meshlets", &colorMeshlets)) {
+				updateUniformBuffers();
+			}
+			if (overlay->checkBox("Freeze culling", &fixedFrustum)) {
+				updateUniformBuffers();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Meshlets: %d / %d", statistics.visibleMeshlets, scene.meshlets.count);
+			overlay->text("Triangles: %d / %d", statistics.visibleTriangles, scene.indices.count / 3);
+		}
+	}
+};
+
+VULKAN_EXAMPLE_MAIN()
@@ -21,6 +21,9 @@ public:
 	} textures;
 
 	vkglTF::Model plane;
+	// Store the plane in the quantized compact vertex layout (if the shader for it is available)
+	bool compactVertices = false;
+	const std::vector<vkglTF::VertexComponent> vertexComponents = { vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::Tangent };
 
 	struct {
 		vks::Buffer vertexShader;
@@ -35,6 +38,8 @@ public:
 			glm::mat4 model;
 			glm::vec4 lightPos = glm::vec4(0.0f, -2.0f, 0.0f, 1.0f);
 			glm::vec4 cameraPos;
+			// Only used by the compact vertex layout shader
+			glm::mat4 positionDequantization = glm::mat4(1.0f);
 		} vertexShader;
 
 		struct {
@@ -88,8 +93,16 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		compactVertices = vks::tools::shaderAvailable(getShadersPath() + "parallaxmapping/parallax_compact.vert.spv");
+		if (compactVertices) {
+			glTFLoadingFlags |= vkglTF::FileLoadingFlags::CompactVertices;
+			plane.compactVertexComponents = vertexComponents;
+		} else {
+			std::cout << "Compact vertex shader not found, using the default vertex layout" << std::endl;
+		}
 		plane.loadFromFile(getAssetPath() + "models/plane.gltf", vulkanDevice, queue, glTFLoadingFlags);
+		ubos.vertexShader.positionDequantization = plane.positionDequantization;
 		textures.normalHeightMap.loadFromFile(getAssetPath() + "textures/rocks_normal_height_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 		textures.colorMap.loadFromFile(getAssetPath() + "textures/rocks_color_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 	}
@@ -205,10 +218,11 @@ public:
 		pipelineCI.pDynamicState = &dynamicState;
 		pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
 		pipelineCI.pStages = shaderStages.data();
-		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::Tangent });
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState(vertexComponents, compactVertices ? vkglTF::VertexLayout::Compact : vkglTF::VertexLayout::Default);
 
 		// Parallax mapping modes pipeline
-		shaderStages[0] = loadShader(getShadersPath() + "parallaxmapping/parallax.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+		// The compact vertex shader decodes the quantized positions and octahedral normals and tangents
+		shaderStages[0] = loadShader(getShadersPath() + (compactVertices ? "parallaxmapping/parallax_compact.vert.spv" : "parallaxmapping/parallax.vert.spv"), VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = loadShader(getShadersPath() + "parallaxmapping/parallax.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipeline));
 	}
@@ -295,6 +309,10 @@ public:
 				updateUniformBuffers();
 			}
 		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Vertex layout: %s", compactVertices ? "compact" : "default");
+			overlay->text("Vertex size: %d bytes (default %d bytes)", plane.vertices.stride, static_cast<uint32_t>(sizeof(vkglTF::Vertex)));
+		}
 	}
 
 };
@@ -12,6 +12,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanIBLCache.h"
 
 #define ENABLE_VALIDATION false
 #define GRID_DIM 7
@@ -37,6 +38,17 @@ class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool displaySkybox = true;
+	// Filters the environment with compute shaders that write to the cube maps through storage image views
+	bool computeFiltering = false;
+	// Diffuse lighting from nine spherical harmonics coefficients instead of the irradiance cube (compute path only)
+	bool sphericalHarmonics = false;
+	// Needs the projection compute shader and the fragment shader variant that evaluates the coefficients
+	bool sphericalHarmonicsSupported = false;
+	// Filters the environment in every frame, as needed for environments that change at runtime (compute path only)
+	bool filterEveryFrame = false;
+
+	// Source of the generated lighting textures, part of their cache keys
+	std::string environmentFile;
 
 	struct Textures {
 		vks::TextureCubeMap environmentCube;
@@ -69,8 +81,45 @@ public:
 		glm::vec4 lights[4];
 		float exposure = 4.5f;
 		float gamma = 2.2f;
+		uint32_t shIrradiance = 0;
 	} uboParams;
 
+	// Sampling parameters shared by the graphics and compute filters
+	struct FilterParams {
+		float deltaPhi = (2.0f * float(M_PI)) / 180.0f;
+		float deltaTheta = (0.5f * float(M_PI)) / 64.0f;
+		uint32_t numSamples = 32u;
+	} filterParams;
+
+	struct ComputeFilter {
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipeline irradiance;
+		VkPipeline prefilter;
+		VkPipeline sphericalHarmonics = VK_NULL_HANDLE;
+		// Storage views and descriptor sets for every mip level of the cube maps
+		std::vector<VkImageView> irradianceViews;
+		std::vector<VkDescriptorSet> irradianceSets;
+		std::vector<VkImageView> prefilteredViews;
+		std::vector<VkDescriptorSet> prefilteredSets;
+		VkDescriptorSet sphericalHarmonicsSet;
+		// Cube maps loaded from the cache don't need to be filtered at startup
+		bool irradianceCached = false;
+		bool prefilteredCached = false;
+		std::string irradianceCacheFile;
+		std::string prefilteredCacheFile;
+		struct PushBlock {
+			float roughness;
+			uint32_t numSamples;
+			float deltaPhi;
+			float deltaTheta;
+		};
+	} computeFilter;
+
+	// Irradiance as spherical harmonics, written by the compute filter and read by the fragment shader as a uniform buffer
+	vks::Buffer shCoefficients;
+
 	struct {
 		VkPipeline skybox;
 		VkPipeline pbr;
@@ -135,6 +184,21 @@ public:
 		uniformBuffers.object.destroy();
 		uniformBuffers.skybox.destroy();
 		uniformBuffers.params.destroy();	
+		shCoefficients.destroy();
+		if (computeFiltering) {
+			vkDestroyPipeline(device, computeFilter.irradiance, nullptr);
+			vkDestroyPipeline(device, computeFilter.prefilter, nullptr);
+			vkDestroyPipeline(device, computeFilter.sphericalHarmonics, nullptr);
+			vkDestroyPipelineLayout(device, computeFilter.pipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(device, computeFilter.descriptorSetLayout, nullptr);
+			vkDestroyDescriptorPool(device, computeFilter.descriptorPool, nullptr);
+			for (auto view : computeFilter.irradianceViews) {
+				vkDestroyImageView(device, view, nullptr);
+			}
+			for (auto view : computeFilter.prefilteredViews) {
+				vkDestroyImageView(device, view, nullptr);
+			}
+		}
 		textures.environmentCube.destroy();
 		textures.irradianceCube.destroy();
 		textures.prefilteredCube.destroy();
@@ -172,6 +236,10 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			if (filterEveryFrame) {
+				recordEnvironmentFilter(drawCmdBuffers[i]);
+			}
+
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			VkViewport viewport = vks::initializers::viewport((float)width,	(float)height, 0.0f, 1.0f);
@@ -238,14 +306,15 @@ public:
 			models.objects[i].loadFromFile(getAssetPath() + "models/" + filenames[i], vulkanDevice, queue, glTFLoadingFlags);
 		}
 		// HDR cubemap
-		textures.environmentCube.loadFromFile(getAssetPath() + "textures/hdr/pisa_cube.ktx", VK_FORMAT_R16G16B16A16_SFLOAT, vulkanDevice, queue);
+		environmentFile = getAssetPath() + "textures/hdr/pisa_cube.ktx";
+		textures.environmentCube.loadFromFile(environmentFile, VK_FORMAT_R16G16B16A16_SFLOAT, vulkanDevice, queue);
 	}
 
 	void setupDescriptors()
 	{
 		// Descriptor Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6)
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo =	vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
@@ -258,6 +327,7 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 5),
 		};
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = 	vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &descriptorSetLayout));
@@ -273,6 +343,7 @@ public:
 			vks::initializers::writeDescriptorSet(descriptorSets.object, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &textures.irradianceCube.descriptor),
 			vks::initializers::writeDescriptorSet(descriptorSets.object, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &textures.lutBrdf.descriptor),
 			vks::initializers::writeDescriptorSet(descriptorSets.object, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &textures.prefilteredCube.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSets.object, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5, &shCoefficients.descriptor),
 		};
 		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
 
@@ -349,7 +420,7 @@ public:
 
 		// PBR pipeline
 		shaderStages[0] = loadShader(getShadersPath() + "pbribl/pbribl.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "pbribl/pbribl.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + (sphericalHarmonicsSupported ? "pbribl/pbribl_sh.frag.spv" : "pbribl/pbribl.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 		// Enable depth test and write
 		depthStencilState.depthWriteEnable = VK_TRUE;
 		depthStencilState.depthTestEnable = VK_TRUE;
@@ -364,6 +435,15 @@ public:
 		const VkFormat format = VK_FORMAT_R16G16_SFLOAT;	// R16G16 is supported pretty much everywhere
 		const int32_t dim = 512;
 
+		// The look-up-table doesn't depend on the environment, so it only needs to be generated again if the shaders change
+		const std::string cacheFile = vks::ibl::cacheFileName("brdflut", { getShadersPath() + "pbribl/genbrdflut.vert.spv", getShadersPath() + "pbribl/genbrdflut.frag.spv" }, { static_cast<float>(format), static_cast<float>(dim) });
+		if (vks::ibl::isCached(cacheFile)) {
+			textures.lutBrdf.loadKTX2File(cacheFile, VK_IMAGE_VIEW_TYPE_2D, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, vulkanDevice, queue, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading BRDF LUT from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
+
 		// Image
 		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
 		imageCI.imageType = VK_IMAGE_TYPE_2D;
@@ -375,7 +455,8 @@ public:
 		imageCI.arrayLayers = 1;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		// Transfer source for writing the image to the cache
+		imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.lutBrdf.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
@@ -559,6 +640,8 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating BRDF LUT took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.lutBrdf.image, format, dim, 1, 1);
 	}
 
 	// Generate an irradiance cube map from the environment cube map
@@ -570,6 +653,24 @@ public:
 		const int32_t dim = 64;
 		const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
 
+		// The compute filter uses different shaders, so its results are cached under their own key
+		const std::vector<float> cacheParameters = { static_cast<float>(format), static_cast<float>(dim), filterParams.deltaPhi, filterParams.deltaTheta };
+		const std::string cacheFile = computeFiltering ?
+			vks::ibl::cacheFileName("irradiance_compute", { environmentFile, getShadersPath() + "pbribl/irradiancecube.comp.spv" }, cacheParameters) :
+			vks::ibl::cacheFileName("irradiance", { environmentFile, getShadersPath() + "pbribl/filtercube.vert.spv", getShadersPath() + "pbribl/irradiancecube.frag.spv" }, cacheParameters);
+		if (vks::ibl::isCached(cacheFile)) {
+			if (computeFiltering) {
+				// Loaded with storage usage into the general layout, so the compute filter can still write to it
+				textures.irradianceCube.loadFromFile(cacheFile, format, vulkanDevice, queue, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_GENERAL);
+				computeFilter.irradianceCached = true;
+			} else {
+				textures.irradianceCube.loadFromFile(cacheFile, format, vulkanDevice, queue);
+			}
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading irradiance cube from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
+
 		// Pre-filtered cube map
 		// Image
 		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
@@ -582,7 +683,10 @@ public:
 		imageCI.arrayLayers = 6;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		if (computeFiltering) {
+			imageCI.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		}
 		imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.irradianceCube.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
@@ -620,6 +724,19 @@ public:
 		textures.irradianceCube.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		textures.irradianceCube.device = vulkanDevice;
 
+		// The compute filter writes to the cube map directly, see prepareComputeFilter
+		// It's stored in the cache after the first filter run
+		if (computeFiltering) {
+			textures.irradianceCube.width = dim;
+			textures.irradianceCube.height = dim;
+			textures.irradianceCube.mipLevels = numMips;
+			textures.irradianceCube.layerCount = 6;
+			textures.irradianceCube.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			textures.irradianceCube.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			computeFilter.irradianceCacheFile = cacheFile;
+			return;
+		}
+
 		// FB, Att, RP, Pipe, etc.
 		VkAttachmentDescription attDesc = {};
 		// Color attachment
@@ -756,9 +873,11 @@ public:
 		struct PushBlock {
 			glm::mat4 mvp;
 			// Sampling deltas
-			float deltaPhi = (2.0f * float(M_PI)) / 180.0f;
-			float deltaTheta = (0.5f * float(M_PI)) / 64.0f;
+			float deltaPhi;
+			float deltaTheta;
 		} pushBlock;
+		pushBlock.deltaPhi = filterParams.deltaPhi;
+		pushBlock.deltaTheta = filterParams.deltaTheta;
 
 		VkPipelineLayout pipelinelayout;
 		std::vector<VkPushConstantRange> pushConstantRanges = {
@@ -938,6 +1057,8 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating irradiance cube with " << numMips << " mip levels took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.irradianceCube.image, format, dim, numMips, 6);
 	}
 
 	// Prefilter environment cubemap
@@ -950,6 +1071,24 @@ public:
 		const int32_t dim = 512;
 		const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
 
+		// The compute filter uses different shaders, so its results are cached under their own key
+		const std::vector<float> cacheParameters = { static_cast<float>(format), static_cast<float>(dim), static_cast<float>(filterParams.numSamples) };
+		const std::string cacheFile = computeFiltering ?
+			vks::ibl::cacheFileName("prefilteredenv_compute", { environmentFile, getShadersPath() + "pbribl/prefilterenvmap.comp.spv" }, cacheParameters) :
+			vks::ibl::cacheFileName("prefilteredenv", { environmentFile, getShadersPath() + "pbribl/filtercube.vert.spv", getShadersPath() + "pbribl/prefilterenvmap.frag.spv" }, cacheParameters);
+		if (vks::ibl::isCached(cacheFile)) {
+			if (computeFiltering) {
+				// Loaded with storage usage into the general layout, so the compute filter can still write to it
+				textures.prefilteredCube.loadFromFile(cacheFile, format, vulkanDevice, queue, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_GENERAL);
+				computeFilter.prefilteredCached = true;
+			} else {
+				textures.prefilteredCube.loadFromFile(cacheFile, format, vulkanDevice, queue);
+			}
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading pre-filtered environment cube from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
+
 		// Pre-filtered cube map
 		// Image
 		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
@@ -962,7 +1101,10 @@ public:
 		imageCI.arrayLayers = 6;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		if (computeFiltering) {
+			imageCI.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		}
 		imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.prefilteredCube.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
@@ -1000,6 +1142,19 @@ public:
 		textures.prefilteredCube.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		textures.prefilteredCube.device = vulkanDevice;
 
+		// The compute filter writes to the cube map directly, see prepareComputeFilter
+		// It's stored in the cache after the first filter run
+		if (computeFiltering) {
+			textures.prefilteredCube.width = dim;
+			textures.prefilteredCube.height = dim;
+			textures.prefilteredCube.mipLevels = numMips;
+			textures.prefilteredCube.layerCount = 6;
+			textures.prefilteredCube.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			textures.prefilteredCube.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			computeFilter.prefilteredCacheFile = cacheFile;
+			return;
+		}
+
 		// FB, Att, RP, Pipe, etc.
 		VkAttachmentDescription attDesc = {};
 		// Color attachment
@@ -1136,8 +1291,9 @@ public:
 		struct PushBlock {
 			glm::mat4 mvp;
 			float roughness;
-			uint32_t numSamples = 32u;
+			uint32_t numSamples;
 		} pushBlock;
+		pushBlock.numSamples = filterParams.numSamples;
 
 		VkPipelineLayout pipelinelayout;
 		std::vector<VkPushConstantRange> pushConstantRanges = {
@@ -1318,6 +1474,165 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating pre-filtered enivornment cube with " << numMips << " mip levels took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.prefilteredCube.image, format, dim, numMips, 6);
+	}
+
+	// The compute filter needs its shaders and storage image support for the formats of the irradiance and pre-filtered cube maps
+	bool computeFilterSupported()
+	{
+		for (auto& shader : { "irradiancecube.comp.spv", "prefilterenvmap.comp.spv" }) {
+			if (!vks::tools::shaderAvailable(getShadersPath() + "pbribl/" + shader)) {
+				return false;
+			}
+		}
+		for (auto format : { VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT }) {
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+			if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Creates a storage view and descriptor set for every mip level of a cube map, the faces are written as layers of a 2D array
+	void prepareComputeFilterTarget(vks::TextureCubeMap& cube, VkFormat format, std::vector<VkImageView>& views, std::vector<VkDescriptorSet>& descriptorSets)
+	{
+		views.resize(cube.mipLevels);
+		descriptorSets.resize(cube.mipLevels);
+		for (uint32_t level = 0; level < cube.mipLevels; level++) {
+			VkImageViewCreateInfo viewCI = vks::initializers::imageViewCreateInfo();
+			viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			viewCI.format = format;
+			viewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 6 };
+			viewCI.image = cube.image;
+			VK_CHECK_RESULT(vkCreateImageView(device, &viewCI, nullptr, &views[level]));
+
+			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(computeFilter.descriptorPool, &computeFilter.descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets[level]));
+			VkDescriptorImageInfo storageImageInfo = vks::initializers::descriptorImageInfo(VK_NULL_HANDLE, views[level], VK_IMAGE_LAYOUT_GENERAL);
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(descriptorSets[level], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &textures.environmentCube.descriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[level], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &storageImageInfo),
+			};
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+	}
+
+	// Pipelines and descriptors for filtering the environment with compute shaders
+	void prepareComputeFilter()
+	{
+		const uint32_t setCount = textures.irradianceCube.mipLevels + textures.prefilteredCube.mipLevels + 1;
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount - 1),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, setCount);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &computeFilter.descriptorPool));
+
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &computeFilter.descriptorSetLayout));
+
+		prepareComputeFilterTarget(textures.irradianceCube, VK_FORMAT_R32G32B32A32_SFLOAT, computeFilter.irradianceViews, computeFilter.irradianceSets);
+		prepareComputeFilterTarget(textures.prefilteredCube, VK_FORMAT_R16G16B16A16_SFLOAT, computeFilter.prefilteredViews, computeFilter.prefilteredSets);
+
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(computeFilter.descriptorPool, &computeFilter.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &computeFilter.sphericalHarmonicsSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(computeFilter.sphericalHarmonicsSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &textures.environmentCube.descriptor),
+			vks::initializers::writeDescriptorSet(computeFilter.sphericalHarmonicsSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &shCoefficients.descriptor),
+		};
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(ComputeFilter::PushBlock), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(&computeFilter.descriptorSetLayout, 1);
+		pipelineLayoutCI.pushConstantRangeCount = 1;
+		pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &computeFilter.pipelineLayout));
+
+		VkComputePipelineCreateInfo computePipelineCI = vks::initializers::computePipelineCreateInfo(computeFilter.pipelineLayout, 0);
+		computePipelineCI.stage = loadShader(getShadersPath() + "pbribl/irradiancecube.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCI, nullptr, &computeFilter.irradiance));
+		computePipelineCI.stage = loadShader(getShadersPath() + "pbribl/prefilterenvmap.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCI, nullptr, &computeFilter.prefilter));
+		if (sphericalHarmonicsSupported) {
+			computePipelineCI.stage = loadShader(getShadersPath() + "pbribl/irradiancesh.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCI, nullptr, &computeFilter.sphericalHarmonics));
+		}
+
+		// The cube maps stay in the general layout, so they can be written again without layout transitions
+		// Cube maps loaded from the cache already are in that layout and must keep their contents
+		VkCommandBuffer cmdBuf = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		if (!computeFilter.irradianceCached) {
+			VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, textures.irradianceCube.mipLevels, 0, 6 };
+			vks::tools::setImageLayout(cmdBuf, textures.irradianceCube.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, subresourceRange);
+		}
+		if (!computeFilter.prefilteredCached) {
+			VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, textures.prefilteredCube.mipLevels, 0, 6 };
+			vks::tools::setImageLayout(cmdBuf, textures.prefilteredCube.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, subresourceRange);
+		}
+		vulkanDevice->flushCommandBuffer(cmdBuf, queue);
+	}
+
+	/*
+		Records the compute filter for all mip levels of the cube maps (or the spherical harmonics projection instead of the irradiance cube)
+		Each dispatch writes all six faces of one mip level, dispatches don't depend on each other so no barriers are needed between them
+	*/
+	void recordEnvironmentFilter(VkCommandBuffer cmdBuf)
+	{
+		// Wait for earlier reads of the filtered images (e.g. by the previous frame) before overwriting them
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		ComputeFilter::PushBlock pushBlock = { 0.0f, filterParams.numSamples, filterParams.deltaPhi, filterParams.deltaTheta };
+		if (sphericalHarmonics) {
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.sphericalHarmonics);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.pipelineLayout, 0, 1, &computeFilter.sphericalHarmonicsSet, 0, nullptr);
+			vkCmdDispatch(cmdBuf, 1, 1, 1);
+		} else {
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.irradiance);
+			vkCmdPushConstants(cmdBuf, computeFilter.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputeFilter::PushBlock), &pushBlock);
+			for (uint32_t level = 0; level < textures.irradianceCube.mipLevels; level++) {
+				const uint32_t levelDim = std::max(textures.irradianceCube.width >> level, 1u);
+				vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.pipelineLayout, 0, 1, &computeFilter.irradianceSets[level], 0, nullptr);
+				vkCmdDispatch(cmdBuf, (levelDim + 7) / 8, (levelDim + 7) / 8, 6);
+			}
+		}
+
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.prefilter);
+		for (uint32_t level = 0; level < textures.prefilteredCube.mipLevels; level++) {
+			const uint32_t levelDim = std::max(textures.prefilteredCube.width >> level, 1u);
+			pushBlock.roughness = (float)level / (float)(textures.prefilteredCube.mipLevels - 1);
+			vkCmdPushConstants(cmdBuf, computeFilter.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputeFilter::PushBlock), &pushBlock);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, computeFilter.pipelineLayout, 0, 1, &computeFilter.prefilteredSets[level], 0, nullptr);
+			vkCmdDispatch(cmdBuf, (levelDim + 7) / 8, (levelDim + 7) / 8, 6);
+		}
+
+		// Make the results visible to the fragment shaders sampling them
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Filters the environment once with a single submission
+	void filterEnvironment()
+	{
+		auto tStart = std::chrono::high_resolution_clock::now();
+		VkCommandBuffer cmdBuf = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		recordEnvironmentFilter(cmdBuf);
+		vulkanDevice->flushCommandBuffer(cmdBuf, queue);
+		auto tEnd = std::chrono::high_resolution_clock::now();
+		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+		std::cout << "Filtering environment with compute shaders " << (sphericalHarmonics ? "(spherical harmonics irradiance) " : "") << "took " << tDiff << " ms" << std::endl;
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -1344,6 +1659,13 @@ public:
 			&uniformBuffers.params,
 			sizeof(uboParams)));
 
+		// Spherical harmonics coefficients (nine vec4), written by the compute filter
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&shCoefficients,
+			sizeof(glm::vec4) * 9));
+
 		// Map persistent
 		VK_CHECK_RESULT(uniformBuffers.object.map());
 		VK_CHECK_RESULT(uniformBuffers.skybox.map());
@@ -1374,6 +1696,7 @@ public:
 		uboParams.lights[1] = glm::vec4(-p, -p*0.5f,  p, 1.0f);
 		uboParams.lights[2] = glm::vec4( p, -p*0.5f,  p, 1.0f);
 		uboParams.lights[3] = glm::vec4( p, -p*0.5f, -p, 1.0f);
+		uboParams.shIrradiance = sphericalHarmonics ? 1 : 0;
 
 		memcpy(uniformBuffers.params.mapped, &uboParams, sizeof(uboParams));
 	}
@@ -1394,9 +1717,25 @@ public:
 		VulkanExampleBase::prepare();
 		loadAssets();
 		generateBRDFLUT();
+		// Decides about the usage of the cube maps, so this needs to be known before they are created
+		computeFiltering = computeFilterSupported();
+		sphericalHarmonicsSupported = computeFiltering && vks::tools::shaderAvailable(getShadersPath() + "pbribl/irradiancesh.comp.spv") && vks::tools::shaderAvailable(getShadersPath() + "pbribl/pbribl_sh.frag.spv");
 		generateIrradianceCube();
 		generatePrefilteredCube();
 		prepareUniformBuffers();
+		if (computeFiltering) {
+			prepareComputeFilter();
+			// Filtered results are stored in the cache, so later runs can skip this
+			if (!computeFilter.irradianceCached || !computeFilter.prefilteredCached) {
+				filterEnvironment();
+				if (!computeFilter.irradianceCached) {
+					vks::ibl::store(computeFilter.irradianceCacheFile, vulkanDevice, queue, textures.irradianceCube.image, VK_FORMAT_R32G32B32A32_SFLOAT, textures.irradianceCube.width, textures.irradianceCube.mipLevels, 6, VK_IMAGE_LAYOUT_GENERAL);
+				}
+				if (!computeFilter.prefilteredCached) {
+					vks::ibl::store(computeFilter.prefilteredCacheFile, vulkanDevice, queue, textures.prefilteredCube.image, VK_FORMAT_R16G16B16A16_SFLOAT, textures.prefilteredCube.width, textures.prefilteredCube.mipLevels, 6, VK_IMAGE_LAYOUT_GENERAL);
+				}
+			}
+		}
 		setupDescriptors();
 		preparePipelines();
 		buildCommandBuffers();
@@ -1434,6 +1773,19 @@ public:
 			if (overlay->checkBox("Skybox", &displaySkybox)) {
 				buildCommandBuffers();
 			}
+			if (computeFiltering) {
+				if (sphericalHarmonicsSupported && overlay->checkBox("SH irradiance", &sphericalHarmonics)) {
+					updateParams();
+					// Only the irradiance representation in use is filtered, so the other one is out of date
+					filterEnvironment();
+					if (filterEveryFrame) {
+						buildCommandBuffers();
+					}
+				}
+				if (overlay->checkBox("Filter every frame", &filterEveryFrame)) {
+					buildCommandBuffers();
+				}
+			}
 		}
 	}
 
@@ -12,6 +12,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanIBLCache.h"
 
 #define ENABLE_VALIDATION false
 
@@ -20,6 +21,9 @@ class VulkanExample : public VulkanExampleBase
 public:
 	bool displaySkybox = true;
 
+	// Source of the generated lighting textures, part of their cache keys
+	std::string environmentFile;
+
 	struct Textures {
 		vks::TextureCubeMap environmentCube;
 		// Generated at runtime
@@ -174,7 +178,8 @@ public:
 		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
 		models.skybox.loadFromFile(getAssetPath() + "models/cube.gltf", vulkanDevice, queue, glTFLoadingFlags);
 		models.object.loadFromFile(getAssetPath() + "models/cerberus/cerberus.gltf", vulkanDevice, queue, glTFLoadingFlags);
-		textures.environmentCube.loadFromFile(getAssetPath() + "textures/hdr/gcanyon_cube.ktx", VK_FORMAT_R16G16B16A16_SFLOAT, vulkanDevice, queue);
+		environmentFile = getAssetPath() + "textures/hdr/gcanyon_cube.ktx";
+		textures.environmentCube.loadFromFile(environmentFile, VK_FORMAT_R16G16B16A16_SFLOAT, vulkanDevice, queue);
 		textures.albedoMap.loadFromFile(getAssetPath() + "models/cerberus/albedo.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 		textures.normalMap.loadFromFile(getAssetPath() + "models/cerberus/normal.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 		textures.aoMap.loadFromFile(getAssetPath() + "models/cerberus/ao.ktx", VK_FORMAT_R8_UNORM, vulkanDevice, queue);
@@ -291,6 +296,15 @@ public:
 		const VkFormat format = VK_FORMAT_R16G16_SFLOAT;	// R16G16 is supported pretty much everywhere
 		const int32_t dim = 512;
 
+		// The look-up-table doesn't depend on the environment, so it only needs to be generated again if the shaders change
+		const std::string cacheFile = vks::ibl::cacheFileName("brdflut", { getShadersPath() + "pbrtexture/genbrdflut.vert.spv", getShadersPath() + "pbrtexture/genbrdflut.frag.spv" }, { static_cast<float>(format), static_cast<float>(dim) });
+		if (vks::ibl::isCached(cacheFile)) {
+			textures.lutBrdf.loadKTX2File(cacheFile, VK_IMAGE_VIEW_TYPE_2D, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, vulkanDevice, queue, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading BRDF LUT from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
+
 		// Image
 		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
 		imageCI.imageType = VK_IMAGE_TYPE_2D;
@@ -302,7 +316,8 @@ public:
 		imageCI.arrayLayers = 1;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		// Transfer source for writing the image to the cache
+		imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.lutBrdf.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
@@ -485,6 +500,8 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating BRDF LUT took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.lutBrdf.image, format, dim, 1, 1);
 	}
 
 	// Generate an irradiance cube map from the environment cube map
@@ -495,6 +512,17 @@ public:
 		const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
 		const int32_t dim = 64;
 		const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
+		// Sampling deltas
+		const float deltaPhi = (2.0f * float(M_PI)) / 180.0f;
+		const float deltaTheta = (0.5f * float(M_PI)) / 64.0f;
+
+		const std::string cacheFile = vks::ibl::cacheFileName("irradiance", { environmentFile, getShadersPath() + "pbrtexture/filtercube.vert.spv", getShadersPath() + "pbrtexture/irradiancecube.frag.spv" }, { static_cast<float>(format), static_cast<float>(dim), deltaPhi, deltaTheta });
+		if (vks::ibl::isCached(cacheFile)) {
+			textures.irradianceCube.loadFromFile(cacheFile, format, vulkanDevice, queue);
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading irradiance cube from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
 
 		// Pre-filtered cube map
 		// Image
@@ -508,7 +536,7 @@ public:
 		imageCI.arrayLayers = 6;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 		imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.irradianceCube.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
@@ -682,9 +710,11 @@ public:
 		struct PushBlock {
 			glm::mat4 mvp;
 			// Sampling deltas
-			float deltaPhi = (2.0f * float(M_PI)) / 180.0f;
-			float deltaTheta = (0.5f * float(M_PI)) / 64.0f;
+			float deltaPhi;
+			float deltaTheta;
 		} pushBlock;
+		pushBlock.deltaPhi = deltaPhi;
+		pushBlock.deltaTheta = deltaTheta;
 
 		VkPipelineLayout pipelinelayout;
 		std::vector<VkPushConstantRange> pushConstantRanges = {
@@ -864,6 +894,8 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating irradiance cube with " << numMips << " mip levels took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.irradianceCube.image, format, dim, numMips, 6);
 	}
 
 	// Prefilter environment cubemap
@@ -875,6 +907,15 @@ public:
 		const VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
 		const int32_t dim = 512;
 		const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
+		const uint32_t numSamples = 32u;
+
+		const std::string cacheFile = vks::ibl::cacheFileName("prefilteredenv", { environmentFile, getShadersPath() + "pbrtexture/filtercube.vert.spv", getShadersPath() + "pbrtexture/prefilterenvmap.frag.spv" }, { static_cast<float>(format), static_cast<float>(dim), static_cast<float>(numSamples) });
+		if (vks::ibl::isCached(cacheFile)) {
+			textures.prefilteredCube.loadFromFile(cacheFile, format, vulkanDevice, queue);
+			auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << "Loading pre-filtered environment cube from cache took " << tDiff << " ms" << std::endl;
+			return;
+		}
 
 		// Pre-filtered cube map
 		// Image
@@ -888,7 +929,7 @@ public:
 		imageCI.arrayLayers = 6;
 		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 		imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &textures.prefilteredCube.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
@@ -1062,8 +1103,9 @@ public:
 		struct PushBlock {
 			glm::mat4 mvp;
 			float roughness;
-			uint32_t numSamples = 32u;
+			uint32_t numSamples;
 		} pushBlock;
+		pushBlock.numSamples = numSamples;
 
 		VkPipelineLayout pipelinelayout;
 		std::vector<VkPushConstantRange> pushConstantRanges = {
@@ -1244,6 +1286,8 @@ public:
 		auto tEnd = std::chrono::high_resolution_clock::now();
 		auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 		std::cout << "Generating pre-filtered enivornment cube with " << numMips << " mip levels took " << tDiff << " ms" << std::endl;
+
+		vks::ibl::store(cacheFile, vulkanDevice, queue, textures.prefilteredCube.image, format, dim, numMips, 6);
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
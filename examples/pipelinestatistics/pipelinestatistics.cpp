@@ -36,6 +36,7 @@ public:
 	int32_t cullMode = VK_CULL_MODE_BACK_BIT;
 	bool blending = false;
 	bool discard = false;
+	bool optimizeMeshes = false;
 	bool wireframe = false;
 	bool tessellation = false;
 
@@ -182,7 +183,7 @@ public:
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &models.objects[models.objectIndex].vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.objects[models.objectIndex].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.objects[models.objectIndex].indices.buffer, 0, models.objects[models.objectIndex].indices.type);
 
 			for (int32_t y = 0; y < gridSize; y++) {
 				for (int32_t x = 0; x < gridSize; x++) {
@@ -223,8 +224,13 @@ public:
 		std::vector<std::string> filenames = { "sphere.gltf", "teapot.gltf", "torusknot.gltf", "venus.gltf" };
 		models.names = { "Sphere", "Teapot", "Torusknot", "Venus" };
 		models.objects.resize(filenames.size());
+		uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::FlipY;
+		// Optimized meshes need less vertex shader invocations, which can be seen in the pipeline statistics
+		if (optimizeMeshes) {
+			glTFLoadingFlags |= vkglTF::FileLoadingFlags::OptimizeMeshes;
+		}
 		for (size_t i = 0; i < filenames.size(); i++) {
-			models.objects[i].loadFromFile(getAssetPath() + "models/" + filenames[i], vulkanDevice, queue, vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::FlipY);
+			models.objects[i].loadFromFile(getAssetPath() + "models/" + filenames[i], vulkanDevice, queue, glTFLoadingFlags);
 		}
 	}
 
@@ -413,6 +419,12 @@ public:
 				preparePipelines();
 				buildCommandBuffers();
 			}
+			if (overlay->checkBox("Optimize meshes", &optimizeMeshes)) {
+				vkDeviceWaitIdle(device);
+				models.objects.clear();
+				loadAssets();
+				buildCommandBuffers();
+			}
 		}
 		if (!pipelineStats.empty()) {
 			if (overlay->header("Pipeline statistics")) {
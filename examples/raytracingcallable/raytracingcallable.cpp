@@ -2,6 +2,7 @@
 * Vulkan Example - Hardware accelerated ray tracing callable shaders example
 *
 * Dynamically calls different shaders based on the geometry id in the closest hit shader
+* The triangles are animated, with the acceleration structures being refit every frame instead of rebuilt
 *
 * Relevant code parts are marked with [POI]
 *
@@ -11,12 +12,18 @@
 */
 
 #include "VulkanRaytracingSample.h"
+#include "VulkanDynamicAccelerationStructure.h"
 
 class VulkanExample : public VulkanRaytracingSample
 {
 public:
-	AccelerationStructure bottomLevelAS;
-	AccelerationStructure topLevelAS;
+	// [POI] Both acceleration structures are created with ALLOW_UPDATE, so they can be refit when the triangles move
+	vks::DynamicAccelerationStructure* bottomLevelAS = nullptr;
+	vks::DynamicAccelerationStructure* topLevelAS = nullptr;
+	// Acceleration structure updates are recorded into a separate command buffer per frame, submitted ahead of the draw command buffer
+	std::vector<VkCommandBuffer> updateCmdBuffers;
+	uint32_t updateFrameIndex = 0;
+	bool animate = true;
 
 	std::vector<VkRayTracingShaderGroupCreateInfoKHR> shaderGroups{};
 	struct ShaderBindingTables {
@@ -62,8 +69,9 @@ public:
 			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 			deleteStorageImage();
-			deleteAccelerationStructure(bottomLevelAS);
-			deleteAccelerationStructure(topLevelAS);
+			delete bottomLevelAS;
+			delete topLevelAS;
+			vkFreeCommandBuffers(device, cmdPool, static_cast<uint32_t>(updateCmdBuffers.size()), updateCmdBuffers.data());
 			shaderBindingTables.raygen.destroy();
 			shaderBindingTables.miss.destroy();
 			shaderBindingTables.hit.destroy();
@@ -110,6 +118,8 @@ public:
 			&transformBuffer,
 			objectCount * sizeof(VkTransformMatrixKHR),
 			transformMatrices.data()));
+		// Kept mapped, the transforms are animated
+		VK_CHECK_RESULT(transformBuffer.map());
 
 		// Create buffers
 		// For the sake of simplicity we won't stage the vertex data to the GPU memory
@@ -139,7 +149,6 @@ public:
 		uint32_t numTriangles = 1;
 
 		// Our scene will consist of three different triangles, that'll be distinguished in the shader via gl_GeometryIndexEXT, so we add three geometries to the bottom level AS
-		std::vector<uint32_t> geometryCounts;
 		std::vector<VkAccelerationStructureGeometryKHR> accelerationStructureGeometries;
 		for (uint32_t i = 0; i < objectCount; i++) {
 			VkAccelerationStructureGeometryKHR accelerationStructureGeometry = vks::initializers::accelerationStructureGeometryKHR();
@@ -154,38 +163,8 @@ public:
 			accelerationStructureGeometry.geometry.triangles.indexData = indexBufferDeviceAddress;
 			accelerationStructureGeometry.geometry.triangles.transformData = transformBufferDeviceAddress;
 			accelerationStructureGeometries.push_back(accelerationStructureGeometry);
-			geometryCounts.push_back(1);
 		}
 
-		// Get size info
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = static_cast<uint32_t>(accelerationStructureGeometries.size());
-		accelerationStructureBuildGeometryInfo.pGeometries = accelerationStructureGeometries.data();
-
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo = vks::initializers::accelerationStructureBuildSizesInfoKHR();
-		vkGetAccelerationStructureBuildSizesKHR(
-			device,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			geometryCounts.data(),
-			&accelerationStructureBuildSizesInfo);
-
-		createAccelerationStructure(bottomLevelAS, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, accelerationStructureBuildSizesInfo);
-
-		// Create a small scratch buffer used during build of the bottom level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationBuildGeometryInfo.dstAccelerationStructure = bottomLevelAS.handle;
-		accelerationBuildGeometryInfo.geometryCount = static_cast<uint32_t>(accelerationStructureGeometries.size());
-		accelerationBuildGeometryInfo.pGeometries = accelerationStructureGeometries.data();
-		accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
 		// [POI] The bottom level acceleration structure for this sample contains three separate triangle geometries, so we can use gl_GeometryIndexEXT in the closest hit shader to select different callable shaders
 		std::vector<VkAccelerationStructureBuildRangeInfoKHR> accelerationStructureBuildRangeInfos{};
 		for (uint32_t i = 0; i < objectCount; i++) {
@@ -196,108 +175,86 @@ public:
 			accelerationStructureBuildRangeInfo.transformOffset = i * sizeof(VkTransformMatrixKHR);
 			accelerationStructureBuildRangeInfos.push_back(accelerationStructureBuildRangeInfo);
 		}
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfos[0], &accelerationStructureBuildRangeInfos[1], &accelerationStructureBuildRangeInfos[2] };
 
-		// Build the acceleration structure on the device via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer device builds
+		// The structure is built with the first call to record, later calls refit it to the animated transforms
+		bottomLevelAS = new vks::DynamicAccelerationStructure(vulkanDevice);
+		bottomLevelAS->createBottomLevel(accelerationStructureGeometries, accelerationStructureBuildRangeInfos);
+	}
+
+	/*
+		The top level acceleration structure contains the scene's object instances
+	*/
+	void createTopLevelAccelerationStructure()
+	{
+		// The instance buffer is double buffered, so the instance of the next frame never overwrites data that the previous frame's update may still read
+		topLevelAS = new vks::DynamicAccelerationStructure(vulkanDevice);
+		topLevelAS->createTopLevel(1, 2);
+		updateTransforms();
+
+		// Initial build of both structures, updates are recorded per frame in draw
 		VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationBuildGeometryInfo,
-			accelerationBuildStructureRangeInfos.data());
+		bottomLevelAS->record(commandBuffer);
+		topLevelAS->record(commandBuffer);
 		vulkanDevice->flushCommandBuffer(commandBuffer, queue);
 
-		deleteScratchBuffer(scratchBuffer);
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 2);
+		updateCmdBuffers.resize(2);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, updateCmdBuffers.data()));
+	}
+
+	VkTransformMatrixKHR transformMatrixKHR(const glm::mat4& matrix)
+	{
+		// VkTransformMatrixKHR is a row-major 3x4 matrix, glm matrices are column-major
+		VkTransformMatrixKHR transformMatrix;
+		for (uint32_t row = 0; row < 3; row++) {
+			for (uint32_t column = 0; column < 4; column++) {
+				transformMatrix.matrix[row][column] = matrix[column][row];
+			}
+		}
+		return transformMatrix;
 	}
 
 	/*
-		The top level acceleration structure contains the scene's object instances
+		[POI] Animates the geometry transforms inside the bottom level acceleration structure and the instance transform of the top level acceleration structure
 	*/
-	void createTopLevelAccelerationStructure()
+	void updateTransforms()
 	{
-		VkTransformMatrixKHR transformMatrix = {
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f };
+		const float angle = timer * 360.0f;
+
+		// Each triangle spins around its own center, which deforms the bottom level acceleration structure
+		std::vector<VkTransformMatrixKHR> transformMatrices(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++) {
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3((float)i * 3.0f - 3.0f, 0.0f, 0.0f));
+			transform = glm::rotate(transform, glm::radians(angle + (float)i * 120.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+			transformMatrices[i] = transformMatrixKHR(transform);
+		}
+		memcpy(transformBuffer.mapped, transformMatrices.data(), objectCount * sizeof(VkTransformMatrixKHR));
 
+		// The whole group moves up and down, which only changes the instance in the top level acceleration structure
 		VkAccelerationStructureInstanceKHR instance{};
-		instance.transform = transformMatrix;
+		instance.transform = transformMatrixKHR(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, sin(glm::radians(angle)) * 1.5f, 0.0f)));
 		instance.instanceCustomIndex = 0;
 		instance.mask = 0xFF;
 		instance.instanceShaderBindingTableRecordOffset = 0;
 		instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-		instance.accelerationStructureReference = bottomLevelAS.deviceAddress;
-
-		// Buffer for instance data
-		vks::Buffer instancesBuffer;
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&instancesBuffer,
-			sizeof(VkAccelerationStructureInstanceKHR),
-			&instance));
-
-		VkDeviceOrHostAddressConstKHR instanceDataDeviceAddress{};
-		instanceDataDeviceAddress.deviceAddress = getBufferDeviceAddress(instancesBuffer.buffer);
-
-		VkAccelerationStructureGeometryKHR accelerationStructureGeometry = vks::initializers::accelerationStructureGeometryKHR();
-		accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-		accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-		accelerationStructureGeometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-		accelerationStructureGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
-		accelerationStructureGeometry.geometry.instances.data = instanceDataDeviceAddress;
-
-		// Get size info
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = 1;
-		accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-		uint32_t primitive_count = 1;
-
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo = vks::initializers::accelerationStructureBuildSizesInfoKHR();
-		vkGetAccelerationStructureBuildSizesKHR(
-			device,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			&primitive_count,
-			&accelerationStructureBuildSizesInfo);
-
-		createAccelerationStructure(topLevelAS, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, accelerationStructureBuildSizesInfo);
-
-		// Create a small scratch buffer used during build of the top level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationBuildGeometryInfo.dstAccelerationStructure = topLevelAS.handle;
-		accelerationBuildGeometryInfo.geometryCount = 1;
-		accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-		accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
-		VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
-		accelerationStructureBuildRangeInfo.primitiveCount = 1;
-		accelerationStructureBuildRangeInfo.primitiveOffset = 0;
-		accelerationStructureBuildRangeInfo.firstVertex = 0;
-		accelerationStructureBuildRangeInfo.transformOffset = 0;
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-
-		// Build the acceleration structure on the device via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer device builds
-		VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationBuildGeometryInfo,
-			accelerationBuildStructureRangeInfos.data());
-		vulkanDevice->flushCommandBuffer(commandBuffer, queue);
+		instance.accelerationStructureReference = bottomLevelAS->accelerationStructure.deviceAddress;
+		topLevelAS->setInstances({ instance });
+	}
 
-		deleteScratchBuffer(scratchBuffer);
-		instancesBuffer.destroy();
+	/*
+		Records the refit (or rebuild, if the refit quality degraded too much) of the acceleration structures for the current frame
+	*/
+	VkCommandBuffer recordAccelerationStructureUpdates()
+	{
+		updateFrameIndex = (updateFrameIndex + 1) % static_cast<uint32_t>(updateCmdBuffers.size());
+		VkCommandBuffer commandBuffer = updateCmdBuffers[updateFrameIndex];
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
+		// The bottom level structure has to be updated first, as the top level structure's bounds depend on it
+		bottomLevelAS->record(commandBuffer);
+		topLevelAS->record(commandBuffer);
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+		return commandBuffer;
 	}
 
 	/*
@@ -359,7 +316,7 @@ public:
 
 		VkWriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructureInfo = vks::initializers::writeDescriptorSetAccelerationStructureKHR();
 		descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
-		descriptorAccelerationStructureInfo.pAccelerationStructures = &topLevelAS.handle;
+		descriptorAccelerationStructureInfo.pAccelerationStructures = &topLevelAS->accelerationStructure.handle;
 
 		VkWriteDescriptorSet accelerationStructureWrite{};
 		accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -630,8 +587,14 @@ public:
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+		std::vector<VkCommandBuffer> commandBuffers = { drawCmdBuffers[currentBuffer] };
+		if (animate && !paused) {
+			updateTransforms();
+			// The barriers recorded after the updates also order them against the ray tracing commands of the draw command buffer
+			commandBuffers.insert(commandBuffers.begin(), recordAccelerationStructureUpdates());
+		}
+		submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+		submitInfo.pCommandBuffers = commandBuffers.data();
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
 		VulkanExampleBase::submitFrame();
 	}
@@ -644,6 +607,17 @@ public:
 		if (!paused || camera.updated)
 			updateUniformBuffers();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			overlay->checkBox("Animate", &animate);
+		}
+		if (overlay->header("Acceleration structures")) {
+			overlay->text("Top level: %d refits, %d rebuilds", topLevelAS->statistics.updateCount, topLevelAS->statistics.rebuildCount);
+			overlay->text("Bottom level: %d refits, %d rebuilds", bottomLevelAS->statistics.updateCount, bottomLevelAS->statistics.rebuildCount);
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
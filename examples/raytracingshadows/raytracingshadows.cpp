@@ -10,6 +10,7 @@
 
 #include "VulkanRaytracingSample.h"
 #include "VulkanglTFModel.h"
+#include "VulkanTemporalAccumulation.h"
 
 class VulkanExample : public VulkanRaytracingSample
 {
@@ -29,6 +30,9 @@ public:
 		glm::mat4 projInverse;
 		glm::vec4 lightPos;
 		int32_t vertexSize;
+		// Selects the pixels traced in this frame if only some pixels are traced per frame
+		uint32_t frame = 0;
+		uint32_t rayBudget = 1;
 	} uniformData;
 	vks::Buffer ubo;
 
@@ -39,6 +43,13 @@ public:
 
 	vkglTF::Model scene;
 
+	// Traces only some of the pixels per frame and reconstructs the image from the reprojected results of the previous frames
+	vks::TemporalAccumulation* temporalAccumulation = nullptr;
+	bool sparseTracing = false;
+	int32_t rayBudgetIndex = 0;
+	int32_t maxHistoryLength = 16;
+	int32_t filterIterations = 3;
+
 	// This sample is derived from an extended base class that saves most of the ray tracing setup boiler plate
 	VulkanExample() : VulkanRaytracingSample()
 	{
@@ -57,6 +68,7 @@ public:
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 		deleteStorageImage();
+		delete temporalAccumulation;
 		deleteAccelerationStructure(bottomLevelAS);
 		deleteAccelerationStructure(topLevelAS);
 		shaderBindingTables.raygen.destroy();
@@ -99,53 +111,15 @@ public:
 		accelerationStructureGeometry.geometry.triangles.transformData.deviceAddress = 0;
 		accelerationStructureGeometry.geometry.triangles.transformData.hostAddress = nullptr;
 
-		// Get size info
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = 1;
-		accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo = vks::initializers::accelerationStructureBuildSizesInfoKHR();
-		vkGetAccelerationStructureBuildSizesKHR(
-			device,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			&numTriangles,
-			&accelerationStructureBuildSizesInfo);
-
-		createAccelerationStructure(bottomLevelAS, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, accelerationStructureBuildSizesInfo);
-
-		// Create a small scratch buffer used during build of the bottom level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo = vks::initializers::accelerationStructureBuildGeometryInfoKHR();
-		accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationBuildGeometryInfo.dstAccelerationStructure = bottomLevelAS.handle;
-		accelerationBuildGeometryInfo.geometryCount = 1;
-		accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-		accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
 		VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
 		accelerationStructureBuildRangeInfo.primitiveCount = numTriangles;
 		accelerationStructureBuildRangeInfo.primitiveOffset = 0;
 		accelerationStructureBuildRangeInfo.firstVertex = 0;
 		accelerationStructureBuildRangeInfo.transformOffset = 0;
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-
-		// Build the acceleration structure on the device via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer device builds
-		VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationBuildGeometryInfo,
-			accelerationBuildStructureRangeInfos.data());
-		vulkanDevice->flushCommandBuffer(commandBuffer, queue);
 
-		deleteScratchBuffer(scratchBuffer);
+		// The builder creates the acceleration structure, builds it on the device with scratch memory from its shared pool and compacts it
+		accelerationStructureBuilder->add(bottomLevelAS, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, { accelerationStructureGeometry }, { accelerationStructureBuildRangeInfo });
+		accelerationStructureBuilder->build();
 	}
 
 	/*
@@ -281,7 +255,7 @@ public:
 	{
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			{ VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 },
 			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
 			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 }
 		};
@@ -304,7 +278,10 @@ public:
 		accelerationStructureWrite.descriptorCount = 1;
 		accelerationStructureWrite.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
 
+		// With sparse tracing the ray generation shader writes samples and distances for the temporal accumulation instead of the final image
 		VkDescriptorImageInfo storageImageDescriptor{ VK_NULL_HANDLE, storageImage.view, VK_IMAGE_LAYOUT_GENERAL };
+		VkDescriptorImageInfo resultImageDescriptor = sparseTracing ? temporalAccumulation->sampleDescriptor : storageImageDescriptor;
+		VkDescriptorImageInfo distanceImageDescriptor = sparseTracing ? temporalAccumulation->distanceDescriptor : storageImageDescriptor;
 		VkDescriptorBufferInfo vertexBufferDescriptor{ scene.vertices.buffer, 0, VK_WHOLE_SIZE };
 		VkDescriptorBufferInfo indexBufferDescriptor{ scene.indices.buffer, 0, VK_WHOLE_SIZE };
 
@@ -312,13 +289,15 @@ public:
 			// Binding 0: Top level acceleration structure
 			accelerationStructureWrite,
 			// Binding 1: Ray tracing result image
-			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &storageImageDescriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &resultImageDescriptor),
 			// Binding 2: Uniform data
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &ubo.descriptor),
 			// Binding 3: Scene vertex buffer
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &vertexBufferDescriptor),
 			// Binding 4: Scene index buffer
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &indexBufferDescriptor),
+			// Binding 5: Primary hit distances (sparse tracing only)
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &distanceImageDescriptor),
 		};
 		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, VK_NULL_HANDLE);
 	}
@@ -339,6 +318,8 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, 3),
 			// Binding 4: Index buffer
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, 4),
+			// Binding 5: Distance image
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR, 5),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
@@ -351,10 +332,11 @@ public:
 			Setup ray tracing shader groups
 		*/
 		std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+		const std::string shaderSuffix = sparseTracing ? "_sparse" : "";
 
 		// Ray generation group
 		{
-			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/raygen.rgen.spv", VK_SHADER_STAGE_RAYGEN_BIT_KHR));
+			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/raygen" + shaderSuffix + ".rgen.spv", VK_SHADER_STAGE_RAYGEN_BIT_KHR));
 			VkRayTracingShaderGroupCreateInfoKHR shaderGroup{};
 			shaderGroup.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
 			shaderGroup.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR;
@@ -367,7 +349,7 @@ public:
 
 		// Miss group
 		{
-			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/miss.rmiss.spv", VK_SHADER_STAGE_MISS_BIT_KHR));
+			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/miss" + shaderSuffix + ".rmiss.spv", VK_SHADER_STAGE_MISS_BIT_KHR));
 			VkRayTracingShaderGroupCreateInfoKHR shaderGroup{};
 			shaderGroup.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
 			shaderGroup.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR;
@@ -384,7 +366,7 @@ public:
 
 		// Closest hit group
 		{
-			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/closesthit.rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR));
+			shaderStages.push_back(loadShader(getShadersPath() + "raytracingshadows/closesthit" + shaderSuffix + ".rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR));
 			VkRayTracingShaderGroupCreateInfoKHR shaderGroup{};
 			shaderGroup.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
 			shaderGroup.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR;
@@ -430,6 +412,15 @@ public:
 		createStorageImage(swapChain.colorFormat, { width, height, 1 });
 		// Update descriptor
 		VkDescriptorImageInfo storageImageDescriptor{ VK_NULL_HANDLE, storageImage.view, VK_IMAGE_LAYOUT_GENERAL };
+		if (sparseTracing) {
+			temporalAccumulation->create(width, height, storageImage.view, queue);
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &temporalAccumulation->sampleDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &temporalAccumulation->distanceDescriptor),
+			};
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, VK_NULL_HANDLE);
+			return;
+		}
 		VkWriteDescriptorSet resultImageWrite = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &storageImageDescriptor);
 		vkUpdateDescriptorSets(device, 1, &resultImageWrite, 0, VK_NULL_HANDLE);
 	}
@@ -458,6 +449,8 @@ public:
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipelineLayout, 0, 1, &descriptorSet, 0, 0);
 
+			// With sparse tracing fewer rays are launched, and the full image is reconstructed by the temporal accumulation
+			const VkExtent2D traceExtent = sparseTracing ? temporalAccumulation->getTraceExtent() : VkExtent2D{ width, height };
 			VkStridedDeviceAddressRegionKHR emptySbtEntry = {};
 			vkCmdTraceRaysKHR(
 				drawCmdBuffers[i],
@@ -465,10 +458,14 @@ public:
 				&shaderBindingTables.miss.stridedDeviceAddressRegion,
 				&shaderBindingTables.hit.stridedDeviceAddressRegion,
 				&emptySbtEntry,
-				width,
-				height,
+				traceExtent.width,
+				traceExtent.height,
 				1);
 
+			if (sparseTracing) {
+				temporalAccumulation->record(drawCmdBuffers[i]);
+			}
+
 			/*
 				Copy ray tracing output to swap chain image
 			*/
@@ -526,6 +523,11 @@ public:
 		uniformData.lightPos = glm::vec4(cos(glm::radians(timer * 360.0f)) * 40.0f, -50.0f + sin(glm::radians(timer * 360.0f)) * 20.0f, 25.0f + sin(glm::radians(timer * 360.0f)) * 5.0f, 0.0f);
 		// Pass the vertex size to the shader for unpacking vertices
 		uniformData.vertexSize = sizeof(vkglTF::Vertex);
+		if (sparseTracing) {
+			temporalAccumulation->update(camera.matrices.view, camera.matrices.perspective);
+			uniformData.frame = temporalAccumulation->getFrameIndex();
+			uniformData.rayBudget = static_cast<uint32_t>(temporalAccumulation->rayBudget);
+		}
 		memcpy(ubo.mapped, &uniformData, sizeof(uniformData));
 	}
 
@@ -555,6 +557,21 @@ public:
 		createTopLevelAccelerationStructure();
 
 		createStorageImage(swapChain.colorFormat, { width, height, 1 });
+		// Sparse tracing needs the temporal accumulation shaders and the sparse variants of the ray tracing shaders
+		// All of them are checked first, so no accumulation resources are created if any of them is missing
+		sparseTracing = vks::TemporalAccumulation::isSupported(getShadersPath() + "base/");
+		for (auto& shader : { "raygen_sparse.rgen.spv", "miss_sparse.rmiss.spv", "closesthit_sparse.rchit.spv" }) {
+			sparseTracing = sparseTracing && vks::tools::shaderAvailable(getShadersPath() + "raytracingshadows/" + shader);
+		}
+		if (sparseTracing) {
+			temporalAccumulation = new vks::TemporalAccumulation(vulkanDevice, getShadersPath() + "base/");
+			sparseTracing = temporalAccumulation->isAvailable();
+		}
+		if (sparseTracing) {
+			temporalAccumulation->create(width, height, storageImage.view, queue);
+		} else {
+			std::cerr << "Sparse ray tracing shaders not found, tracing every pixel\n";
+		}
 		createUniformBuffer();
 		createRayTracingPipeline();
 		createShaderBindingTables();
@@ -577,9 +594,26 @@ public:
 		if (!prepared)
 			return;
 		draw();
-		if (!paused || camera.updated)
+		// The temporal accumulation needs the camera of every frame for reprojection
+		if (!paused || camera.updated || sparseTracing)
 			updateUniformBuffers();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (sparseTracing && overlay->header("Temporal accumulation")) {
+			if (overlay->comboBox("Rays per pixel", &rayBudgetIndex, { "1", "1/2", "1/4" })) {
+				const vks::TemporalAccumulation::RayBudget rayBudgets[3] = { vks::TemporalAccumulation::RayBudgetFull, vks::TemporalAccumulation::RayBudgetHalf, vks::TemporalAccumulation::RayBudgetQuarter };
+				temporalAccumulation->rayBudget = rayBudgets[rayBudgetIndex];
+			}
+			if (overlay->sliderInt("History length", &maxHistoryLength, 1, 32)) {
+				temporalAccumulation->settings.maxHistoryLength = static_cast<uint32_t>(maxHistoryLength);
+			}
+			if (overlay->sliderInt("Filter iterations", &filterIterations, 0, 5)) {
+				temporalAccumulation->settings.filterIterations = static_cast<uint32_t>(filterIterations);
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
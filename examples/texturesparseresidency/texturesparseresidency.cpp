@@ -8,10 +8,73 @@
 
 /*
 * Note : This sample is work-in-progress and works basically, but it's not yet finished
+*
+* The texture is streamed from a tiled page file: the fragment shader writes the pages it samples into a feedback buffer,
+* the host reads that buffer back after each frame, loads missing pages on worker threads and binds them from a pooled heap.
+* Pages that haven't been used for the longest time are evicted once the memory budget is reached
 */
 
 #include "texturesparseresidency.h"
 
+/*
+	Page pool
+	Sub-allocates page sized slots from a few large memory blocks
+ */
+
+void PagePool::create(VkDevice device, VkDeviceSize pageSize, uint32_t memoryTypeIndex, VkDeviceSize memoryBudget)
+{
+	this->device = device;
+	this->pageSize = pageSize;
+	this->memoryTypeIndex = memoryTypeIndex;
+	maxPages = std::max(static_cast<uint32_t>(memoryBudget / pageSize), 1u);
+	pagesPerBlock = std::min(pagesPerBlock, maxPages);
+}
+
+// Returns false if the memory budget has been exhausted
+bool PagePool::allocate(VkDeviceMemory& memory, VkDeviceSize& offset)
+{
+	if (usedPages >= maxPages)
+	{
+		return false;
+	}
+	if (freeSlots.empty())
+	{
+		// Blocks are allocated on demand, so memory is only committed for pages that are actually used
+		VkMemoryAllocateInfo allocInfo = vks::initializers::memoryAllocateInfo();
+		allocInfo.allocationSize = pageSize * pagesPerBlock;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+		VkDeviceMemory block;
+		VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &block));
+		blocks.push_back(block);
+		for (uint32_t i = pagesPerBlock; i > 0; i--)
+		{
+			freeSlots.push_back({ block, (i - 1) * pageSize });
+		}
+	}
+	memory = freeSlots.back().memory;
+	offset = freeSlots.back().offset;
+	freeSlots.pop_back();
+	usedPages++;
+	return true;
+}
+
+void PagePool::free(VkDeviceMemory memory, VkDeviceSize offset)
+{
+	freeSlots.push_back({ memory, offset });
+	usedPages--;
+}
+
+void PagePool::destroy()
+{
+	for (auto block : blocks)
+	{
+		vkFreeMemory(device, block, nullptr);
+	}
+	blocks.clear();
+	freeSlots.clear();
+	usedPages = 0;
+}
+
 /*
 	Virtual texture page 
 	Contains all functions and objects for a single page of a virtual texture
@@ -28,20 +91,18 @@ bool VirtualTexturePage::resident()
 	return (imageMemoryBind.memory != VK_NULL_HANDLE);
 }
 
-// Allocate Vulkan memory for the virtual page
-void VirtualTexturePage::allocate(VkDevice device, uint32_t memoryTypeIndex)
+// Assign a slot of the page pool to the virtual page, returns false if the pool is exhausted
+bool VirtualTexturePage::allocate(PagePool& pool)
 {
 	if (imageMemoryBind.memory != VK_NULL_HANDLE)
 	{
-		return;
+		return true;
 	};
 
-	imageMemoryBind = {};
-
-	VkMemoryAllocateInfo allocInfo = vks::initializers::memoryAllocateInfo();
-	allocInfo.allocationSize = size;
-	allocInfo.memoryTypeIndex = memoryTypeIndex;
-	VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemoryBind.memory));
+	if (!pool.allocate(imageMemoryBind.memory, imageMemoryBind.memoryOffset))
+	{
+		return false;
+	}
 
 	VkImageSubresource subResource{};
 	subResource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -52,16 +113,19 @@ void VirtualTexturePage::allocate(VkDevice device, uint32_t memoryTypeIndex)
 	imageMemoryBind.subresource = subResource;
 	imageMemoryBind.extent = extent;
 	imageMemoryBind.offset = offset;
+	return true;
 }
 
-// Release Vulkan memory allocated for this page
-void VirtualTexturePage::release(VkDevice device)
+// Return the pool slot used by this page
+void VirtualTexturePage::release(PagePool& pool)
 {
 	if (imageMemoryBind.memory != VK_NULL_HANDLE)
 	{
-		vkFreeMemory(device, imageMemoryBind.memory, nullptr);
+		pool.free(imageMemoryBind.memory, imageMemoryBind.memoryOffset);
 		imageMemoryBind.memory = VK_NULL_HANDLE;
+		imageMemoryBind.memoryOffset = 0;
 	}
+	state = PageState::NonResident;
 }
 
 /*
@@ -86,20 +150,17 @@ VirtualTexturePage* VirtualTexture::addPage(VkOffset3D offset, VkExtent3D extent
 }
 
 // Call before sparse binding to update memory bind list etc.
-void VirtualTexture::updateSparseBindInfo()
+// Only the pages passed in are (re)bound, pages without memory are unbound
+void VirtualTexture::updateSparseBindInfo(const std::vector<VirtualTexturePage*>& bindingChangedPages, bool bindMipTail)
 {
-	// Update list of memory-backed sparse image memory binds
-	//sparseImageMemoryBinds.resize(pages.size());
+	// Update list of changed sparse image memory binds
 	sparseImageMemoryBinds.clear();
-	for (auto page : pages)
+	for (auto page : bindingChangedPages)
 	{
-		sparseImageMemoryBinds.push_back(page.imageMemoryBind);
+		sparseImageMemoryBinds.push_back(page->imageMemoryBind);
 	}
 	// Update sparse bind info
 	bindSparseInfo = vks::initializers::bindSparseInfo();
-	// todo: Semaphore for queue submission
-	// bindSparseInfo.signalSemaphoreCount = 1;
-	// bindSparseInfo.pSignalSemaphores = &bindSparseSemaphore;
 
 	// Image memory binds
 	imageMemoryBindInfo = {};
@@ -111,7 +172,7 @@ void VirtualTexture::updateSparseBindInfo()
 
 	// Opaque image memory binds for the mip tail
 	opaqueMemoryBindInfo.image = image;
-	opaqueMemoryBindInfo.bindCount = static_cast<uint32_t>(opaqueMemoryBinds.size());
+	opaqueMemoryBindInfo.bindCount = bindMipTail ? static_cast<uint32_t>(opaqueMemoryBinds.size()) : 0;
 	opaqueMemoryBindInfo.pBinds = opaqueMemoryBinds.data();
 	bindSparseInfo.imageOpaqueBindCount = (opaqueMemoryBindInfo.bindCount > 0) ? 1 : 0;
 	bindSparseInfo.pImageOpaqueBinds = &opaqueMemoryBindInfo;
@@ -120,10 +181,7 @@ void VirtualTexture::updateSparseBindInfo()
 // Release all Vulkan resources
 void VirtualTexture::destroy()
 {
-	for (auto page : pages)
-	{
-		page.release(device);
-	}
+	pagePool.destroy();
 	for (auto bind : opaqueMemoryBinds)
 	{
 		vkFreeMemory(device, bind.memory, nullptr);
@@ -147,12 +205,17 @@ VulkanExample::~VulkanExample()
 {
 	// Clean up used Vulkan resources
 	// Note : Inherited destructor cleans up resources stored in base class
+	// Loader threads need to finish before the staging buffer is destroyed
+	streaming.threadPool.wait();
+	streaming.threadPool.setThreadCount(0);
 	destroyTextureImage(texture);
-	vkDestroySemaphore(device, bindSparseSemaphore, nullptr);
+	vkDestroyFence(device, bindSparseFence, nullptr);
 	vkDestroyPipeline(device, pipeline, nullptr);
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 	uniformBufferVS.destroy();
+	feedbackBuffer.destroy();
+	streaming.stagingBuffer.destroy();
 }
 
 void VulkanExample::getEnabledFeatures()
@@ -166,6 +229,10 @@ void VulkanExample::getEnabledFeatures()
 	else {
 		std::cout << "Sparse binding not supported" << std::endl;
 	}
+	// Required for writing the page requests to the feedback buffer
+	if (deviceFeatures.fragmentStoresAndAtomics) {
+		enabledFeatures.fragmentStoresAndAtomics = VK_TRUE;
+	}
 }
 
 glm::uvec3 VulkanExample::alignedDivision(const VkExtent3D& extent, const VkExtent3D& granularity)
@@ -234,8 +301,9 @@ void VulkanExample::prepareSparseTexture(uint32_t width, uint32_t height, uint32
 	sparseImageCreateInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
 	VK_CHECK_RESULT(vkCreateImage(device, &sparseImageCreateInfo, nullptr, &texture.image));
 
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, texture.layerCount };
 	VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
 	vulkanDevice->flushCommandBuffer(copyCmd, queue);
 
 	// Get memory requirements
@@ -415,18 +483,17 @@ void VulkanExample::prepareSparseTexture(uint32_t width, uint32_t height, uint32
 		texture.opaqueMemoryBinds.push_back(sparseMemoryBind);
 	}
 
-	// Create signal semaphore for sparse binding
-	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &bindSparseSemaphore));
+	// Pages are sub-allocated from a pool that's limited by the memory budget, so the texture can be much larger than the available memory
+	texture.pagePool.create(device, sparseImageMemoryReqs.alignment, texture.memoryTypeIndex, streaming.memoryBudget);
 
-	// Prepare bind sparse info for reuse in queue submission
-	texture.updateSparseBindInfo();
+	VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
+	VK_CHECK_RESULT(vkCreateFence(device, &fenceInfo, nullptr, &bindSparseFence));
 
-	// Bind to queue
-	// todo: in draw?
-	vkQueueBindSparse(queue, 1, &texture.bindSparseInfo, VK_NULL_HANDLE);
-	//todo: use sparse bind semaphore
-	vkQueueWaitIdle(queue);
+	// The mip tail is always resident and serves as the fallback for pages that are not (yet) resident
+	texture.updateSparseBindInfo({}, true);
+	VK_CHECK_RESULT(vkQueueBindSparse(queue, 1, &texture.bindSparseInfo, bindSparseFence));
+	VK_CHECK_RESULT(vkWaitForFences(device, 1, &bindSparseFence, VK_TRUE, UINT64_MAX));
+	VK_CHECK_RESULT(vkResetFences(device, 1, &bindSparseFence));
 
 	// Create sampler
 	VkSamplerCreateInfo sampler = vks::initializers::samplerCreateInfo();
@@ -534,11 +601,12 @@ void VulkanExample::loadAssets()
 
 void VulkanExample::setupDescriptorPool()
 {
-	// Example uses one ubo and one image sampler
+	// Example uses one ubo, one image sampler and one storage buffer for the page feedback
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
 		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
-		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
 	};
 
 	VkDescriptorPoolCreateInfo descriptorPoolInfo =
@@ -554,16 +622,21 @@ void VulkanExample::setupDescriptorSetLayout()
 {
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 	{
-		// Binding 0 : Vertex shader uniform buffer
+		// Binding 0 : Vertex and fragment shader uniform buffer
 		vks::initializers::descriptorSetLayoutBinding(
 			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_VERTEX_BIT,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 			0),
 		// Binding 1 : Fragment shader image sampler
 		vks::initializers::descriptorSetLayoutBinding(
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			VK_SHADER_STAGE_FRAGMENT_BIT,
-			1)
+			1),
+		// Binding 2 : Fragment shader page feedback buffer
+		vks::initializers::descriptorSetLayoutBinding(
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_FRAGMENT_BIT,
+			2)
 	};
 
 	VkDescriptorSetLayoutCreateInfo descriptorLayout =
@@ -604,7 +677,13 @@ void VulkanExample::setupDescriptorSet()
 			descriptorSet,
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			1,
-			&texture.descriptor)
+			&texture.descriptor),
+		// Binding 2 : Fragment shader page feedback buffer
+		vks::initializers::writeDescriptorSet(
+			descriptorSet,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			2,
+			&feedbackBuffer.descriptor)
 	};
 
 	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
@@ -636,7 +715,8 @@ void VulkanExample::preparePipelines()
 	pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV });
 
 	shaderStages[0] = loadShader(getShadersPath() + "texturesparseresidency/sparseresidency.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-	shaderStages[1] = loadShader(getShadersPath() + "texturesparseresidency/sparseresidency.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+	// The feedback shader also writes the sampled pages to the feedback buffer and falls back to coarser resident levels
+	shaderStages[1] = loadShader(getShadersPath() + (feedbackStreaming ? "texturesparseresidency/sparseresidency_feedback.frag.spv" : "texturesparseresidency/sparseresidency.frag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT);
 	VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipeline));
 }
 
@@ -651,6 +731,18 @@ void VulkanExample::prepareUniformBuffers()
 		sizeof(uboVS),
 		&uboVS));
 
+	// Page feedback buffer, read back on the host after each frame
+	VK_CHECK_RESULT(vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&feedbackBuffer,
+		std::max(texture.pages.size(), (size_t)1) * sizeof(uint32_t)));
+	VK_CHECK_RESULT(feedbackBuffer.map());
+	memset(feedbackBuffer.mapped, 0, feedbackBuffer.size);
+
+	uboVS.pageExtent = glm::ivec2(texture.sparseImageMemoryRequirements.formatProperties.imageGranularity.width, texture.sparseImageMemoryRequirements.formatProperties.imageGranularity.height);
+	uboVS.mipTailStart = static_cast<int32_t>(texture.mipTailStart);
+
 	updateUniformBuffers();
 }
 
@@ -672,10 +764,20 @@ void VulkanExample::prepare()
 	if (!vulkanDevice->features.sparseResidencyImage2D) {
 		vks::tools::exitFatal("Device does not support sparse residency for 2D images!", VK_ERROR_FEATURE_NOT_PRESENT);
 	}
+	feedbackStreaming = vks::tools::shaderAvailable(getShadersPath() + "texturesparseresidency/sparseresidency_feedback.frag.spv");
+	if (!feedbackStreaming) {
+		std::cout << "Page feedback shader not found, streaming pages coarse to fine until the memory budget is reached" << std::endl;
+	}
+	if (feedbackStreaming && !vulkanDevice->features.fragmentStoresAndAtomics) {
+		vks::tools::exitFatal("Selected GPU does not support stores and atomic operations in the fragment stage", VK_ERROR_FEATURE_NOT_PRESENT);
+	}
 	loadAssets();
+	// Create a virtual texture that's much larger than the memory budget (does not take up any VRAM yet)
+	prepareSparseTexture(8192, 8192, 1, VK_FORMAT_R8G8B8A8_UNORM);
 	prepareUniformBuffers();
-	// Create a virtual texture with max. possible dimension (does not take up any VRAM yet)
-	prepareSparseTexture(4096, 4096, 1, VK_FORMAT_R8G8B8A8_UNORM);
+	preparePageFile();
+	prepareStreaming();
+	fillMipTail();
 	setupDescriptorSetLayout();
 	preparePipelines();
 	setupDescriptorPool();
@@ -689,204 +791,471 @@ void VulkanExample::render()
 	if (!prepared)
 		return;
 	draw();
-	if (camera.updated) {
-		updateUniformBuffers();
-	}
+	// The queue is idle after the frame has been submitted, so the feedback buffer can be read without further synchronization
+	updateVirtualTexture();
 }
 
-void VulkanExample::uploadContent(VirtualTexturePage page, VkImage image)
+// Procedural content of the virtual texture
+// Every mip level is generated directly (instead of downsampled) and tinted with a different color to visualize the streamed levels
+void VulkanExample::generateTexel(uint32_t x, uint32_t y, uint32_t mipLevel, uint32_t levelWidth, uint32_t levelHeight, uint8_t* texel)
 {
-	// Generate some random image data and upload as a buffer
-	const size_t bufferSize = 4 * page.extent.width * page.extent.height;
+	static const uint8_t mipColors[8][3] = {
+		{ 255, 255, 255 }, { 255, 96, 96 }, { 96, 255, 96 }, { 96, 96, 255 },
+		{ 255, 255, 96 }, { 255, 96, 255 }, { 96, 255, 255 }, { 192, 192, 192 }
+	};
+	const float u = (x + 0.5f) / levelWidth;
+	const float v = (y + 0.5f) / levelHeight;
+	// Checkerboard with concentric rings
+	const bool checker = ((static_cast<uint32_t>(u * 64.0f) + static_cast<uint32_t>(v * 64.0f)) & 1) == 0;
+	const float du = u - 0.5f;
+	const float dv = v - 0.5f;
+	const float ring = 0.75f + 0.25f * cosf(sqrtf(du * du + dv * dv) * 400.0f);
+	const float intensity = (checker ? 1.0f : 0.55f) * ring;
+	const uint8_t* tint = mipColors[mipLevel % 8];
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		texel[c] = static_cast<uint8_t>(tint[c] * intensity);
+	}
+	texel[3] = 255;
+}
 
-	vks::Buffer imageBuffer;
-	VK_CHECK_RESULT(vulkanDevice->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageBuffer,
-		bufferSize));
-	imageBuffer.map();
+// Creates the tiled page file the virtual texture is streamed from, an existing file is reused if its layout matches the virtual texture
+// Only the header, the page offset table and the mip tail are written up front, pages are generated and appended on first use
+void VulkanExample::preparePageFile()
+{
+	// The page file is only generated data, so it's stored with the other caches (or the temporary directory if caching is disabled)
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	// Assets are read-only on Android
+	std::string pageFileDirectory = androidApp->activity->internalDataPath;
+#else
+	std::string pageFileDirectory = vks::tools::getCacheDirectory("texturesparseresidency");
+	if (pageFileDirectory.empty()) {
+#if defined(_WIN32)
+		const char* tempDirectory = getenv("TEMP");
+		pageFileDirectory = tempDirectory ? tempDirectory : ".";
+#else
+		const char* tempDirectory = getenv("TMPDIR");
+		pageFileDirectory = tempDirectory ? tempDirectory : "/tmp";
+#endif
+	}
+#endif
+	streaming.pageFilePath = pageFileDirectory + "/texturesparseresidency.vtex";
+
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const uint64_t pageBytes = granularity.width * granularity.height * 4;
+
+	PageFileHeader header{};
+	memcpy(header.magic, "VTEX", 4);
+	header.version = 2;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.mipLevels = texture.mipLevels;
+	header.mipTailStart = texture.mipTailStart;
+	header.pageWidth = granularity.width;
+	header.pageHeight = granularity.height;
+	header.pageCount = static_cast<uint32_t>(texture.pages.size());
+	streaming.header = header;
+
+	uint64_t mipTailBytes = 0;
+	for (uint32_t mipLevel = texture.mipTailStart; mipLevel < texture.mipLevels; mipLevel++)
+	{
+		mipTailBytes += std::max(texture.width >> mipLevel, 1u) * std::max(texture.height >> mipLevel, 1u) * 4;
+	}
+	const uint64_t tableBytes = header.pageCount * sizeof(uint64_t);
+	streaming.pageOffsets.assign(header.pageCount, 0);
+	streaming.completePageFileSize = sizeof(header) + tableBytes + mipTailBytes + header.pageCount * pageBytes;
 
-	// Fill buffer with random colors
-	std::random_device rd;
-	std::mt19937 rndEngine(rd());
-	std::uniform_int_distribution<uint32_t> rndDist(0, 255);
-	uint8_t* data = (uint8_t*)imageBuffer.mapped;
-	uint8_t rndVal[4] = { 0, 0, 0, 0 };
-	while (rndVal[0] + rndVal[1] + rndVal[2] < 10) {
-		rndVal[0] = (uint8_t)rndDist(rndEngine);
-		rndVal[1] = (uint8_t)rndDist(rndEngine);
-		rndVal[2] = (uint8_t)rndDist(rndEngine);
+	bool reuse = false;
+	std::ifstream is(streaming.pageFilePath, std::ios::binary);
+	if (is.is_open())
+	{
+		PageFileHeader fileHeader;
+		is.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+		if (is && (memcmp(&fileHeader, &header, sizeof(header)) == 0))
+		{
+			is.read(reinterpret_cast<char*>(streaming.pageOffsets.data()), tableBytes);
+			reuse = !is.fail();
+		}
 	}
-	rndVal[3] = 255;
+	is.close();
 
-	for (uint32_t y = 0; y < page.extent.height; y++)
+	if (!reuse)
 	{
-		for (uint32_t x = 0; x < page.extent.width; x++)
+		std::ofstream os(streaming.pageFilePath, std::ios::binary | std::ios::trunc);
+		if (!os.is_open())
+		{
+			vks::tools::exitFatal("Could not create page file \"" + streaming.pageFilePath + "\"", -1);
+		}
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		streaming.pageOffsets.assign(header.pageCount, 0);
+		os.write(reinterpret_cast<const char*>(streaming.pageOffsets.data()), tableBytes);
+
+		// The mip tail is small and always resident, so it's generated right away
+		for (uint32_t mipLevel = texture.mipTailStart; mipLevel < texture.mipLevels; mipLevel++)
 		{
-			for (uint32_t c = 0; c < 4; c++, ++data)
+			const uint32_t levelWidth = std::max(texture.width >> mipLevel, 1u);
+			const uint32_t levelHeight = std::max(texture.height >> mipLevel, 1u);
+			std::vector<uint8_t> level(levelWidth * levelHeight * 4);
+			for (uint32_t y = 0; y < levelHeight; y++)
 			{
-				*data = rndVal[c];
+				for (uint32_t x = 0; x < levelWidth; x++)
+				{
+					generateTexel(x, y, mipLevel, levelWidth, levelHeight, &level[(y * levelWidth + x) * 4]);
+				}
 			}
+			os.write(reinterpret_cast<const char*>(level.data()), level.size());
+		}
+
+		if (!os)
+		{
+			vks::tools::exitFatal("Could not write page file \"" + streaming.pageFilePath + "\"", -1);
 		}
 	}
 
-	VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-	vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-	VkBufferImageCopy region{};
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.layerCount = 1;
-	region.imageSubresource.mipLevel = page.mipLevel;
-	region.imageOffset = page.offset;
-	region.imageExtent = page.extent;
-	vkCmdCopyBufferToImage(copyCmd, imageBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-	vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-	vulkanDevice->flushCommandBuffer(copyCmd, queue);
+	// Pages generated by the loader threads are appended through this stream
+	streaming.pageFileWriter.open(streaming.pageFilePath, std::ios::in | std::ios::out | std::ios::binary);
+	if (!streaming.pageFileWriter.is_open())
+	{
+		vks::tools::exitFatal("Could not open page file \"" + streaming.pageFilePath + "\" for writing", -1);
+	}
+	streaming.pageFileWriter.seekp(0, std::ios::end);
+	streaming.pageFileSize = static_cast<uint64_t>(streaming.pageFileWriter.tellp());
 
-	imageBuffer.destroy();
+	std::cout << "Streaming the virtual texture from \"" << streaming.pageFilePath << "\" (" << streaming.pageFileSize / (1024 * 1024) << " MB, grows up to "
+		<< streaming.completePageFileSize / (1024 * 1024) << " MB as pages are generated on first use)" << std::endl;
 }
-	
-void VulkanExample::fillRandomPages()
+
+// Generates a single page, edge pages are padded to the full page extent
+void VulkanExample::generatePage(const VirtualTexturePage& page, uint8_t* data)
 {
-	vkDeviceWaitIdle(device);
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const uint32_t levelWidth = std::max(texture.width >> page.mipLevel, 1u);
+	const uint32_t levelHeight = std::max(texture.height >> page.mipLevel, 1u);
+	for (uint32_t y = 0; y < granularity.height; y++)
+	{
+		for (uint32_t x = 0; x < granularity.width; x++, data += 4)
+		{
+			if ((x >= page.extent.width) || (y >= page.extent.height))
+			{
+				memset(data, 0, 4);
+				continue;
+			}
+			generateTexel(page.offset.x + x, page.offset.y + y, page.mipLevel, levelWidth, levelHeight, data);
+			// Darken the page borders to visualize the streamed pages
+			if ((x == 0) || (y == 0))
+			{
+				data[0] /= 4;
+				data[1] /= 4;
+				data[2] /= 4;
+			}
+		}
+	}
+}
 
-	std::default_random_engine rndEngine(std::random_device{}());
-	std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+// Called on the loader threads, reads a page from the page file or generates it and appends it to the file if it hasn't been used before
+void VulkanExample::loadPage(uint32_t threadIndex, uint32_t pageIndex, char* destination)
+{
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const uint64_t pageBytes = granularity.width * granularity.height * 4;
 
-	std::vector<VirtualTexturePage> updatedPages;
-	for (auto& page : texture.pages) {
-		if (rndDist(rndEngine) < 0.5f) {
-			continue;
+	uint64_t fileOffset;
+	{
+		std::lock_guard<std::mutex> lock(streaming.pageFileMutex);
+		fileOffset = streaming.pageOffsets[pageIndex];
+	}
+	if (fileOffset != 0)
+	{
+		std::ifstream& stream = streaming.pageFileStreams[threadIndex];
+		stream.clear();
+		stream.seekg(fileOffset);
+		stream.read(destination, pageBytes);
+		if (stream)
+		{
+			return;
 		}
-		page.allocate(device, texture.memoryTypeIndex);
-		updatedPages.push_back(page);
 	}
 
-	// Update sparse queue binding
-	texture.updateSparseBindInfo();
-	VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
-	VkFence fence;
-	VK_CHECK_RESULT(vkCreateFence(device, &fenceInfo, nullptr, &fence));
-	vkQueueBindSparse(queue, 1, &texture.bindSparseInfo, fence);
-	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
-
-	for (auto &page: updatedPages) {
-		uploadContent(page, texture.image);
+	// Generated into system memory, as the staging buffer is write-combined and slow to read back from
+	std::vector<uint8_t> data(pageBytes);
+	generatePage(texture.pages[pageIndex], data.data());
+	memcpy(destination, data.data(), pageBytes);
+
+	std::lock_guard<std::mutex> lock(streaming.pageFileMutex);
+	std::fstream& os = streaming.pageFileWriter;
+	const uint64_t offset = streaming.pageFileSize;
+	os.seekp(offset);
+	os.write(reinterpret_cast<const char*>(data.data()), pageBytes);
+	os.flush();
+	// The table entry is written after the page data, so an interrupted run never leaves an entry pointing to missing data
+	os.seekp(sizeof(PageFileHeader) + pageIndex * sizeof(uint64_t));
+	os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+	os.flush();
+	if (os)
+	{
+		streaming.pageOffsets[pageIndex] = offset;
+		streaming.pageFileSize += pageBytes;
+	}
+	else
+	{
+		// Not fatal, the page is generated again the next time it's needed
+		os.clear();
 	}
 }
 
-void VulkanExample::fillMipTail()
+// Sets up the staging memory and the loader threads that read pages from the page file
+void VulkanExample::prepareStreaming()
 {
-	//@todo: WIP
-	VkDeviceSize imageMipTailSize = texture.sparseImageMemoryRequirements.imageMipTailSize;
-	VkDeviceSize imageMipTailOffset = texture.sparseImageMemoryRequirements.imageMipTailOffset;
-	// Stride between memory bindings for each mip level if not single mip tail (VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT not set)
-	VkDeviceSize imageMipTailStride = texture.sparseImageMemoryRequirements.imageMipTailStride;
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const VkDeviceSize pageBytes = granularity.width * granularity.height * 4;
 
-	VkSparseImageMemoryBind mipTailimageMemoryBind{};
-
-	VkMemoryAllocateInfo allocInfo = vks::initializers::memoryAllocateInfo();
-	allocInfo.allocationSize = imageMipTailSize;
-	allocInfo.memoryTypeIndex = texture.memoryTypeIndex;
-	VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &mipTailimageMemoryBind.memory));
+	// Each page that's being loaded owns one slot of the staging buffer until it has been copied to the image
+	VK_CHECK_RESULT(vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&streaming.stagingBuffer,
+		pageBytes * streaming.stagingSlotCount));
+	VK_CHECK_RESULT(streaming.stagingBuffer.map());
+	for (uint32_t i = streaming.stagingSlotCount; i > 0; i--)
+	{
+		streaming.freeStagingSlots.push_back(i - 1);
+	}
 
-	uint32_t mipLevel = texture.sparseImageMemoryRequirements.imageMipTailFirstLod;
-	uint32_t width = std::max(texture.width >> texture.sparseImageMemoryRequirements.imageMipTailFirstLod, 1u);
-	uint32_t height = std::max(texture.height >> texture.sparseImageMemoryRequirements.imageMipTailFirstLod, 1u);
-	uint32_t depth = 1;
+	const uint32_t threadCount = std::max(std::min(std::thread::hardware_concurrency(), 4u), 1u);
+	streaming.threadPool.setThreadCount(threadCount);
+	streaming.pageFileStreams.resize(threadCount);
+	for (auto& stream : streaming.pageFileStreams)
+	{
+		stream.open(streaming.pageFilePath, std::ios::binary);
+		if (!stream.is_open())
+		{
+			vks::tools::exitFatal("Could not open page file \"" + streaming.pageFilePath + "\"", -1);
+		}
+	}
+}
 
-	for (uint32_t i = texture.mipTailStart; i < texture.mipLevels; i++) {
+// Uploads the mip tail from the page file, the mip tail stays resident for the lifetime of the texture
+void VulkanExample::fillMipTail()
+{
+	if (texture.mipTailStart >= texture.mipLevels)
+	{
+		return;
+	}
 
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize bufferSize = 0;
+	for (uint32_t i = texture.mipTailStart; i < texture.mipLevels; i++)
+	{
 		const uint32_t width = std::max(texture.width >> i, 1u);
 		const uint32_t height = std::max(texture.height >> i, 1u);
-		const uint32_t depth = 1;
-
-		// Generate some random image data and upload as a buffer
-		const size_t bufferSize = 4 * width * height;
-
-		vks::Buffer imageBuffer;
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&imageBuffer,
-			bufferSize));
-		imageBuffer.map();
-
-		// Fill buffer with random colors
-		std::random_device rd;
-		std::mt19937 rndEngine(rd());
-		std::uniform_int_distribution<uint32_t> rndDist(0, 255);
-		uint8_t* data = (uint8_t*)imageBuffer.mapped;
-		uint8_t rndVal[4] = { 0, 0, 0, 0 };
-		while (rndVal[0] + rndVal[1] + rndVal[2] < 10) {
-			rndVal[0] = (uint8_t)rndDist(rndEngine);
-			rndVal[1] = (uint8_t)rndDist(rndEngine);
-			rndVal[2] = (uint8_t)rndDist(rndEngine);
-		}
-		rndVal[3] = 255;
-
-		switch (mipLevel) {
-		case 0:
-			rndVal[0] = rndVal[1] = rndVal[2] = 255;
-			break;
-		case 1:
-			rndVal[0] = rndVal[1] = rndVal[2] = 200;
-			break;
-		case 2:
-			rndVal[0] = rndVal[1] = rndVal[2] = 150;
-			break;
-		}
-
-		for (uint32_t y = 0; y < height; y++)
-		{
-			for (uint32_t x = 0; x < width; x++)
-			{
-				for (uint32_t c = 0; c < 4; c++, ++data)
-				{
-					*data = rndVal[c];
-				}
-			}
-		}
-
-		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 		VkBufferImageCopy region{};
+		region.bufferOffset = bufferSize;
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		region.imageSubresource.layerCount = 1;
 		region.imageSubresource.mipLevel = i;
 		region.imageOffset = {};
-		region.imageExtent = { width, height, depth };
-		vkCmdCopyBufferToImage(copyCmd, imageBuffer.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-		vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-		vulkanDevice->flushCommandBuffer(copyCmd, queue);
+		region.imageExtent = { width, height, 1 };
+		regions.push_back(region);
+		bufferSize += width * height * 4;
+	}
 
-		imageBuffer.destroy();
+	vks::Buffer imageBuffer;
+	VK_CHECK_RESULT(vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&imageBuffer,
+		bufferSize));
+	VK_CHECK_RESULT(imageBuffer.map());
+
+	std::ifstream is(streaming.pageFilePath, std::ios::binary);
+	is.seekg(sizeof(PageFileHeader) + streaming.header.pageCount * sizeof(uint64_t));
+	is.read(reinterpret_cast<char*>(imageBuffer.mapped), bufferSize);
+	if (!is)
+	{
+		vks::tools::exitFatal("Could not read the mip tail from \"" + streaming.pageFilePath + "\"", -1);
 	}
+
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, texture.layerCount };
+	VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	vkCmdCopyBufferToImage(copyCmd, imageBuffer.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	vulkanDevice->flushCommandBuffer(copyCmd, queue);
+
+	imageBuffer.destroy();
 }
 
-void VulkanExample::flushRandomPages()
+// Updates the sparse memory bindings of the given pages with a single queue operation
+void VulkanExample::bindSparsePages(const std::vector<VirtualTexturePage*>& pages)
 {
-	vkDeviceWaitIdle(device);
+	if (pages.empty())
+	{
+		return;
+	}
+	texture.updateSparseBindInfo(pages);
+	VK_CHECK_RESULT(vkQueueBindSparse(queue, 1, &texture.bindSparseInfo, bindSparseFence));
+	VK_CHECK_RESULT(vkWaitForFences(device, 1, &bindSparseFence, VK_TRUE, UINT64_MAX));
+	VK_CHECK_RESULT(vkResetFences(device, 1, &bindSparseFence));
+}
 
-	std::default_random_engine rndEngine(std::random_device{}());
-	std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+// Evicts the least recently used resident page, pages used by the current frame are only evicted if keepVisible is false
+bool VulkanExample::evictLeastRecentlyUsedPage(bool keepVisible)
+{
+	if (texture.lruPages.empty())
+	{
+		return false;
+	}
+	VirtualTexturePage& page = texture.pages[texture.lruPages.back()];
+	if (keepVisible && (page.lastUsedFrame == uboVS.frameIndex))
+	{
+		return false;
+	}
+	texture.lruPages.pop_back();
+	page.release(texture.pagePool);
+	// The page is unbound with the next sparse binding operation
+	streaming.evictedPages.push_back(&page);
+	stats.evictedPages++;
+	return true;
+}
 
-	std::vector<VirtualTexturePage> updatedPages;
+// Gathers the pages sampled by the last frame from the feedback buffer and starts loading the ones that are not resident
+void VulkanExample::requestPages()
+{
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const VkDeviceSize pageBytes = granularity.width * granularity.height * 4;
+	const uint32_t* feedback = reinterpret_cast<const uint32_t*>(feedbackBuffer.mapped);
+
+	std::vector<VirtualTexturePage*> requests;
+	stats.requestedPages = 0;
 	for (auto& page : texture.pages)
 	{
-		if (rndDist(rndEngine) < 0.5f) {
+		if (feedbackStreaming && (feedback[page.index] != uboVS.frameIndex))
+		{
 			continue;
 		}
-		page.release(device);
+		stats.requestedPages++;
+		page.lastUsedFrame = uboVS.frameIndex;
+		if (page.state == PageState::Resident)
+		{
+			texture.lruPages.splice(texture.lruPages.begin(), texture.lruPages, page.lruPosition);
+		}
+		if (page.state == PageState::NonResident)
+		{
+			requests.push_back(&page);
+		}
 	}
 
-	// Update sparse queue binding
-	texture.updateSparseBindInfo();
-	VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
-	VkFence fence;
-	VK_CHECK_RESULT(vkCreateFence(device, &fenceInfo, nullptr, &fence));
-	vkQueueBindSparse(queue, 1, &texture.bindSparseInfo, fence);
-	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+	// Coarse levels are loaded first as they cover larger areas and serve as the fallback for finer levels
+	std::sort(requests.begin(), requests.end(), [](const VirtualTexturePage* a, const VirtualTexturePage* b) { return a->mipLevel > b->mipLevel; });
+
+	for (auto page : requests)
+	{
+		if (streaming.freeStagingSlots.empty())
+		{
+			break;
+		}
+		// Once the memory budget is exhausted, pages that are not visible anymore are evicted to make room
+		bool allocated = page->allocate(texture.pagePool);
+		while (!allocated && evictLeastRecentlyUsedPage(true))
+		{
+			allocated = page->allocate(texture.pagePool);
+		}
+		if (!allocated)
+		{
+			break;
+		}
+		page->state = PageState::Loading;
+		page->stagingSlot = streaming.freeStagingSlots.back();
+		streaming.freeStagingSlots.pop_back();
+		stats.loadsInFlight++;
+
+		// Read the page on one of the loader threads
+		const uint32_t threadIndex = streaming.nextThread;
+		streaming.nextThread = (streaming.nextThread + 1) % static_cast<uint32_t>(streaming.threadPool.threads.size());
+		const uint32_t pageIndex = page->index;
+		char* destination = reinterpret_cast<char*>(streaming.stagingBuffer.mapped) + page->stagingSlot * pageBytes;
+		streaming.threadPool.threads[threadIndex]->addJob([this, threadIndex, pageIndex, destination] {
+			loadPage(threadIndex, pageIndex, destination);
+			std::lock_guard<std::mutex> lock(streaming.completedMutex);
+			streaming.completedPages.push_back(pageIndex);
+		});
+	}
+
+	// Evicted pages need to be unbound before their memory is bound to other pages
+	bindSparsePages(streaming.evictedPages);
+	streaming.evictedPages.clear();
+}
+
+// Binds the memory of all pages that finished loading and copies their data from the staging buffer to the image
+void VulkanExample::uploadCompletedPages()
+{
+	std::vector<uint32_t> completedPages;
+	{
+		std::lock_guard<std::mutex> lock(streaming.completedMutex);
+		completedPages.swap(streaming.completedPages);
+	}
+	if (completedPages.empty())
+	{
+		return;
+	}
+
+	const VkExtent3D granularity = texture.sparseImageMemoryRequirements.formatProperties.imageGranularity;
+	const VkDeviceSize pageBytes = granularity.width * granularity.height * 4;
+
+	std::vector<VirtualTexturePage*> pages;
+	std::vector<VkBufferImageCopy> regions;
+	for (auto index : completedPages)
+	{
+		VirtualTexturePage& page = texture.pages[index];
+		pages.push_back(&page);
+		VkBufferImageCopy region{};
+		region.bufferOffset = page.stagingSlot * pageBytes;
+		region.bufferRowLength = granularity.width;
+		region.bufferImageHeight = granularity.height;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = page.mipLevel;
+		region.imageSubresource.baseArrayLayer = page.layer;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = page.offset;
+		region.imageExtent = page.extent;
+		regions.push_back(region);
+	}
+
+	bindSparsePages(pages);
+
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, texture.layerCount };
+	VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	vkCmdCopyBufferToImage(copyCmd, streaming.stagingBuffer.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	vks::tools::setImageLayout(copyCmd, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	vulkanDevice->flushCommandBuffer(copyCmd, queue);
+
+	for (auto page : pages)
+	{
+		page->state = PageState::Resident;
+		texture.lruPages.push_front(page->index);
+		page->lruPosition = texture.lruPages.begin();
+		streaming.freeStagingSlots.push_back(page->stagingSlot);
+	}
+	stats.loadsInFlight -= static_cast<uint32_t>(pages.size());
+	stats.uploadedPages += static_cast<uint32_t>(pages.size());
+}
+
+void VulkanExample::updateVirtualTexture()
+{
+	requestPages();
+	uploadCompletedPages();
+	// Advancing the frame index tells requests of the next frame apart from older ones without having to clear the feedback buffer
+	uboVS.frameIndex++;
+	updateUniformBuffers();
+}
+
+// Evicts all resident pages, visible pages are streamed in again over the next frames
+void VulkanExample::flushPages()
+{
+	vkDeviceWaitIdle(device);
+	while (evictLeastRecentlyUsedPage(false)) {}
+	bindSparsePages(streaming.evictedPages);
+	streaming.evictedPages.clear();
 }
 
 void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay* overlay)
@@ -895,20 +1264,25 @@ void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay* overlay)
 		if (overlay->sliderFloat("LOD bias", &uboVS.lodBias, -(float)texture.mipLevels, (float)texture.mipLevels)) {
 			updateUniformBuffers();
 		}
-		if (overlay->button("Fill random pages")) {
-			fillRandomPages();
-		}
-		if (overlay->button("Flush random pages")) {
-			flushRandomPages();
-		}
-		if (overlay->button("Fill mip tail")) {
-			fillMipTail();
+		if (overlay->button("Flush pages")) {
+			flushPages();
 		}
 	}
 	if (overlay->header("Statistics")) {
-		uint32_t respages = 0;
-		std::for_each(texture.pages.begin(), texture.pages.end(), [&respages](VirtualTexturePage page) { respages += (page.resident()) ? 1 : 0; });
-		overlay->text("Resident pages: %d of %d", respages, static_cast<uint32_t>(texture.pages.size()));
+		const uint32_t pageSizeKB = static_cast<uint32_t>(texture.pagePool.pageSize / 1024);
+		overlay->text("Resident pages: %d of %d", static_cast<uint32_t>(texture.lruPages.size()), static_cast<uint32_t>(texture.pages.size()));
+		overlay->text("Requested pages: %d (%s)", stats.requestedPages, feedbackStreaming ? "GPU feedback" : "all pages");
+		overlay->text("Loads in flight: %d", stats.loadsInFlight);
+		overlay->text("Uploaded pages: %d", stats.uploadedPages);
+		overlay->text("Evicted pages: %d", stats.evictedPages);
+		overlay->text("Page memory: %d of %d MB", texture.pagePool.usedPages * pageSizeKB / 1024, texture.pagePool.maxPages * pageSizeKB / 1024);
+		overlay->text("Virtual size: %d MB", static_cast<uint32_t>(texture.pages.size()) * pageSizeKB / 1024);
+		uint64_t pageFileSize;
+		{
+			std::lock_guard<std::mutex> lock(streaming.pageFileMutex);
+			pageFileSize = streaming.pageFileSize;
+		}
+		overlay->text("Page file: %d of %d MB", static_cast<uint32_t>(pageFileSize / (1024 * 1024)), static_cast<uint32_t>(streaming.completePageFileSize / (1024 * 1024)));
 		overlay->text("Mip tail starts at: %d", texture.mipTailStart);
 	}
 
@@ -13,8 +13,39 @@
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
 
+#include <list>
+#include <fstream>
+#include "threadpool.hpp"
+
 #define ENABLE_VALIDATION false
 
+// Residency state of a virtual page
+enum class PageState { NonResident, Loading, Resident };
+
+// Pooled device memory the virtual pages are sub-allocated from
+// Memory is allocated in blocks of pagesPerBlock pages instead of one allocation per page, the number of pages in use is capped by the memory budget
+struct PagePool
+{
+	VkDevice device;
+	VkDeviceSize pageSize;												// Size of a single page (sparse block alignment)
+	uint32_t memoryTypeIndex;
+	uint32_t pagesPerBlock = 64;
+	uint32_t maxPages;													// Memory budget in pages
+	std::vector<VkDeviceMemory> blocks;
+	// Free page slots in the allocated blocks
+	struct Slot {
+		VkDeviceMemory memory;
+		VkDeviceSize offset;
+	};
+	std::vector<Slot> freeSlots;
+	uint32_t usedPages = 0;
+
+	void create(VkDevice device, VkDeviceSize pageSize, uint32_t memoryTypeIndex, VkDeviceSize memoryBudget);
+	bool allocate(VkDeviceMemory& memory, VkDeviceSize& offset);
+	void free(VkDeviceMemory memory, VkDeviceSize offset);
+	void destroy();
+};
+
 // Virtual texture page as a part of the partially resident texture
 // Contains memory bindings, offsets and status information
 struct VirtualTexturePage
@@ -26,11 +57,15 @@ struct VirtualTexturePage
 	uint32_t mipLevel;													// Mip level that this page belongs to
 	uint32_t layer;														// Array layer that this page belongs to
 	uint32_t index;
+	PageState state = PageState::NonResident;
+	uint32_t lastUsedFrame = 0;											// Last frame this page has been requested by the feedback buffer
+	uint32_t stagingSlot = 0;											// Staging buffer slot the page is loaded into
+	std::list<uint32_t>::iterator lruPosition;							// Position in the LRU list (resident pages only)
 
 	VirtualTexturePage();
 	bool resident();
-	void allocate(VkDevice device, uint32_t memoryTypeIndex);
-	void release(VkDevice device);
+	bool allocate(PagePool& pool);
+	void release(PagePool& pool);
 };
 
 // Virtual texture object containing all pages
@@ -40,13 +75,15 @@ struct VirtualTexture
 	VkImage image;														// Texture image handle
 	VkBindSparseInfo bindSparseInfo;									// Sparse queue binding information
 	std::vector<VirtualTexturePage> pages;								// Contains all virtual pages of the texture
-	std::vector<VkSparseImageMemoryBind> sparseImageMemoryBinds;		// Sparse image memory bindings of all memory-backed virtual tables
+	std::vector<VkSparseImageMemoryBind> sparseImageMemoryBinds;		// Sparse image memory bindings of all pages changed since the last bind
 	std::vector<VkSparseMemoryBind>	opaqueMemoryBinds;					// Sparse ópaque memory bindings for the mip tail (if present)
 	VkSparseImageMemoryBindInfo imageMemoryBindInfo;					// Sparse image memory bind info
 	VkSparseImageOpaqueMemoryBindInfo opaqueMemoryBindInfo;				// Sparse image opaque memory bind info (mip tail)
 	uint32_t mipTailStart;												// First mip level in mip tail
 	VkSparseImageMemoryRequirements sparseImageMemoryRequirements;		// @todo: Comment
 	uint32_t memoryTypeIndex;											// @todo: Comment
+	PagePool pagePool;													// Pooled memory backing the resident pages
+	std::list<uint32_t> lruPages;										// Indices of resident pages, most recently used first
 
 	// @todo: comment
 	struct MipTailInfo {
@@ -55,11 +92,28 @@ struct VirtualTexture
 	} mipTailInfo;
 
 	VirtualTexturePage *addPage(VkOffset3D offset, VkExtent3D extent, const VkDeviceSize size, const uint32_t mipLevel, uint32_t layer);
-	void updateSparseBindInfo();
+	void updateSparseBindInfo(const std::vector<VirtualTexturePage*>& bindingChangedPages, bool bindMipTail = false);
 	// @todo: replace with dtor?
 	void destroy();
 };
 
+// Header of the tiled file the virtual texture is streamed from
+// The header is followed by the file offset of every page outside of the mip tail (in the same order as VirtualTexture::pages, 0 if the page
+// hasn't been generated yet) and the tightly packed mip tail levels
+// Pages are appended in the order they are first requested, each padded to the full page extent
+struct PageFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t mipTailStart;
+	uint32_t pageWidth;
+	uint32_t pageHeight;
+	uint32_t pageCount;
+};
+
 class VulkanExample : public VulkanExampleBase
 {
 public:
@@ -82,17 +136,59 @@ public:
 		glm::mat4 model;
 		glm::vec4 viewPos;
 		float lodBias = 0.0f;
+		// Feedback pass parameters, the fragment shader tags every page it samples with the current frame index
+		uint32_t frameIndex = 1;
+		glm::ivec2 pageExtent;
+		int32_t mipTailStart;
 	} uboVS;
 	vks::Buffer uniformBufferVS;
 
+	// Page request feedback written by the fragment shader, one frame index per virtual page
+	vks::Buffer feedbackBuffer;
+	// If the feedback shader is not available, all pages are requested (coarse to fine) until the memory budget is reached
+	bool feedbackStreaming = false;
+
+	// Streaming of pages from the tiled page file
+	struct {
+		std::string pageFilePath;
+		PageFileHeader header;
+		VkDeviceSize memoryBudget = 32 * 1024 * 1024;
+		// Loads are limited by the number of staging slots, so the staging memory is fixed too
+		uint32_t stagingSlotCount = 64;
+		vks::Buffer stagingBuffer;
+		std::vector<uint32_t> freeStagingSlots;
+		// One reader per loader thread
+		vks::ThreadPool threadPool;
+		std::vector<std::ifstream> pageFileStreams;
+		// Pages are generated on first use and appended to the page file, all of these are guarded by pageFileMutex
+		std::mutex pageFileMutex;
+		std::fstream pageFileWriter;
+		std::vector<uint64_t> pageOffsets;
+		uint64_t pageFileSize = 0;
+		// Size of the page file once all pages have been generated
+		uint64_t completePageFileSize = 0;
+		uint32_t nextThread = 0;
+		// Pages whose data has been loaded into their staging slot
+		std::mutex completedMutex;
+		std::vector<uint32_t> completedPages;
+		// Pages evicted since the last sparse bind
+		std::vector<VirtualTexturePage*> evictedPages;
+	} streaming;
+
+	struct {
+		uint32_t requestedPages = 0;
+		uint32_t loadsInFlight = 0;
+		uint32_t uploadedPages = 0;
+		uint32_t evictedPages = 0;
+	} stats;
+
+	VkFence bindSparseFence = VK_NULL_HANDLE;
+
 	VkPipeline pipeline;
 	VkPipelineLayout pipelineLayout;
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
-	//todo: comment
-	VkSemaphore bindSparseSemaphore = VK_NULL_HANDLE;
-
 	VulkanExample();
 	~VulkanExample();
 	virtual void getEnabledFeatures();
@@ -111,9 +207,17 @@ public:
 	void updateUniformBuffers();
 	void prepare();
 	virtual void render();
-	void uploadContent(VirtualTexturePage page, VkImage image);
-	void fillRandomPages();
+	static void generateTexel(uint32_t x, uint32_t y, uint32_t mipLevel, uint32_t levelWidth, uint32_t levelHeight, uint8_t* texel);
+	void preparePageFile();
+	void generatePage(const VirtualTexturePage& page, uint8_t* data);
+	void loadPage(uint32_t threadIndex, uint32_t pageIndex, char* destination);
+	void prepareStreaming();
 	void fillMipTail();
-	void flushRandomPages();
+	void bindSparsePages(const std::vector<VirtualTexturePage*>& pages);
+	bool evictLeastRecentlyUsedPage(bool keepVisible);
+	void requestPages();
+	void uploadCompletedPages();
+	void updateVirtualTexture();
+	void flushPages();
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay);
 };